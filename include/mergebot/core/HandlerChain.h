@@ -28,7 +28,9 @@ public:
     ConflictBlockCount = countConflictBlocks();
     spdlog::info("there are {} conflict blocks in this merge scenario",
                  ConflictBlockCount);
-    if (ConflictBlockCount) {
+    if (ConflictBlockCount && pipelined()) {
+      handlePipelined();
+    } else if (ConflictBlockCount) {
       Handlers_[0]->handle(ConflictFiles_);
     }
     int AfterResolveCount = countConflictBlocks();
@@ -44,7 +46,16 @@ public:
                       ConflictBlockCount - AfterResolveCount);
   }
 
+  /// pipelined mode is on by default, set env `MERGEBOT_PIPELINED=0` to run
+  /// every handler over all the conflict files before the next one starts
+  static bool pipelined();
+
 private:
+  /// per-file handlers run on each conflict file as soon as it's picked up,
+  /// publishing its block resolutions right away; files with blocks left are
+  /// then handed to the rest of the chain as a batch, as the AST based
+  /// analysis shares graphs across conflict files
+  void handlePipelined();
   void writeResolveRatio(int cbCnt, int resolvedCnt);
   int ConflictBlockCount = 0;
   void chain();
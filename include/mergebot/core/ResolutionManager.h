@@ -6,6 +6,8 @@
 #define MB_RESOLUTIONMANAGER_H
 
 #include "HandlerChain.h"
+#include "mergebot/core/ResolutionScheduler.h"
+#include "mergebot/core/SparseCheckout.h"
 #include "mergebot/core/model/MergeScenario.h"
 #include "mergebot/filesystem.h"
 #include "mergebot/globals.h"
@@ -15,6 +17,7 @@
 #include <llvm/ADT/StringSet.h>
 #include <llvm/Support/Error.h>
 #include <memory>
+#include <optional>
 #include <string>
 
 namespace mergebot {
@@ -44,6 +47,13 @@ public:
     return HomePath / projectCheckSum();
   }
 
+  /// get current project's blob store, where blobs of all the dumped revisions
+  /// are deduplicated by OID, in the following form:
+  /// /home/whalien/.mergebot/f690cc3bcbb89d40a7e484ff47e38baad3f55a5a/blobs
+  std::string blobStoreDir() const {
+    return fs::path(projectCacheDir()) / "blobs";
+  }
+
   /// get current merge scenario of current project's cache dir, in the
   /// following form:
   /// /home/whalien/.mergebot/f690cc3bcbb89d40a7e484ff47e38baad3f55a5a/b9b352-fa24d4
@@ -77,19 +87,21 @@ public:
   /// Scenario \return string representation of MergeScenario
   std::string mergeScenario() const noexcept { return MS_.toString(); };
 
-  void doResolution();
+  /// submit the resolution of current merge scenario to the scheduler
+  /// \param Priority jobs of higher priority are dequeued first
+  /// \return ticket of the scheduled job, std::nullopt if the queue is full
+  std::optional<JobTicket> doResolution(int Priority = 0);
 
 private:
-  const static std::string CompDBRelative;
-
-  static bool fineTuneCompDB(const std::string &CompDBPath,
-                             const std::string &ProjPath,
-                             const std::string &OrigPath);
   static void
   _doResolutionAsync(std::shared_ptr<ResolutionManager> const &Self);
+  /// dump sources of CommitHash to SourceDest
+  /// \param Checkout if not null, only SparsePaths are materialized by it
   static void prepareSource(std::shared_ptr<ResolutionManager> const &Self,
                             std::string const &CommitHash,
-                            std::string const &SourceDest);
+                            std::string const &SourceDest,
+                            std::shared_ptr<SparseCheckout> const &Checkout,
+                            std::vector<std::string> const &SparsePaths);
 
   //  std::vector<std::string> _extractCppSources();
 
@@ -0,0 +1,102 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_RESOLUTIONSCHEDULER_H
+#define MB_INCLUDE_MERGEBOT_CORE_RESOLUTIONSCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+/// where a submitted resolution job stands
+struct JobTicket {
+  /// 0 if the job is running, otherwise its 1-based position in the queue
+  size_t Position = 0;
+  /// estimated seconds until the job finishes
+  double ETASeconds = 0;
+  /// the submission was merged into an identical queued or running job
+  bool Coalesced = false;
+};
+
+/// Runs resolution jobs on a fixed number of workers.
+///
+/// Jobs are ordered by priority (higher first), then by submission order.
+/// Submissions beyond MaxPending queued jobs are rejected, and a submission
+/// whose key is already queued or running is coalesced into that job. Each job
+/// executes inside its own tbb::task_arena, so the TBB parallelism a single
+/// merge scenario can occupy is capped by ArenaConcurrency.
+class ResolutionScheduler {
+public:
+  using Job = std::function<void()>;
+
+  struct Options {
+    unsigned Workers = 1;
+    unsigned ArenaConcurrency = 1;
+    size_t MaxPending = 32;
+  };
+
+  explicit ResolutionScheduler(Options Opts);
+  ~ResolutionScheduler();
+
+  ResolutionScheduler(const ResolutionScheduler &) = delete;
+  ResolutionScheduler &operator=(const ResolutionScheduler &) = delete;
+
+  /// the process wide scheduler, configured via env `MERGEBOT_MAX_JOBS`,
+  /// `MERGEBOT_JOB_CONCURRENCY` and `MERGEBOT_MAX_PENDING_JOBS`
+  static ResolutionScheduler &instance();
+
+  /// enqueue a job identified by Key
+  /// \return ticket of the job, std::nullopt if the queue is full
+  std::optional<JobTicket> submit(const std::string &Key, Job Work,
+                                  int Priority = 0);
+
+  /// \return ticket of the queued or running job identified by Key
+  std::optional<JobTicket> query(const std::string &Key) const;
+
+  size_t pending() const;
+  size_t running() const;
+  /// jobs finished by throwing, of any type, so far
+  size_t failed() const;
+  const Options &options() const noexcept { return Opts_; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct PendingJob {
+    std::string Key;
+    int Priority = 0;
+    Job Work;
+  };
+
+  void workerLoop();
+  /// caller must hold Mutex_
+  std::optional<JobTicket> ticketOf(const std::string &Key) const;
+
+  Options Opts_;
+  std::vector<std::thread> Workers_;
+
+  mutable std::mutex Mutex_;
+  std::condition_variable CV_;
+  /// sorted by priority desc, FIFO within the same priority
+  std::deque<PendingJob> Queue_;
+  std::unordered_map<std::string, Clock::time_point> Running_;
+  size_t Failed_ = 0;
+  /// exponential moving average of job durations, in seconds
+  double AvgSeconds_ = 60;
+  bool Stopped_ = false;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_RESOLUTIONSCHEDULER_H
@@ -0,0 +1,115 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_SCENARIOCACHE_H
+#define MB_INCLUDE_MERGEBOT_CORE_SCENARIOCACHE_H
+
+#include "mergebot/core/model/MergeScenario.h"
+#include "mergebot/filesystem.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+/// Persistent, content-addressed store of resolution results.
+///
+/// Entries live in MBDIR/cache/<key>, where key is derived from the commit
+/// OIDs of a merge scenario (ours, theirs and merge base) and the digest of
+/// the CompDB it's analyzed with. As commit OIDs transitively address every
+/// tree and blob of the revisions, two requests sharing the same key are
+/// guaranteed to see identical sources and compile commands, so their
+/// `resolutions/` and `merged/` output can be reused verbatim, regardless of
+/// which project checkout or scenario directory they come from.
+///
+/// The store survives server restarts: `load()` validates the entries found on
+/// disk instead of wiping them. Total size is capped, least recently used
+/// entries are evicted first. Finished merge scenario dirs, which clients
+/// fetch results from, are counted in the cap and evicted the same way.
+class ScenarioCache {
+public:
+  /// \param Root directory holding cache entries
+  /// \param Capacity size cap in bytes, 0 means unlimited
+  /// \param ScenariosRoot if not empty, finished merge scenario dirs found in
+  /// ScenariosRoot/<project>/ are counted in the cap on load
+  ScenarioCache(fs::path Root, uint64_t Capacity, fs::path ScenariosRoot = {});
+
+  /// the process wide cache rooted at MBDIR/cache, whose capacity can be
+  /// configured via env `MERGEBOT_CACHE_CAP_MB` (defaults to 8192MB)
+  static ScenarioCache &instance();
+
+  /// scan Root, drop broken or partially written entries, rebuild the LRU
+  /// order from persisted access times and shrink to capacity
+  void load();
+
+  /// copy the cached `resolutions/` and `merged/` of MS into MSCacheDir.
+  /// \param CompDB digest of the CompDB, see compDBDigest
+  /// \param Files relative paths of conflict files to be resolved
+  /// \return true if there is an entry covering all the Files
+  bool restore(const MergeScenario &MS, const std::string &CompDB,
+               const std::vector<std::string> &Files,
+               const std::string &MSCacheDir);
+
+  /// save `resolutions/` and `merged/` of MSCacheDir as the entry of MS
+  /// \return true if the entry is committed to the cache
+  bool publish(const MergeScenario &MS, const std::string &CompDB,
+               const std::vector<std::string> &Files,
+               const std::string &MSCacheDir);
+
+  /// count the finished merge scenario dir \p MSCacheDir in the cap. It's
+  /// removed as a whole when evicted, unless it's being resolved again
+  void track(const std::string &MSCacheDir);
+
+  /// \return cache key of MS analyzed with the CompDB of digest \p CompDB,
+  /// empty if the merge base is unknown
+  static std::string keyOf(const MergeScenario &MS, const std::string &CompDB);
+
+  /// \return digest of the path and content of the CompDB at \p CompDBPath,
+  /// empty if there is none
+  static std::string compDBDigest(const std::string &CompDBPath);
+
+  uint64_t size() const;
+  size_t entryCount() const;
+
+private:
+  struct Entry {
+    MergeScenario MS;
+    std::string CompDB;
+    uint64_t Size = 0;
+    int64_t LastAccess = 0;
+    std::vector<std::string> Files;
+  };
+
+  /// a finished merge scenario dir
+  struct Scenario {
+    uint64_t Size = 0;
+    int64_t LastAccess = 0;
+  };
+
+  static constexpr const char *MetaFile = "entry.json";
+
+  static bool writeMeta(const fs::path &EntryDir, const Entry &E);
+  void loadScenarios();
+  void evictIfNeeded();
+  /// strictly increasing access stamp, in milliseconds since epoch
+  int64_t tick();
+
+  fs::path Root_;
+  uint64_t Capacity_;
+  fs::path ScenariosRoot_;
+  /// of entries and scenario dirs
+  uint64_t Size_ = 0;
+  int64_t Clock_ = 0;
+  std::unordered_map<std::string, Entry> Entries_;
+  /// keyed by path
+  std::unordered_map<std::string, Scenario> Scenarios_;
+  mutable std::mutex Mutex_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_SCENARIOCACHE_H
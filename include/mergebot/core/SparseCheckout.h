@@ -0,0 +1,95 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_SPARSECHECKOUT_H
+#define MB_INCLUDE_MERGEBOT_CORE_SPARSECHECKOUT_H
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+/// Materializes a revision on demand instead of dumping its whole tree.
+///
+/// Only the paths the analysis asks for are written to Dest, together with
+/// their header/source counterparts and the closure of the project headers
+/// they include, so that clangd can still switch between header and source
+/// and parse them as in a full checkout. Includes are resolved against the
+/// includer's dir, the include dirs of the CompDB and the repo root, until no
+/// more file of the revision turns up. Later requests expand the working set
+/// lazily, thus preparation cost scales with the conflict size rather than
+/// the repository size.
+///
+/// Headers reached only through generated files, or through include dirs
+/// outside the repo, are not found, and cross-TU references still see only
+/// the working set. That's why it's opt-in.
+class SparseCheckout {
+public:
+  /// \param BlobStore see util::dump_tree_paths_to, empty to write private
+  /// copies
+  SparseCheckout(std::string RepoPath, std::string CommitHash,
+                 std::string Dest, std::string BlobStore = "")
+      : RepoPath_(std::move(RepoPath)), CommitHash_(std::move(CommitHash)),
+        Dest_(std::move(Dest)), BlobStore_(std::move(BlobStore)) {}
+
+  /// sparse mode is off by default, set env `MERGEBOT_SPARSE_CHECKOUT=1` to
+  /// materialize revisions on demand
+  static bool enabled();
+
+  /// dirs (relative to the repo root) angle and quoted includes are looked
+  /// up in, besides the repo root. Takes effect on later materializations.
+  void setIncludeDirs(std::vector<std::string> IncludeDirs);
+
+  /// make sure Paths (relative to the repo root) and their neighborhood exist
+  /// in Dest. Paths absent in this revision are ignored.
+  /// \return false if the commit cannot be read
+  bool materialize(const std::vector<std::string> &Paths);
+
+  /// convenient overload for a single path
+  bool materialize(const std::string &Path) {
+    return materialize(std::vector<std::string>{Path});
+  }
+
+  const std::string &dest() const noexcept { return Dest_; }
+  const std::string &commitHash() const noexcept { return CommitHash_; }
+  /// number of files written (or found) in Dest so far
+  size_t size() const;
+
+  /// candidates of header/source counterparts of Path, e.g. a/b.cpp ->
+  /// [a/b.h, a/b.hpp, ...]
+  static std::vector<std::string> counterpartsOf(const std::string &Path);
+  /// candidates of the includes in Content of file at Path, relative to the
+  /// repo root: quoted ones in the includer's dir first, then both kinds in
+  /// each of IncludeDirs and the repo root
+  static std::vector<std::string>
+  includesOf(const std::string &Path, const std::string &Content,
+             const std::vector<std::string> &IncludeDirs = {});
+  /// include dirs (`-I`, `-iquote`, `-isystem`) of a compile command run in
+  /// Directory with Arguments, relative to ProjectRoot. Dirs outside of it
+  /// are dropped.
+  static std::vector<std::string>
+  includeDirsOf(const std::vector<std::string> &Arguments,
+                const std::string &Directory, const std::string &ProjectRoot);
+
+private:
+  std::string RepoPath_;
+  std::string CommitHash_;
+  std::string Dest_;
+  std::string BlobStore_;
+
+  mutable std::mutex Mutex_;
+  std::vector<std::string> IncludeDirs_;
+  /// paths requested by callers, already expanded
+  std::unordered_set<std::string> Requested_;
+  /// paths existing in Dest
+  std::unordered_set<std::string> Materialized_;
+  /// include candidates looked up in the commit, found or not
+  std::unordered_set<std::string> Probed_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_SPARSECHECKOUT_H
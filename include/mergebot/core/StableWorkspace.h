@@ -0,0 +1,84 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_STABLEWORKSPACE_H
+#define MB_INCLUDE_MERGEBOT_CORE_STABLEWORKSPACE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mergebot {
+namespace sa {
+/// A per-project, per-side directory that the sources of each merge scenario
+/// are rotated into before clangd sees them.
+///
+/// Sources of a scenario live in a fresh `MSCacheDir/<side>`, so clangd's
+/// preambles and its on-disk background index, both keyed by absolute paths,
+/// never hit across scenarios of the same project. The stable root mirrors
+/// the side dir of the current scenario: files of the same content are left
+/// untouched, others are hard linked (or copied) in, and files the scenario
+/// doesn't have are dropped. A root is leased by one scenario at a time, the
+/// others fall back to their own side dirs.
+class StableWorkspace {
+public:
+  /// on by default, set env `MERGEBOT_STABLE_WORKSPACE=0` to let clangd work
+  /// in side dirs of scenarios as before
+  static bool enabled();
+
+  /// lease the stable root of side \p SideName in \p ProjectCacheDir, which
+  /// mirrors \p SourceDir
+  /// \return nullptr if the root is leased by another scenario, or cannot be
+  /// created
+  static std::unique_ptr<StableWorkspace> lease(const std::string &ProjectCacheDir,
+                                                std::string_view SideName,
+                                                std::string SourceDir);
+
+  /// the clangd cache dir (XDG_CACHE_HOME) of the project, its index is
+  /// pruned least recently written first to `MERGEBOT_CLANGD_INDEX_MB` (1024
+  /// by default) before it's handed out
+  static std::string indexDir(const std::string &ProjectCacheDir);
+
+  /// remove the least recently written files of \p Dir until it takes at most
+  /// \p CapBytes
+  /// \return bytes removed
+  static uintmax_t prune(const std::string &Dir, uintmax_t CapBytes);
+
+  StableWorkspace(const StableWorkspace &) = delete;
+  StableWorkspace &operator=(const StableWorkspace &) = delete;
+  ~StableWorkspace();
+
+  /// bring files of the side dir into the root. \p Generation tells whether
+  /// the side dir may have grown since the last sync, e.g. the size of a
+  /// sparse checkout; nothing is done if it's unchanged. Thread safe
+  void sync(size_t Generation);
+
+  const std::string &root() const noexcept { return Root_; }
+
+private:
+  StableWorkspace(std::string Root, std::string SourceDir, int LockFd)
+      : Root_(std::move(Root)), SourceDir_(std::move(SourceDir)),
+        LockFd_(LockFd) {}
+
+  /// drop files of previous scenarios absent in the side dir
+  void dropStale();
+  /// make Root_/RelPath the same as SourceDir_/RelPath
+  bool mirror(const std::string &RelPath);
+
+  std::string Root_;
+  std::string SourceDir_;
+  int LockFd_;
+  std::mutex Mutex_;
+  bool Synced_ = false;
+  size_t Generation_ = 0;
+  /// size of the source file of each mirrored path
+  std::unordered_map<std::string, uintmax_t> Mirrored_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_STABLEWORKSPACE_H
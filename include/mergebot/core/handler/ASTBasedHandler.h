@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "mergebot/core/model/ConflictFile.h"
+#include "mergebot/core/semantic/RemappedCompDB.h"
 #include "mergebot/filesystem.h"
 
 namespace mergebot {
@@ -23,9 +24,7 @@ class ASTBasedHandler : public SAHandler {
 public:
   explicit ASTBasedHandler(ProjectMeta Meta, std::string Name = __FILE__)
       : SAHandler(Meta, Name) {
-    OurCompDB = fs::path(Meta.MSCacheDir) / "ours" / CompDBRelative;
-    TheirCompDB = fs::path(Meta.MSCacheDir) / "theirs" / CompDBRelative;
-    BaseCompDB = fs::path(Meta.MSCacheDir) / "base" / CompDBRelative;
+    CompDBPath = RemappedCompDB::locate(Meta.ProjectPath, Meta.CDBPath);
 
     OurDir = fs::path(Meta.MSCacheDir) / "ours";
     TheirDir = fs::path(Meta.MSCacheDir) / "theirs";
@@ -46,12 +45,8 @@ private:
 
   void initCompDB();
 
-  const static std::string CompDBRelative;
-
-  // CompDB file
-  std::string OurCompDB;
-  std::string BaseCompDB;
-  std::string TheirCompDB;
+  // CompDB file of the original project, shared by three revisions
+  std::string CompDBPath;
 
   // three revisions source dir
   std::string OurDir;
@@ -5,16 +5,24 @@
 #ifndef MB_SAHANDLER_H
 #define MB_SAHANDLER_H
 
+#include "mergebot/core/SparseCheckout.h"
 #include "mergebot/core/model/ConflictFile.h"
 #include "mergebot/core/model/MergeScenario.h"
+#include "mergebot/core/model/enum/Side.h"
 #include "mergebot/filesystem.h"
 
+#include <array>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <spdlog/spdlog.h>
 
 namespace mergebot {
+namespace ts {
+class ParseCache;
+}
+
 namespace sa {
 struct ProjectMeta {
   std::string Project;
@@ -23,6 +31,21 @@ struct ProjectMeta {
   MergeScenario MS;
   std::string CDBPath;
   std::string MSCacheDir;
+  // sparse checkouts of ours, base and theirs, indexed by Side. Null when the
+  // whole commit tree has been dumped to MSCacheDir/<side>
+  std::array<std::shared_ptr<SparseCheckout>, 3> Checkouts;
+  // syntax trees of the sources and snippets parsed in this scenario, shared
+  // by all handlers. Null to parse afresh each time
+  std::shared_ptr<ts::ParseCache> Parses;
+
+  /// make sure relative Paths exist in the checkout of side S, no-op if S is
+  /// fully dumped
+  void materialize(Side S, const std::vector<std::string> &Paths) const {
+    const size_t Idx = static_cast<size_t>(S);
+    if (Idx < Checkouts.size() && Checkouts[Idx]) {
+      Checkouts[Idx]->materialize(Paths);
+    }
+  }
 
   std::string toString() const {
     std::ostringstream oss;
@@ -71,6 +94,18 @@ public:
     }
   }
 
+  /// run this handler only, without passing the rest to the next handler
+  void resolve(std::vector<ConflictFile> &ConflictFiles) {
+    if (!Skip_ && ConflictFiles.size()) {
+      resolveConflictFiles(ConflictFiles);
+    }
+  }
+
+  /// whether the handler resolves each conflict file on its own and cheaply,
+  /// such handlers are run per file as soon as the scenario starts in
+  /// pipelined mode, see HandlerChain
+  virtual bool isPerFile() const noexcept { return false; }
+
   void setNext(SAHandler *NextHandler) noexcept { NextHandler_ = NextHandler; }
 
   std::string_view name() const noexcept { return Name_; }
@@ -15,8 +15,12 @@ public:
   explicit StyleBasedHandler(ProjectMeta Meta, std::string Name = __FILE__)
       : SAHandler(Meta, Name) {}
 
+  bool isPerFile() const noexcept override { return true; }
+
 private:
   void resolveConflictFiles(std::vector<ConflictFile> &ConflictFiles) override;
+  /// resolve style related blocks of \p CF and marshal the results
+  void resolveConflictFile(ConflictFile &CF, bool WithBase) const;
 
   std::string findRefFile(std::string_view const &ConflictFilePath) const;
 
@@ -19,8 +19,12 @@ public:
     initDeletionInfavor();
   }
 
+  bool isPerFile() const noexcept override { return true; }
+
 private:
   void resolveConflictFiles(std::vector<ConflictFile> &ConflictFiles) override;
+  /// resolve blocks of \p CF heuristically and marshal the results
+  void resolveConflictFile(ConflictFile &CF, bool WithBase);
   bool checkDeletion(std::string_view Our, std::string_view Their,
                      ConflictFile const &CF,
                      server::BlockResolutionResult &BRR);
@@ -0,0 +1,62 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_MODEL_NODEARENA_H
+#define MB_INCLUDE_MERGEBOT_CORE_MODEL_NODEARENA_H
+
+#include "mergebot/core/model/SemanticNode.h"
+#include "mergebot/core/model/StringPool.h"
+#include <llvm/Support/Allocator.h>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+/// Storage of the semantic nodes of a merge scenario.
+///
+/// Nodes are bump allocated in large slabs and destroyed all at once with the
+/// arena, when the scenario is done, instead of one heap block (and one
+/// control block) per node. The arena is the only owner of its nodes: the
+/// graphs, child lists, matchings and the merger refer to them by plain
+/// pointers, valid as long as the arena is. Names of the nodes are interned
+/// in the string pool of the arena.
+class NodeArena {
+public:
+  NodeArena() = default;
+  NodeArena(const NodeArena &) = delete;
+  NodeArena &operator=(const NodeArena &) = delete;
+  ~NodeArena();
+
+  /// construct a node in the arena, thread safe. The node is destroyed with
+  /// the arena, never by the caller
+  template <typename T, typename... Args> T *create(Args &&...Arguments) {
+    static_assert(std::is_base_of_v<SemanticNode, T>,
+                  "only semantic nodes live in the arena");
+    void *Mem = allocate(sizeof(T), alignof(T));
+    T *Node = new (Mem) T(std::forward<Args>(Arguments)...);
+    adopt(Node);
+    return Node;
+  }
+
+  StringPool &strings() noexcept { return Strings_; }
+
+  size_t size() const;
+  /// bytes allocated for nodes
+  size_t bytesAllocated() const;
+
+private:
+  void *allocate(size_t Size, size_t Alignment);
+  void adopt(SemanticNode *Node);
+
+  mutable std::mutex Mutex_;
+  llvm::BumpPtrAllocator Allocator_;
+  /// to be destroyed, in the order of creation
+  std::vector<SemanticNode *> Nodes_;
+  StringPool Strings_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_MODEL_NODEARENA_H
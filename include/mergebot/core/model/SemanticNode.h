@@ -6,12 +6,16 @@
 #define MB_INCLUDE_MERGEBOT_CORE_MODEL_SEMANTICNODE_H
 
 #include "mergebot/core/model/ConflictFile.h"
+#include "mergebot/core/model/StringPool.h"
 #include "mergebot/core/model/enum/AccessSpecifierKind.h"
 #include "mergebot/core/model/enum/NodeKind.h"
 #include "mergebot/core/model/mapping/NodeContext.h"
 #include "mergebot/core/sa_utility.h"
 #include "mergebot/parser/point.h"
 #include "mergebot/parser/range.h"
+#include "mergebot/utils/similarity.h"
+#include <cassert>
+#include <cstdint>
 #include <llvm/Support/Casting.h> // for LLVM's RTTI template
 #include <memory>
 #include <optional>
@@ -37,12 +41,43 @@ public:
     return lhs.hashSignature() == rhs.hashSignature();
   }
 
-  virtual size_t hashSignature() const = 0;
+  /// the signature identifying this node across sides, cached once sealed
+  size_t hashSignature() const {
+    return Sealed ? Signature : computeSignature();
+  }
+
+  /// cache the signature and intern the names in \p Pool, done by the graph
+  /// builder when the node is final. Seal again after changing any field the
+  /// signature or the sketches depend on; without a pool, interned names are
+  /// dropped
+  void seal(StringPool *Pool = nullptr) {
+    Signature = computeSignature();
+    Sealed = true;
+    QualifiedNameSym = Pool ? Pool->intern(QualifiedName) : StringPool::None;
+    USRSym = Pool ? Pool->intern(USR) : StringPool::None;
+    computeSketches();
+  }
+
+  bool sealed() const { return Sealed; }
+
+  /// k-gram sketch of OriginalSignature, for util::sketch_cosine
+  const util::KGramSketch &signatureSketch() const {
+    assert(Sealed && "sketches are computed when sealed");
+    return SignatureSketch;
+  }
+
+  bool sameQualifiedName(const SemanticNode &Other) const {
+    if (QualifiedNameSym != StringPool::None &&
+        Other.QualifiedNameSym != StringPool::None) {
+      return QualifiedNameSym == Other.QualifiedNameSym;
+    }
+    return QualifiedName == Other.QualifiedName;
+  }
 
   virtual ~SemanticNode() = default;
 
   std::vector<std::string> getNearestNeighborNames() const {
-    if (auto ParentPtr = Parent.lock()) {
+    if (SemanticNode *ParentPtr = Parent) {
       std::string PrevNeighbor;
       std::string NextNeighbor;
       SemanticNode *prevSibling = nullptr;
@@ -58,13 +93,20 @@ public:
             PrevNeighbor = prevSibling->QualifiedName;
           }
         }
-        prevSibling = Child.get();
+        prevSibling = Child;
       }
       return {PrevNeighbor, NextNeighbor};
     }
     return {"", ""};
   }
 
+protected:
+  virtual size_t computeSignature() const = 0;
+  /// sketch the fields compared by the matchers, on sealing
+  virtual void computeSketches() {
+    SignatureSketch = util::KGramSketch(OriginalSignature);
+  }
+
 public:
   // id in graph
   int ID;
@@ -89,6 +131,10 @@ public:
   // extension)
   std::string USR;
 
+  /// interned QualifiedName and USR of a sealed node, if sealed with a pool
+  StringPool::Symbol QualifiedNameSym = StringPool::None;
+  StringPool::Symbol USRSym = StringPool::None;
+
   NodeContext Context;
 
   /// for preserving original format
@@ -98,27 +144,32 @@ public:
 
   bool IsSynthetic;
 
-  std::weak_ptr<SemanticNode> Parent;
-  std::vector<std::shared_ptr<SemanticNode>> Children;
+  /// not owning, the parent outlives its children in the graph (or arena)
+  SemanticNode *Parent = nullptr;
+  /// not owning either, nodes are owned by the arena of the scenario
+  std::vector<SemanticNode *> Children;
 
   NodeKind getKind() const { return Kind; }
 
   static bool classof(const SemanticNode *N) {
     return N->getKind() >= NodeKind::NODE && N->getKind() <= NodeKind::COUNT;
   }
+
+private:
+  size_t Signature = 0;
+  bool Sealed = false;
+  util::KGramSketch SignatureSketch;
 };
 
 struct SemanticNodeHasher {
-  size_t
-  operator()(const std::shared_ptr<mergebot::sa::SemanticNode> &node) const {
+  size_t operator()(const mergebot::sa::SemanticNode *node) const {
     return node->hashSignature();
   }
 };
 
 struct SemanticNodeEqual {
-  bool
-  operator()(const std::shared_ptr<mergebot::sa::SemanticNode> &lhs,
-             const std::shared_ptr<mergebot::sa::SemanticNode> &rhs) const {
+  bool operator()(const mergebot::sa::SemanticNode *lhs,
+                  const mergebot::sa::SemanticNode *rhs) const {
     return *lhs == *rhs;
   }
 };
@@ -0,0 +1,45 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_MODEL_STRINGPOOL_H
+#define MB_INCLUDE_MERGEBOT_CORE_MODEL_STRINGPOOL_H
+
+#include <cstdint>
+#include <limits>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <mutex>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+/// Interned identifier strings (qualified names, USRs) of a merge scenario.
+///
+/// Each distinct string is stored once and named by a dense 32-bit symbol, so
+/// names of the nodes of all three sides compare as integers.
+class StringPool {
+public:
+  using Symbol = uint32_t;
+  /// not interned
+  static constexpr Symbol None = std::numeric_limits<Symbol>::max();
+
+  /// the symbol of \p Str, interned if it's new. Thread safe
+  Symbol intern(llvm::StringRef Str);
+  /// the symbol of \p Str, None if it's never interned
+  Symbol lookup(llvm::StringRef Str) const;
+  /// the string of \p Sym, valid as long as the pool
+  llvm::StringRef str(Symbol Sym) const;
+
+  size_t size() const;
+
+private:
+  mutable std::mutex Mutex_;
+  llvm::StringMap<Symbol> Symbols_;
+  /// keys of Symbols_, indexed by symbol
+  std::vector<llvm::StringRef> Strings_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_MODEL_STRINGPOOL_H
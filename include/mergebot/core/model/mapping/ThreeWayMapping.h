@@ -10,14 +10,14 @@
 #include "mergebot/core/model/SemanticNode.h"
 namespace mergebot::sa {
 struct ThreeWayMapping {
-  ThreeWayMapping(std::optional<std::shared_ptr<SemanticNode>> OurNode,
-                  std::optional<std::shared_ptr<SemanticNode>> BaseNode,
-                  std::optional<std::shared_ptr<SemanticNode>> TheirNode)
+  ThreeWayMapping(std::optional<SemanticNode *> OurNode,
+                  std::optional<SemanticNode *> BaseNode,
+                  std::optional<SemanticNode *> TheirNode)
       : OurNode(OurNode), BaseNode(BaseNode), TheirNode(TheirNode) {}
 
-  std::optional<std::shared_ptr<SemanticNode>> OurNode;
-  std::optional<std::shared_ptr<SemanticNode>> BaseNode;
-  std::optional<std::shared_ptr<SemanticNode>> TheirNode;
+  std::optional<SemanticNode *> OurNode;
+  std::optional<SemanticNode *> BaseNode;
+  std::optional<SemanticNode *> TheirNode;
 
   std::string toString() const {
     std::stringstream ss;
@@ -13,20 +13,20 @@
 namespace mergebot::sa {
 struct TwoWayMatching {
   using BiMap = boost::bimap<
-      boost::bimaps::unordered_set_of<std::shared_ptr<SemanticNode>,
+      boost::bimaps::unordered_set_of<SemanticNode *,
                                       SemanticNodeHasher, SemanticNodeEqual>,
-      boost::bimaps::unordered_set_of<std::shared_ptr<SemanticNode>,
+      boost::bimaps::unordered_set_of<SemanticNode *,
                                       SemanticNodeHasher, SemanticNodeEqual>>;
   BiMap OneOneMatching;
-  std::unordered_map<NodeKind, std::vector<std::shared_ptr<SemanticNode>>>
+  std::unordered_map<NodeKind, std::vector<SemanticNode *>>
       PossiblyDeleted; // possibly deleted
-  std::unordered_map<NodeKind, std::vector<std::shared_ptr<SemanticNode>>>
+  std::unordered_map<NodeKind, std::vector<SemanticNode *>>
       PossiblyAdded; // possibly added
 
   /// \brief Add a node that is unmatched in the other graph
   /// \param Node Unmatched node
   /// \param IsInBase whether the unmatched node is in base graph
-  void addUnmatchedNode(std::shared_ptr<SemanticNode> Node, bool IsInBase) {
+  void addUnmatchedNode(SemanticNode *Node, bool IsInBase) {
     if (IsInBase) {
       PossiblyDeleted[Node->getKind()].push_back(Node);
     } else {
@@ -0,0 +1,294 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_BIPARTITEMATCHER_H
+#define MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_BIPARTITEMATCHER_H
+
+#include "mergebot/core/model/SemanticNode.h"
+#include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/CandidateBlocker.h"
+#include "mergebot/utils/similarity.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <magic_enum.hpp>
+#include <memory>
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_for.h>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mergebot::sa {
+/// a candidate pair of a bipartite matching, as indices into the base and the
+/// revision nodes
+struct ScoredPair {
+  uint32_t Base;
+  uint32_t Revision;
+  double Score;
+};
+
+/// Maximum weight matching of the bipartite graph of \p Edges, all of
+/// non-negative scores.
+///
+/// The graph is split into connected components, solved exactly by the
+/// Hungarian algorithm, or greedily with local exchanges when a component is
+/// too large for its cubic cost.
+/// \return the matched pairs, ordered by base index
+std::vector<ScoredPair> maxWeightAssignment(size_t NumBase, size_t NumRevision,
+                                            std::vector<ScoredPair> Edges);
+
+/// whether the parents of \p Base and \p Revision are the same, or a pair of
+/// types matched as refactored. Nodes without parents are compatible
+inline bool
+compatibleParents(const SemanticNode *Base, const SemanticNode *Revision,
+                  const std::unordered_map<size_t, size_t> &RefactoredTypes) {
+  const SemanticNode *BaseParentPtr = Base->Parent;
+  const SemanticNode *RevParentPtr = Revision->Parent;
+  if (!BaseParentPtr || !RevParentPtr) {
+    return true;
+  }
+  if (BaseParentPtr->hashSignature() == RevParentPtr->hashSignature()) {
+    return true;
+  }
+  auto It = RefactoredTypes.find(BaseParentPtr->hashSignature());
+  return It != RefactoredTypes.end() &&
+         It->second == RevParentPtr->hashSignature();
+}
+
+/// blocking affinity of the nodes checked by compatibleParents: the parent,
+/// mapped to its revision for refactored base types. None for nodes without
+/// parents, as they are compatible with any
+inline std::optional<size_t>
+parentAffinity(const SemanticNode &Node, bool IsBase,
+               const std::unordered_map<size_t, size_t> &RefactoredTypes) {
+  const SemanticNode *ParentPtr = Node.Parent;
+  if (!ParentPtr) {
+    return std::nullopt;
+  }
+  if (IsBase) {
+    auto It = RefactoredTypes.find(ParentPtr->hashSignature());
+    if (It != RefactoredTypes.end()) {
+      return It->second;
+    }
+  }
+  return ParentPtr->hashSignature();
+}
+
+/// what nodes of a matcher are blocked by, see CandidateBlocker
+template <typename NodeT> struct BlockingKeys {
+  /// sketches banded, sharing a band of any of them makes a candidate pair
+  std::vector<std::function<const util::KGramSketch &(const NodeT &)>> Sketches;
+  /// affinity of a node of base (or revision), pairs of different affinities
+  /// are never candidates, a node of none pairs with any. All pair if unset
+  std::function<std::optional<size_t>(const NodeT &, bool IsBase)> Affinity;
+};
+
+/// Matching of the unmatched nodes of one kind, shared by the node matchers.
+///
+/// Pairs accepted by the compatibility predicate are scored in parallel, and
+/// only those scoring at least the threshold are kept as edges. The maximum
+/// weight assignment over the edges is matched, and the matched nodes are
+/// removed from the unmatched ones at once.
+///
+/// With blocking keys, large inputs are first blocked and only candidate pairs
+/// are scored, at the recall of CandidateBlocker::recall().
+///
+/// \tparam NodeT the kind of nodes matched
+/// \tparam Scorer double(const NodeT *Base, const NodeT *Revision), called
+/// concurrently
+template <typename NodeT, typename Scorer> class BipartiteMatcher {
+public:
+  using NodePtr = SemanticNode *;
+  using MatchedPairs = std::vector<std::pair<NodePtr, NodePtr>>;
+
+  /// inputs of fewer pairs are scored all, it's cheaper than blocking
+  static constexpr size_t MinBlockedPairs = size_t(1) << 12;
+
+  BipartiteMatcher(Scorer Score, double Threshold)
+      : Score(std::move(Score)), Threshold(Threshold) {}
+
+  BipartiteMatcher &block(BlockingKeys<NodeT> Keys) {
+    Blocking = std::move(Keys);
+    return *this;
+  }
+
+  /// match \p BaseNodes against \p RevisionNodes into \p Matching
+  /// \param Compatible bool(const NodeT *Base, const NodeT *Revision), pairs
+  /// it rejects are never scored
+  /// \return the pairs matched
+  template <typename Predicate>
+  MatchedPairs match(TwoWayMatching &Matching, std::vector<NodePtr> &BaseNodes,
+                     std::vector<NodePtr> &RevisionNodes,
+                     Predicate Compatible) const {
+    const std::vector<ScoredPair> Assigned = maxWeightAssignment(
+        BaseNodes.size(), RevisionNodes.size(),
+        scorePairs(BaseNodes, RevisionNodes, Compatible));
+
+    MatchedPairs Matched;
+    Matched.reserve(Assigned.size());
+    std::unordered_set<size_t> BaseMatched;
+    std::unordered_set<size_t> RevisionMatched;
+    for (const ScoredPair &Pair : Assigned) {
+      const NodePtr &BaseNode = BaseNodes[Pair.Base];
+      const NodePtr &RevisionNode = RevisionNodes[Pair.Revision];
+      Matching.OneOneMatching.insert({BaseNode, RevisionNode});
+      BaseMatched.insert(BaseNode->hashSignature());
+      RevisionMatched.insert(RevisionNode->hashSignature());
+      Matched.emplace_back(BaseNode, RevisionNode);
+    }
+
+    eraseMatched(BaseNodes, BaseMatched);
+    eraseMatched(RevisionNodes, RevisionMatched);
+    return Matched;
+  }
+
+  MatchedPairs match(TwoWayMatching &Matching, std::vector<NodePtr> &BaseNodes,
+                     std::vector<NodePtr> &RevisionNodes) const {
+    return match(Matching, BaseNodes, RevisionNodes,
+                 [](const NodeT *, const NodeT *) { return true; });
+  }
+
+private:
+  template <typename Predicate>
+  std::vector<ScoredPair>
+  scorePairs(const std::vector<NodePtr> &BaseNodes,
+             const std::vector<NodePtr> &RevisionNodes,
+             Predicate &Compatible) const {
+    const size_t Pairs = BaseNodes.size() * RevisionNodes.size();
+    const size_t Bands =
+        Blocking && Pairs >= MinBlockedPairs
+            ? CandidateBlocker::bandsForRecall(CandidateBlocker::recall())
+            : 0;
+    // revision candidates of each base, all of them if not blocked
+    std::vector<std::vector<uint32_t>> Candidates;
+    if (Bands) {
+      Candidates = blockPairs(BaseNodes, RevisionNodes, Bands);
+    }
+
+    // one row of edges per base node, concatenated in order, so that the
+    // result doesn't depend on the scheduling
+    std::vector<std::vector<ScoredPair>> Rows(BaseNodes.size());
+    std::atomic<size_t> Candidate = 0;
+    std::atomic<size_t> Scored = 0;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, BaseNodes.size()),
+        [&](const tbb::blocked_range<size_t> &Range) {
+          size_t RangeCandidate = 0;
+          size_t RangeScored = 0;
+          for (size_t i = Range.begin(); i != Range.end(); ++i) {
+            assert(llvm::isa<NodeT>(BaseNodes[i]));
+            const auto *Base = llvm::cast<NodeT>(BaseNodes[i]);
+            auto scoreWith = [&](size_t j) {
+              assert(llvm::isa<NodeT>(RevisionNodes[j]));
+              const auto *Revision = llvm::cast<NodeT>(RevisionNodes[j]);
+              if (!Compatible(Base, Revision)) {
+                return;
+              }
+              ++RangeScored;
+              const double Similarity = Score(Base, Revision);
+              if (Similarity >= Threshold) {
+                Rows[i].push_back({static_cast<uint32_t>(i),
+                                   static_cast<uint32_t>(j), Similarity});
+              }
+            };
+            if (Bands) {
+              RangeCandidate += Candidates[i].size();
+              for (uint32_t j : Candidates[i]) {
+                scoreWith(j);
+              }
+            } else {
+              RangeCandidate += RevisionNodes.size();
+              for (size_t j = 0; j < RevisionNodes.size(); ++j) {
+                scoreWith(j);
+              }
+            }
+          }
+          Candidate += RangeCandidate;
+          Scored += RangeScored;
+        });
+
+    std::vector<ScoredPair> Edges;
+    for (std::vector<ScoredPair> &Row : Rows) {
+      Edges.insert(Edges.end(), Row.begin(), Row.end());
+    }
+    if (!BaseNodes.empty()) {
+      spdlog::info("{} pairs of {}: {} pruned by blocking, {} incompatible, {} "
+                   "scored, {} above {}",
+                   Pairs, magic_enum::enum_name(BaseNodes.front()->getKind()),
+                   Pairs - Candidate, Candidate - Scored, Scored.load(),
+                   Edges.size(), Threshold);
+    }
+    return Edges;
+  }
+
+  std::vector<std::vector<uint32_t>>
+  blockPairs(const std::vector<NodePtr> &BaseNodes,
+             const std::vector<NodePtr> &RevisionNodes, size_t Bands) const {
+    struct NodeKeys {
+      std::vector<uint64_t> Keys;
+      std::optional<size_t> Affinity;
+    };
+    auto keysOf = [&](const std::vector<NodePtr> &Nodes, bool IsBase) {
+      std::vector<NodeKeys> Keys(Nodes.size());
+      tbb::parallel_for(size_t(0), Nodes.size(), [&](size_t i) {
+        const auto &Node = *llvm::cast<NodeT>(Nodes[i]);
+        if (Blocking->Affinity) {
+          Keys[i].Affinity = Blocking->Affinity(Node, IsBase);
+        }
+        for (unsigned Slot = 0; Slot < Blocking->Sketches.size(); ++Slot) {
+          std::vector<uint64_t> SlotKeys = CandidateBlocker::sketchKeys(
+              Blocking->Sketches[Slot](Node), Bands, Slot);
+          Keys[i].Keys.insert(Keys[i].Keys.end(), SlotKeys.begin(),
+                              SlotKeys.end());
+        }
+      });
+      return Keys;
+    };
+
+    CandidateBlocker Blocker(BaseNodes.size(), RevisionNodes.size());
+    std::vector<NodeKeys> BaseKeys = keysOf(BaseNodes, true);
+    for (size_t i = 0; i < BaseKeys.size(); ++i) {
+      Blocker.add(true, static_cast<uint32_t>(i), BaseKeys[i].Keys,
+                  BaseKeys[i].Affinity);
+    }
+    std::vector<NodeKeys> RevisionKeys = keysOf(RevisionNodes, false);
+    for (size_t j = 0; j < RevisionKeys.size(); ++j) {
+      Blocker.add(false, static_cast<uint32_t>(j), RevisionKeys[j].Keys,
+                  RevisionKeys[j].Affinity);
+    }
+    return Blocker.candidates();
+  }
+
+  /// nodes of the same signature as a matched one are matched as well
+  static void eraseMatched(std::vector<NodePtr> &Nodes,
+                           const std::unordered_set<size_t> &Matched) {
+    if (Matched.empty()) {
+      return;
+    }
+    Nodes.erase(std::remove_if(Nodes.begin(), Nodes.end(),
+                               [&](const NodePtr &Node) {
+                                 return Matched.count(Node->hashSignature());
+                               }),
+                Nodes.end());
+  }
+
+  Scorer Score;
+  double Threshold;
+  std::optional<BlockingKeys<NodeT>> Blocking;
+};
+
+template <typename NodeT, typename Scorer>
+BipartiteMatcher<NodeT, Scorer> makeBipartiteMatcher(Scorer Score,
+                                                     double Threshold) {
+  return BipartiteMatcher<NodeT, Scorer>(std::move(Score), Threshold);
+}
+} // namespace mergebot::sa
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_BIPARTITEMATCHER_H
@@ -0,0 +1,69 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_CANDIDATEBLOCKER_H
+#define MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_CANDIDATEBLOCKER_H
+
+#include "mergebot/utils/similarity.h"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace mergebot::sa {
+/// Candidate pairs of a bipartite matching, by blocking.
+///
+/// Nodes are put in buckets by locality sensitive hashing of their k-gram
+/// sketches: MinHash signatures cut into bands of Rows hashes, one bucket per
+/// band. Each bucket is further split by an affinity key of the node, such as
+/// its parent or TU, nodes of no affinity going with all of the bucket. Only
+/// pairs sharing a bucket are candidates. A pair whose
+/// k-gram sets have Jaccard similarity J shares a bucket with probability
+/// 1 - (1 - J^Rows)^Bands, so more bands trade speed for recall.
+class CandidateBlocker {
+public:
+  static constexpr size_t Rows = 2;
+  /// Jaccard similarity of the k-gram sets the recall is targeted at
+  static constexpr double TargetJaccard = 0.3;
+
+  /// bands for a pair of TargetJaccard to be a candidate with probability
+  /// \p Recall, 0 if it takes pairing all (Recall >= 1)
+  static size_t bandsForRecall(double Recall);
+  /// MERGEBOT_MATCH_RECALL, 0.95 by default
+  static double recall();
+
+  /// bucket keys of a sketch, one per band. Sketches of no k-gram share a
+  /// single key. \p Slot tells apart the sketches of different fields
+  static std::vector<uint64_t> sketchKeys(const util::KGramSketch &Sketch,
+                                          size_t Bands, unsigned Slot);
+
+  CandidateBlocker(size_t NumBase, size_t NumRevision)
+      : NumBase(NumBase), NumRevision(NumRevision) {}
+
+  /// put node \p Idx of base or revision in the buckets of \p Keys, paired
+  /// only with nodes of the same \p Affinity there, or of none
+  void add(bool IsBase, uint32_t Idx, const std::vector<uint64_t> &Keys,
+           std::optional<size_t> Affinity = std::nullopt);
+
+  /// the revision candidates of each base node, sorted
+  std::vector<std::vector<uint32_t>> candidates() const;
+
+private:
+  struct Group {
+    std::vector<uint32_t> Bases;
+    std::vector<uint32_t> Revisions;
+  };
+  struct Bucket {
+    std::unordered_map<size_t, Group> ByAffinity;
+    /// nodes of no affinity
+    Group Neutral;
+  };
+
+  size_t NumBase;
+  size_t NumRevision;
+  std::unordered_map<uint64_t, Bucket> Buckets;
+};
+} // namespace mergebot::sa
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_CANDIDATEBLOCKER_H
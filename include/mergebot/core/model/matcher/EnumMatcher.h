@@ -7,6 +7,7 @@
 
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
 #include "mergebot/core/model/node/EnumNode.h"
 #include "mergebot/globals.h"
 #include "mergebot/utils/similarity.h"
@@ -15,47 +16,19 @@
 namespace mergebot::sa {
 struct EnumMatcher {
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes) {
-    for (auto &BaseNode : BaseNodes) {
-      for (auto &RevisionNode : RevisionNodes) {
-        assert(llvm::isa<EnumNode>(BaseNode.get()) &&
-               llvm::isa<EnumNode>(RevisionNode.get()));
-
-        auto *Base = llvm::dyn_cast<EnumNode>(BaseNode.get());
-        auto *Revision = llvm::dyn_cast<EnumNode>(RevisionNode.get());
-        if (Base && Revision && isMatched(Base, Revision)) {
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //          Base->OriginalSignature,
-          //                        magic_enum::enum_name(Base->getKind()),
-          //                        Revision->OriginalSignature,
-          //                        magic_enum::enum_name(Revision->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-
-          auto BaseQualifiedName = BaseNode->QualifiedName;
-          auto RevisionQualifiedName = RevisionNode->QualifiedName;
-
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](const auto &Node) {
-                                           return Node->hashSignature() ==
-                                                  BaseNode->hashSignature();
-                                         }),
-                          BaseNodes.end());
-
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](const auto &Node) {
-                               return Node->hashSignature() ==
-                                      RevisionNode->hashSignature();
-                             }),
-              RevisionNodes.end());
-        }
-      }
-    }
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes) {
+    auto Matcher = makeBipartiteMatcher<EnumNode>(
+        [this](const EnumNode *Base, const EnumNode *Revision) {
+          return calcSimilarity(Base, Revision);
+        },
+        MIN_SIMI);
+    Matcher.match(Matching, BaseNodes, RevisionNodes);
   }
 
 private:
-  bool isMatched(const EnumNode *BaseNode, const EnumNode *RevisionNode) {
+  double calcSimilarity(const EnumNode *BaseNode,
+                        const EnumNode *RevisionNode) {
     double NameSim = 0, BaseSim = 0, BodySim = 0;
     NameSim = util::string_levenshtein(BaseNode->QualifiedName,
                                        RevisionNode->QualifiedName);
@@ -73,7 +46,7 @@ private:
       BodySim = 0;
     }
 
-    return NameSim * 0.2 + BaseSim * 0.2 + BodySim * 0.6 >= MIN_SIMI;
+    return NameSim * 0.2 + BaseSim * 0.2 + BodySim * 0.6;
   }
 };
 } // namespace mergebot::sa
@@ -6,108 +6,39 @@
 #define MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_FIELDDECLMATCHER_H
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
 #include "mergebot/core/model/node/FieldDeclarationNode.h"
 #include "mergebot/globals.h"
 #include "mergebot/utils/similarity.h"
-#include <boost/graph/maximum_weighted_matching.hpp>
 #include <vector>
 namespace mergebot::sa {
 struct FieldDeclMatcher {
-  using FieldDeclGraph =
-      boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
-                            std::shared_ptr<SemanticNode>,
-                            boost::property<boost::edge_weight_t, double>>;
-  using vertex_descriptor =
-      boost::graph_traits<FieldDeclGraph>::vertex_descriptor;
-  using edge_descriptor = boost::graph_traits<FieldDeclGraph>::edge_descriptor;
-
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes,
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes,
              const std::unordered_map<size_t, size_t> &RefactoredTypes) {
-    FieldDeclGraph FDGraph(BaseNodes.size() + RevisionNodes.size());
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      FDGraph[i] = BaseNodes[i];
-    }
-    for (size_t i = 0; i < RevisionNodes.size(); ++i) {
-      FDGraph[BaseNodes.size() + i] = RevisionNodes[i];
-    }
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      for (size_t j = 0; j < RevisionNodes.size(); ++j) {
-        auto BaseFieldDecl =
-            llvm::cast<FieldDeclarationNode>(BaseNodes[i].get());
-        auto RevFieldDecl =
-            llvm::cast<FieldDeclarationNode>(RevisionNodes[j].get());
-        double DeclaratorSim = util::string_cosine(BaseFieldDecl->Declarator,
-                                                   RevFieldDecl->Declarator);
-        if (DeclaratorSim < MIN_SIMI) {
-          continue;
-        }
-
-        auto [Edge, Success] = add_edge(i, BaseNodes.size() + j, FDGraph);
-        assert(llvm::isa<FieldDeclarationNode>(BaseNodes[i].get()) &&
-               llvm::isa<FieldDeclarationNode>(RevisionNodes[j].get()));
-        put(boost::edge_weight, FDGraph, Edge,
-            calcSimilarity(
-                llvm::dyn_cast<FieldDeclarationNode>(BaseNodes[i].get()),
-                llvm::dyn_cast<FieldDeclarationNode>(RevisionNodes[j].get())));
-      }
-    }
-
-    std::vector<vertex_descriptor> mate(num_vertices(FDGraph));
-
-    boost::maximum_weighted_matching(FDGraph, &mate[0]);
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      if (mate[i] != boost::graph_traits<FieldDeclGraph>::null_vertex()) {
-        std::shared_ptr<SemanticNode> BaseNode = FDGraph[i];
-        std::shared_ptr<SemanticNode> RevisionNode = FDGraph[mate[i]];
-
-        auto [Edge, Ok] = boost::edge(i, mate[i], FDGraph);
-        if (Ok) {
-          auto Weight = get(boost::edge_weight, FDGraph, Edge);
-          if (Weight < MIN_SIMI) {
-            continue;
-          }
-
-          if (auto BaseParentPtr = BaseNode->Parent.lock()) {
-            if (auto RevParentPtr = RevisionNode->Parent.lock()) {
-              if (BaseParentPtr->hashSignature() !=
-                      RevParentPtr->hashSignature() &&
-                  (RefactoredTypes.find(BaseParentPtr->hashSignature()) ==
-                       RefactoredTypes.end() ||
-                   RefactoredTypes.at(BaseParentPtr->hashSignature()) !=
-                       RevParentPtr->hashSignature())) {
-                continue;
-              }
-            }
+    auto Matcher = makeBipartiteMatcher<FieldDeclarationNode>(
+        [this](const FieldDeclarationNode *Base,
+               const FieldDeclarationNode *Revision) {
+          if (util::sketch_cosine(Base->declaratorSketch(),
+                                  Revision->declaratorSketch()) < MIN_SIMI) {
+            return 0.0;
           }
-
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //                        BaseNode->OriginalSignature,
-          //                        magic_enum::enum_name(BaseNode->getKind()),
-          //                        RevisionNode->OriginalSignature,
-          //                        magic_enum::enum_name(RevisionNode->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](const auto &Node) {
-                                           return Node->hashSignature() ==
-                                                  BaseNode->hashSignature();
-                                         }),
-                          BaseNodes.end());
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](const auto &Node) {
-                               return Node->hashSignature() ==
-                                      RevisionNode->hashSignature();
-                             }),
-              RevisionNodes.end());
-        }
-      }
-    }
+          return calcSimilarity(Base, Revision);
+        },
+        MIN_SIMI);
+    Matcher.block(
+        {{[](const FieldDeclarationNode &Node) -> const util::KGramSketch & {
+           return Node.declaratorSketch();
+         }},
+         [&](const FieldDeclarationNode &Node, bool IsBase) {
+           return parentAffinity(Node, IsBase, RefactoredTypes);
+         }});
+    Matcher.match(Matching, BaseNodes, RevisionNodes,
+                  [&](const FieldDeclarationNode *Base,
+                      const FieldDeclarationNode *Revision) {
+                    return compatibleParents(Base, Revision, RefactoredTypes);
+                  });
   }
 
 private:
@@ -129,8 +60,8 @@ private:
                         const FieldDeclarationNode *RevisionNode) {
     double SimAvg = 0;
 
-    if (auto BaseParentPtr = BaseNode->Parent.lock()) {
-      if (auto RevParentPtr = RevisionNode->Parent.lock()) {
+    if (SemanticNode *BaseParentPtr = BaseNode->Parent) {
+      if (SemanticNode *RevParentPtr = RevisionNode->Parent) {
         double SimName = util::string_levenshtein(BaseParentPtr->QualifiedName,
                                                   RevParentPtr->QualifiedName) *
                          0.3;
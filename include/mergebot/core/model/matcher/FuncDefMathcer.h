@@ -6,105 +6,41 @@
 #define MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_FUNCDEFMATHCER_H
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
 #include "mergebot/core/model/node/FuncDefNode.h"
 #include "mergebot/globals.h"
 #include "mergebot/utils/similarity.h"
-#include <boost/graph/maximum_weighted_matching.hpp>
 #include <vector>
 namespace mergebot::sa {
 struct FuncDefMatcher {
-  //  static constexpr double Thresh = 0.8;
-  using FuncDefGraph =
-      boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
-                            std::shared_ptr<SemanticNode>,
-                            boost::property<boost::edge_weight_t, double>>;
-  using vertex_descriptor =
-      boost::graph_traits<FuncDefGraph>::vertex_descriptor;
-  using edge_descriptor = boost::graph_traits<FuncDefGraph>::edge_descriptor;
-
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes,
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes,
              const std::unordered_map<size_t, size_t> &RefactoredTypes) {
-    FuncDefGraph FDGraph(BaseNodes.size() + RevisionNodes.size());
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      FDGraph[i] = BaseNodes[i];
-    }
-    for (size_t i = 0; i < RevisionNodes.size(); ++i) {
-      FDGraph[BaseNodes.size() + i] = RevisionNodes[i];
-    }
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      for (size_t j = 0; j < RevisionNodes.size(); ++j) {
-        auto SigSim = util::string_cosine(BaseNodes[i]->OriginalSignature,
-                                          RevisionNodes[j]->OriginalSignature);
-        if (SigSim < MIN_SIMI) {
-          continue;
-        }
-
-        auto [Edge, Success] = add_edge(i, BaseNodes.size() + j, FDGraph);
-        assert(llvm::isa<FuncDefNode>(BaseNodes[i].get()) &&
-               llvm::isa<FuncDefNode>(RevisionNodes[j].get()));
-        put(boost::edge_weight, FDGraph, Edge,
-            calcSimilarity(
-                llvm::dyn_cast<FuncDefNode>(BaseNodes[i].get()),
-                llvm::dyn_cast<FuncDefNode>(RevisionNodes[j].get())));
-      }
-    }
-
-    std::vector<vertex_descriptor> mate(num_vertices(FDGraph));
-
-    boost::maximum_weighted_matching(FDGraph, &mate[0]);
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      if (mate[i] != boost::graph_traits<FuncDefGraph>::null_vertex()) {
-        std::shared_ptr<SemanticNode> BaseNode = FDGraph[i];
-        std::shared_ptr<SemanticNode> RevisionNode = FDGraph[mate[i]];
-
-        auto [Edge, Ok] = boost::edge(i, mate[i], FDGraph);
-        if (Ok) {
-          auto Weight = get(boost::edge_weight, FDGraph, Edge);
-          if (Weight < MIN_SIMI) {
-            continue;
-          }
-
-          if (auto BaseParentPtr = BaseNode->Parent.lock()) {
-            if (auto RevParentPtr = RevisionNode->Parent.lock()) {
-              if (BaseParentPtr->hashSignature() !=
-                      RevParentPtr->hashSignature() &&
-                  (RefactoredTypes.find(BaseParentPtr->hashSignature()) ==
-                       RefactoredTypes.end() ||
-                   RefactoredTypes.at(BaseParentPtr->hashSignature()) !=
-                       RevParentPtr->hashSignature())) {
-                continue;
-              }
-            }
+    auto Matcher = makeBipartiteMatcher<FuncDefNode>(
+        [this](const FuncDefNode *Base, const FuncDefNode *Revision) {
+          // signatures too far apart are not worth a full comparison
+          if (util::sketch_cosine(Base->signatureSketch(),
+                                  Revision->signatureSketch()) < MIN_SIMI) {
+            return 0.0;
           }
-
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //                        BaseNode->OriginalSignature,
-          //                        magic_enum::enum_name(BaseNode->getKind()),
-          //                        RevisionNode->OriginalSignature,
-          //                        magic_enum::enum_name(RevisionNode->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](const auto &Node) {
-                                           return Node->hashSignature() ==
-                                                  BaseNode->hashSignature();
-                                         }),
-                          BaseNodes.end());
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](const auto &Node) {
-                               return Node->hashSignature() ==
-                                      RevisionNode->hashSignature();
-                             }),
-              RevisionNodes.end());
-        }
-      }
-    }
+          return calcSimilarity(Base, Revision);
+        },
+        MIN_SIMI);
+    Matcher.block(
+        {{[](const FuncDefNode &Node) -> const util::KGramSketch & {
+            return Node.signatureSketch();
+          },
+          [](const FuncDefNode &Node) -> const util::KGramSketch & {
+            return Node.bodySketch();
+          }},
+         [&](const FuncDefNode &Node, bool IsBase) {
+           return parentAffinity(Node, IsBase, RefactoredTypes);
+         }});
+    Matcher.match(Matching, BaseNodes, RevisionNodes,
+                  [&](const FuncDefNode *Base, const FuncDefNode *Revision) {
+                    return compatibleParents(Base, Revision, RefactoredTypes);
+                  });
   }
 
 private:
@@ -125,15 +61,16 @@ private:
   double calcSimilarity(const FuncDefNode *BaseNode,
                         const FuncDefNode *RevisionNode) {
     double SimAvg = 0;
-    double NameSim = util::string_levenshtein(BaseNode->OriginalSignature,
-                                              RevisionNode->OriginalSignature);
+    double NameSim = util::string_levenshtein(
+        BaseNode->OriginalSignature, RevisionNode->OriginalSignature, MIN_SIMI);
     // for terminal node, if body similarity is too low, unnecessary to match
     if (NameSim < MIN_SIMI) {
       return 0;
     }
     SimAvg += NameSim * 0.5;
 
-    double BodySim = util::string_cosine(BaseNode->Body, RevisionNode->Body);
+    double BodySim =
+        util::sketch_cosine(BaseNode->bodySketch(), RevisionNode->bodySketch());
     if (BodySim < 0) {
       BodySim = 0;
     }
@@ -174,8 +111,8 @@ private:
     }
 
     // CONTAINS
-    if (auto BaseParentPtr = BaseNode->Parent.lock()) {
-      if (auto RevParentPtr = RevisionNode->Parent.lock()) {
+    if (SemanticNode *BaseParentPtr = BaseNode->Parent) {
+      if (SemanticNode *RevParentPtr = RevisionNode->Parent) {
         double SimName = util::string_levenshtein(BaseParentPtr->QualifiedName,
                                                   RevParentPtr->QualifiedName);
         if (SimName < 0) {
@@ -6,99 +6,31 @@
 #define MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_FUNCSPECIALMEMBERMATCHER_H
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
 #include "mergebot/core/model/node/FuncSpecialMemberNode.h"
 #include "mergebot/globals.h"
 #include "mergebot/utils/similarity.h"
-#include <boost/graph/maximum_weighted_matching.hpp>
 #include <vector>
 namespace mergebot::sa {
 struct FuncSpecialMemberMatcher {
-  //  static constexpr double Thresh = 0.8;
-  using FuncSpecialGraph =
-      boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
-                            std::shared_ptr<SemanticNode>,
-                            boost::property<boost::edge_weight_t, double>>;
-  using vertex_descriptor =
-      boost::graph_traits<FuncSpecialGraph>::vertex_descriptor;
-  using edge_descriptor =
-      boost::graph_traits<FuncSpecialGraph>::edge_descriptor;
-
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes) {
-    FuncSpecialGraph FSGraph(BaseNodes.size() + RevisionNodes.size());
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      FSGraph[i] = BaseNodes[i];
-    }
-    for (size_t i = 0; i < RevisionNodes.size(); ++i) {
-      FSGraph[BaseNodes.size() + i] = RevisionNodes[i];
-    }
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      for (size_t j = 0; j < RevisionNodes.size(); ++j) {
-        auto [Edge, Success] = add_edge(i, BaseNodes.size() + j, FSGraph);
-        assert(llvm::isa<FuncSpecialMemberNode>(BaseNodes[i].get()) &&
-               llvm::isa<FuncSpecialMemberNode>(RevisionNodes[j].get()));
-        put(boost::edge_weight, FSGraph, Edge,
-            calcSimilarity(
-                llvm::dyn_cast<FuncSpecialMemberNode>(BaseNodes[i].get()),
-                llvm::dyn_cast<FuncSpecialMemberNode>(RevisionNodes[j].get())));
-      }
-    }
-
-    std::vector<vertex_descriptor> mate(num_vertices(FSGraph));
-
-    boost::maximum_weighted_matching(FSGraph, &mate[0]);
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      if (mate[i] != boost::graph_traits<FuncSpecialGraph>::null_vertex()) {
-        std::shared_ptr<SemanticNode> BaseNode = FSGraph[i];
-        std::shared_ptr<SemanticNode> RevisionNode = FSGraph[mate[i]];
-
-        auto [Edge, Ok] = boost::edge(i, mate[i], FSGraph);
-        if (Ok) {
-          auto Weight = get(boost::edge_weight, FSGraph, Edge);
-          if (Weight < MIN_SIMI) {
-            continue;
-          }
-
-          //          if (auto BaseParentPtr = BaseNode->Parent.lock()) {
-          //            if (auto RevParentPtr = RevisionNode->Parent.lock()) {
-          //              if (BaseParentPtr->hashSignature() !=
-          //                      RevParentPtr->hashSignature() ||
-          //                  RefactoredTypes.at(BaseParentPtr->hashSignature())
-          //                  !=
-          //                      RevParentPtr->hashSignature()) {
-          //                continue;
-          //                // mark refactoring: field extraction
-          //              }
-          //            }
-          //          }
-
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //                        BaseNode->OriginalSignature,
-          //                        magic_enum::enum_name(BaseNode->getKind()),
-          //                        RevisionNode->OriginalSignature,
-          //                        magic_enum::enum_name(RevisionNode->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](const auto &Node) {
-                                           return Node->hashSignature() ==
-                                                  BaseNode->hashSignature();
-                                         }),
-                          BaseNodes.end());
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](const auto &Node) {
-                               return Node->hashSignature() ==
-                                      RevisionNode->hashSignature();
-                             }),
-              RevisionNodes.end());
-        }
-      }
-    }
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes) {
+    auto Matcher = makeBipartiteMatcher<FuncSpecialMemberNode>(
+        [this](const FuncSpecialMemberNode *Base,
+               const FuncSpecialMemberNode *Revision) {
+          return calcSimilarity(Base, Revision);
+        },
+        MIN_SIMI);
+    // special members of a renamed type change signatures, hence no affinity
+    Matcher.block(
+        {{[](const FuncSpecialMemberNode &Node) -> const util::KGramSketch & {
+            return Node.signatureSketch();
+          },
+          [](const FuncSpecialMemberNode &Node) -> const util::KGramSketch & {
+            return Node.bodySketch();
+          }}});
+    Matcher.match(Matching, BaseNodes, RevisionNodes);
   }
 
 private:
@@ -119,15 +51,16 @@ private:
   double calcSimilarity(const FuncSpecialMemberNode *BaseNode,
                         const FuncSpecialMemberNode *RevisionNode) {
     double SimAvg = 0;
-    double NameSim = util::string_levenshtein(BaseNode->OriginalSignature,
-                                              RevisionNode->OriginalSignature);
+    double NameSim = util::string_levenshtein(
+        BaseNode->OriginalSignature, RevisionNode->OriginalSignature, MIN_SIMI);
     // for terminal node, if body similarity is too low, unnecessary to match
     if (NameSim < MIN_SIMI) {
       return 0;
     }
     SimAvg += NameSim * 0.5;
 
-    double BodySim = util::string_cosine(BaseNode->Body, RevisionNode->Body);
+    double BodySim =
+        util::sketch_cosine(BaseNode->bodySketch(), RevisionNode->bodySketch());
     if (BodySim < 0) {
       BodySim = 0;
     }
@@ -178,8 +111,8 @@ private:
     }
 
     // CONTAINS
-    if (auto BaseParentPtr = BaseNode->Parent.lock()) {
-      if (auto RevParentPtr = RevisionNode->Parent.lock()) {
+    if (SemanticNode *BaseParentPtr = BaseNode->Parent) {
+      if (SemanticNode *RevParentPtr = RevisionNode->Parent) {
         double SimName = util::string_levenshtein(BaseParentPtr->QualifiedName,
                                                   RevParentPtr->QualifiedName);
         if (SimName < 0) {
@@ -6,7 +6,9 @@
 #define MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_LINKAGESPECLISTMATCHER_H
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
 #include "mergebot/core/model/node/LinkageSpecNode.h"
+#include "mergebot/globals.h"
 #include "mergebot/utils/similarity.h"
 #include <memory>
 #include <string>
@@ -14,43 +16,16 @@
 namespace mergebot::sa {
 struct LinkageSpecListMatcher {
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes) {
-    for (auto &BaseNode : BaseNodes) {
-      for (auto &RevisionNode : RevisionNodes) {
-        assert(llvm::isa<LinkageSpecNode>(BaseNode.get()) &&
-               llvm::isa<LinkageSpecNode>(RevisionNode.get()));
-
-        auto *Base = llvm::dyn_cast<LinkageSpecNode>(BaseNode.get());
-        auto *Revision = llvm::dyn_cast<LinkageSpecNode>(RevisionNode.get());
-        if (Base && Revision && isMatched(Base, Revision)) {
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //          Base->OriginalSignature,
-          //                        magic_enum::enum_name(Base->getKind()),
-          //                        Revision->OriginalSignature,
-          //                        magic_enum::enum_name(Revision->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-
-          auto BaseQualifiedName = BaseNode->QualifiedName;
-          auto RevisionQualifiedName = RevisionNode->QualifiedName;
-
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](const auto &Node) {
-                                           return Node->hashSignature() ==
-                                                  BaseNode->hashSignature();
-                                         }),
-                          BaseNodes.end());
-
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](const auto &Node) {
-                               return Node->hashSignature() ==
-                                      RevisionNode->hashSignature();
-                             }),
-              RevisionNodes.end());
-        }
-      }
-    }
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes) {
+    auto Matcher = makeBipartiteMatcher<LinkageSpecNode>(
+        [](const LinkageSpecNode *, const LinkageSpecNode *) { return 1.0; },
+        MIN_SIMI);
+    Matcher.match(Matching, BaseNodes, RevisionNodes,
+                  [this](const LinkageSpecNode *Base,
+                         const LinkageSpecNode *Revision) {
+                    return isMatched(Base, Revision);
+                  });
   }
 
 private:
@@ -8,124 +8,72 @@
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
 #include "mergebot/core/model/node/TextualNode.h"
-#include "mergebot/globals.h"
-#include "mergebot/utils/similarity.h"
-#include <boost/graph/maximum_weighted_matching.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace mergebot::sa {
+/// Patience alignment of two sequences of keys: the common prefix and suffix,
+/// then anchors of keys occurring exactly once in both, longest increasing
+/// between the two sides, recursively in the gaps. Gaps without such anchors
+/// are aligned by LCS when small enough.
+/// \return the aligned pairs of indices, in increasing order on both sides
+std::vector<std::pair<uint32_t, uint32_t>>
+alignSequences(const std::vector<uint64_t> &Base,
+               const std::vector<uint64_t> &Revision);
+
+/// Matching of textual nodes (macros, using-declarations, typedefs,
+/// enumerators, friend declarations, ...), by far the most numerous kind.
+///
+/// Nodes are matched in stages, each on the leftovers of the previous one:
+/// 1. equal text up to whitespace and a trailing comma, in the same TU;
+/// 2. alignment of the nodes of each TU in source order, by their leading
+///    tokens, as long as their bodies stay similar;
+/// 3. body and neighbor similarity, by the shared bipartite matcher.
 class TextualMatcher {
 public:
-  using TextualGraph =
-      boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
-                            std::shared_ptr<SemanticNode>,
-                            boost::property<boost::edge_weight_t, double>>;
-  using vertex_descriptor =
-      boost::graph_traits<TextualGraph>::vertex_descriptor;
-  using edge_descriptor = boost::graph_traits<TextualGraph>::edge_descriptor;
-
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes) {
-    TextualGraph TTGraph(BaseNodes.size() + RevisionNodes.size());
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      TTGraph[i] = BaseNodes[i];
-    }
-    for (size_t i = 0; i < RevisionNodes.size(); ++i) {
-      TTGraph[BaseNodes.size() + i] = RevisionNodes[i];
-    }
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      for (size_t j = 0; j < RevisionNodes.size(); ++j) {
-        auto BaseTextualNode = llvm::cast<TextualNode>(BaseNodes[i].get());
-        auto RevTextualNode = llvm::cast<TextualNode>(RevisionNodes[j].get());
-
-        if (BaseTextualNode->TUPath != RevTextualNode->TUPath) {
-          continue;
-        }
-
-        auto [Edge, Success] = add_edge(i, BaseNodes.size() + j, TTGraph);
-        assert(llvm::isa<TextualNode>(BaseNodes[i].get()) &&
-               llvm::isa<TextualNode>(RevisionNodes[j].get()));
-        put(boost::edge_weight, TTGraph, Edge,
-            calcSimilarity(
-                llvm::dyn_cast<TextualNode>(BaseNodes[i].get()),
-                llvm::dyn_cast<TextualNode>(RevisionNodes[j].get())));
-      }
-    }
-
-    std::vector<vertex_descriptor> mate(num_vertices(TTGraph));
-
-    boost::maximum_weighted_matching(TTGraph, &mate[0]);
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      if (mate[i] != boost::graph_traits<TextualGraph>::null_vertex()) {
-        std::shared_ptr<SemanticNode> BaseNode = TTGraph[i];
-        std::shared_ptr<SemanticNode> RevisionNode = TTGraph[mate[i]];
-
-        auto [Edge, Ok] = boost::edge(i, mate[i], TTGraph);
-        if (Ok) {
-          auto Weight = get(boost::edge_weight, TTGraph, Edge);
-          if (Weight < HIGH_SIMI) {
-            continue;
-          }
-
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //                        BaseNode->OriginalSignature,
-          //                        magic_enum::enum_name(BaseNode->getKind()),
-          //                        RevisionNode->OriginalSignature,
-          //                        magic_enum::enum_name(RevisionNode->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](const auto &Node) {
-                                           return Node->hashSignature() ==
-                                                  BaseNode->hashSignature();
-                                         }),
-                          BaseNodes.end());
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](const auto &Node) {
-                               return Node->hashSignature() ==
-                                      RevisionNode->hashSignature();
-                             }),
-              RevisionNodes.end());
-        }
-      }
-    }
-  }
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes);
 
 private:
+  /// a node with its keys for the first two stages
+  struct Entry {
+    SemanticNode *Node;
+    const TextualNode *Textual;
+    /// normalized text
+    uint64_t ExactKey;
+    /// leading tokens of the normalized text
+    uint64_t AlignKey;
+  };
+
+  static std::vector<Entry>
+  entriesOf(const std::vector<SemanticNode *> &Nodes);
+
+  /// the first two stages on the nodes of one TU, in source order
+  static void matchInUnit(const std::vector<Entry> &BaseEntries,
+                          const std::vector<Entry> &RevisionEntries,
+                          std::vector<uint32_t> BaseIdx,
+                          std::vector<uint32_t> RevisionIdx,
+                          std::vector<std::pair<uint32_t, uint32_t>> &Exact,
+                          std::vector<std::pair<uint32_t, uint32_t>> &Aligned);
+
+  void matchSimilar(TwoWayMatching &Matching,
+                    std::vector<SemanticNode *> &BaseNodes,
+                    std::vector<SemanticNode *> &RevisionNodes);
+
   bool available(const std::vector<std::string> &BaseRefs,
-                 const std::vector<std::string> &RevisionRefs) {
-    if (BaseRefs.empty() || RevisionRefs.empty()) {
-      return false;
-    }
-    bool BaseAllEmpty =
-        std::all_of(BaseRefs.begin(), BaseRefs.end(),
-                    [&](const auto &item) { return item.empty(); });
-    bool RevisionAllEmpty =
-        std::all_of(RevisionRefs.begin(), RevisionRefs.end(),
-                    [&](const auto &item) { return item.empty(); });
-    return !(BaseAllEmpty || RevisionAllEmpty);
-  }
+                 const std::vector<std::string> &RevisionRefs) const;
 
   double calcSimilarity(const TextualNode *BaseNode,
-                        const TextualNode *RevisionNode) {
-    double BodySim = util::string_cosine(BaseNode->Body, RevisionNode->Body);
-
-    std::vector<std::string> BaseNeighbors =
-        BaseNode->getNearestNeighborNames();
-    std::vector<std::string> RevisionNeighbors =
-        RevisionNode->getNearestNeighborNames();
-    if (available(BaseNeighbors, RevisionNeighbors)) {
-      double NeighborSim = util::dice(BaseNeighbors, RevisionNeighbors);
-      return (BodySim + NeighborSim) / 2;
-    }
+                        const TextualNode *RevisionNode) const;
 
-    return BodySim;
-  }
+  /// nearest neighbor names of the nodes left for the last stage, as they
+  /// take a scan of the siblings
+  std::unordered_map<const SemanticNode *, std::vector<std::string>> Neighbors;
 };
 } // namespace mergebot::sa
 
@@ -7,42 +7,26 @@
 
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
 #include "mergebot/core/model/node/TranslationUnitNode.h"
+#include "mergebot/globals.h"
 #include <vector>
 namespace mergebot {
 namespace sa {
 struct TranslationUnitMatcher {
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes) {
-    for (auto &BaseNode : BaseNodes) {
-      for (auto &RevisionNode : RevisionNodes) {
-        assert(llvm::isa<TranslationUnitNode>(BaseNode.get()) &&
-               llvm::isa<TranslationUnitNode>(RevisionNode.get()));
-        if (BaseNode->QualifiedName == RevisionNode->QualifiedName) {
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //                        BaseNode->OriginalSignature,
-          //                        magic_enum::enum_name(BaseNode->getKind()),
-          //                        RevisionNode->OriginalSignature,
-          //                        magic_enum::enum_name(RevisionNode->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-          // take care of equality match of std::shared_ptr<SemanticNode>
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](auto &Node) {
-                                           return Node->QualifiedName ==
-                                                  BaseNode->QualifiedName;
-                                         }),
-                          BaseNodes.end());
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](auto &Node) {
-                               return Node->QualifiedName ==
-                                      RevisionNode->QualifiedName;
-                             }),
-              RevisionNodes.end());
-        }
-      }
-    }
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes) {
+    auto Matcher = makeBipartiteMatcher<TranslationUnitNode>(
+        [](const TranslationUnitNode *, const TranslationUnitNode *) {
+          return 1.0;
+        },
+        MIN_SIMI);
+    Matcher.match(Matching, BaseNodes, RevisionNodes,
+                  [](const TranslationUnitNode *Base,
+                     const TranslationUnitNode *Revision) {
+                    return Base->sameQualifiedName(*Revision);
+                  });
   }
 };
 } // namespace sa
@@ -6,93 +6,33 @@
 #define MB_INCLUDE_MERGEBOT_CORE_MODEL_MATCHER_TYPESPECIFIERMATCHER_H
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/mapping/TwoWayMatching.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
 #include "mergebot/core/model/node/TypeDeclNode.h"
 #include "mergebot/globals.h"
 #include "mergebot/utils/similarity.h"
-#include <boost/graph/maximum_weighted_matching.hpp>
 #include <vector>
 namespace mergebot::sa {
 struct TypeSpecifierMatcher {
-  //  static constexpr double Thresh = 0.8;
-  using TypeDeclGraph =
-      boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
-                            std::shared_ptr<SemanticNode>,
-                            boost::property<boost::edge_weight_t, double>>;
-  using vertex_descriptor =
-      boost::graph_traits<TypeDeclGraph>::vertex_descriptor;
-  using edge_descriptor = boost::graph_traits<TypeDeclGraph>::edge_descriptor;
-
   void match(TwoWayMatching &Matching,
-             std::vector<std::shared_ptr<SemanticNode>> &BaseNodes,
-             std::vector<std::shared_ptr<SemanticNode>> &RevisionNodes,
+             std::vector<SemanticNode *> &BaseNodes,
+             std::vector<SemanticNode *> &RevisionNodes,
              std::unordered_map<size_t, size_t> &RefactoredTypes) {
-    TypeDeclGraph TDGraph(BaseNodes.size() + RevisionNodes.size());
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      TDGraph[i] = BaseNodes[i];
-    }
-    for (size_t i = 0; i < RevisionNodes.size(); ++i) {
-      TDGraph[BaseNodes.size() + i] = RevisionNodes[i];
-    }
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      for (size_t j = 0; j < RevisionNodes.size(); ++j) {
-        auto NameSim = util::string_cosine(BaseNodes[i]->OriginalSignature,
-                                           RevisionNodes[j]->OriginalSignature);
-        if (NameSim < MIN_SIMI) {
-          continue;
-        }
-
-        auto [Edge, Success] = add_edge(i, BaseNodes.size() + j, TDGraph);
-        assert(llvm::isa<TypeDeclNode>(BaseNodes[i].get()) &&
-               llvm::isa<TypeDeclNode>(RevisionNodes[j].get()));
-        put(boost::edge_weight, TDGraph, Edge,
-            calcSimilarity(
-                llvm::dyn_cast<TypeDeclNode>(BaseNodes[i].get()),
-                llvm::dyn_cast<TypeDeclNode>(RevisionNodes[j].get())));
-      }
-    }
-
-    std::vector<vertex_descriptor> mate(num_vertices(TDGraph));
-
-    boost::maximum_weighted_matching(TDGraph, &mate[0]);
-
-    for (size_t i = 0; i < BaseNodes.size(); ++i) {
-      if (mate[i] != boost::graph_traits<TypeDeclGraph>::null_vertex()) {
-        std::shared_ptr<SemanticNode> BaseNode = TDGraph[i];
-        std::shared_ptr<SemanticNode> RevisionNode = TDGraph[mate[i]];
-
-        auto [Edge, Ok] = boost::edge(i, mate[i], TDGraph);
-        if (Ok) {
-          auto Weight = get(boost::edge_weight, TDGraph, Edge);
-          if (Weight < MIN_SIMI) {
-            continue;
+    auto Matcher = makeBipartiteMatcher<TypeDeclNode>(
+        [this](const TypeDeclNode *Base, const TypeDeclNode *Revision) {
+          if (util::sketch_cosine(Base->signatureSketch(),
+                                  Revision->signatureSketch()) < MIN_SIMI) {
+            return 0.0;
           }
-
-          //          spdlog::debug("refactor: {}({}) -> {}({})",
-          //                        BaseNode->OriginalSignature,
-          //                        magic_enum::enum_name(BaseNode->getKind()),
-          //                        RevisionNode->OriginalSignature,
-          //                        magic_enum::enum_name(RevisionNode->getKind()));
-          Matching.OneOneMatching.insert({BaseNode, RevisionNode});
-          RefactoredTypes.insert(
-              {BaseNode->hashSignature(), RevisionNode->hashSignature()});
-
-          BaseNodes.erase(std::remove_if(BaseNodes.begin(), BaseNodes.end(),
-                                         [&](const auto &Node) {
-                                           return Node->hashSignature() ==
-                                                  BaseNode->hashSignature();
-                                         }),
-                          BaseNodes.end());
-          RevisionNodes.erase(
-              std::remove_if(RevisionNodes.begin(), RevisionNodes.end(),
-                             [&](const auto &Node) {
-                               return Node->hashSignature() ==
-                                      RevisionNode->hashSignature();
-                             }),
-              RevisionNodes.end());
-        }
-      }
+          return calcSimilarity(Base, Revision);
+        },
+        MIN_SIMI);
+    Matcher.block({{[](const TypeDeclNode &Node) -> const util::KGramSketch & {
+      return Node.signatureSketch();
+    }}});
+    for (const auto &[BaseNode, RevisionNode] :
+         Matcher.match(Matching, BaseNodes, RevisionNodes)) {
+      RefactoredTypes.insert(
+          {BaseNode->hashSignature(), RevisionNode->hashSignature()});
     }
   }
 
@@ -140,8 +80,8 @@ private:
       SimSum += SimNeighbors;
     }
 
-    if (auto BaseParentPtr = BaseNode->Parent.lock()) {
-      if (auto RevParentPtr = RevisionNode->Parent.lock()) {
+    if (SemanticNode *BaseParentPtr = BaseNode->Parent) {
+      if (SemanticNode *RevParentPtr = RevisionNode->Parent) {
         IndicatorNum++;
         double SimName = util::string_levenshtein(BaseParentPtr->QualifiedName,
                                                   RevParentPtr->QualifiedName);
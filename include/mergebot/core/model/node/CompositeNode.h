@@ -21,7 +21,7 @@ public:
                      std::move(USR), IsSynthetic),
         BeforeFirstChildEOL(BeforeFirstChildEOL) {}
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, getKind());
     if (!this->USR.empty()) { // USR is the most important
@@ -28,7 +28,7 @@ public:
                       std::move(USR), BeforeFirstChildEOL, IsSynthetic),
         EnumKey(Key), Attrs(Attrs), EnumBase(Base), Body(Body) {}
 
-  /// use CompositeNode's hashSignature, no need to rewrite
+  /// use CompositeNode's computeSignature, no need to rewrite
 
   static bool classof(const SemanticNode *N) {
     return N->getKind() == NodeKind::ENUM;
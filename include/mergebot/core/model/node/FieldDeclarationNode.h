@@ -23,7 +23,7 @@ public:
                      FollowingEOL, IsSynthetic),
         Declarator(std::move(Declarator)), IsFieldDecl(IsFieldDecl) {}
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, getKind());
     if (!USR.empty()) {
@@ -46,10 +46,25 @@ public:
     return N->getKind() == NodeKind::FIELD_DECLARATION;
   }
 
+  /// k-gram sketch of Declarator, for util::sketch_cosine
+  const util::KGramSketch &declaratorSketch() const {
+    assert(sealed() && "sketches are computed when sealed");
+    return DeclaratorSketch;
+  }
+
   std::string Declarator;
   bool IsFieldDecl;
 
   std::vector<std::string> References;
+
+protected:
+  void computeSketches() override {
+    TerminalNode::computeSketches();
+    DeclaratorSketch = util::KGramSketch(Declarator);
+  }
+
+private:
+  util::KGramSketch DeclaratorSketch;
 };
 } // namespace mergebot::sa
 #endif // MB_INCLUDE_MERGEBOT_CORE_MODEL_NODE_FIELDDECLARATIONNODE_H
@@ -34,7 +34,7 @@ public:
     return N->getKind() == NodeKind::FUNC_DEF;
   }
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, getKind());
     if (!USR.empty()) {
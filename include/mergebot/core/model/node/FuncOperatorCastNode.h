@@ -36,7 +36,7 @@ public:
     return N->getKind() == NodeKind::FUNC_OPERATOR_CAST;
   }
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, getKind());
     if (!USR.empty()) {
@@ -22,7 +22,7 @@ public:
                       std::move(USR), BeforeFirstChildEOLs, IsSynthetic),
         ParentSignatureHash(ParentSignatureHash) {}
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, this->Kind);
     mergebot::hash_combine(H, this->ParentSignatureHash);
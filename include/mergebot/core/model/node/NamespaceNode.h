@@ -27,7 +27,7 @@ public:
     return N->getKind() == NodeKind::NAMESPACE;
   }
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, getKind());
     mergebot::hash_combine(H, TUPath);
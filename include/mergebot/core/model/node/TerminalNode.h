@@ -28,7 +28,7 @@ public:
     return lhs.Body == rhs.Body;
   }
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, getKind());
     mergebot::hash_combine(H, this->Body);
@@ -40,11 +40,26 @@ public:
            N->getKind() <= NodeKind::LAST_TERMINAL_NODE;
   }
 
+  /// k-gram sketch of Body, for util::sketch_cosine
+  const util::KGramSketch &bodySketch() const {
+    assert(sealed() && "sketches are computed when sealed");
+    return BodySketch;
+  }
+
   std::string Body;
   size_t ParentSignatureHash;
 
   // for FuncDefNode, FuncSpecialMemberNode and FuncOperatorCastNode
   bool SigUnchanged;
+
+protected:
+  void computeSketches() override {
+    SemanticNode::computeSketches();
+    BodySketch = util::KGramSketch(Body);
+  }
+
+private:
+  util::KGramSketch BodySketch;
 };
 } // namespace sa
 } // namespace mergebot
@@ -24,7 +24,7 @@ public:
                      FollowingEOL, IsSynthetic),
         TUPath(TUPath) {}
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     //    mergebot::hash_combine(H, this->ParentSignatureHash);
     mergebot::hash_combine(H, this->Body);
@@ -33,7 +33,7 @@ public:
     return N->getKind() == NodeKind::TRANSLATION_UNIT;
   }
 
-  size_t hashSignature() const override {
+  size_t computeSignature() const override {
     size_t H = 1;
     mergebot::hash_combine(H, getKind());
     mergebot::hash_combine(H, this->QualifiedName);
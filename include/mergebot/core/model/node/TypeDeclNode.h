@@ -42,16 +42,16 @@ public:
       return;
     }
     AccessSpecifierKind AccessKind = AccessSpecifierKind::Default;
-    std::shared_ptr<SemanticNode> FirstChild = this->Children.front();
+    SemanticNode *FirstChild = this->Children.front();
     if (auto *AccessSpecifierPtr =
-            llvm::dyn_cast<AccessSpecifierNode>(FirstChild.get())) {
+            llvm::dyn_cast<AccessSpecifierNode>(FirstChild)) {
       AccessKind = AccessSpecifierPtr->AccessKind;
     }
     for (size_t idx = 1; idx < this->Children.size(); ++idx) {
-      if (!llvm::isa<AccessSpecifierNode>(this->Children[idx].get())) {
+      if (!llvm::isa<AccessSpecifierNode>(this->Children[idx])) {
         this->Children[idx]->AccessSpecifier = AccessKind;
       } else {
-        AccessKind = llvm::cast<AccessSpecifierNode>(this->Children[idx].get())
+        AccessKind = llvm::cast<AccessSpecifierNode>(this->Children[idx])
                          ->AccessKind;
       }
     }
@@ -5,19 +5,27 @@
 #ifndef MB_GRAPH_BUILDER_H
 #define MB_GRAPH_BUILDER_H
 
+#include "mergebot/core/StableWorkspace.h"
 #include "mergebot/core/handler/SAHandler.h"
 #include "mergebot/core/model/ConflictFile.h"
+#include "mergebot/core/model/NodeArena.h"
 #include "mergebot/core/model/SemanticEdge.h"
 #include "mergebot/core/model/SemanticNode.h"
 #include "mergebot/core/model/enum/Side.h"
 #include "mergebot/core/model/node/TypeDeclNode.h"
+#include "mergebot/core/semantic/SymbolCache.h"
+#include "mergebot/core/semantic/SymbolIndex.h"
 #include "mergebot/filesystem.h"
-#include "mergebot/lsp/client.h"
+#include "mergebot/lsp/client_pool.h"
 #include "mergebot/parser/tree.h"
 #include <boost/graph/graph_selectors.hpp>
+#include <clang/Tooling/CompilationDatabase.h>
 #include <magic_enum.hpp>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -41,8 +49,8 @@ public:
       boost::listS,     // Store out-edges of each vertex in std::list
       boost::vecS,      // Store vertex set in std::vector
       boost::directedS, // The graph is directed
-      std::shared_ptr<SemanticNode>, // Vertex properties
-      SemanticEdge                   // Edge properties
+      SemanticNode *,   // Vertex properties, owned by the arena
+      SemanticEdge      // Edge properties
       >
       SemanticGraph;
 
@@ -51,10 +59,16 @@ public:
                std::vector<std::string> const &SourceList,    // relative paths
                std::unordered_map<std::string, std::vector<std::string>> const
                    &DirectIncluded,
+               std::shared_ptr<clang::tooling::CompilationDatabase>
+                   Compilations = nullptr,
+               std::shared_ptr<SymbolCache> Symbols = nullptr,
+               std::shared_ptr<NodeArena> Arena = nullptr,
                bool OnlyHeaderSourceMapping = true)
       : S(S), Meta(Meta),
         ConflictPaths(ConflictPaths.begin(), ConflictPaths.end()),
         SourceList(SourceList), DirectIncluded(DirectIncluded),
+        Compilations(std::move(Compilations)), Symbols(std::move(Symbols)),
+        Arena(Arena ? std::move(Arena) : std::make_shared<NodeArena>()),
         OnlyHeaderSourceMapping(OnlyHeaderSourceMapping) {
     SourceDir = (fs::path(Meta.MSCacheDir) / magic_enum::enum_name(S)).string();
 
@@ -80,6 +94,19 @@ public:
   size_t numEdges() const { return boost::num_edges(G); }
   size_t numVertices() const { return boost::num_vertices(G); }
 
+  /// the subgraph of a translation unit built by a worker, with node and edge
+  /// ids local to it
+  struct TranslationUnitGraph {
+    SemanticGraph G;
+    int NodeCount = 0;
+    int EdgeCount = 0;
+  };
+  /// append \p Unit to \p Into, whose ids are taken up to \p NodeCount and
+  /// \p EdgeCount, renumbering its nodes and edges after them and advancing
+  /// both counts, as if it was built right into \p Into
+  static void mergeTranslationUnit(SemanticGraph &Into, int &NodeCount,
+                                   int &EdgeCount, TranslationUnitGraph &Unit);
+
   static std::unordered_set<std::string> CompositeTypes;
   static std::unordered_set<std::string> TerminalTypes;
   static std::unordered_set<std::string> ComplexTypes;
@@ -92,77 +119,119 @@ private:
 
   void processTranslationUnit(const std::string &Path);
 
+  /// process the translation units with \p Workers builders, each leasing its
+  /// own clangd, then merge their subgraphs in the order of `SourceList`, so
+  /// that the graph is the same as the one built serially
+  void processTranslationUnits(size_t Workers);
+  /// a builder of the same side sharing the symbol index, cache and
+  /// workspace of this one, nullptr if its clangd cannot be started
+  std::unique_ptr<GraphBuilder> spawnWorker() const;
+
   void processCppTranslationUnit(const std::string &Path,
                                  const std::string &FilePath,
                                  bool IsConflicting);
-  void parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
-                          const vertex_descriptor &V, bool IsConflicting,
-                          const ts::Node &Root, const std::string &Path,
-                          const int FirstChildIdx = 0);
-  std::shared_ptr<TranslationUnitNode>
-  parseTranslationUnit(const ts::Node &Node, bool IsConflicting,
-                       const std::string &Path, const std::string &FilePath,
-                       size_t &FrontDeclCnt, ts::Node &TURoot);
-  std::shared_ptr<NamespaceNode> parseNamespaceNode(const ts::Node &Node,
-                                                    bool IsConflicting,
-                                                    const std::string &Path);
-  std::shared_ptr<TextualNode> parseTextualNode(const ts::Node &Node,
-                                                bool IsConflicting,
-                                                size_t ParentSignatureHash,
-                                                const std::string &Path);
-  std::shared_ptr<FieldDeclarationNode> parseFieldDeclarationNode(
+  void parseCompositeNode(SemanticNode *SRoot, const vertex_descriptor &V,
+                          bool IsConflicting, const ts::Node &Root,
+                          const std::string &Path, const int FirstChildIdx = 0);
+  TranslationUnitNode *parseTranslationUnit(
+      const ts::Node &Node, bool IsConflicting, const std::string &Path,
+      const std::string &FilePath, size_t &FrontDeclCnt, ts::Node &TURoot);
+  NamespaceNode *parseNamespaceNode(const ts::Node &Node, bool IsConflicting,
+                                    const std::string &Path);
+  TextualNode *parseTextualNode(const ts::Node &Node, bool IsConflicting,
+                                size_t ParentSignatureHash,
+                                const std::string &Path);
+  FieldDeclarationNode *parseFieldDeclarationNode(
       const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash,
       const std::string &FilePath, bool IsFieldDecl = true);
-  std::shared_ptr<LinkageSpecNode>
-  parseLinkageSpecNode(const ts::Node &Node, bool IsConflicting,
-                       size_t ParentSignatureHash);
-  std::shared_ptr<EnumNode> parseEnumNode(const ts::Node &Node,
-                                          bool IsConflicting,
-                                          const std::string &FilePath);
-  std::pair<std::shared_ptr<TypeDeclNode>, TypeDeclNode::TypeDeclKind>
+  LinkageSpecNode *parseLinkageSpecNode(
+      const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash);
+  EnumNode *parseEnumNode(const ts::Node &Node, bool IsConflicting,
+                          const std::string &FilePath);
+  std::pair<TypeDeclNode *, TypeDeclNode::TypeDeclKind>
   parseTypeDeclNode(const ts::Node &Node, const ts::Node &RealNode,
                     bool IsConflicting, const std::string &Path);
 
-  std::shared_ptr<FuncDefNode> parseFuncDefNode(const ts::Node &Node,
-                                                const ts::Node &RealNode,
-                                                bool IsConflicting,
-                                                size_t ParentSignatureHash,
-                                                const std::string &FilePath);
+  FuncDefNode *parseFuncDefNode(const ts::Node &Node, const ts::Node &RealNode,
+                                bool IsConflicting, size_t ParentSignatureHash,
+                                const std::string &FilePath);
 
-  std::shared_ptr<FuncOperatorCastNode>
-  parseFuncOperatorCastNode(const ts::Node &Node, bool IsConflicting,
-                            size_t ParentSignatureHash,
-                            const std::string &FilePath);
+  FuncOperatorCastNode *parseFuncOperatorCastNode(
+      const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash,
+      const std::string &FilePath);
 
-  std::shared_ptr<FuncSpecialMemberNode>
-  parseFuncSpecialMemberNode(const ts::Node &Node, bool IsConflicting,
-                             size_t ParentSignatureHash,
-                             const std::string &FilePath);
+  FuncSpecialMemberNode *parseFuncSpecialMemberNode(
+      const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash,
+      const std::string &FilePath);
 
   void addIncludeEdges();
   void addReferenceEdges();
   void addUseEdges();
 
   bool initLanguageServer();
+  /// index the sources in process, see SymbolIndex
+  void buildSymbolIndex();
+  /// send compile commands of the sources to analyze to clangd
+  void pushCompileCommands();
+  /// mirror what's materialized in the side dir to the stable workspace
+  void syncWorkspace();
+  /// \p Path under the side dir as seen by clangd
+  std::string toWorkspace(const std::string &Path) const;
   std::optional<lsp::SymbolDetails> getSymbolDetails(const lsp::URIForFile &URI,
                                                      const lsp::Position Pos);
 
   std::vector<std::string> getReferences(const lsp::URIForFile &URI,
                                          const lsp::Position Pos);
 
+  /// dry-run the parse of a translation unit to record the symbol queries it
+  /// issues, then send them to clangd all at once and keep the answers for
+  /// the real parse
+  void prefetchSymbols(const std::string &Path, const std::string &FilePath,
+                       bool IsConflicting, const ts::Node &TSRoot);
+
+  /// hash of what clangd's answers about \p FilePath depend on besides its
+  /// content: its compile command and direct includes, and its counterpart
+  uint64_t includeContextHash(const std::string &Path,
+                              const std::string &FilePath,
+                              const std::string &AltFileContent) const;
+  /// the key of a query in the shared cache, nullopt if the query is not
+  /// about the translation unit being parsed, or its results are not
+  /// shareable
+  std::optional<SymbolCache::Key> cacheKeyOf(const lsp::URIForFile &URI,
+                                             const lsp::Position Pos,
+                                             SymbolCache::Method M) const;
+  /// ask the shared cache first, then clangd with \p Ask
+  template <typename AskFn>
+  std::optional<nlohmann::json> querySymbolCache(const lsp::URIForFile &URI,
+                                                 const lsp::Position Pos,
+                                                 SymbolCache::Method M,
+                                                 AskFn &&Ask);
+
   bool isConflicting(std::string_view Path) const;
 
-  vertex_descriptor addVertex(std::shared_ptr<SemanticNode> Node);
+  /// nodes are created in the arena of the scenario, the throwaway ones of
+  /// the dry run in a scratch arena dropped with it
+  template <typename T, typename... Args> T *makeNode(Args &&...Arguments) {
+    NodeArena &Into = Prefetch.Recording ? *Prefetch.Scratch : *Arena;
+    return Into.create<T>(std::forward<Args>(Arguments)...);
+  }
+
+  vertex_descriptor addVertex(SemanticNode *Node);
   std::pair<edge_descriptor, bool> addEdge(vertex_descriptor Source,
                                            vertex_descriptor Target,
                                            SemanticEdge Edge);
 
   std::pair<vertex_descriptor, bool>
-  insertToGraphAndParent(std::shared_ptr<SemanticNode> &ParentPtr,
+  insertToGraphAndParent(SemanticNode *ParentPtr,
                          const vertex_descriptor &ParentDesc,
-                         const std::shared_ptr<SemanticNode> &CurPtr);
+                         SemanticNode *CurPtr);
 
-  lsp::LspClient Client;
+  /// clangd leased from the pool for the lifetime of the builder
+  lsp::ClientPool::Lease Client;
+  /// where clangd sees the sources, null if it works in the side dir
+  std::shared_ptr<StableWorkspace> Workspace;
+  /// builds translation units for another builder, see spawnWorker
+  bool IsWorker = false;
 
   /// build for which side
   Side S;
@@ -174,6 +243,14 @@ private:
   std::vector<std::string> SourceList;
   /// mapping of source's direct included files for each source in `SourceList`
   std::unordered_map<std::string, std::vector<std::string>> DirectIncluded;
+  /// CompDB viewed from this side, fed to clangd as there is no CompDB on
+  /// disk in the side dir
+  std::shared_ptr<clang::tooling::CompilationDatabase> Compilations;
+  /// symbol results shared with the other sides of the scenario, optional
+  std::shared_ptr<SymbolCache> Symbols;
+  /// owns the nodes of the graph, shared by the builders of a scenario. One
+  /// of the builder's own if none is given
+  std::shared_ptr<NodeArena> Arena;
 
   bool OnlyHeaderSourceMapping;
 
@@ -184,6 +261,32 @@ private:
   int NodeCount = 0;
   int EdgeCount = 0;
 
+  /// symbols resolved in process, consulted before clangd if enabled
+  std::shared_ptr<SymbolIndex> Index;
+
+  /// symbol queries of the translation unit being parsed
+  struct SymbolPrefetch {
+    using Query = std::pair<lsp::URIForFile, lsp::Position>;
+    using QueryKey = std::tuple<lsp::URIForFile, int, int>;
+
+    /// in the dry run, queries are recorded rather than sent, and nothing is
+    /// added to the graph
+    bool Recording = false;
+    /// nodes of the dry run
+    std::unique_ptr<NodeArena> Scratch;
+    std::vector<Query> InfoQueries;
+    std::vector<Query> RefQueries;
+    std::map<QueryKey, std::optional<lsp::SymbolDetails>> Infos;
+    std::map<QueryKey, std::vector<std::string>> Refs;
+  } Prefetch;
+
+  /// the translation unit being parsed, as seen by the shared cache
+  struct SymbolCacheScope {
+    std::string FilePath;
+    uint64_t ContentHash = 0;
+    uint64_t ContextHash = 0;
+  } CacheScope;
+
   std::mutex ClientMutex;
 
   /**
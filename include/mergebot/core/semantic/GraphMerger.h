@@ -37,22 +37,20 @@ public:
   std::string getMergedDir() const { return MergedDir; }
 
 private:
-  using RCSemanticNode = std::shared_ptr<SemanticNode>;
+  using RCSemanticNode = SemanticNode *;
   using NeighborTuple =
       std::tuple<RCSemanticNode, RCSemanticNode, RCSemanticNode>;
-  void mergeSemanticNode(std::shared_ptr<SemanticNode> &BaseNode);
+  void mergeSemanticNode(SemanticNode *BaseNode);
 
-  void threeWayMergeChildren(
-      const std::vector<std::shared_ptr<SemanticNode>> &OurChildren,
-      std::vector<std::shared_ptr<SemanticNode>> &BaseChildren,
-      const std::vector<std::shared_ptr<SemanticNode>> &TheirChildren);
+  void threeWayMergeChildren(const std::vector<SemanticNode *> &OurChildren,
+                             std::vector<SemanticNode *> &BaseChildren,
+                             const std::vector<SemanticNode *> &TheirChildren);
 
   /// Merge children nodes from three versions (base, ours, theirs),
   /// the order is determined by OrderInFavour
-  std::vector<std::shared_ptr<SemanticNode>>
-  directMergeChildren(const std::shared_ptr<SemanticNode> &OurNode,
-                      const std::shared_ptr<SemanticNode> &BaseNode,
-                      const std::shared_ptr<SemanticNode> &TheirNode);
+  std::vector<SemanticNode *>
+  directMergeChildren(SemanticNode *OurNode, SemanticNode *BaseNode,
+                      SemanticNode *TheirNode);
 
   /// Merge children nodes from three versions (base, ours, theirs),
   /// prioritizing the order from our version
@@ -60,10 +58,9 @@ private:
   /// @param BaseNode The node from base version
   /// @param TheirNode The node from their version
   /// @return A vector of merged children nodes
-  std::vector<std::shared_ptr<SemanticNode>>
-  directMergeChildrenInOurOrder(const std::shared_ptr<SemanticNode> &OurNode,
-                                const std::shared_ptr<SemanticNode> &BaseNode,
-                                const std::shared_ptr<SemanticNode> &TheirNode);
+  std::vector<SemanticNode *>
+  directMergeChildrenInOurOrder(SemanticNode *OurNode, SemanticNode *BaseNode,
+                                SemanticNode *TheirNode);
 
   /// Merge children nodes from three versions (base, ours, theirs),
   /// prioritizing the order from their version
@@ -71,10 +68,8 @@ private:
   /// @param BaseNode The node from base version
   /// @param TheirNode The node from their version
   /// @return A vector of merged children nodes
-  std::vector<std::shared_ptr<SemanticNode>> directMergeChildrenInTheirOrder(
-      const std::shared_ptr<SemanticNode> &OurNode,
-      const std::shared_ptr<SemanticNode> &BaseNode,
-      const std::shared_ptr<SemanticNode> &TheirNode);
+  std::vector<SemanticNode *> directMergeChildrenInTheirOrder(
+      SemanticNode *OurNode, SemanticNode *BaseNode, SemanticNode *TheirNode);
 
   std::vector<std::string>
   mergeStrVecByUnion(const std::vector<std::string> &V1,
@@ -89,13 +84,13 @@ private:
                      const std::vector<std::string> &BaseList,
                      const std::vector<std::string> &TheirList) const;
 
-  std::vector<std::shared_ptr<SemanticNode>>
-  filterAddedNodes(const std::shared_ptr<SemanticNode> &BaseNode,
+  std::vector<SemanticNode *>
+  filterAddedNodes(SemanticNode *BaseNode,
                    const TwoWayMatching &Matching) const;
 
-  std::vector<std::shared_ptr<SemanticNode>> removeDuplicates(
-      std::vector<std::shared_ptr<SemanticNode>> &&OurAdded,
-      std::vector<std::shared_ptr<SemanticNode>> &&TheirAdded) const;
+  std::vector<SemanticNode *>
+  removeDuplicates(std::vector<SemanticNode *> &&OurAdded,
+                   std::vector<SemanticNode *> &&TheirAdded) const;
 
   std::optional<NeighborTuple> getNeighbors(const RCSemanticNode &Node) const;
 
@@ -0,0 +1,81 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_INDEXEDCOMPDB_H
+#define MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_INDEXEDCOMPDB_H
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <cstdint>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+/// A JSON CompDB which is parsed lazily.
+///
+/// The compile_commands.json is memory-mapped and scanned once to build a
+/// sorted index from the (absolute, normalized) file path to the byte range of
+/// its entry, entries are parsed only when getCompileCommands asks for them.
+/// The index can be persisted, so that later scenarios of the same project
+/// skip the scan as long as the CompDB is not modified.
+class IndexedCompDB : public clang::tooling::CompilationDatabase {
+public:
+  /// load CompDB at \p CompDBPath, reuse the index persisted at \p IndexPath
+  /// if it's still valid, otherwise scan the CompDB and persist the index to
+  /// \p IndexPath (if not empty)
+  /// \return nullptr and set \p ErrMsg if the CompDB is malformed
+  static std::unique_ptr<IndexedCompDB> load(const std::string &CompDBPath,
+                                             const std::string &IndexPath,
+                                             std::string &ErrMsg);
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override;
+
+  std::vector<std::string> getAllFiles() const override;
+
+  /// number of entries in the CompDB
+  size_t size() const noexcept { return Records_.size(); }
+
+  /// normalize \p File relative to \p Directory to the form used as index key
+  static std::string normalize(llvm::StringRef Directory, llvm::StringRef File);
+
+private:
+  struct Record {
+    uint32_t PathOffset;
+    uint32_t PathLength;
+    uint64_t Offset;
+    uint64_t Length;
+  };
+
+  IndexedCompDB(std::string CompDBPath,
+                std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : CompDBPath_(std::move(CompDBPath)), Buffer_(std::move(Buffer)) {}
+
+  /// build the index in one pass over the buffer
+  bool scan(std::string &ErrMsg);
+  bool readIndex(const std::string &IndexPath, uint64_t Size, int64_t MTime);
+  bool writeIndex(const std::string &IndexPath, uint64_t Size,
+                  int64_t MTime) const;
+  void addRecord(std::string_view Path, uint64_t Offset, uint64_t Length);
+  void sortRecords();
+  std::string_view pathOf(const Record &R) const {
+    return std::string_view(PathPool_).substr(R.PathOffset, R.PathLength);
+  }
+  bool parseEntry(const Record &R, clang::tooling::CompileCommand &Cmd) const;
+
+  std::string CompDBPath_;
+  std::unique_ptr<llvm::MemoryBuffer> Buffer_;
+  /// all the paths, concatenated
+  std::string PathPool_;
+  /// sorted by path, entries of the same file keep their order in the CompDB
+  std::vector<Record> Records_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_INDEXEDCOMPDB_H
@@ -0,0 +1,70 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_REMAPPEDCOMPDB_H
+#define MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_REMAPPEDCOMPDB_H
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/StringRef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+/// A view of the original project's CompDB as if it was generated in one of
+/// the revision dirs of a merge scenario.
+///
+/// The original CompDB is parsed once per project and shared by all the sides
+/// and scenarios, paths under the original project root are remapped on the
+/// fly in both directions: queried files from the side dir to the project,
+/// and directory/file/output/arguments of returned commands from the project
+/// to the side dir.
+class RemappedCompDB : public clang::tooling::CompilationDatabase {
+public:
+  /// \param Base CompDB of the original project
+  /// \param From root of the original project
+  /// \param To revision dir that substitutes \p From
+  RemappedCompDB(std::shared_ptr<clang::tooling::CompilationDatabase> Base,
+                 std::string From, std::string To);
+
+  /// load CompDB at \p CompDBPath with missing commands inferred. It's indexed
+  /// only once and cached until the file is modified, the index is persisted
+  /// in \p IndexDir (if not empty) to be reused by later processes.
+  /// \return nullptr and set \p ErrMsg if the CompDB cannot be loaded
+  static std::shared_ptr<clang::tooling::CompilationDatabase>
+  loadShared(const std::string &CompDBPath, const std::string &IndexDir,
+             std::string &ErrMsg);
+
+  /// find the CompDB of the project the way users are told to place it:
+  /// project-root, project-root/build, or the specified \p CDBPath
+  /// \return path of the CompDB, empty if none of them exists
+  static std::string locate(const std::string &ProjectPath,
+                            const std::string &CDBPath);
+
+  /// replace every occurrence of the path \p From in \p S with \p To, an
+  /// occurrence must end at a path separator or a non-path character
+  static std::string remap(llvm::StringRef S, llvm::StringRef From,
+                           llvm::StringRef To);
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override;
+
+  std::vector<std::string> getAllFiles() const override;
+
+  std::vector<clang::tooling::CompileCommand>
+  getAllCompileCommands() const override;
+
+private:
+  clang::tooling::CompileCommand
+  remapCommand(clang::tooling::CompileCommand Cmd) const;
+
+  std::shared_ptr<clang::tooling::CompilationDatabase> Base_;
+  std::string From_;
+  std::string To_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_REMAPPEDCOMPDB_H
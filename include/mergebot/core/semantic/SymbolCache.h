@@ -0,0 +1,129 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_SYMBOLCACHE_H
+#define MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_SYMBOLCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace mergebot {
+namespace sa {
+/// LSP symbol results shared by the graph builders of a scenario.
+///
+/// Most of the analyzed files are byte-identical across base, ours and
+/// theirs, and the builders ask their own clangd about the same positions of
+/// them. Results are keyed by what determines them: the content of the file,
+/// its include context (compile command and direct includes), the position
+/// and the method, so that a file is resolved once for all the sides.
+///
+/// Only symbol info is shared. References are project wide: the callers of a
+/// byte-identical header differ across sides, which is just what the merge is
+/// about, so they are never shared nor persisted, see shareable.
+///
+/// The first builder to miss a key claims it and must fulfill it, the others
+/// asking meanwhile wait for its result instead of asking their clangd.
+class SymbolCache {
+public:
+  enum class Method : uint8_t { SymbolInfo, References };
+
+  struct Key {
+    uint64_t ContentHash;
+    uint64_t ContextHash;
+    uint32_t Line;
+    uint32_t Column;
+    Method M;
+
+    bool operator==(const Key &Other) const {
+      return ContentHash == Other.ContentHash &&
+             ContextHash == Other.ContextHash && Line == Other.Line &&
+             Column == Other.Column && M == Other.M;
+    }
+  };
+
+  using Result = std::optional<nlohmann::json>;
+
+  /// whether results of \p M depend on the keyed translation unit only, and
+  /// can be shared across sides and scenarios
+  static bool shareable(Method M) noexcept { return M == Method::SymbolInfo; }
+
+  /// whether results are persisted in the project cache dir, set
+  /// `MERGEBOT_SYMBOL_CACHE_PERSIST=1` to enable it
+  static bool persistent();
+
+  /// a cache which loads results persisted at \p Path, and saves to it; an
+  /// empty \p Path makes an in-memory cache
+  static std::shared_ptr<SymbolCache> open(std::string Path = "");
+
+  /// persist the resolved results, a no-op for in-memory caches
+  bool save() const;
+
+  /// the result of \p K if it's resolved, or being resolved, by someone else.
+  /// Otherwise \p Claimed is set and the caller must fulfill \p K, hold it
+  /// by a Claim to do so even if the caller throws. Keys not shareable are
+  /// always claimed, and their results dropped
+  std::shared_future<Result> acquire(const Key &K, bool &Claimed);
+
+  void fulfill(const Key &K, Result R);
+
+  /// a claimed key, fulfilled as a failure on destruction unless fulfilled
+  /// before, so that waiters of a claimant unwinding by an exception fall
+  /// back to their own clangd instead of waiting forever. Empty claims, of
+  /// queries never claimed, do nothing
+  class Claim {
+  public:
+    Claim() = default;
+    Claim(SymbolCache &Cache, const Key &K) : Cache_(&Cache), K_(K) {}
+    Claim(Claim &&Other) noexcept : Cache_(Other.Cache_), K_(Other.K_) {
+      Other.Cache_ = nullptr;
+    }
+    Claim &operator=(Claim &&Other) noexcept;
+    Claim(const Claim &) = delete;
+    Claim &operator=(const Claim &) = delete;
+    ~Claim() { release(); }
+
+    void fulfill(Result R);
+
+  private:
+    void release() noexcept;
+
+    SymbolCache *Cache_ = nullptr;
+    Key K_{};
+  };
+
+  size_t size() const;
+  size_t hits() const noexcept { return Hits_; }
+  size_t misses() const noexcept { return Misses_; }
+
+private:
+  struct KeyHash {
+    size_t operator()(const Key &K) const noexcept;
+  };
+
+  struct Entry {
+    std::shared_future<Result> Future;
+    /// set until the entry is fulfilled
+    std::shared_ptr<std::promise<Result>> Promise;
+  };
+
+  explicit SymbolCache(std::string Path) : Path_(std::move(Path)) {}
+  void load();
+
+  std::string Path_;
+  mutable std::mutex Mutex_;
+  std::unordered_map<Key, Entry, KeyHash> Entries_;
+  std::atomic<size_t> Hits_{0};
+  std::atomic<size_t> Misses_{0};
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_SYMBOLCACHE_H
@@ -0,0 +1,88 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_SYMBOLINDEX_H
+#define MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_SYMBOLINDEX_H
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <cstdint>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+struct IndexShard;
+}
+
+/// USRs and references of the sources to analyze, resolved in process with
+/// clang's indexer.
+///
+/// GraphBuilder asks clangd for the symbol info, and often the references, of
+/// every declaration it meets, one position at a time. The index runs clang's
+/// indexer once per translation unit, in parallel, and answers the same
+/// questions from a position to symbol table and a USR to references map.
+/// Positions it cannot answer (e.g. sources failed to compile) are still left
+/// to clangd.
+class SymbolIndex {
+public:
+  struct Symbol {
+    std::string Name;
+    /// qualifier of the symbol with the trailing "::", like the containerName
+    /// of clangd's symbolInfo
+    std::string ContainerName;
+    std::string USR;
+  };
+
+  /// whether GraphBuilder resolves symbols in process, set
+  /// `MERGEBOT_INPROCESS_INDEX=1` to enable it
+  static bool enabled();
+
+  /// index \p Files (absolute paths) in parallel, only occurrences in files
+  /// under \p Root are kept
+  static std::unique_ptr<SymbolIndex>
+  build(const clang::tooling::CompilationDatabase &CompDB,
+        const std::vector<std::string> &Files, llvm::StringRef Root);
+
+  /// the symbol whose name spans (\p Line, \p Column) of \p File, both are
+  /// 0-based like LSP positions
+  /// \return nullptr if there is none
+  const Symbol *lookup(llvm::StringRef File, unsigned Line,
+                       unsigned Column) const;
+
+  /// qualified names of the declarations referencing \p USR
+  std::vector<std::string> references(llvm::StringRef USR) const;
+
+  size_t numSymbols() const noexcept { return Symbols_.size(); }
+
+  /// the form of file paths used as keys
+  static std::string normalize(llvm::StringRef File);
+
+private:
+  struct Occurrence {
+    unsigned Line;
+    unsigned Column;
+    unsigned Length;
+    /// declarations win over references at the same position
+    bool IsDecl;
+    uint32_t SymbolIdx;
+  };
+
+  void merge(detail::IndexShard &Shard);
+  void finalize();
+
+  std::vector<Symbol> Symbols_;
+  llvm::StringMap<uint32_t> SymbolByUSR_;
+  /// per file, sorted by position
+  llvm::StringMap<std::vector<Occurrence>> Occurrences_;
+  /// USR to containers of its references, deduplicated
+  llvm::StringMap<std::vector<std::string>> References_;
+};
+} // namespace sa
+} // namespace mergebot
+
+#endif // MB_INCLUDE_MERGEBOT_CORE_SEMANTIC_SYMBOLINDEX_H
@@ -45,7 +45,7 @@ struct SemanticNodeWriter {
 
   template <class VertexDesc>
   void operator()(std::ostream &out, const VertexDesc &v) const {
-    const std::shared_ptr<SemanticNode> &node = g[v];
+    SemanticNode *node = g[v];
     if (!showSynthetic && node->IsSynthetic) {
       out << fmt::format("[style=invis]");
       return;
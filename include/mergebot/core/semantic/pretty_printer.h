@@ -9,10 +9,9 @@
 #include "mergebot/filesystem.h"
 #include <memory>
 namespace mergebot::sa {
-std::string PrintTU(const std::shared_ptr<SemanticNode> &TUNode,
-                    const std::string &DestDir);
+std::string PrintTU(SemanticNode *TUNode, const std::string &DestDir);
 
-std::string PrettyPrintTU(const std::shared_ptr<SemanticNode> &TUNode,
+std::string PrettyPrintTU(SemanticNode *TUNode,
                           const std::string &DestDir,
                           const std::string &ClangFormatPath =
                               (fs::current_path() / ".clang-format").string());
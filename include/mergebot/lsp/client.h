@@ -8,8 +8,13 @@
 #include <spdlog/spdlog.h>
 #include <sys/wait.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <nlohmann/json.hpp>
-#include <shared_mutex>
 
 #include "communicator.h"
 #include "mergebot/filesystem.h"
@@ -47,21 +52,35 @@ class JSONRpcEndpoint final {
   /**
    * @brief Receives a JSON RPC response from the network.
    *
-   * This method reads the headers and content of a response from the network,
-   * parses the content into a JSON object, and returns it.
+   * This method reads whatever the Communicator has in large chunks, frames
+   * the headers and content of a response incrementally, parses the content
+   * into a JSON object, and returns it. An empty (null) response is returned
+   * if no complete message is available yet, or the read was interrupted,
+   * nullopt if the connection is closed or the message is malformed.
    */
   std::optional<RpcResponseBody> RecvResponse();
 
+  /**
+   * @brief Wakes up a RecvResponse blocked in the Communicator.
+   */
+  void Interrupt() { communicator->interrupt(); }
+
  private:
   std::string fillMessageHeader(const std::string &json);
-  std::string readLine();
-  std::string readMessageContent(ssize_t len);
+  /// try to cut a complete message out of the inbox
+  std::optional<std::string> takeFrame(bool &malformed);
 
   const char *LEN_HEADER = "Content-Length: ";
   const char *TYPE_HEADER = "Content-Type: ";
 
   std::unique_ptr<Communicator> communicator;
-  std::shared_mutex rwMutex;
+  /// reading and writing are independent, a pending read shouldn't block
+  /// requests from being sent
+  std::mutex readMutex;
+  std::mutex writeMutex;
+  /// bytes read but not framed yet, starting at inboxPos
+  std::string inbox;
+  size_t inboxPos = 0;
 };
 
 /**
@@ -124,11 +143,43 @@ class LspEndpoint final {
   std::optional<JSONRpcResult> CallMethod(std::string_view method,
                                           const json &params = {});
 
+  /// invoked with the result, or nullopt on error or timeout
+  using Callback = std::function<void(std::optional<JSONRpcResult>)>;
+
+  /**
+   * @brief Calls a method on the Language Server without waiting.
+   *
+   * The callback runs on the thread reading responses as soon as the response
+   * arrives, so it should be cheap. It is called with nullopt if the server
+   * reports an error, does not respond within the timeout, or the endpoint is
+   * stopped.
+   * \return the id of the request
+   */
+  int CallMethodAsync(std::string_view method, const json &params,
+                      Callback callback);
+
+  /**
+   * @brief Future flavor of CallMethodAsync.
+   */
+  std::future<std::optional<JSONRpcResult>> CallMethodAsync(
+      std::string_view method, const json &params = {});
+
+  /**
+   * @brief Calls the method once per params with at most window requests in
+   * flight, and waits for all of them.
+   *
+   * \return results in the order of paramsList
+   */
+  std::vector<std::optional<JSONRpcResult>> CallMethodBatch(
+      std::string_view method, const std::vector<json> &paramsList,
+      size_t window);
+
   /**
    * @brief Stops the LspEndpoint.
    *
-   * This method sets a flag that causes the operator() method to return. It
-   * also wakes up any threads that are waiting for a response.
+   * This method sets a flag that causes the operator() method to return,
+   * interrupts it if it's blocked in reading. It also wakes up any threads
+   * that are waiting for a response.
    */
   void Stop();
 
@@ -141,10 +192,24 @@ class LspEndpoint final {
    */
   void operator()();
 
+  /**
+   * @brief Number of messages sent to the Language Server so far.
+   */
+  size_t RequestCount() const { return requestCount; }
+
  private:
+  struct PendingCall {
+    Callback callback;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
   void handleResult(int rpcId, const JSONRpcResult &result,
                     const JSONRpcError &error);
   void sendMessage(std::string_view method, const json &params, int id = -1);
+  /// move the callbacks of expired calls out, cvMutex should be held
+  void takeExpiredCalls(std::vector<Callback> &expired);
+  static std::optional<JSONRpcResult> unwrapResponse(const JSONRpcResult &result,
+                                                     const JSONRpcError &error);
 
   std::unique_ptr<JSONRpcEndpoint> rpcEndpoint;
   std::unordered_map<std::string, std::function<void(const json &)>>
@@ -154,11 +219,15 @@ class LspEndpoint final {
   std::mutex cvMutex;
   std::unordered_map<int, std::shared_ptr<std::condition_variable>> eventDict;
   std::unordered_map<int, std::pair<JSONRpcResult, JSONRpcError>> responseDict;
+  /// asynchronous calls waiting for responses
+  std::unordered_map<int, PendingCall> pendingCalls;
+  std::chrono::steady_clock::time_point nextSweep;
 
-  static int ID;
+  static std::atomic<int> ID;
   const char *jsonrpc = "2.0";
   int timeout = 3;
-  bool shutdownFlag = false;
+  std::atomic<bool> shutdownFlag{false};
+  std::atomic<size_t> requestCount{0};
 };
 
 class LspClient final {
@@ -232,6 +301,10 @@ class LspClient final {
 
   void Exit() { lspEndpoint->SendNotification("exit"); }
 
+  size_t RequestCount() const {
+    return lspEndpoint ? lspEndpoint->RequestCount() : 0;
+  }
+
   std::optional<JSONRpcResult> Sync() {
     return lspEndpoint->CallMethod("sync");
   }
@@ -360,6 +433,40 @@ class LspClient final {
                                    std::move(params));
   }
 
+  std::future<std::optional<JSONRpcResult>> ReferencesAsync(URIForFile uri,
+                                                            Position position) {
+    ReferenceParams params;
+    params.textDocument.uri = std::move(uri);
+    params.position = position;
+    return lspEndpoint->CallMethodAsync("textDocument/references",
+                                        std::move(params));
+  }
+
+  void ReferencesAsync(URIForFile uri, Position position,
+                       LspEndpoint::Callback callback) {
+    ReferenceParams params;
+    params.textDocument.uri = std::move(uri);
+    params.position = position;
+    lspEndpoint->CallMethodAsync("textDocument/references", std::move(params),
+                                 std::move(callback));
+  }
+
+  /// references of all the positions, at most window requests in flight
+  std::vector<std::optional<JSONRpcResult>> ReferencesBatch(
+      const std::vector<std::pair<URIForFile, Position>> &queries,
+      size_t window) {
+    std::vector<json> paramsList;
+    paramsList.reserve(queries.size());
+    for (const auto &[uri, position] : queries) {
+      ReferenceParams params;
+      params.textDocument.uri = uri;
+      params.position = position;
+      paramsList.emplace_back(std::move(params));
+    }
+    return lspEndpoint->CallMethodBatch("textDocument/references", paramsList,
+                                        window);
+  }
+
   std::optional<JSONRpcResult> SwitchSourceHeader(URIForFile uri) {
     TextDocumentIdentifier params;
     params.uri = std::move(uri);
@@ -414,6 +521,40 @@ class LspClient final {
                                    std::move(params));
   }
 
+  std::future<std::optional<JSONRpcResult>> SymbolInfoAsync(URIForFile uri,
+                                                            Position position) {
+    TextDocumentPositionParams params;
+    params.textDocument.uri = std::move(uri);
+    params.position = position;
+    return lspEndpoint->CallMethodAsync("textDocument/symbolInfo",
+                                        std::move(params));
+  }
+
+  void SymbolInfoAsync(URIForFile uri, Position position,
+                       LspEndpoint::Callback callback) {
+    TextDocumentPositionParams params;
+    params.textDocument.uri = std::move(uri);
+    params.position = position;
+    lspEndpoint->CallMethodAsync("textDocument/symbolInfo", std::move(params),
+                                 std::move(callback));
+  }
+
+  /// symbol info of all the positions, at most window requests in flight
+  std::vector<std::optional<JSONRpcResult>> SymbolInfoBatch(
+      const std::vector<std::pair<URIForFile, Position>> &queries,
+      size_t window) {
+    std::vector<json> paramsList;
+    paramsList.reserve(queries.size());
+    for (const auto &[uri, position] : queries) {
+      TextDocumentPositionParams params;
+      params.textDocument.uri = uri;
+      params.position = position;
+      paramsList.emplace_back(std::move(params));
+    }
+    return lspEndpoint->CallMethodBatch("textDocument/symbolInfo", paramsList,
+                                        window);
+  }
+
   std::optional<JSONRpcResult> TypeHierarchy(URIForFile uri, Position position,
                                              TypeHierarchyDirection direction,
                                              int resolve) {
@@ -451,12 +592,12 @@ class LspClient final {
                                    std::move(params));
   }
 
-  std::optional<JSONRpcResult> DidChangeConfiguration(
-      ConfigurationSettings &settings) {
+  void DidChangeConfiguration(ConfigurationSettings &settings) {
     DidChangeConfigurationParams params;
     params.settings = std::move(settings);
-    return lspEndpoint->CallMethod("workspace/didChangeConfiguration",
-                                   std::move(params));
+    // a notification by the spec, clangd never replies to it
+    lspEndpoint->SendNotification("workspace/didChangeConfiguration",
+                                  std::move(params));
   }
 
  private:
@@ -0,0 +1,159 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_LSP_CLIENT_POOL_H
+#define MB_INCLUDE_MERGEBOT_LSP_CLIENT_POOL_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "client.h"
+
+namespace mergebot {
+namespace lsp {
+/**
+ * @class ClientPool
+ * @brief Keeps initialized clangd instances warm between analyses.
+ *
+ * Forking clangd and letting it re-parse preambles dominates the cost of
+ * building a side's graph. Instances are keyed by (project, workspace root,
+ * CompDB). A GraphBuilder leases one for the duration of its build and gives
+ * it back to the pool afterwards, instead of shutting it down. Instances that
+ * have served too many requests, or grown over the memory cap, are shut down
+ * on release rather than kept.
+ *
+ * clangd keeps its background index under `$XDG_CACHE_HOME/clangd/index` for
+ * the commands pushed to it. If the key specifies an index dir, instances
+ * store the index there instead of the user's cache dir.
+ */
+class ClientPool final {
+ public:
+  struct Key {
+    std::string project;
+    std::string workspaceRoot;
+    std::string compDB;
+    /// used as XDG_CACHE_HOME of clangd, empty to inherit ours
+    std::string indexDir = "";
+
+    std::string str() const {
+      return project + '\n' + workspaceRoot + '\n' + compDB + '\n' + indexDir;
+    }
+  };
+
+  struct Options {
+    /// max instances kept idle, 0 disables pooling
+    size_t maxIdle = 3;
+    /// recycle an instance after it has been sent this many messages
+    size_t maxRequests = 200000;
+    /// recycle an instance once its resident memory exceeds this
+    size_t maxRssMB = 4096;
+
+    /// read `MERGEBOT_CLANGD_POOL_SIZE`, `MERGEBOT_CLANGD_MAX_REQUESTS` and
+    /// `MERGEBOT_CLANGD_MAX_RSS_MB`, fall back to the defaults above
+    static Options FromEnv();
+  };
+
+ private:
+  struct Entry {
+    std::string key;
+    pid_t pid = -1;
+    std::unique_ptr<LspClient> client;
+  };
+
+ public:
+  /**
+   * @class Lease
+   * @brief Exclusive use of a pooled client, returned to the pool on
+   * destruction.
+   */
+  class Lease final {
+   public:
+    Lease() = default;
+    Lease(ClientPool *pool, std::unique_ptr<Entry> entry, bool reused)
+        : pool(pool), entry(std::move(entry)), reused(reused) {}
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+    Lease(Lease &&other) noexcept { *this = std::move(other); }
+    Lease &operator=(Lease &&other) noexcept {
+      if (this != &other) {
+        Reset();
+        pool = other.pool;
+        entry = std::move(other.entry);
+        reused = other.reused;
+        other.pool = nullptr;
+      }
+      return *this;
+    }
+    ~Lease() { Reset(); }
+
+    LspClient *operator->() const { return entry->client.get(); }
+    LspClient &operator*() const { return *entry->client; }
+    explicit operator bool() const { return entry != nullptr; }
+
+    /// whether the client was warm, i.e. initialized by an earlier lease
+    bool Reused() const { return reused; }
+
+    /// give the client back to the pool now
+    void Reset() {
+      if (pool && entry) {
+        pool->release(std::move(entry));
+      }
+      pool = nullptr;
+    }
+
+   private:
+    ClientPool *pool = nullptr;
+    std::unique_ptr<Entry> entry;
+    bool reused = false;
+  };
+
+  ClientPool(Options options, std::string clangdPath)
+      : options(options), clangdPath(std::move(clangdPath)) {}
+  ~ClientPool() { Clear(); }
+
+  ClientPool(const ClientPool &) = delete;
+  ClientPool &operator=(const ClientPool &) = delete;
+
+  /**
+   * @brief The pool of the clangd shipped next to the current executable.
+   */
+  static ClientPool &Instance();
+
+  /**
+   * @brief Lease a client initialized with workspace root of the key.
+   *
+   * A warm instance of the same key is reused if there is one, otherwise a
+   * new clangd is spawned and initialized.
+   * \return an empty lease if clangd cannot be started
+   */
+  Lease Acquire(const Key &key);
+
+  /**
+   * @brief Shut down all the idle instances.
+   */
+  void Clear();
+
+  size_t IdleCount() const;
+
+ private:
+  std::unique_ptr<Entry> spawn(const Key &key) const;
+  void release(std::unique_ptr<Entry> entry);
+  bool healthy(const Entry &entry) const;
+  static void retire(std::unique_ptr<Entry> entry);
+
+  Options options;
+  std::string clangdPath;
+  mutable std::mutex mutex;
+  /// most recently released first
+  std::list<std::unique_ptr<Entry>> idle;
+};
+}  // namespace lsp
+}  // namespace mergebot
+
+#endif  // MB_INCLUDE_MERGEBOT_LSP_CLIENT_POOL_H
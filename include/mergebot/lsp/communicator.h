@@ -6,10 +6,14 @@
 #define MB_INCLUDE_MERGEBOT_LSP_COMMUNICATOR_H
 
 #include <spdlog/spdlog.h>
+#include <sys/uio.h>
 #include <sys/unistd.h>
 #include <sys/wait.h>
 
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace mergebot {
 
@@ -27,6 +31,13 @@ class Communicator {
 
   virtual ssize_t write(const std::string& message) = 0;
   virtual ssize_t read(void* buf, size_t len) = 0;
+
+  /**
+   * @brief Wakes up a reader blocked in read, later reads fail with EINTR.
+   *
+   * Communicators never block in read don't have to override it.
+   */
+  virtual void interrupt() {}
 };
 
 /**
@@ -43,12 +54,14 @@ class PipeCommunicator final : public Communicator {
    * @brief Factory method to construct PipeCommunicator
    *
    * This method creates the pipes and forks a new process. The child process
-   * executes the given executable with the given arguments.
+   * executes the given executable with the given arguments, in the
+   * environment of the current process overridden by `env` ("NAME=VALUE").
    * \return pointer of constructed PipeCommunicator, if the pointer is nullptr,
    * it means the construction failed.
    */
-  static std::unique_ptr<PipeCommunicator> create(const char* executable,
-                                                  const char* args);
+  static std::unique_ptr<PipeCommunicator> create(
+      const char* executable, const char* args,
+      const std::vector<std::string>& env = {});
 
   /**
    * @brief Destructor for PipeCommunicator.
@@ -69,10 +82,27 @@ class PipeCommunicator final : public Communicator {
    * @brief Reads a message from the output pipe.
    *
    * This method reads a message from the output pipe that the child process has
-   * written. It reads up to len bytes and stores them in buf.
+   * written. It reads up to len bytes and stores them in buf, without waiting
+   * for more once the pipe is drained. If nothing is read, errno is EAGAIN for
+   * an empty pipe and 0 for a closed one.
    */
   ssize_t read(void* buf, size_t len) override;
 
+  /**
+   * @brief Process id of the child process.
+   */
+  pid_t pid() const { return processId; }
+
+  /**
+   * @brief The (non-blocking) fd to read from the child process.
+   */
+  int readFd() const { return pipeOut[0]; }
+
+  /**
+   * @brief The fd to write to the child process.
+   */
+  int writeFd() const { return pipeIn[1]; }
+
  private:
   PipeCommunicator(int* pipeIn, int* pipeOut, pid_t processId);
 
@@ -80,6 +110,90 @@ class PipeCommunicator final : public Communicator {
   int pipeOut[2];
   pid_t processId;
 };
+
+/**
+ * @class RingBuffer
+ * @brief A fixed-capacity byte ring buffer.
+ */
+class RingBuffer final {
+ public:
+  explicit RingBuffer(size_t capacity) : buffer(capacity) {}
+
+  size_t size() const { return tail - head; }
+  size_t capacity() const { return buffer.size(); }
+  bool empty() const { return head == tail; }
+  bool full() const { return size() == capacity(); }
+
+  /**
+   * @brief Free space as at most two contiguous segments, to be filled by a
+   * single readv. Call commit with the number of bytes written afterwards.
+   */
+  int writableSegments(struct iovec* iov);
+  void commit(size_t len) { tail += len; }
+
+  /**
+   * @brief Moves at most len bytes out of the buffer into out.
+   */
+  size_t pop(void* out, size_t len);
+
+ private:
+  std::vector<char> buffer;
+  /// monotonic offsets, positions in buffer are taken modulo the capacity
+  size_t head = 0;
+  size_t tail = 0;
+};
+
+/**
+ * @class EpollCommunicator
+ * @brief Event-driven Communicator over the pipes of a PipeCommunicator.
+ *
+ * Reads block in epoll_wait until the child writes, instead of polling a
+ * non-blocking pipe with sleeps, and pull everything available into a ring
+ * buffer with a single readv, so that callers framing messages get whole
+ * chunks rather than paying a syscall per byte.
+ */
+class EpollCommunicator final : public Communicator {
+ public:
+  /**
+   * @brief Takes over the pipes of the given PipeCommunicator.
+   * \return nullptr if epoll cannot be set up
+   */
+  static std::unique_ptr<EpollCommunicator> create(
+      std::unique_ptr<PipeCommunicator> pipe, size_t ringCapacity = 1 << 18);
+
+  ~EpollCommunicator() override;
+
+  ssize_t write(const std::string& message) override;
+
+  /**
+   * @brief Reads up to len bytes, blocking until some are available.
+   *
+   * \return bytes read, 0 if the child closed its end, -1 with errno set to
+   * EINTR after interrupt, or -1 on other errors
+   */
+  ssize_t read(void* buf, size_t len) override;
+
+  void interrupt() override;
+
+  pid_t pid() const { return pipe->pid(); }
+
+ private:
+  EpollCommunicator(std::unique_ptr<PipeCommunicator> pipe, int epollFd,
+                    int wakeFd, size_t ringCapacity)
+      : pipe(std::move(pipe)),
+        epollFd(epollFd),
+        wakeFd(wakeFd),
+        ring(ringCapacity) {}
+
+  /// wait until the pipe is readable and drain it into the ring
+  ssize_t fill();
+
+  std::unique_ptr<PipeCommunicator> pipe;
+  int epollFd;
+  int wakeFd;
+  RingBuffer ring;
+  bool closed = false;
+};
 }  // namespace lsp
 }  // namespace mergebot
 
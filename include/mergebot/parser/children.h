@@ -47,8 +47,8 @@ class Children {
     iterator();
     uint32_t index;
     TSNode parent;
-    std::shared_ptr<Tree> tree;
-    iterator(TSNode, std::shared_ptr<Tree>, uint32_t);
+    const Tree* tree;
+    iterator(TSNode, const Tree*, uint32_t);
   };
 
   iterator begin() const;
@@ -56,9 +56,11 @@ class Children {
 
  private:
   TSNode parent;
-  std::shared_ptr<Tree> tree;
+  /// not owning, as children are reached through their parent node, which
+  /// keeps the tree alive
+  const Tree* tree;
 
-  Children(TSNode parent, std::shared_ptr<Tree> tree);
+  Children(TSNode parent, const Tree* tree);
 
   friend class Node;
 };
@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 #include "mergebot/parser/children.h"
@@ -23,6 +24,7 @@ namespace ts {
 class Tree;
 class TreeCursor;
 class Children;
+class NodeRef;
 
 class Node {
  public:
@@ -38,6 +40,11 @@ class Node {
   std::string type() const;
   TSSymbol symbol() const;
   std::string text() const;
+  /// text of the node in the source of the tree, without copying it
+  std::string_view textView() const;
+
+  /// a non-owning handle of this node
+  NodeRef ref() const;
 
   TreeCursor walk() const;
 
@@ -97,6 +104,116 @@ class Node {
 
   friend class Children;
   friend class TreeCursor;
+  friend class NodeRef;
+};
+
+class ChildIterator;
+
+/// children of a node, iterated with a tree cursor
+class ChildRange {
+ public:
+  ChildIterator begin() const;
+  /// children are exhausted when the iterator says so
+  std::nullptr_t end() const { return nullptr; }
+
+ private:
+  ChildRange(TSNode parent, const Tree *tree, bool named)
+      : parent(parent), tree(tree), named(named) {}
+
+  TSNode parent;
+  const Tree *tree;
+  bool named;
+
+  friend class NodeRef;
+};
+
+/// A non-owning handle of a node.
+///
+/// Unlike Node, copying it never touches the refcount of the tree, and text
+/// and types are views into the tree and the language. It's only valid as
+/// long as the tree it's taken from, so it's meant for traversals that hold
+/// the tree anyway; take node() to keep a node around.
+class NodeRef {
+ public:
+  NodeRef(TSNode node, const Tree *tree);
+
+  TSSymbol symbol() const;
+  std::string_view type() const;
+  std::string_view textView() const;
+
+  bool isNamed() const;
+
+  size_t startByte() const;
+  size_t endByte() const;
+
+  Point startPoint() const;
+  Point endPoint() const;
+
+  size_t childrenCount() const;
+
+  /// children (or named children) in order, no vector is built
+  ChildRange children() const;
+  ChildRange namedChildren() const;
+
+  std::optional<NodeRef> getChildByFieldID(TSFieldId field_id) const;
+  std::optional<NodeRef> getChildByFieldName(std::string_view name) const;
+
+  std::optional<NodeRef> nextSibling() const;
+  std::optional<NodeRef> prevSibling() const;
+  std::optional<NodeRef> parent() const;
+
+  /// an owning node, which keeps the tree alive
+  Node node() const;
+
+  bool operator==(const NodeRef &rhs) const;
+  bool operator!=(const NodeRef &rhs) const { return !(*this == rhs); }
+
+ private:
+  std::optional<NodeRef> wrap(TSNode nodeOrNull) const;
+
+  TSNode node_;
+  const Tree *tree_;
+
+  friend class Node;
+};
+
+/// Steps through the children of a node with a tree cursor: each step is
+/// O(1), where indexing a child walks the siblings before it. Move only, as
+/// it owns the cursor.
+class ChildIterator {
+ public:
+  ChildIterator(TSNode parent, const Tree *tree, bool named);
+  ChildIterator(ChildIterator &&) noexcept;
+  ChildIterator(const ChildIterator &) = delete;
+  ChildIterator &operator=(const ChildIterator &) = delete;
+  ChildIterator &operator=(ChildIterator &&) = delete;
+  ~ChildIterator();
+
+  NodeRef operator*() const;
+  ChildIterator &operator++();
+
+  /// move forward to the child at \p target, counting all (or named)
+  /// children as Children does
+  /// \return false if there are not as many children
+  bool advanceTo(size_t target);
+
+  /// index of the current child
+  size_t index() const { return index_; }
+  /// field of the current child in its parent, 0 if it has none
+  TSFieldId fieldID() const;
+
+  bool operator!=(std::nullptr_t) const { return valid; }
+  bool operator==(std::nullptr_t) const { return !valid; }
+
+ private:
+  void skipUnnamed();
+
+  TSTreeCursor cursor;
+  const Tree *tree;
+  bool named;
+  bool valid;
+  bool owns;
+  size_t index_ = 0;
 };
 
 }  // namespace ts
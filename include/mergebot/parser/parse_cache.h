@@ -0,0 +1,58 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#ifndef MB_INCLUDE_MERGEBOT_PARSER_PARSE_CACHE_H
+#define MB_INCLUDE_MERGEBOT_PARSER_PARSE_CACHE_H
+
+#include <tree_sitter/api.h>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "mergebot/parser/tree.h"
+
+namespace mergebot {
+namespace ts {
+/// Syntax trees of the sources seen in a merge scenario, keyed by content.
+///
+/// Handlers and graph builders parse the same conflict-side snippets and the
+/// same files (e.g. ones unchanged across sides) over and over; with the
+/// cache each content is parsed once, by the parser of the thread that first
+/// asks for it. Sources are kept up to `MERGEBOT_PARSE_CACHE_MB` (16 by
+/// default), the first parsed are dropped first. Thread safe.
+class ParseCache {
+ public:
+  explicit ParseCache(TSLanguage const *language);
+  ParseCache(TSLanguage const *language, size_t capacity_bytes);
+
+  /// the tree of \p source. Every call gets a tree of its own, which may be
+  /// used on another thread than the other copies
+  std::shared_ptr<Tree> parse(std::string_view source);
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+ private:
+  TSLanguage const *language;
+  const size_t capacity;
+
+  std::mutex mutex;
+  /// by hash of source, the source is compared on hits
+  std::unordered_map<size_t, std::shared_ptr<Tree>> trees;
+  /// hashes in the order of insertion
+  std::deque<size_t> order;
+  size_t bytes = 0;
+
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> misses_{0};
+};
+}  // namespace ts
+}  // namespace mergebot
+
+#endif  // MB_INCLUDE_MERGEBOT_PARSER_PARSE_CACHE_H
@@ -25,6 +25,10 @@ class Parser {
   /// delete parser
   ~Parser();
 
+  /// the parser of \p language owned by the calling thread. Parsers are
+  /// expensive to create and not thread-safe, so threads keep theirs
+  static Parser& forThread(TSLanguage const* language);
+
   /// parse a source buffer and return a concrete syntax tree.
   ///
   /// If you are parsing this document for the first time, pass `nullptr` for
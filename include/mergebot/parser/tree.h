@@ -23,6 +23,8 @@ namespace ts {
 class Tree : public std::enable_shared_from_this<Tree> {
  public:
   Tree(TSTree* tree, std::string const& source, bool keep_text);
+  /// share the source with other trees of it
+  Tree(TSTree* tree, std::shared_ptr<const std::string> source);
   ~Tree();
 
   static std::shared_ptr<Tree> create(TSTree* tree, std::string const& source,
@@ -32,6 +34,10 @@ class Tree : public std::enable_shared_from_this<Tree> {
 
   Node rootNode();
 
+  /// a tree of the same source for another thread, syntax trees are not
+  /// thread-safe. It's cheap: nodes and the source are shared
+  std::shared_ptr<Tree> copy() const;
+
   /// not implemented, as its ambiguous
   //  Node rootNodeWithOffset(uint32_t offset_bytes, Point offset_point) const;
 
@@ -54,7 +60,7 @@ class Tree : public std::enable_shared_from_this<Tree> {
   void exportDotGraph(int file_desc) const;
 
  private:
-  std::string source_;
+  std::shared_ptr<const std::string> source_;
   TSTree* tree;
 
   friend class Parser;
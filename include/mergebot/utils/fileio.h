@@ -70,6 +70,13 @@ static bool file_put_binary(Arr const &arr, std::string const &path) {
 
 bool copy_file(const std::string &source, const std::string &destination);
 
+/// make \p destination share the content of \p source without writing it
+/// again: a reflink (FICLONE) if the filesystem supports it, otherwise a
+/// hardlink, and a plain copy as the last resort (e.g. across devices)
+/// \return false if \p destination already exists or none of them works
+bool clone_or_link_file(const std::string &source,
+                        const std::string &destination);
+
 /// \brief Compute the offsets of each line in a file
 /// \param filename the file to compute the offsets for
 /// \return a vector of offsets, where the first element is the offset of the
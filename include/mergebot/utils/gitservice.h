@@ -6,8 +6,11 @@
 #define MB_GITSERVICE_H
 #include <git2.h>
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <unordered_set>
+#include <vector>
 
 #include "mergebot/core/model/SimplifiedDiffDelta.h"
 #include "mergebot/filesystem.h"
@@ -159,6 +162,11 @@ class GitRepository {
     return std::make_unique<GitRepository>(repo);
   }
 
+  /// process wide handle of the repository at \p project_path, opened on the
+  /// first call and reused by all the later requests of the project
+  /// \return nullptr if \p project_path is not a valid git repo
+  static std::shared_ptr<GitRepository> shared(const std::string& project_path);
+
   git_repository* unwrap() noexcept { return repo; }
 
   std::unique_ptr<GitCommit> lookupCommit(std::string_view commit_hash) const;
@@ -188,9 +196,37 @@ std::unordered_map<std::string, std::string> get_cpp_diff_mapping(
 /// \param dest destination folder
 /// \param hash SHA1 hash, consists of 40 hex digits
 /// \param repo_path git repo directory
+/// \param blob_store if not empty, blobs are written once into this folder
+/// keyed by their OIDs, and `dest` gets reflinks or hardlinks to them
 /// \return success or fail indicated by a boolean
 bool dump_tree_object_to(std::string_view dest, std::string_view hash,
-                         std::string_view repo_path);
+                         std::string_view repo_path,
+                         std::string_view blob_store = {});
+
+/// dump only \p paths of commit tree object with `hash` in project
+/// `repo_path` to `dest`, files already in `dest` are left untouched
+/// \param dest destination folder
+/// \param hash SHA1 hash, consists of 40 hex digits
+/// \param repo_path git repo directory
+/// \param paths relative paths of blobs to dump, missing ones are skipped
+/// \param blob_store see dump_tree_object_to
+/// \return paths found in the commit tree, std::nullopt if the commit cannot
+/// be read
+std::optional<std::vector<std::string>> dump_tree_paths_to(
+    std::string_view dest, std::string_view hash, std::string_view repo_path,
+    const std::vector<std::string>& paths, std::string_view blob_store = {});
+
+/// remove blobs of `blob_store` no side tree links to anymore, i.e. those
+/// with a link count of 1. Reflinked trees don't count as links, they own
+/// their extents. A dump racing with it falls back to a private copy.
+/// \return bytes freed
+uint64_t prune_blob_store(std::string_view blob_store);
+
+/// list unmerged paths of the working tree at \p project_path by reading the
+/// conflict entries of its index, like `git diff --name-only --diff-filter=U`
+/// \return sorted paths, std::nullopt if the index cannot be read
+std::optional<std::vector<std::string>> list_conflict_paths(
+    const std::string& project_path);
 
 [[deprecated("use commit_hash_of_rev instead")]] std::optional<std::string>
 full_commit_hash(const std::string& hash, const std::string& project_path);
@@ -204,7 +240,7 @@ commit_hash_of_branch(const std::string& branch_name,
 /// http://git-scm.com/docs/git-rev-parse.html#_specifying_revisions for
 /// information on the syntax accepted.
 /// \param project_path project path
-/// \return optional of full commit hash
+/// \return optional of full commit hash, cached if \p revision is a full hash
 std::optional<std::string> commit_hash_of_rev(const std::string& revision,
                                               const std::string& project_path);
 
@@ -212,11 +248,18 @@ std::optional<std::string> commit_hash_of_rev(const std::string& revision,
 /// \param our our side commit hash
 /// \param their their side commit hash
 /// \param project_path project path
-/// \return optional full commit hash
+/// \return optional full commit hash, cached per pair of resolved commits
 std::optional<std::string> git_merge_base(const std::string& our,
                                           const std::string& their,
                                           const std::string& project_path);
 
+/// in-process equivalent of `git merge-file -p --diff3 ours base theirs`
+/// \return merged content, with conflicts labeled by file paths,
+/// std::nullopt if any of the files cannot be read or merged
+std::optional<std::string> merge_file_diff3(const std::string& ours_path,
+                                            const std::string& base_path,
+                                            const std::string& theirs_path);
+
 /// merge textual content, create diff3 style conflicts chunk
 /// Note it's the caller's duty to make sure git_libgit2_init is called before
 /// calling this function
@@ -6,7 +6,9 @@
 #define MB_INCLUDE_MERGEBOT_UTILS_SIMILARITY_H
 #include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <vector>
 namespace mergebot {
 namespace util {
@@ -65,8 +67,51 @@ double dice(std::vector<T>& a, std::vector<T>& b) {
   return static_cast<double>(2 * intersection.size()) / (a.size() + b.size());
 }
 
+/// @brief edit distance of two strings, bit-parallel (Myers, Hyyrö)
+///
+/// The shorter string is encoded in 64-bit words, so a column of the DP table
+/// costs one word operation per 64 characters. Long strings with a tight
+/// cutoff are computed in a band of width 2 * max_distance + 1 around the
+/// diagonal instead.
+/// \param s1 one string
+/// \param s2 the other
+/// \param max_distance cutoff, computation stops as soon as the distance is
+/// known to exceed it
+/// \return the distance, or max_distance + 1 if it exceeds max_distance
+size_t levenshtein_distance(
+    std::string_view s1, std::string_view s2,
+    size_t max_distance = std::numeric_limits<size_t>::max());
+
 double string_levenshtein(const std::string& s1, const std::string& s2);
 
+/// levenshtein similarity which gives up on pairs that can't reach
+/// \p min_similarity, 0 is returned for them
+double string_levenshtein(std::string_view s1, std::string_view s2,
+                          double min_similarity);
+
+/// @brief k-gram profile of a string, built once and compared many times
+///
+/// Whitespace runs are collapsed as string_cosine does, each k-gram is hashed
+/// to 64 bits and the distinct hashes are kept sorted with their counts, so
+/// two sketches compare by a merge of flat arrays without any allocation.
+struct KGramSketch {
+  KGramSketch() = default;
+  explicit KGramSketch(std::string_view str, int k = 7);
+
+  int k = 0;
+  /// the sketched string was empty, a default sketch is of an empty string
+  bool source_empty = true;
+  /// sorted, distinct k-gram hashes
+  std::vector<uint64_t> hashes;
+  /// occurrences of the k-gram of the same index in hashes
+  std::vector<uint32_t> counts;
+  /// euclidean norm of counts
+  double norm = 0.0;
+};
+
+/// cosine similarity of two sketches of the same k, see string_cosine
+double sketch_cosine(const KGramSketch& a, const KGramSketch& b);
+
 /// @brief use k-gram to calcuate string similarity
 ///
 /// k-shingling is the operation of transforming a string (or text document)
@@ -86,6 +131,8 @@ double string_levenshtein(const std::string& s1, const std::string& s2);
 /// \param s2 the other to calculate similarity
 /// \param k k-gram window size
 /// \return similarity
+///
+/// Sketch strings with KGramSketch if they are compared more than once.
 double string_cosine(const std::string& s1, const std::string& s2, int k = 7);
 };  // namespace util
 }  // namespace mergebot
@@ -16,6 +16,7 @@
 
 #include "mergebot/controller/exception_handler_aspect.h"
 #include "mergebot/core/ResolutionManager.h"
+#include "mergebot/core/ResolutionScheduler.h"
 #include "mergebot/core/model/Project.h"
 #include "mergebot/core/model/enum/ConflictMark.h"
 #include "mergebot/core/sa_utility.h"
@@ -100,10 +101,19 @@ bool writeConflictFiles(const fs::path& msCacheDir,
   return false;
 }
 
-void goResolve(std::string project, std::string path, sa::MergeScenario& ms,
-               const std::string& compile_db_path,
-               std::vector<std::string>& conflicts,
-               [[maybe_unused]] crow::response& res) {
+crow::json::wvalue ticketToJSON(const sa::JobTicket& ticket) {
+  crow::json::wvalue data;
+  data["queuePosition"] = ticket.Position;
+  data["eta"] = ticket.ETASeconds;
+  data["coalesced"] = ticket.Coalesced;
+  return data;
+}
+
+crow::json::wvalue goResolve(std::string project, std::string path,
+                             sa::MergeScenario& ms,
+                             const std::string& compile_db_path,
+                             std::vector<std::string>& conflicts, int priority,
+                             [[maybe_unused]] crow::response& res) {
   const std::string cacheDirCheckSum = utils::calcProjChecksum(project, path);
   const fs::path projectCacheDir =
       fs::path(mergebot::util::toabs(MBDIR)) / cacheDirCheckSum;
@@ -119,14 +129,16 @@ void goResolve(std::string project, std::string path, sa::MergeScenario& ms,
         "files field exists and is [\n\t{}\n], we'll skip manually check",
         fmt::join(fileNames.begin(), fileNames.end(), ",\n\t"));
   } else {
-    std::string command =
-        fmt::format("(cd {} && git diff --name-only --diff-filter=U)", path);
-    llvm::ErrorOr<std::string> resultOrErr =
-        ::mergebot::utils::ExecCommand(command);
-    if (!resultOrErr) handleServerExecError(resultOrErr.getError(), command);
-    std::string result = resultOrErr.get();
-
-    fileNames = util::string_split<std::vector<std::string>>(result, "\n");
+    std::optional<std::vector<std::string>> conflictPaths =
+        util::list_conflict_paths(path);
+    if (!conflictPaths.has_value()) {
+      removeRunningSign(msCacheDir);
+      throw AppBaseException(
+          "S1000",
+          fmt::format("failed to read the index of project [{}] at [{}]",
+                      project, path));
+    }
+    fileNames = std::move(conflictPaths.value());
   }
   if (fileNames.size() == 0) {
     removeRunningSign(msCacheDir);
@@ -181,15 +193,24 @@ void goResolve(std::string project, std::string path, sa::MergeScenario& ms,
       std::make_shared<sa::ResolutionManager>(
           std::move(project), std::move(path), std::move(ms), compile_db_path,
           std::move(conflictFiles));
+  std::optional<sa::JobTicket> ticket;
   try {
-    // call its async doResolution method to do resolution
-    resolutionManager->doResolution();
+    // submit to the scheduler, it'll be resolved asynchronously
+    ticket = resolutionManager->doResolution(priority);
   } catch (const std::exception& ex) {
     removeRunningSign(resolutionManager->mergeScenarioPath());
     spdlog::info("unexpected error caught: {}, unlock merge scenario\n\n\n",
                  ex.what());
     throw ex;
   }
+  if (!ticket.has_value()) {
+    removeRunningSign(resolutionManager->mergeScenarioPath());
+    throw AppBaseException(
+        "S1000",
+        "Too many merge scenarios are waiting to be resolved, please retry "
+        "later.");
+  }
+  return ticketToJSON(ticket.value());
 }
 
 bool checkAndAddProjectMetadata(const std::string& project,
@@ -370,15 +391,24 @@ bool checkAndAddMSMetadata(const std::string& project, const std::string& path,
   }
 }
 
-void handleMergeScenario(const std::string& project, const std::string& path,
-                         sa::MergeScenario& ms,
-                         const std::string& compile_db_path,
-                         std::vector<std::string>& conflicts,
-                         crow::response& res) {
+crow::json::wvalue handleMergeScenario(const std::string& project,
+                                       const std::string& path,
+                                       sa::MergeScenario& ms,
+                                       const std::string& compile_db_path,
+                                       std::vector<std::string>& conflicts,
+                                       int priority, crow::response& res) {
   const std::string cacheDirCheckSum = utils::calcProjChecksum(project, path);
   const fs::path manifestPath =
       fs::path(util::toabs(MBDIR)) /
       fmt::format("manifest-{}.json", cacheDirCheckSum.substr(0, 2));
+  const fs::path msCacheDir =
+      fs::path(util::toabs(MBDIR)) / cacheDirCheckSum / ms.name;
+
+  // the same merge scenario is queued or being resolved, join it
+  if (auto ticket = sa::ResolutionScheduler::instance().query(msCacheDir)) {
+    spdlog::info("merge scenario[{}] is already scheduled, coalesced", ms.name);
+    return ticketToJSON(ticket.value());
+  }
 
   bool Success = checkAndAddProjectMetadata(project, path);
   if (!Success) {
@@ -395,7 +425,8 @@ void handleMergeScenario(const std::string& project, const std::string& path,
     }
   }
 
-  goResolve(project, path, ms, compile_db_path, conflicts, res);
+  return goResolve(project, path, ms, compile_db_path, conflicts, priority,
+                   res);
 }
 
 crow::json::wvalue doPostMergeScenario(const crow::request& req,
@@ -443,10 +474,13 @@ crow::json::wvalue doPostMergeScenario(const crow::request& req,
   std::vector<std::string> conflicts;
   utils::checkFilesField(body, conflicts, ms, path);
 
-  internal::handleMergeScenario(project, path, ms, compile_db_path, conflicts,
-                                res);
-  // default constructs a crow::json::wvalue to indicate return successfully
-  return {};
+  // optional, jobs of higher priority are resolved first
+  int priority = body.has("priority") ? static_cast<int>(body["priority"].i())
+                                      : 0;
+
+  // queue position and estimated time of the resolution job
+  return internal::handleMergeScenario(project, path, ms, compile_db_path,
+                                       conflicts, priority, res);
 }
 }  // namespace internal
 
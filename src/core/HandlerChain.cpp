@@ -6,9 +6,14 @@
 #include "mergebot/core/model/ConflictFile.h"
 #include "mergebot/globals.h"
 #include "mergebot/utils/pathop.h"
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <numeric>
+#include <oneapi/tbb/flow_graph.h>
+#include <oneapi/tbb/tick_count.h>
+#include <optional>
 #include <vector>
 
 namespace mergebot {
@@ -21,6 +26,68 @@ void HandlerChain::chain() {
   }
 }
 
+bool HandlerChain::pipelined() {
+  const char *Env = std::getenv("MERGEBOT_PIPELINED");
+  return !Env || std::strcmp(Env, "0") != 0;
+}
+
+void HandlerChain::handlePipelined() {
+  std::vector<SAHandler *> PerFile, Batched;
+  for (const auto &Handler : Handlers_) {
+    (Handler->isPerFile() ? PerFile : Batched).push_back(Handler.get());
+  }
+  // re-chain the batched handlers, per-file ones are done when they start
+  for (size_t cur = 0; cur + 1 < Batched.size(); ++cur) {
+    Batched[cur]->setNext(Batched[cur + 1]);
+  }
+  if (Batched.size()) {
+    Batched.back()->setNext(nullptr);
+  }
+
+  tbb::tick_count Start = tbb::tick_count::now();
+  // slot per conflict file, so that the batch keeps the original order
+  std::vector<std::optional<ConflictFile>> Remaining(ConflictFiles_.size());
+  tbb::flow::graph G;
+  tbb::flow::function_node<size_t> PerFileStage(
+      G, tbb::flow::unlimited, [&](size_t Idx) -> tbb::flow::continue_msg {
+        const std::string Filename = ConflictFiles_[Idx].Filename;
+        std::vector<ConflictFile> One;
+        One.push_back(std::move(ConflictFiles_[Idx]));
+        for (SAHandler *Handler : PerFile) {
+          Handler->resolve(One);
+          if (One.empty()) {
+            spdlog::debug("{} resolved by per-file handlers in {}ms", Filename,
+                          (tbb::tick_count::now() - Start).seconds() * 1000);
+            return {};
+          }
+        }
+        Remaining[Idx] = std::move(One.front());
+        return {};
+      });
+  for (size_t Idx = 0; Idx < ConflictFiles_.size(); ++Idx) {
+    PerFileStage.try_put(Idx);
+  }
+  G.wait_for_all();
+
+  std::vector<ConflictFile> Unresolved;
+  for (std::optional<ConflictFile> &CF : Remaining) {
+    if (CF.has_value()) {
+      Unresolved.push_back(std::move(CF.value()));
+    }
+  }
+  ConflictFiles_ = std::move(Unresolved);
+  spdlog::info("per-file handlers done in {}ms, {} conflict files left for "
+               "the rest of the chain",
+               (tbb::tick_count::now() - Start).seconds() * 1000,
+               ConflictFiles_.size());
+
+  if (ConflictFiles_.empty()) {
+    spdlog::info("Incredible! All conflicts are resolved");
+  } else if (Batched.size()) {
+    Batched.front()->handle(ConflictFiles_);
+  }
+}
+
 unsigned HandlerChain::countConflictBlocks() const {
   return std::accumulate(ConflictFiles_.begin(), ConflictFiles_.end(), 0,
                          [&](int Cnt, const ConflictFile &Cur) {
@@ -4,6 +4,7 @@
 
 #include "mergebot/core/ResolutionManager.h"
 
+#include <array>
 #include <fcntl.h>
 #include <filesystem>
 #include <fmt/core.h>
@@ -18,12 +19,19 @@
 #include <unistd.h>
 #include <unordered_set>
 
+#include "mergebot/core/ScenarioCache.h"
+#include "mergebot/core/SparseCheckout.h"
 #include "mergebot/core/handler/ASTBasedHandler.h"
 #include "mergebot/core/handler/LLVMBasedHandler.h"
 #include "mergebot/core/handler/SAHandler.h"
 #include "mergebot/core/handler/StyleBasedHandler.h"
 #include "mergebot/core/handler/TextBasedHandler.h"
+#include "mergebot/core/model/SimplifiedDiffDelta.h"
+#include "mergebot/core/model/enum/Side.h"
 #include "mergebot/core/sa_utility.h"
+#include "mergebot/core/semantic/RemappedCompDB.h"
+#include "mergebot/parser/languages/cpp.h"
+#include "mergebot/parser/parse_cache.h"
 #include "mergebot/utils/ThreadPool.h"
 #include "mergebot/utils/fileio.h"
 #include "mergebot/utils/gitservice.h"
@@ -31,9 +39,6 @@
 
 namespace mergebot {
 namespace sa {
-const std::string ResolutionManager::CompDBRelative =
-    "build/compile_commands.json";
-
 namespace detail {
 /// copy conflict files to destination folder
 /// \param FileList paths of conflict files
@@ -107,9 +112,100 @@ bool copyConflicts(const std::vector<std::string> &FileList,
 
   return Success;
 }
+
+/// remove running sign of the merge scenario to tell clients that the
+/// resolution results are ready
+void unlockMergeScenario(const std::string &MSPath) {
+  const fs::path RunningSign = fs::path(MSPath) / "running";
+  if (fs::exists(RunningSign)) {
+    fs::remove(RunningSign);
+    spdlog::info("unlock merge scenario(remove running sign)\n\n\n");
+  }
+}
+
+/// drop the side sources the analysis ran on, as clients only fetch results
+/// from the merge scenario dir, and the blobs no other side tree of the
+/// project links to, then count what's left in the cache cap and unlock it
+void retireMergeScenario(const std::string &MSPath) {
+  std::error_code EC;
+  for (const char *SideDir : {"base", "ours", "theirs"}) {
+    fs::remove_all(fs::path(MSPath) / SideDir, EC);
+    if (EC) {
+      spdlog::warn("fail to remove {} sources of merge scenario {}, reason: {}",
+                   SideDir, MSPath, EC.message());
+    }
+  }
+  // sibling of the merge scenario dir, see ResolutionManager::blobStoreDir
+  util::prune_blob_store(
+      (fs::path(MSPath).parent_path() / "blobs").string());
+  ScenarioCache::instance().track(MSPath);
+  unlockMergeScenario(MSPath);
+}
+/// paths of each side (indexed by Side) a sparse checkout starts from: the
+/// conflict files, and where they come from according to cpp diff deltas
+std::array<std::vector<std::string>, 3>
+collectSparsePaths(const std::string &ProjectPath, const MergeScenario &MS,
+                   const std::vector<std::string> &Conflicts) {
+  const std::unordered_set<std::string> ConflictSet(Conflicts.begin(),
+                                                    Conflicts.end());
+  std::array<std::unordered_set<std::string>, 3> PathSets;
+  for (auto &PathSet : PathSets) {
+    PathSet.insert(Conflicts.begin(), Conflicts.end());
+  }
+
+  auto &BaseSet = PathSets[static_cast<size_t>(Side::BASE)];
+  for (Side S : {Side::OURS, Side::THEIRS}) {
+    const std::string &Revision = S == Side::OURS ? MS.ours : MS.theirs;
+    auto &SideSet = PathSets[static_cast<size_t>(S)];
+    for (const SimplifiedDiffDelta &SDD :
+         util::list_cpp_diff_files(ProjectPath, MS.base, Revision)) {
+      if (ConflictSet.count(SDD.NewPath) || ConflictSet.count(SDD.OldPath)) {
+        SideSet.insert(SDD.NewPath);
+        BaseSet.insert(SDD.OldPath);
+      }
+    }
+  }
+
+  std::array<std::vector<std::string>, 3> SparsePaths;
+  for (size_t I = 0; I < PathSets.size(); ++I) {
+    SparsePaths[I].assign(PathSets[I].begin(), PathSets[I].end());
+  }
+  return SparsePaths;
+}
+/// include dirs inside the project of the compile commands of the conflict
+/// files, sparse checkouts follow includes through them
+std::vector<std::string>
+collectIncludeDirs(const std::string &ProjectPath, const std::string &CompDBPath,
+                   const std::string &IndexDir,
+                   const std::vector<std::string> &Conflicts) {
+  if (CompDBPath.empty()) {
+    return {};
+  }
+  std::string ErrMsg;
+  auto CompDB = RemappedCompDB::loadShared(CompDBPath, IndexDir, ErrMsg);
+  if (!CompDB) {
+    spdlog::warn("fail to load CompDB {} for include dirs, reason: {}",
+                 CompDBPath, ErrMsg);
+    return {};
+  }
+  std::vector<std::string> IncludeDirs;
+  std::unordered_set<std::string> Seen;
+  for (const std::string &Conflict : Conflicts) {
+    for (const clang::tooling::CompileCommand &Cmd : CompDB->getCompileCommands(
+             (fs::path(ProjectPath) / Conflict).string())) {
+      for (std::string &IncludeDir : SparseCheckout::includeDirsOf(
+               Cmd.CommandLine, Cmd.Directory, ProjectPath)) {
+        if (Seen.insert(IncludeDir).second) {
+          IncludeDirs.push_back(std::move(IncludeDir));
+        }
+      }
+    }
+  }
+  return IncludeDirs;
+}
 } // namespace detail
 
-void ResolutionManager::doResolution() {
+std::optional<JobTicket> ResolutionManager::doResolution(int Priority) {
   // remember to clear running sign
   // clang-format off
   spdlog::info(R"(begin resolving conflicts...
@@ -124,11 +220,19 @@ void ResolutionManager::doResolution() {
   fmt::join(ConflictFiles_->begin(), ConflictFiles_->end(), ",\n\t"));
   // clang-format on
 
-  // use_count 2
+  // the job holds a reference to keep us alive until it is done
   const std::shared_ptr<ResolutionManager> Self = shared_from_this();
-  std::thread ResolveAsyncThread(
-      std::bind(&ResolutionManager::_doResolutionAsync, Self));
-  ResolveAsyncThread.detach();
+  return ResolutionScheduler::instance().submit(
+      mergeScenarioPath(),
+      [Self]() {
+        try {
+          ResolutionManager::_doResolutionAsync(Self);
+        } catch (...) {
+          detail::unlockMergeScenario(Self->mergeScenarioPath());
+          throw;
+        }
+      },
+      Priority);
 }
 
 void ResolutionManager::_doResolutionAsync(
@@ -172,17 +276,25 @@ void ResolutionManager::_doResolutionAsync(
                   ConflictDest.string());
   }
 
+  // the same commits were resolved with the same CompDB before, possibly
+  // prior to a restart, reuse the results and skip source preparation and
+  // analysis entirely
+  const std::string CompDBPath =
+      RemappedCompDB::locate(Self->ProjectPath_, Self->CDBPath_);
+  const std::string CompDB = ScenarioCache::compDBDigest(CompDBPath);
+  if (ScenarioCache::instance().restore(Self->MS_, CompDB,
+                                        *Self->ConflictFiles_,
+                                        Self->mergeScenarioPath())) {
+    detail::retireMergeScenario(Self->mergeScenarioPath());
+    return;
+  }
+
   tbb::tick_count Start = tbb::tick_count::now();
   tbb::task_group TG;
   spdlog::info("collecting source, preparing to conduct analysis...");
-  auto CMD = fmt::format("(cd {} && git merge-base {} {})", Self->ProjectPath_,
-                         Self->MS_.ours, Self->MS_.theirs);
-  llvm::ErrorOr<std::string> BaseOrErr = utils::ExecCommand(CMD);
-  if (!BaseOrErr) {
-    sa::handleSAExecError(BaseOrErr.getError(), CMD);
-  }
-
-  std::string &BaseCommitHash = BaseOrErr.get();
+  std::optional<std::string> BaseOpt =
+      util::git_merge_base(Self->MS_.ours, Self->MS_.theirs, Self->ProjectPath_);
+  const std::string BaseCommitHash = BaseOpt.value_or("");
   // 40 is a magic number of commit hash length
   if (BaseCommitHash.length() != 40) {
     spdlog::error("merge base {} of commit {} and commit {} is illegal",
@@ -193,23 +305,51 @@ void ResolutionManager::_doResolutionAsync(
   const fs::path BasePath = fs::path(Self->mergeScenarioPath()) / "base";
   const fs::path OursPath = fs::path(Self->mergeScenarioPath()) / "ours";
   const fs::path TheirsPath = fs::path(Self->mergeScenarioPath()) / "theirs";
-  TG.run([&]() {
-    if (BaseCommitHash.length() == 40) { // success to get base commit
-      Self->MS_.base = BaseCommitHash;
-      // copy to base folder and if possible, prepare CompDB
-      ResolutionManager::prepareSource(Self, Self->MS_.base, BasePath);
+  const bool HasBase = BaseCommitHash.length() == 40;
+  if (HasBase) { // success to get base commit
+    Self->MS_.base = BaseCommitHash;
+  }
+
+  // sparse checkouts need the merge base to map conflict files back to base
+  std::array<std::shared_ptr<SparseCheckout>, 3> Checkouts;
+  std::array<std::vector<std::string>, 3> SparsePaths;
+  if (HasBase && SparseCheckout::enabled()) {
+    SparsePaths = detail::collectSparsePaths(Self->ProjectPath_, Self->MS_,
+                                             *Self->ConflictFiles_);
+    Checkouts[static_cast<size_t>(Side::OURS)] =
+        std::make_shared<SparseCheckout>(Self->ProjectPath_, Self->MS_.ours,
+                                         OursPath, Self->blobStoreDir());
+    Checkouts[static_cast<size_t>(Side::BASE)] =
+        std::make_shared<SparseCheckout>(Self->ProjectPath_, Self->MS_.base,
+                                         BasePath, Self->blobStoreDir());
+    Checkouts[static_cast<size_t>(Side::THEIRS)] =
+        std::make_shared<SparseCheckout>(Self->ProjectPath_, Self->MS_.theirs,
+                                         TheirsPath, Self->blobStoreDir());
+    const std::vector<std::string> IncludeDirs = detail::collectIncludeDirs(
+        Self->ProjectPath_, CompDBPath, Self->projectCacheDir(),
+        *Self->ConflictFiles_);
+    for (const auto &Checkout : Checkouts) {
+      Checkout->setIncludeDirs(IncludeDirs);
     }
-  });
-  TG.run([&]() {
-    ResolutionManager::prepareSource(Self, Self->MS_.ours, OursPath);
-  });
+  }
+
+  auto Prepare = [&](Side S, const std::string &CommitHash,
+                     const fs::path &Dest) {
+    const size_t Idx = static_cast<size_t>(S);
+    // copy to side folder, CompDB of the project is remapped on the fly later
+    ResolutionManager::prepareSource(Self, CommitHash, Dest, Checkouts[Idx],
+                                     SparsePaths[Idx]);
+  };
   TG.run([&]() {
-    ResolutionManager::prepareSource(Self, Self->MS_.theirs, TheirsPath);
+    if (HasBase) {
+      Prepare(Side::BASE, Self->MS_.base, BasePath);
+    }
   });
+  TG.run([&]() { Prepare(Side::OURS, Self->MS_.ours, OursPath); });
+  TG.run([&]() { Prepare(Side::THEIRS, Self->MS_.theirs, TheirsPath); });
   TG.wait();
   tbb::tick_count End = tbb::tick_count::now();
-  spdlog::info("it takes {}ms to copy 3(or 2) versions' sources and fine tune "
-               "CompDB\n",
+  spdlog::info("it takes {}ms to copy 3(or 2) versions' sources\n",
                (End - Start).seconds() * 1000);
   assert(fs::exists(OursPath) && fs::exists(TheirsPath) &&
          "copy our version's and their version's source failed");
@@ -225,6 +365,8 @@ void ResolutionManager::_doResolutionAsync(
       .MS = Self->MS_,
       .CDBPath = Self->CDBPath_,
       .MSCacheDir = Self->mergeScenarioPath(),
+      .Checkouts = Checkouts,
+      .Parses = std::make_shared<ts::ParseCache>(ts::cpp::language()),
   };
   std::vector<std::unique_ptr<SAHandler>> Handlers;
   Handlers.push_back(std::make_unique<StyleBasedHandler>(Meta));
@@ -234,58 +376,37 @@ void ResolutionManager::_doResolutionAsync(
 
   HandlerChain Chain(std::move(Handlers), AbsCSources);
   Chain.handle();
+  spdlog::debug("parse cache of project[{}]: {} hits, {} misses",
+                Self->Project_, Meta.Parses->hits(), Meta.Parses->misses());
 
-  const fs::path RunningSign = fs::path(Self->mergeScenarioPath()) / "running";
-  if (fs::exists(RunningSign)) {
-    fs::remove(RunningSign);
-    spdlog::info("unlock merge scenario(remove running sign)\n\n\n");
-  }
+  ScenarioCache::instance().publish(Self->MS_, CompDB,
+                                    *Self->ConflictFiles_,
+                                    Self->mergeScenarioPath());
+  detail::retireMergeScenario(Self->mergeScenarioPath());
 }
 
 void ResolutionManager::prepareSource(
     const std::shared_ptr<ResolutionManager> &Self,
-    const std::string &CommitHash, std::string const &SourceDest) {
-  // use libgit2 to read commit tree and dump to SourceDest
-  bool Success = mergebot::util::dump_tree_object_to(SourceDest, CommitHash,
-                                                     Self->ProjectPath_);
-  if (!Success) {
-    spdlog::error("fail to dump version {} to {}", CommitHash, SourceDest);
+    const std::string &CommitHash, std::string const &SourceDest,
+    const std::shared_ptr<SparseCheckout> &Checkout,
+    const std::vector<std::string> &SparsePaths) {
+  bool Success = false;
+  if (Checkout) {
+    // only what the analysis starts from, the rest is materialized on demand
+    fs::create_directories(SourceDest);
+    Success = Checkout->materialize(SparsePaths);
   } else {
-    spdlog::info("sources of commit {} prepared, written to {}", CommitHash,
-                 SourceDest);
-  }
-
-  // Generate CompDB.
-  // At this stage, we simply move the 3 compile_commands to merge scenario dir
-  // and do a textual replacement
-  bool copied = false;
-  const fs::path DestCDBPath = fs::path(SourceDest) / CompDBRelative;
-  fs::path OrigCompDBPath;
-  // project-root
-  if (fs::exists(fs::path(Self->ProjectPath_) / "compile_commands.json")) {
-    OrigCompDBPath = fs::path(Self->ProjectPath_) / "compile_commands.json";
-  } else if (fs::exists(fs::path(Self->ProjectPath_) / CompDBRelative)) {
-    // project-root/build
-    OrigCompDBPath = fs::path(Self->ProjectPath_) / CompDBRelative;
-  } else if (fs::exists(Self->CDBPath_)) {
-    // specific location
-    OrigCompDBPath = fs::path(Self->CDBPath_);
+    // use libgit2 to read commit tree and dump to SourceDest
+    Success = mergebot::util::dump_tree_object_to(
+        SourceDest, CommitHash, Self->ProjectPath_, Self->blobStoreDir());
   }
-
-  if (!OrigCompDBPath.empty()) {
-    spdlog::info("using compile_commands.json found at {}",
-                 OrigCompDBPath.string());
-    copied = util::copy_file(OrigCompDBPath, DestCDBPath);
+  if (!Success) {
+    spdlog::error("fail to dump version {} to {}", CommitHash, SourceDest);
   } else {
-    spdlog::warn("no valid compile_commands.json found");
-  }
-
-  if (copied) {
-    bool fineTuned =
-        fineTuneCompDB(DestCDBPath, SourceDest, Self->ProjectPath_);
-    if (fineTuned) {
-      spdlog::info("CompDB fine tuned, written to {}", DestCDBPath.string());
-    }
+    spdlog::info("sources of commit {} prepared, written to {}{}", CommitHash,
+                 SourceDest,
+                 Checkout ? fmt::format("({} files, sparse)", Checkout->size())
+                          : "");
   }
 }
 
@@ -333,41 +454,5 @@ void ResolutionManager::prepareSource(
 //   }
 //   return CSources;
 // }
-
-bool ResolutionManager::fineTuneCompDB(const std::string &CompDBPath,
-                                       const std::string &ProjPath,
-                                       const std::string &OrigPath) {
-  std::ifstream CompDB(CompDBPath);
-  if (!CompDB.is_open()) {
-    spdlog::error("failed to open CompDB {}", CompDBPath);
-    return false;
-  }
-
-  std::stringstream ss;
-  std::streambuf *FileBuf = CompDB.rdbuf();
-  char Buffer[4096];
-  std::size_t BytesRead;
-  while ((BytesRead = FileBuf->sgetn(Buffer, sizeof(Buffer))) > 0) {
-    ss.write(Buffer, BytesRead);
-  }
-
-  // remove trailing separator if it has
-  std::string ProjectPath = OrigPath;
-  if (ProjectPath.back() == fs::path::preferred_separator) {
-    ProjectPath.pop_back();
-  }
-  std::string FileData = ss.str();
-  re2::RE2 OriginalPath("(" + re2::RE2::QuoteMeta(ProjectPath) + ")");
-  assert(OriginalPath.ok() && "fail to compile regex for CompDB");
-  int ReplaceCnt = re2::RE2::GlobalReplace(&FileData, OriginalPath, ProjPath);
-#ifndef NDEBUG
-  if (!ReplaceCnt) {
-    spdlog::warn("0 original project path in {}, which is weird", CompDBPath);
-  }
-#endif
-
-  util::file_overwrite_content(CompDBPath, FileData);
-  return true;
-}
 } // namespace sa
 } // namespace mergebot
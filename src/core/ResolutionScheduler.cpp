@@ -0,0 +1,179 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/ResolutionScheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <oneapi/tbb/task_arena.h>
+#include <spdlog/spdlog.h>
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+unsigned envOr(const char *Name, unsigned Default) {
+  const char *Env = std::getenv(Name);
+  if (!Env) {
+    return Default;
+  }
+  char *End = nullptr;
+  unsigned long Parsed = std::strtoul(Env, &End, 10);
+  if (End == Env || *End != '\0' || Parsed == 0) {
+    spdlog::warn("illegal {} [{}], fallback to {}", Name, Env, Default);
+    return Default;
+  }
+  return static_cast<unsigned>(Parsed);
+}
+} // namespace detail
+
+ResolutionScheduler::ResolutionScheduler(Options Opts) : Opts_(Opts) {
+  Opts_.Workers = std::max(1u, Opts_.Workers);
+  Opts_.ArenaConcurrency = std::max(1u, Opts_.ArenaConcurrency);
+  Workers_.reserve(Opts_.Workers);
+  for (unsigned I = 0; I < Opts_.Workers; ++I) {
+    Workers_.emplace_back(&ResolutionScheduler::workerLoop, this);
+  }
+}
+
+ResolutionScheduler::~ResolutionScheduler() {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    Stopped_ = true;
+    if (!Queue_.empty()) {
+      spdlog::warn("resolution scheduler stopped, {} queued jobs dropped",
+                   Queue_.size());
+    }
+    Queue_.clear();
+  }
+  CV_.notify_all();
+  for (auto &Worker : Workers_) {
+    if (Worker.joinable()) {
+      Worker.join();
+    }
+  }
+}
+
+ResolutionScheduler &ResolutionScheduler::instance() {
+  static ResolutionScheduler Scheduler([] {
+    const unsigned Cores = std::max(1u, std::thread::hardware_concurrency());
+    Options Opts;
+    // every job drives 3 clangd processes besides its own TBB workers
+    Opts.Workers = detail::envOr("MERGEBOT_MAX_JOBS", std::max(1u, Cores / 8));
+    Opts.ArenaConcurrency = detail::envOr(
+        "MERGEBOT_JOB_CONCURRENCY", std::max(1u, Cores / Opts.Workers));
+    Opts.MaxPending = detail::envOr("MERGEBOT_MAX_PENDING_JOBS", 32);
+    spdlog::info("resolution scheduler: {} workers, {} threads per job, at "
+                 "most {} pending jobs",
+                 Opts.Workers, Opts.ArenaConcurrency, Opts.MaxPending);
+    return Opts;
+  }());
+  return Scheduler;
+}
+
+std::optional<JobTicket> ResolutionScheduler::ticketOf(
+    const std::string &Key) const {
+  if (auto It = Running_.find(Key); It != Running_.end()) {
+    double Elapsed =
+        std::chrono::duration<double>(Clock::now() - It->second).count();
+    return JobTicket{0, std::max(0.0, AvgSeconds_ - Elapsed), false};
+  }
+  auto It = std::find_if(Queue_.begin(), Queue_.end(),
+                         [&](const auto &J) { return J.Key == Key; });
+  if (It == Queue_.end()) {
+    return std::nullopt;
+  }
+  const size_t Index = It - Queue_.begin();
+  // jobs ahead of us drain in rounds of Opts_.Workers
+  const size_t Rounds = (Index + Running_.size()) / Opts_.Workers + 1;
+  return JobTicket{Index + 1, AvgSeconds_ * Rounds, false};
+}
+
+std::optional<JobTicket> ResolutionScheduler::submit(const std::string &Key,
+                                                     Job Work, int Priority) {
+  std::unique_lock<std::mutex> Lock(Mutex_);
+  if (auto Ticket = ticketOf(Key)) {
+    spdlog::info("resolution job {} is already scheduled, coalesced", Key);
+    Ticket->Coalesced = true;
+    return Ticket;
+  }
+  if (Stopped_ || Queue_.size() >= Opts_.MaxPending) {
+    spdlog::warn("resolution queue is full({} pending), reject job {}",
+                 Queue_.size(), Key);
+    return std::nullopt;
+  }
+
+  auto Pos = std::find_if(Queue_.begin(), Queue_.end(), [&](const auto &J) {
+    return J.Priority < Priority;
+  });
+  Queue_.insert(Pos, PendingJob{Key, Priority, std::move(Work)});
+  std::optional<JobTicket> Ticket = ticketOf(Key);
+  Lock.unlock();
+  CV_.notify_one();
+  return Ticket;
+}
+
+std::optional<JobTicket> ResolutionScheduler::query(
+    const std::string &Key) const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  std::optional<JobTicket> Ticket = ticketOf(Key);
+  if (Ticket) {
+    Ticket->Coalesced = true;
+  }
+  return Ticket;
+}
+
+size_t ResolutionScheduler::pending() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Queue_.size();
+}
+
+size_t ResolutionScheduler::running() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Running_.size();
+}
+
+size_t ResolutionScheduler::failed() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Failed_;
+}
+
+void ResolutionScheduler::workerLoop() {
+  tbb::task_arena Arena(static_cast<int>(Opts_.ArenaConcurrency));
+  while (true) {
+    PendingJob Next;
+    {
+      std::unique_lock<std::mutex> Lock(Mutex_);
+      CV_.wait(Lock, [this] { return Stopped_ || !Queue_.empty(); });
+      if (Stopped_) {
+        return;
+      }
+      Next = std::move(Queue_.front());
+      Queue_.pop_front();
+      Running_.emplace(Next.Key, Clock::now());
+    }
+
+    const Clock::time_point Start = Clock::now();
+    // whatever a job throws must not escape, or the server is terminated
+    bool Failed = true;
+    try {
+      Arena.execute([&]() { Next.Work(); });
+      Failed = false;
+    } catch (const std::exception &Ex) {
+      spdlog::error("resolution job {} failed, reason: {}", Next.Key,
+                    Ex.what());
+    } catch (...) {
+      spdlog::error("resolution job {} failed, reason: unknown exception",
+                    Next.Key);
+    }
+    const double Seconds =
+        std::chrono::duration<double>(Clock::now() - Start).count();
+
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    Running_.erase(Next.Key);
+    Failed_ += Failed;
+    AvgSeconds_ = 0.7 * AvgSeconds_ + 0.3 * Seconds;
+  }
+}
+} // namespace sa
+} // namespace mergebot
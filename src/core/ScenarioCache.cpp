@@ -0,0 +1,404 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/ScenarioCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+
+#include "mergebot/globals.h"
+#include "mergebot/utils/fileio.h"
+#include "mergebot/utils/pathop.h"
+#include "mergebot/utils/sha1.h"
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+uint64_t directorySize(const fs::path &Dir) {
+  uint64_t Size = 0;
+  std::error_code EC;
+  for (auto It = fs::recursive_directory_iterator(Dir, EC);
+       !EC && It != fs::recursive_directory_iterator(); It.increment(EC)) {
+    if (It->is_regular_file(EC)) {
+      Size += It->file_size(EC);
+    }
+  }
+  return Size;
+}
+
+/// copy Src recursively to Dest if Src exists
+bool copyTree(const fs::path &Src, const fs::path &Dest) {
+  std::error_code EC;
+  if (!fs::exists(Src, EC)) {
+    return true;
+  }
+  fs::create_directories(Dest, EC);
+  fs::copy(Src, Dest,
+           fs::copy_options::recursive | fs::copy_options::overwrite_existing,
+           EC);
+  if (EC) {
+    spdlog::error("fail to copy {} to {}, reason: {}", Src.string(),
+                  Dest.string(), EC.message());
+    return false;
+  }
+  return true;
+}
+
+uint64_t capacityFromEnv() {
+  constexpr uint64_t DefaultCapMB = 8192;
+  const char *Env = std::getenv("MERGEBOT_CACHE_CAP_MB");
+  uint64_t CapMB = DefaultCapMB;
+  if (Env) {
+    char *End = nullptr;
+    unsigned long long Parsed = std::strtoull(Env, &End, 10);
+    if (End != Env && *End == '\0') {
+      CapMB = Parsed;
+    } else {
+      spdlog::warn("illegal MERGEBOT_CACHE_CAP_MB [{}], fallback to {}MB", Env,
+                   DefaultCapMB);
+    }
+  }
+  return CapMB * 1024 * 1024;
+}
+
+/// a resolved merge scenario dir that's not being resolved again
+bool isFinishedScenario(const fs::path &Dir) {
+  std::error_code EC;
+  return (fs::is_directory(Dir / "resolutions", EC) ||
+          fs::is_directory(Dir / "conflicts", EC)) &&
+         !fs::exists(Dir / "running", EC);
+}
+
+/// modification time of Dir in milliseconds since epoch, 0 if unknown
+int64_t modifiedAt(const fs::path &Dir) {
+  struct stat StatBuffer;
+  if (stat(Dir.c_str(), &StatBuffer) != 0) {
+    return 0;
+  }
+  return static_cast<int64_t>(StatBuffer.st_mtim.tv_sec) * 1000 +
+         StatBuffer.st_mtim.tv_nsec / 1000000;
+}
+} // namespace detail
+
+ScenarioCache::ScenarioCache(fs::path Root, uint64_t Capacity,
+                             fs::path ScenariosRoot)
+    : Root_(std::move(Root)), Capacity_(Capacity),
+      ScenariosRoot_(std::move(ScenariosRoot)) {}
+
+ScenarioCache &ScenarioCache::instance() {
+  static ScenarioCache Cache(fs::path(util::toabs(MBDIR)) / "cache",
+                             detail::capacityFromEnv(),
+                             fs::path(util::toabs(MBDIR)));
+  return Cache;
+}
+
+std::string ScenarioCache::keyOf(const MergeScenario &MS,
+                                 const std::string &CompDB) {
+  if (MS.ours.empty() || MS.theirs.empty() || MS.base.empty()) {
+    return "";
+  }
+  util::SHA1 Checksum;
+  Checksum.update(
+      fmt::format("{}-{}-{}-{}", MS.ours, MS.theirs, MS.base, CompDB));
+  return Checksum.final();
+}
+
+std::string ScenarioCache::compDBDigest(const std::string &CompDBPath) {
+  std::error_code EC;
+  if (CompDBPath.empty() || !fs::is_regular_file(CompDBPath, EC)) {
+    return "";
+  }
+  std::ifstream CompDB(CompDBPath, std::ios::binary);
+  if (!CompDB) {
+    spdlog::warn("fail to read CompDB {} for the scenario cache key",
+                 CompDBPath);
+    return "";
+  }
+  util::SHA1 Checksum;
+  Checksum.update(CompDBPath + "\n");
+  Checksum.update(CompDB);
+  return Checksum.final();
+}
+
+int64_t ScenarioCache::tick() {
+  int64_t Now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+  Clock_ = std::max(Clock_ + 1, Now);
+  return Clock_;
+}
+
+bool ScenarioCache::writeMeta(const fs::path &EntryDir, const Entry &E) {
+  nlohmann::json Meta;
+  Meta["ms"] = E.MS;
+  Meta["compdb"] = E.CompDB;
+  Meta["files"] = E.Files;
+  Meta["lastAccess"] = E.LastAccess;
+  return util::file_overwrite_content_sync(EntryDir / MetaFile, Meta.dump(2));
+}
+
+void ScenarioCache::load() {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  Entries_.clear();
+  Scenarios_.clear();
+  Size_ = 0;
+
+  std::error_code EC;
+  fs::create_directories(Root_, EC);
+  if (EC) {
+    spdlog::error("fail to create scenario cache dir {}, reason: {}",
+                  Root_.string(), EC.message());
+    return;
+  }
+
+  std::vector<fs::path> Broken;
+  for (const auto &DirEntry : fs::directory_iterator(Root_, EC)) {
+    const fs::path EntryDir = DirEntry.path();
+    const std::string Key = EntryDir.filename().string();
+    if (!DirEntry.is_directory()) {
+      Broken.push_back(EntryDir);
+      continue;
+    }
+
+    // entries are committed by renaming a fully written temp dir, anything
+    // without a parsable meta file is a leftover of a crash
+    if (!fs::exists(EntryDir / MetaFile)) {
+      Broken.push_back(EntryDir);
+      continue;
+    }
+    const std::optional<std::string> Content =
+        util::file_get_content_sync(EntryDir / MetaFile);
+    if (!Content.has_value()) {
+      Broken.push_back(EntryDir);
+      continue;
+    }
+    nlohmann::json Meta = nlohmann::json::parse(*Content, nullptr, false);
+    if (Meta.is_discarded() || !Meta.contains("ms") ||
+        !Meta.contains("compdb") || !Meta.contains("files") ||
+        !Meta.contains("lastAccess")) {
+      Broken.push_back(EntryDir);
+      continue;
+    }
+
+    Entry E;
+    try {
+      E.MS = Meta["ms"].get<MergeScenario>();
+      E.CompDB = Meta["compdb"].get<std::string>();
+      E.Files = Meta["files"].get<std::vector<std::string>>();
+      E.LastAccess = Meta["lastAccess"].get<int64_t>();
+    } catch (const nlohmann::json::exception &) {
+      Broken.push_back(EntryDir);
+      continue;
+    }
+    if (keyOf(E.MS, E.CompDB) != Key || !fs::exists(EntryDir / "resolutions")) {
+      Broken.push_back(EntryDir);
+      continue;
+    }
+    E.Size = detail::directorySize(EntryDir);
+    Size_ += E.Size;
+    Clock_ = std::max(Clock_, E.LastAccess);
+    Entries_.emplace(Key, std::move(E));
+  }
+
+  for (const auto &Dir : Broken) {
+    spdlog::warn("drop broken scenario cache entry {}", Dir.string());
+    fs::remove_all(Dir, EC);
+  }
+
+  loadScenarios();
+  evictIfNeeded();
+  spdlog::info("scenario cache {} loaded, {} entries and {} merge scenario "
+               "dirs, {} bytes in total",
+               Root_.string(), Entries_.size(), Scenarios_.size(), Size_);
+}
+
+void ScenarioCache::loadScenarios() {
+  std::error_code EC;
+  if (ScenariosRoot_.empty() || !fs::is_directory(ScenariosRoot_, EC)) {
+    return;
+  }
+  // MBDIR/<project checksum>/<merge scenario>
+  for (const auto &ProjDir : fs::directory_iterator(ScenariosRoot_, EC)) {
+    if (!ProjDir.is_directory(EC) ||
+        fs::equivalent(ProjDir.path(), Root_, EC)) {
+      continue;
+    }
+    for (const auto &MSDir : fs::directory_iterator(ProjDir.path(), EC)) {
+      if (!MSDir.is_directory(EC) ||
+          !detail::isFinishedScenario(MSDir.path())) {
+        continue;
+      }
+      Scenario S;
+      S.Size = detail::directorySize(MSDir.path());
+      S.LastAccess = detail::modifiedAt(MSDir.path());
+      Size_ += S.Size;
+      Scenarios_.emplace(MSDir.path().string(), S);
+    }
+  }
+}
+
+bool ScenarioCache::restore(const MergeScenario &MS, const std::string &CompDB,
+                            const std::vector<std::string> &Files,
+                            const std::string &MSCacheDir) {
+  const std::string Key = keyOf(MS, CompDB);
+  if (Key.empty()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  auto It = Entries_.find(Key);
+  if (It == Entries_.end()) {
+    return false;
+  }
+  Entry &E = It->second;
+  std::unordered_set<std::string> Cached(E.Files.begin(), E.Files.end());
+  bool Covered = std::all_of(Files.begin(), Files.end(), [&](const auto &F) {
+    return Cached.count(F) != 0;
+  });
+  if (!Covered) {
+    return false;
+  }
+
+  // copying happens under lock so that the entry cannot be evicted halfway
+  const fs::path EntryDir = Root_ / Key;
+  if (!detail::copyTree(EntryDir / "resolutions",
+                        fs::path(MSCacheDir) / "resolutions") ||
+      !detail::copyTree(EntryDir / "merged", fs::path(MSCacheDir) / "merged")) {
+    return false;
+  }
+
+  E.LastAccess = tick();
+  if (!writeMeta(EntryDir, E)) {
+    spdlog::warn("fail to persist access time of scenario cache entry {}",
+                 Key);
+  }
+  spdlog::info("scenario cache hit for {}, entry {}", MS.name, Key);
+  return true;
+}
+
+bool ScenarioCache::publish(const MergeScenario &MS, const std::string &CompDB,
+                            const std::vector<std::string> &Files,
+                            const std::string &MSCacheDir) {
+  const std::string Key = keyOf(MS, CompDB);
+  if (Key.empty()) {
+    return false;
+  }
+
+  // stage the entry next to its final location, then commit it with a rename
+  std::error_code EC;
+  const fs::path Staging =
+      Root_ / fmt::format(".{}-{}", Key,
+                          std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  fs::remove_all(Staging, EC);
+  if (!fs::create_directories(Staging, EC) ||
+      !detail::copyTree(fs::path(MSCacheDir) / "resolutions",
+                        Staging / "resolutions") ||
+      !detail::copyTree(fs::path(MSCacheDir) / "merged", Staging / "merged")) {
+    fs::remove_all(Staging, EC);
+    return false;
+  }
+  fs::create_directories(Staging / "resolutions", EC);
+
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  Entry E;
+  E.MS = MS;
+  E.CompDB = CompDB;
+  E.Files = Files;
+  E.LastAccess = tick();
+  if (!writeMeta(Staging, E)) {
+    fs::remove_all(Staging, EC);
+    return false;
+  }
+  E.Size = detail::directorySize(Staging);
+
+  const fs::path EntryDir = Root_ / Key;
+  if (auto It = Entries_.find(Key); It != Entries_.end()) {
+    Size_ -= It->second.Size;
+    Entries_.erase(It);
+  }
+  fs::remove_all(EntryDir, EC);
+  fs::rename(Staging, EntryDir, EC);
+  if (EC) {
+    spdlog::error("fail to commit scenario cache entry {}, reason: {}", Key,
+                  EC.message());
+    fs::remove_all(Staging, EC);
+    return false;
+  }
+
+  Size_ += E.Size;
+  Entries_.emplace(Key, std::move(E));
+  spdlog::info("resolution results of {} cached as entry {}", MS.name, Key);
+  evictIfNeeded();
+  return true;
+}
+
+void ScenarioCache::track(const std::string &MSCacheDir) {
+  const uint64_t Size = detail::directorySize(MSCacheDir);
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  Scenario &S = Scenarios_[MSCacheDir];
+  Size_ = Size_ - S.Size + Size;
+  S.Size = Size;
+  S.LastAccess = tick();
+  evictIfNeeded();
+}
+
+void ScenarioCache::evictIfNeeded() {
+  while (Capacity_ && Size_ > Capacity_) {
+    auto EntryVictim = std::min_element(Entries_.begin(), Entries_.end(),
+                                        [](const auto &Lhs, const auto &Rhs) {
+                                          return Lhs.second.LastAccess <
+                                                 Rhs.second.LastAccess;
+                                        });
+    // scenario dirs being resolved again are left alone
+    auto ScenarioVictim = Scenarios_.end();
+    for (auto It = Scenarios_.begin(); It != Scenarios_.end(); ++It) {
+      if ((ScenarioVictim == Scenarios_.end() ||
+           It->second.LastAccess < ScenarioVictim->second.LastAccess) &&
+          detail::isFinishedScenario(It->first)) {
+        ScenarioVictim = It;
+      }
+    }
+
+    std::error_code EC;
+    if (ScenarioVictim != Scenarios_.end() &&
+        (EntryVictim == Entries_.end() ||
+         ScenarioVictim->second.LastAccess < EntryVictim->second.LastAccess)) {
+      fs::remove_all(ScenarioVictim->first, EC);
+      spdlog::info("evict merge scenario dir {}({} bytes)",
+                   ScenarioVictim->first, ScenarioVictim->second.Size);
+      Size_ -= ScenarioVictim->second.Size;
+      Scenarios_.erase(ScenarioVictim);
+    } else if (EntryVictim != Entries_.end()) {
+      fs::remove_all(Root_ / EntryVictim->first, EC);
+      spdlog::info("evict scenario cache entry {}({} bytes)",
+                   EntryVictim->first, EntryVictim->second.Size);
+      Size_ -= EntryVictim->second.Size;
+      Entries_.erase(EntryVictim);
+    } else {
+      break;
+    }
+  }
+}
+
+uint64_t ScenarioCache::size() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Size_;
+}
+
+size_t ScenarioCache::entryCount() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Entries_.size();
+}
+} // namespace sa
+} // namespace mergebot
@@ -0,0 +1,196 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/SparseCheckout.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <re2/re2.h>
+#include <spdlog/spdlog.h>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+#include "mergebot/utils/gitservice.h"
+
+namespace mergebot {
+namespace sa {
+bool SparseCheckout::enabled() {
+  const char *Env = std::getenv("MERGEBOT_SPARSE_CHECKOUT");
+  return Env && std::strcmp(Env, "0") != 0;
+}
+
+void SparseCheckout::setIncludeDirs(std::vector<std::string> IncludeDirs) {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  IncludeDirs_ = std::move(IncludeDirs);
+}
+
+size_t SparseCheckout::size() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Materialized_.size();
+}
+
+std::vector<std::string>
+SparseCheckout::counterpartsOf(const std::string &Path) {
+  // clang-format off
+  static const char *Extensions[] = {
+      ".h", ".hh", ".hpp", ".hxx", ".c", ".cc", ".cpp", ".cxx", ".c++"
+  };
+  // clang-format on
+  const fs::path P(Path);
+  if (!P.has_extension()) {
+    return {};
+  }
+  std::vector<std::string> Counterparts;
+  for (const char *Ext : Extensions) {
+    fs::path Candidate = P;
+    Candidate.replace_extension(Ext);
+    if (Candidate != P) {
+      Counterparts.push_back(Candidate.string());
+    }
+  }
+  return Counterparts;
+}
+
+std::vector<std::string>
+SparseCheckout::includesOf(const std::string &Path, const std::string &Content,
+                           const std::vector<std::string> &IncludeDirs) {
+  static const re2::RE2 IncludePattern(
+      R"re((?m)^\s*#\s*include\s*([<"])([^">]+)[">])re");
+  assert(IncludePattern.ok() && "fail to compile regex for includes");
+
+  const fs::path Dir = fs::path(Path).parent_path();
+  std::vector<std::string> Includes;
+  re2::StringPiece Input(Content);
+  std::string Delimiter;
+  std::string Included;
+  while (re2::RE2::FindAndConsume(&Input, IncludePattern, &Delimiter,
+                                  &Included)) {
+    // quoted includes are looked up relative to the includer first, then
+    // both kinds go through the include dirs, and the project root which is
+    // the most common one. System headers simply don't exist in the commit
+    std::vector<fs::path> Candidates;
+    if (Delimiter == "\"") {
+      Candidates.push_back(Dir / Included);
+    }
+    for (const std::string &IncludeDir : IncludeDirs) {
+      Candidates.push_back(fs::path(IncludeDir) / Included);
+    }
+    Candidates.emplace_back(Included);
+    for (const fs::path &Candidate : Candidates) {
+      const std::string Normalized = Candidate.lexically_normal().string();
+      if (Candidate.is_absolute() || Normalized.rfind("..", 0) == 0) {
+        continue;
+      }
+      Includes.push_back(Normalized);
+    }
+  }
+  return Includes;
+}
+
+std::vector<std::string>
+SparseCheckout::includeDirsOf(const std::vector<std::string> &Arguments,
+                              const std::string &Directory,
+                              const std::string &ProjectRoot) {
+  static const char *Flags[] = {"-I", "-iquote", "-isystem"};
+  fs::path Root = fs::path(ProjectRoot).lexically_normal();
+  if (!Root.has_filename()) {
+    Root = Root.parent_path();
+  }
+
+  std::vector<std::string> IncludeDirs;
+  std::unordered_set<std::string> Seen;
+  for (size_t I = 0; I < Arguments.size(); ++I) {
+    std::string IncludeDir;
+    for (const char *Flag : Flags) {
+      const size_t FlagLen = std::strlen(Flag);
+      if (Arguments[I] == Flag && I + 1 < Arguments.size()) {
+        IncludeDir = Arguments[++I];
+        break;
+      }
+      if (Arguments[I].size() > FlagLen &&
+          Arguments[I].compare(0, FlagLen, Flag) == 0) {
+        IncludeDir = Arguments[I].substr(FlagLen);
+        break;
+      }
+    }
+    if (IncludeDir.empty()) {
+      continue;
+    }
+    fs::path Absolute = (fs::path(Directory) / IncludeDir).lexically_normal();
+    if (!Absolute.has_filename()) {
+      Absolute = Absolute.parent_path();
+    }
+    const std::string Relative = Absolute.lexically_relative(Root).string();
+    // the root itself is always searched
+    if (Relative.empty() || Relative == "." || Relative.rfind("..", 0) == 0) {
+      continue;
+    }
+    if (Seen.insert(Relative).second) {
+      IncludeDirs.push_back(Relative);
+    }
+  }
+  return IncludeDirs;
+}
+
+bool SparseCheckout::materialize(const std::vector<std::string> &Paths) {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  std::vector<std::string> Wanted;
+  for (const std::string &Path : Paths) {
+    if (Requested_.insert(Path).second) {
+      Wanted.push_back(Path);
+      for (std::string &Counterpart : counterpartsOf(Path)) {
+        Wanted.push_back(std::move(Counterpart));
+      }
+    }
+  }
+  if (Wanted.empty()) {
+    return true;
+  }
+
+  auto DumpedOpt = util::dump_tree_paths_to(Dest_, CommitHash_, RepoPath_,
+                                            Wanted, BlobStore_);
+  if (!DumpedOpt.has_value()) {
+    spdlog::error("fail to materialize {} paths of commit {} to {}",
+                  Wanted.size(), CommitHash_, Dest_);
+    return false;
+  }
+
+  // includes of what we just wrote, and includes of those, until nothing
+  // new of this revision turns up
+  std::vector<std::string> Frontier = std::move(DumpedOpt.value());
+  Materialized_.insert(Frontier.begin(), Frontier.end());
+  while (!Frontier.empty()) {
+    std::vector<std::string> Includes;
+    for (const std::string &Dumped : Frontier) {
+      const std::string Content =
+          util::file_get_content((fs::path(Dest_) / Dumped).string());
+      for (std::string &Included :
+           includesOf(Dumped, Content, IncludeDirs_)) {
+        if (!Materialized_.count(Included) &&
+            Probed_.insert(Included).second) {
+          Includes.push_back(std::move(Included));
+        }
+      }
+    }
+    if (Includes.empty()) {
+      break;
+    }
+    auto IncludedOpt = util::dump_tree_paths_to(Dest_, CommitHash_, RepoPath_,
+                                                Includes, BlobStore_);
+    if (!IncludedOpt.has_value()) {
+      spdlog::warn("fail to materialize includes of commit {} to {}",
+                   CommitHash_, Dest_);
+      break;
+    }
+    Frontier = std::move(IncludedOpt.value());
+    Materialized_.insert(Frontier.begin(), Frontier.end());
+  }
+
+  spdlog::debug("commit {} sparsely materialized to {}, {} files in total",
+                CommitHash_.substr(0, 8), Dest_, Materialized_.size());
+  return true;
+}
+} // namespace sa
+} // namespace mergebot
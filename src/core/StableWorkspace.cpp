@@ -0,0 +1,241 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/StableWorkspace.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <sys/file.h>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+/// ProjectCacheDir is shared with merge scenarios named by users, keep out of
+/// their way
+constexpr const char *ClangdCacheDirName = ".clangd";
+
+uintmax_t indexCapBytes() {
+  const char *Env = std::getenv("MERGEBOT_CLANGD_INDEX_MB");
+  uintmax_t CapMB = 1024;
+  if (Env && *Env) {
+    char *End = nullptr;
+    unsigned long long Value = std::strtoull(Env, &End, 10);
+    if (!*End) {
+      CapMB = Value;
+    }
+  }
+  return CapMB << 20;
+}
+} // namespace detail
+
+bool StableWorkspace::enabled() {
+  const char *Env = std::getenv("MERGEBOT_STABLE_WORKSPACE");
+  return !Env || std::strcmp(Env, "0") != 0;
+}
+
+std::unique_ptr<StableWorkspace>
+StableWorkspace::lease(const std::string &ProjectCacheDir,
+                       std::string_view SideName, std::string SourceDir) {
+  const fs::path Root = fs::path(ProjectCacheDir) /
+                        detail::ClangdCacheDirName / "workspaces" /
+                        std::string(SideName);
+  std::error_code EC;
+  fs::create_directories(Root, EC);
+  if (EC) {
+    spdlog::warn("fail to create stable workspace {}: {}", Root.string(),
+                 EC.message());
+    return nullptr;
+  }
+
+  // flock conflicts between open file descriptions, hence between scenarios
+  // in the same process too. Not inherited by clangd, which outlives leases
+  const std::string LockPath = Root.string() + ".lock";
+  int Fd = open(LockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (Fd == -1) {
+    spdlog::warn("fail to open {}: {}", LockPath, strerror(errno));
+    return nullptr;
+  }
+  if (flock(Fd, LOCK_EX | LOCK_NB) == -1) {
+    spdlog::debug("stable workspace {} is leased by another scenario",
+                  Root.string());
+    close(Fd);
+    return nullptr;
+  }
+  return std::unique_ptr<StableWorkspace>(
+      new StableWorkspace(Root.string(), std::move(SourceDir), Fd));
+}
+
+StableWorkspace::~StableWorkspace() {
+  flock(LockFd_, LOCK_UN);
+  close(LockFd_);
+}
+
+std::string StableWorkspace::indexDir(const std::string &ProjectCacheDir) {
+  static std::mutex PruneMutex;
+  const fs::path Dir =
+      fs::path(ProjectCacheDir) / detail::ClangdCacheDirName / "cache";
+  std::error_code EC;
+  fs::create_directories(Dir, EC);
+
+  std::lock_guard<std::mutex> Lock(PruneMutex);
+  const uintmax_t Removed = prune(Dir.string(), detail::indexCapBytes());
+  if (Removed) {
+    spdlog::info("clangd index of {} pruned by {}MB", ProjectCacheDir,
+                 Removed >> 20);
+  }
+  return Dir.string();
+}
+
+uintmax_t StableWorkspace::prune(const std::string &Dir, uintmax_t CapBytes) {
+  struct Shard {
+    fs::file_time_type MTime;
+    uintmax_t Size;
+    fs::path Path;
+  };
+  std::vector<Shard> Shards;
+  uintmax_t Total = 0;
+  std::error_code EC;
+  for (fs::recursive_directory_iterator
+           It(Dir, fs::directory_options::skip_permission_denied, EC),
+       End;
+       !EC && It != End; It.increment(EC)) {
+    if (!It->is_regular_file(EC)) {
+      continue;
+    }
+    Shard S{It->last_write_time(EC), It->file_size(EC), It->path()};
+    if (!EC) {
+      Total += S.Size;
+      Shards.push_back(std::move(S));
+    }
+  }
+  if (Total <= CapBytes) {
+    return 0;
+  }
+
+  std::sort(Shards.begin(), Shards.end(), [](const Shard &L, const Shard &R) {
+    return std::tie(L.MTime, L.Path) < std::tie(R.MTime, R.Path);
+  });
+  uintmax_t Removed = 0;
+  for (const Shard &S : Shards) {
+    if (Total - Removed <= CapBytes) {
+      break;
+    }
+    if (fs::remove(S.Path, EC)) {
+      Removed += S.Size;
+    }
+  }
+  return Removed;
+}
+
+void StableWorkspace::sync(size_t Generation) {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  if (Synced_ && Generation == Generation_) {
+    return;
+  }
+  if (!Synced_) {
+    dropStale();
+  }
+  Synced_ = true;
+  Generation_ = Generation;
+
+  size_t Count = 0;
+  std::error_code EC;
+  for (fs::recursive_directory_iterator
+           It(SourceDir_, fs::directory_options::skip_permission_denied, EC),
+       End;
+       !EC && It != End; It.increment(EC)) {
+    if (!It->is_regular_file(EC)) {
+      continue;
+    }
+    const uintmax_t Size = It->file_size(EC);
+    const std::string RelPath =
+        fs::relative(It->path(), SourceDir_, EC).string();
+    if (EC) {
+      EC.clear();
+      continue;
+    }
+    auto Mirrored = Mirrored_.find(RelPath);
+    if (Mirrored != Mirrored_.end() && Mirrored->second == Size) {
+      continue;
+    }
+    if (mirror(RelPath)) {
+      Mirrored_[RelPath] = Size;
+      ++Count;
+    }
+  }
+  spdlog::debug("{} files of {} mirrored to {}", Count, SourceDir_, Root_);
+}
+
+void StableWorkspace::dropStale() {
+  std::vector<fs::path> Stale;
+  std::error_code EC;
+  for (fs::recursive_directory_iterator
+           It(Root_, fs::directory_options::skip_permission_denied, EC),
+       End;
+       !EC && It != End; It.increment(EC)) {
+    if (It->is_directory(EC)) {
+      continue;
+    }
+    const fs::path RelPath = fs::relative(It->path(), Root_, EC);
+    if (EC || !fs::is_regular_file(fs::path(SourceDir_) / RelPath, EC)) {
+      EC.clear();
+      Stale.push_back(It->path());
+    }
+  }
+  for (const fs::path &Path : Stale) {
+    fs::remove(Path, EC);
+  }
+  spdlog::debug("{} stale files dropped from {}", Stale.size(), Root_);
+}
+
+bool StableWorkspace::mirror(const std::string &RelPath) {
+  const fs::path Src = fs::path(SourceDir_) / RelPath;
+  const fs::path Dst = fs::path(Root_) / RelPath;
+  std::error_code EC;
+  // files of the same content are kept, so are their mtimes, which clangd
+  // checks before reusing preambles
+  if (fs::is_regular_file(Dst, EC)) {
+    if (fs::equivalent(Src, Dst, EC)) {
+      return true;
+    }
+    if (fs::file_size(Src, EC) == fs::file_size(Dst, EC) &&
+        util::file_get_content(Src.string()) ==
+            util::file_get_content(Dst.string())) {
+      return true;
+    }
+  }
+
+  fs::create_directories(Dst.parent_path(), EC);
+  const fs::path Tmp = Dst.string() + ".mbtmp";
+  fs::remove(Tmp, EC);
+  EC.clear();
+  fs::create_hard_link(Src, Tmp, EC);
+  if (EC) {
+    // across file systems
+    EC.clear();
+    fs::copy_file(Src, Tmp, fs::copy_options::overwrite_existing, EC);
+  }
+  if (!EC) {
+    fs::rename(Tmp, Dst, EC);
+  }
+  if (EC) {
+    spdlog::debug("fail to mirror {} to {}: {}", Src.string(), Dst.string(),
+                  EC.message());
+    fs::remove(Tmp, EC);
+    return false;
+  }
+  return true;
+}
+} // namespace sa
+} // namespace mergebot
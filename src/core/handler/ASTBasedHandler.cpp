@@ -8,30 +8,29 @@
 #endif
 #include "mergebot/core/handler/ASTBasedHandler.h"
 #include "mergebot/core/model/ConflictFile.h"
+#include "mergebot/core/model/NodeArena.h"
 #include "mergebot/core/semantic/GraphBuilder.h"
 #include "mergebot/core/semantic/GraphMerger.h"
 #include "mergebot/core/semantic/SourceCollectorV2.h"
+#include "mergebot/core/semantic/SymbolCache.h"
 #include "mergebot/core/semantic/pretty_printer.h"
 #include "mergebot/filesystem.h"
 #include "mergebot/utils/fileio.h"
 #include "mergebot/utils/gitservice.h"
 #include "mergebot/utils/stringop.h"
 #include <clang/Tooling/CompilationDatabase.h>
-#include <clang/Tooling/JSONCompilationDatabase.h>
 #include <filesystem>
 #include <llvm/ADT/StringRef.h>
 #include <oneapi/tbb/parallel_invoke.h>
 #include <oneapi/tbb/tick_count.h>
 #include <spdlog/spdlog.h>
+#include <sys/resource.h>
 #include <system_error>
 #include <vector>
 
 namespace mergebot {
 namespace sa {
 
-const std::string ASTBasedHandler::CompDBRelative =
-    "build/compile_commands.json";
-
 void ASTBasedHandler::resolveConflictFiles(
     std::vector<ConflictFile> &ConflictFiles) {
   assert(ConflictFiles.size() &&
@@ -41,8 +40,7 @@ void ASTBasedHandler::resolveConflictFiles(
   //  spdlog::info("dependencies analysis disabled due to lack of CompDB");
 
   /// init CompDB
-  if (!fs::exists(OurCompDB) || !fs::exists(TheirCompDB) ||
-      !fs::exists(BaseCompDB)) {
+  if (CompDBPath.empty()) {
     spdlog::warn("CompDB doesn't exist, we'll skip AST based handler");
     return;
   }
@@ -102,12 +100,23 @@ void ASTBasedHandler::resolveConflictFiles(
 
   // 2. Get Graph representation of 3 commit nodes
   Start = tbb::tick_count::now();
+  // files unchanged between sides are resolved once for all of them
+  std::shared_ptr<SymbolCache> Symbols = SymbolCache::open(
+      SymbolCache::persistent()
+          ? (fs::path(Meta.ProjectCacheDir) / "lsp_symbols.cache").string()
+          : "");
+  // nodes of the three graphs, freed at once when the scenario is done. It
+  // must outlive the builders and the merger
+  std::shared_ptr<NodeArena> Arena = std::make_shared<NodeArena>();
   GraphBuilder OurBuilder(Side::OURS, Meta, ConflictPaths, ST.OurSourceList,
-                          ST.OurDirectIncluded);
+                          ST.OurDirectIncluded, OurCompilations, Symbols,
+                          Arena);
   GraphBuilder BaseBuilder(Side::BASE, Meta, ConflictPaths, ST.BaseSourceList,
-                           ST.BaseDirectIncluded);
+                           ST.BaseDirectIncluded, BaseCompilations, Symbols,
+                           Arena);
   GraphBuilder TheirBuilder(Side::THEIRS, Meta, ConflictPaths,
-                            ST.TheirSourceList, ST.TheirDirectIncluded);
+                            ST.TheirSourceList, ST.TheirDirectIncluded,
+                            TheirCompilations, Symbols, Arena);
 
   bool OurOk = false;
   bool BaseOk = false;
@@ -119,6 +128,18 @@ void ASTBasedHandler::resolveConflictFiles(
                        [&]() { BaseOk = BaseBuilder.build(); },
                        [&]() { TheirOk = TheirBuilder.build(); });
   End = tbb::tick_count::now();
+  spdlog::debug("symbol cache: {} hits, {} misses", Symbols->hits(),
+                Symbols->misses());
+  struct rusage Usage {};
+  getrusage(RUSAGE_SELF, &Usage);
+  spdlog::debug(
+      "{} nodes take {}KB in the arena, {} distinct names, peak RSS {}KB",
+      Arena->size(), Arena->bytesAllocated() >> 10, Arena->strings().size(),
+      Usage.ru_maxrss);
+  if (SymbolCache::persistent() && !Symbols->save()) {
+    spdlog::warn("fail to persist symbol cache of project {}",
+                 Meta.ProjectPath);
+  }
   if (!OurOk || !TheirOk) {
     spdlog::info("fail to construct graph representation of revisions");
     return;
@@ -247,48 +268,28 @@ void scanLines(const std::string &Filename, std::string &OurSideId,
 
 /**
  * @brief use clang libTooling library to infer missing compile commands from
- * JSON CDB
+ * JSON CDB, the CDB is loaded once and viewed from each revision dir
  */
 void ASTBasedHandler::initCompDB() {
-  tbb::parallel_invoke(
-      [&]() {
-        std::string ErrMsg;
-        OurCompilationsPair.first = clang::tooling::inferMissingCompileCommands(
-            clang::tooling::JSONCompilationDatabase::loadFromFile(
-                OurCompDB, ErrMsg,
-                clang::tooling::JSONCommandLineSyntax::AutoDetect));
-        OurCompilationsPair.second = true;
-        if (!ErrMsg.empty()) {
-          spdlog::error(ErrMsg, OurCompDB);
-          OurCompilationsPair.second = false;
-        }
-      },
-      [&]() {
-        std::string ErrMsg;
-        BaseCompilationsPair.first =
-            clang::tooling::inferMissingCompileCommands(
-                clang::tooling::JSONCompilationDatabase::loadFromFile(
-                    BaseCompDB, ErrMsg,
-                    clang::tooling::JSONCommandLineSyntax::AutoDetect));
-        BaseCompilationsPair.second = true;
-        if (!ErrMsg.empty()) {
-          spdlog::error(ErrMsg, BaseCompDB);
-          BaseCompilationsPair.second = false;
-        }
-      },
-      [&]() {
-        std::string ErrMsg;
-        TheirCompilationsPair.first =
-            clang::tooling::inferMissingCompileCommands(
-                clang::tooling::JSONCompilationDatabase::loadFromFile(
-                    TheirCompDB, ErrMsg,
-                    clang::tooling::JSONCommandLineSyntax::AutoDetect));
-        TheirCompilationsPair.second = true;
-        if (!ErrMsg.empty()) {
-          spdlog::error(ErrMsg, TheirCompDB);
-          TheirCompilationsPair.second = false;
-        }
-      });
+  std::string ErrMsg;
+  std::shared_ptr<clang::tooling::CompilationDatabase> CompDB =
+      RemappedCompDB::loadShared(CompDBPath, Meta.ProjectCacheDir, ErrMsg);
+  if (!CompDB) {
+    spdlog::error("fail to load CompDB {}: {}", CompDBPath, ErrMsg);
+    OurCompilationsPair.second = false;
+    BaseCompilationsPair.second = false;
+    TheirCompilationsPair.second = false;
+    return;
+  }
+
+  OurCompilationsPair = {
+      std::make_shared<RemappedCompDB>(CompDB, Meta.ProjectPath, OurDir), true};
+  BaseCompilationsPair = {
+      std::make_shared<RemappedCompDB>(CompDB, Meta.ProjectPath, BaseDir),
+      true};
+  TheirCompilationsPair = {
+      std::make_shared<RemappedCompDB>(CompDB, Meta.ProjectPath, TheirDir),
+      true};
 }
 
 std::tuple<std::string, std::string, std::string>
@@ -16,6 +16,8 @@
 #include <clang/Tooling/Core/Replacement.h>
 #include <filesystem>
 #include <magic_enum.hpp>
+#include <oneapi/tbb/parallel_for.h>
+#include <optional>
 #include <spdlog/spdlog.h>
 #include <string>
 #include <string_view>
@@ -47,95 +49,106 @@ void StyleBasedHandler::resolveConflictFiles(
     WithBase = OurPos != EndPos && BasePos != EndPos && TheirPos != EndPos;
   }
 
-  // check resolved, check not resolved
-  bool NeedShrink = false;
-  for (ConflictFile &CF : ConflictFiles) {
-    bool EverResolved = false, AllResolved = true;
-    spdlog::debug("resolving {}...", CF.Filename);
-
-    std::vector<server::BlockResolutionResult> ResolvedBlocks;
-    for (ConflictBlock &CB : CF.ConflictBlocks) {
-      std::string_view OurCode, TheirCode;
-      if (WithBase) {
-        OurCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
-            magic_enum::enum_name(ConflictMark::BASE));
-        TheirCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
-            magic_enum::enum_name(ConflictMark::END));
-      } else {
-        OurCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
-            magic_enum::enum_name(ConflictMark::THEIRS));
-        TheirCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
-            magic_enum::enum_name(ConflictMark::END));
-      }
-      assert((!OurCode.empty() || !TheirCode.empty()) &&
-             "at least one side of code should not be empty");
-
-      // 先进行宏展开，再移除注释和空格
-      std::string ExpandedOurs = util::doMacroExpansion(OurCode);
-      std::string ExpandedTheirs = util::doMacroExpansion(TheirCode);
-
-      std::string DeflatedOurs =
-          util::removeCommentsAndSpaces(std::move(ExpandedOurs));
-      std::string DeflatedTheirs =
-          util::removeCommentsAndSpaces(std::move(ExpandedTheirs));
-
-      if (DeflatedOurs == DeflatedTheirs) { // style related conflicts
-        spdlog::debug("deflated ours  : {}", DeflatedOurs);
-        spdlog::debug("deflated theirs: {}", DeflatedTheirs);
-        spdlog::info("ConflictBlock {} in File [{}] of Project [{}] is a "
-                     "style related conflict",
-                     CB.Index, CF.Filename, Meta.Project);
-        std::string ResultStr = std::string(OurCode);
-        if (NeedFormat) {
-          std::string RefFile = findRefFile(CF.Filename);
-          std::string FormattedCode = WhichSide == "ours"
-                                          ? formatOneSide(OurCode, RefFile)
-                                          : formatOneSide(TheirCode, RefFile);
-          if (!FormattedCode.empty()) {
-            ResultStr = FormattedCode;
-          }
+  // a style conflict is told from the code of its own block alone, so files
+  // are checked in parallel, and so are the blocks of each file, see
+  // resolveConflictFile for how results are kept in order
+  tbb::parallel_for(size_t(0), ConflictFiles.size(), [&](size_t I) {
+    resolveConflictFile(ConflictFiles[I], WithBase);
+  });
+
+  // tidy up conflict files and their conflict blocks
+  bool NeedShrink = std::any_of(
+      ConflictFiles.begin(), ConflictFiles.end(), [](ConflictFile const &CF) {
+        return std::any_of(CF.ConflictBlocks.begin(), CF.ConflictBlocks.end(),
+                           [](ConflictBlock const &CB) { return CB.Resolved; });
+      });
+  if (NeedShrink) {
+    tidyUpConflictFiles(ConflictFiles);
+  }
+}
+
+void StyleBasedHandler::resolveConflictFile(ConflictFile &CF,
+                                            bool WithBase) const {
+  spdlog::debug("resolving {}...", CF.Filename);
+
+  // one slot per block, filled by whichever task checks it, and marshalled
+  // in block order once all of them are done, thus the resolution file is
+  // the same as a serial run's
+  std::vector<std::optional<server::BlockResolutionResult>> Results(
+      CF.ConflictBlocks.size());
+  tbb::parallel_for(size_t(0), CF.ConflictBlocks.size(), [&](size_t J) {
+    ConflictBlock &CB = CF.ConflictBlocks[J];
+    std::string_view OurCode, TheirCode;
+    if (WithBase) {
+      OurCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
+          magic_enum::enum_name(ConflictMark::BASE));
+      TheirCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
+          magic_enum::enum_name(ConflictMark::END));
+    } else {
+      OurCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
+          magic_enum::enum_name(ConflictMark::THEIRS));
+      TheirCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
+          magic_enum::enum_name(ConflictMark::END));
+    }
+    assert((!OurCode.empty() || !TheirCode.empty()) &&
+           "at least one side of code should not be empty");
+
+    // 先进行宏展开，再移除注释和空格
+    std::string ExpandedOurs = util::doMacroExpansion(OurCode);
+    std::string ExpandedTheirs = util::doMacroExpansion(TheirCode);
+
+    std::string DeflatedOurs =
+        util::removeCommentsAndSpaces(std::move(ExpandedOurs));
+    std::string DeflatedTheirs =
+        util::removeCommentsAndSpaces(std::move(ExpandedTheirs));
+
+    if (DeflatedOurs == DeflatedTheirs) { // style related conflicts
+      spdlog::debug("deflated ours  : {}", DeflatedOurs);
+      spdlog::debug("deflated theirs: {}", DeflatedTheirs);
+      spdlog::info("ConflictBlock {} in File [{}] of Project [{}] is a "
+                   "style related conflict",
+                   CB.Index, CF.Filename, Meta.Project);
+      std::string ResultStr = std::string(OurCode);
+      if (NeedFormat) {
+        std::string RefFile = findRefFile(CF.Filename);
+        std::string FormattedCode = WhichSide == "ours"
+                                        ? formatOneSide(OurCode, RefFile)
+                                        : formatOneSide(TheirCode, RefFile);
+        if (!FormattedCode.empty()) {
+          ResultStr = FormattedCode;
         }
-        CB.Resolved = true;
-        ResolvedBlocks.push_back({
-            .index = CB.Index,
-            .desc = "Merge conflict caused by formatting issues.",
-            .code = std::move(ResultStr),
-        });
       }
+      CB.Resolved = true;
+      Results[J] = server::BlockResolutionResult{
+          .index = CB.Index,
+          .desc = "Merge conflict caused by formatting issues.",
+          .code = std::move(ResultStr),
+      };
     }
+  });
 
-    std::for_each(CF.ConflictBlocks.begin(), CF.ConflictBlocks.end(),
-                  [&](ConflictBlock const &CB) {
-                    if (CB.Resolved) {
-                      EverResolved = true;
-                    } else {
-                      AllResolved = false;
-                    }
-                  });
-    // update resolved flag of ConflictFile
-    CF.Resolved = AllResolved;
-    // check any of blocks is resolved, if true, marshal resolution results to
-    // MSCache dir; if false, do nothing
-    if (EverResolved) {
-      const std::string RelativePath =
-          fs::relative(CF.Filename, Meta.ProjectPath).string();
-      fs::path ResolutionDest =
-          fs::path(Meta.MSCacheDir) / "resolutions" / pathToName(RelativePath);
-      marshalResolutionResult(ResolutionDest.string(), RelativePath,
-                              ResolvedBlocks);
-    }
-
-    // tidy up conflict files and their conflict blocks
-    if (EverResolved) {
-      NeedShrink = true;
+  std::vector<server::BlockResolutionResult> ResolvedBlocks;
+  for (std::optional<server::BlockResolutionResult> &Result : Results) {
+    if (Result.has_value()) {
+      ResolvedBlocks.push_back(std::move(Result.value()));
     }
   }
-  if (NeedShrink) {
-    tidyUpConflictFiles(ConflictFiles);
+  // update resolved flag of ConflictFile
+  CF.Resolved = std::all_of(CF.ConflictBlocks.begin(), CF.ConflictBlocks.end(),
+                            [](ConflictBlock const &CB) { return CB.Resolved; });
+  // check any of blocks is resolved, if true, marshal resolution results to
+  // MSCache dir; if false, do nothing
+  if (ResolvedBlocks.size()) {
+    const std::string RelativePath =
+        fs::relative(CF.Filename, Meta.ProjectPath).string();
+    fs::path ResolutionDest =
+        fs::path(Meta.MSCacheDir) / "resolutions" / pathToName(RelativePath);
+    marshalResolutionResult(ResolutionDest.string(), RelativePath,
+                            ResolvedBlocks);
   }
 }
 
@@ -11,11 +11,13 @@
 #include "mergebot/filesystem.h"
 // #include "mergebot/parser/languages/cpp.h"
 #include "mergebot/parser/node.h"
+#include "mergebot/parser/parse_cache.h"
 #include "mergebot/parser/parser.h"
 #include "mergebot/parser/symbol.h"
 #include "mergebot/parser/tree.h"
 #include "mergebot/server/vo/ResolutionResultVO.h"
 #include "mergebot/utils/fileio.h"
+#include "mergebot/utils/gitservice.h"
 #include "mergebot/utils/stringop.h"
 #include <algorithm>
 #include <cctype>
@@ -23,6 +25,8 @@
 #include <llvm/Support/MemoryBuffer.h>
 #include <magic_enum.hpp>
 #include <memory>
+#include <oneapi/tbb/parallel_for.h>
+#include <optional>
 #include <queue>
 #include <spdlog/spdlog.h>
 #include <string>
@@ -98,19 +102,25 @@ bool isSubSequence(std::vector<std::string_view> const &Seq1,
   return j == Seq2.size();
 }
 
-bool parseDeclarations(std::string const &Code,
+/// blocks are resolved in parallel, and each side of a block is parsed by
+/// several strategies, reuse trees of the scenario if there's a cache
+std::shared_ptr<ts::Tree> parseCode(ts::ParseCache *Parses,
+                                    std::string_view Code) {
+  if (Parses) {
+    return Parses->parse(Code);
+  }
+  return ts::Parser::forThread(ts::cpp::language()).parse(std::string(Code));
+}
+
+bool parseDeclarations(ts::ParseCache *Parses, std::string_view Code,
                        std::vector<std::string> &Decls) {
   if (Code.empty())
     return false;
-  ts::Parser Parser(ts::cpp::language());
-
-  std::shared_ptr<ts::Tree> Tree = Parser.parse(std::string(Code));
-  ts::Node RootNode = Tree->rootNode();
-  for (ts::Node const &Node : RootNode.namedChildren()) {
-    std::string SymbolName =
-        ts::Symbol::nameOfSymbol(ts::cpp::language(), Node.symbol());
+  std::shared_ptr<ts::Tree> Tree = parseCode(Parses, Code);
+  for (ts::NodeRef Node : Tree->rootNode().ref().namedChildren()) {
+    const std::string_view SymbolName = Node.type();
     if (SymbolName != ts::cpp::symbols::sym_comment.name &&
-        SymbolName.find("declaration") == std::string::npos) {
+        SymbolName.find("declaration") == std::string_view::npos) {
       return false;
     }
     if (SymbolName == ts::cpp::symbols::sym_comment.name) {
@@ -118,14 +128,13 @@ bool parseDeclarations(std::string const &Code,
     }
 
     // declaration
-    std::string Decl = Node.text();
-    std::optional<ts::Node> PrevSibling = Node.prevSibling();
+    std::string Decl(Node.textView());
+    std::optional<ts::NodeRef> PrevSibling = Node.prevSibling();
     if (PrevSibling.has_value() &&
-        ts::Symbol::nameOfSymbol(ts::cpp::language(),
-                                 PrevSibling.value().symbol()) ==
-            ts::cpp::symbols::sym_comment.name) {
-      std::string comment = PrevSibling.value().text();
-      Decl = comment + "\n" + Node.text();
+        PrevSibling.value().type() == ts::cpp::symbols::sym_comment.name) {
+      Decl = std::string(PrevSibling.value().textView())
+                 .append("\n")
+                 .append(Node.textView());
       PrevSibling = PrevSibling.value().prevSibling();
     }
     Decls.push_back(std::move(Decl));
@@ -133,21 +142,17 @@ bool parseDeclarations(std::string const &Code,
   return true;
 }
 
-bool parseDefinitions(std::string const &Code,
+bool parseDefinitions(ts::ParseCache *Parses, std::string_view Code,
                       std::vector<std::string> &Definitions) {
   if (Code.empty())
     return false;
-  ts::Parser Parser(ts::cpp::language());
-
-  std::shared_ptr<ts::Tree> Tree = Parser.parse(std::string(Code));
-  ts::Node RootNode = Tree->rootNode();
+  std::shared_ptr<ts::Tree> Tree = parseCode(Parses, Code);
   bool EverDefinition = false;
-  for (ts::Node const &Node : RootNode.namedChildren()) {
-    std::string SymbolName =
-        ts::Symbol::nameOfSymbol(ts::cpp::language(), Node.symbol());
+  for (ts::NodeRef Node : Tree->rootNode().ref().namedChildren()) {
+    const std::string_view SymbolName = Node.type();
     if (SymbolName != ts::cpp::symbols::sym_comment.name &&
-        SymbolName.find("definition") == std::string::npos &&
-        SymbolName.find("declaration") == std::string::npos) {
+        SymbolName.find("definition") == std::string_view::npos &&
+        SymbolName.find("declaration") == std::string_view::npos) {
       return false;
     }
     if (SymbolName == ts::cpp::symbols::sym_comment.name) {
@@ -155,18 +160,16 @@ bool parseDefinitions(std::string const &Code,
     }
 
     // declaration or definition
-    std::string Definition = Node.text();
-    if (ts::Symbol::nameOfSymbol(ts::cpp::language(), Node.symbol())
-            .find("definition") != std::string::npos) {
+    std::string Definition(Node.textView());
+    if (SymbolName.find("definition") != std::string_view::npos) {
       EverDefinition = true;
     }
-    std::optional<ts::Node> PrevSibling = Node.prevSibling();
+    std::optional<ts::NodeRef> PrevSibling = Node.prevSibling();
     while (PrevSibling.has_value() &&
-           ts::Symbol::nameOfSymbol(ts::cpp::language(),
-                                    PrevSibling.value().symbol()) ==
-               ts::cpp::symbols::sym_comment.name) {
-      std::string comment = PrevSibling.value().text();
-      Definition = comment + "\n" + Node.text();
+           PrevSibling.value().type() == ts::cpp::symbols::sym_comment.name) {
+      Definition = std::string(PrevSibling.value().textView())
+                       .append("\n")
+                       .append(Node.textView());
       PrevSibling = PrevSibling.value().prevSibling();
     }
     Definitions.push_back(std::move(Definition));
@@ -174,22 +177,17 @@ bool parseDefinitions(std::string const &Code,
   return EverDefinition;
 }
 
-bool parseInclusions(std::string const &Code,
+bool parseInclusions(ts::ParseCache *Parses, std::string_view Code,
                      std::vector<std::string> &Inclusions) {
   if (Code.empty())
     return false;
-  ts::Parser Parser(ts::cpp::language());
-
-  std::shared_ptr<ts::Tree> Tree = Parser.parse(std::string(Code));
-  ts::Node Root = Tree->rootNode();
-  for (ts::Node const &Node : Root.namedChildren()) {
-    std::string SymbolName =
-        ts::Symbol::nameOfSymbol(ts::cpp::language(), Node.symbol());
+  std::shared_ptr<ts::Tree> Tree = parseCode(Parses, Code);
+  for (ts::NodeRef Node : Tree->rootNode().ref().namedChildren()) {
     // only parse #include
-    if (SymbolName != ts::cpp::symbols::sym_preproc_include.name) {
+    if (Node.type() != ts::cpp::symbols::sym_preproc_include.name) {
       return false;
     }
-    Inclusions.push_back(Node.text());
+    Inclusions.emplace_back(Node.textView());
   }
   return true;
 }
@@ -404,32 +402,28 @@ bool TextBasedHandler::checkInclusion(std::string_view Our,
   }
 
   if (_details::isCppHeader(CF.Filename)) {
-    ts::Parser Parser(ts::cpp::language());
-
-    std::shared_ptr<ts::Tree> OurTree = Parser.parse(std::string(Our));
-    ts::Node OurRootNode = OurTree->rootNode();
-    for (ts::Node const &Node : OurRootNode.namedChildren()) {
-      std::string SymbolName =
-          ts::Symbol::nameOfSymbol(ts::cpp::language(), Node.symbol());
+    std::shared_ptr<ts::Tree> OurTree =
+        _details::parseCode(Meta.Parses.get(), Our);
+    for (ts::NodeRef Node : OurTree->rootNode().ref().namedChildren()) {
+      const std::string_view SymbolName = Node.type();
       if (SymbolName == ts::cpp::symbols::sym_comment.name) {
         continue;
       }
       // currently, in header we only resolve declaration related inclusion
       // resolution, as function definition may change frequently
-      if (SymbolName.find("declaration") == std::string::npos) {
+      if (SymbolName.find("declaration") == std::string_view::npos) {
         return false;
       }
     }
 
-    std::shared_ptr<ts::Tree> TheirTree = Parser.parse(std::string(Their));
-    ts::Node TheirRootNode = TheirTree->rootNode();
-    for (ts::Node const &Node : TheirRootNode.namedChildren()) {
-      std::string SymbolName =
-          ts::Symbol::nameOfSymbol(ts::cpp::language(), Node.symbol());
+    std::shared_ptr<ts::Tree> TheirTree =
+        _details::parseCode(Meta.Parses.get(), Their);
+    for (ts::NodeRef Node : TheirTree->rootNode().ref().namedChildren()) {
+      const std::string_view SymbolName = Node.type();
       if (SymbolName == ts::cpp::symbols::sym_comment.name) {
         continue;
       }
-      if (SymbolName.find("declaration") == std::string::npos) {
+      if (SymbolName.find("declaration") == std::string_view::npos) {
         return false;
       }
     }
@@ -460,10 +454,10 @@ bool TextBasedHandler::doListMerge(std::string_view Our, std::string_view Their,
                                    server::BlockResolutionResult &BRR) {
   std::vector<std::string> OurInclusions;
   bool OurAllInclusions =
-      _details::parseInclusions(std::string(Our), OurInclusions);
+      _details::parseInclusions(Meta.Parses.get(), Our, OurInclusions);
   std::vector<std::string> TheirInclusions;
   bool TheirAllInclusions =
-      _details::parseInclusions(std::string(Their), TheirInclusions);
+      _details::parseInclusions(Meta.Parses.get(), Their, TheirInclusions);
   if (OurAllInclusions && TheirAllInclusions) {
     std::vector<std::string> Merged;
     if (_details::mergeVectors(OurInclusions, TheirInclusions, Merged)) {
@@ -481,11 +475,11 @@ bool TextBasedHandler::doListMerge(std::string_view Our, std::string_view Their,
   // 抽取签名成为list，判断相交，合并
   if (_details::isCppHeader(CF.Filename)) {
     std::vector<std::string> OurDecls;
-    if (!_details::parseDeclarations(std::string(Our), OurDecls)) {
+    if (!_details::parseDeclarations(Meta.Parses.get(), Our, OurDecls)) {
       return false;
     }
     std::vector<std::string> TheirDecls;
-    if (!_details::parseDeclarations(std::string(Their), TheirDecls)) {
+    if (!_details::parseDeclarations(Meta.Parses.get(), Their, TheirDecls)) {
       return false;
     }
     std::vector<std::string> Merged;
@@ -501,11 +495,12 @@ bool TextBasedHandler::doListMerge(std::string_view Our, std::string_view Their,
   // cpp source, check function and merge function
   if (_details::isCppSource(CF.Filename)) {
     std::vector<std::string> OurDefinitions;
-    if (!_details::parseDefinitions(std::string(Our), OurDefinitions)) {
+    if (!_details::parseDefinitions(Meta.Parses.get(), Our, OurDefinitions)) {
       return false;
     }
     std::vector<std::string> TheirDefinitions;
-    if (!_details::parseDefinitions(std::string(Their), TheirDefinitions)) {
+    if (!_details::parseDefinitions(Meta.Parses.get(), Their,
+                                    TheirDefinitions)) {
       return false;
     }
     std::vector<std::string> Merged;
@@ -526,7 +521,8 @@ bool TextBasedHandler::doListMerge(std::string_view Our, std::string_view Their,
 void TextBasedHandler::threeWayMerge(std::vector<ConflictFile> &ConflictFiles) {
   auto conflictsDir = fs::path(Meta.MSCacheDir) / "conflicts";
   fs::create_directories(conflictsDir);
-  for (const ConflictFile &CF : ConflictFiles) {
+  tbb::parallel_for(size_t(0), ConflictFiles.size(), [&](size_t I) {
+    const ConflictFile &CF = ConflictFiles[I];
     fs::path Relative = fs::relative(CF.Filename, Meta.ProjectPath);
     std::string ourFilePath = fs::path(Meta.MSCacheDir) /
                               magic_enum::enum_name(Side::OURS) / Relative;
@@ -536,21 +532,20 @@ void TextBasedHandler::threeWayMerge(std::vector<ConflictFile> &ConflictFiles) {
                                 magic_enum::enum_name(Side::THEIRS) / Relative;
     if (!exists(fs::path(ourFilePath)) || !exists(fs::path(baseFilePath)) ||
         !exists(fs::path(theirFilePath))) {
-      continue;
+      return;
     }
-    auto CMD = fmt::format("git merge-file -p --diff3 {} {} {}", ourFilePath,
-                           baseFilePath, theirFilePath);
-    auto OutputOrErr = utils::ExecCommand(CMD, 10, 0, false);
-    if (!OutputOrErr)
+    auto MergedOpt =
+        util::merge_file_diff3(ourFilePath, baseFilePath, theirFilePath);
+    if (!MergedOpt)
       spdlog::error("fail to merge {}, {} and {}", ourFilePath, baseFilePath,
                     theirFilePath);
     else {
       fs::path FilePath = conflictsDir / Relative;
       if (!exists(FilePath.parent_path()))
         fs::create_directories(FilePath.parent_path());
-      util::file_overwrite_content(FilePath, OutputOrErr.get());
+      util::file_overwrite_content(FilePath, MergedOpt.value());
     }
-  }
+  });
 }
 
 void TextBasedHandler::resolveConflictFiles(
@@ -571,90 +566,82 @@ void TextBasedHandler::resolveConflictFiles(
   }
 
   threeWayMerge(ConflictFiles);
-  bool NeedShrink = false;
-  for (ConflictFile &CF : ConflictFiles) {
-    bool EverResolved = false, AllResolved = true;
-    spdlog::debug("resolving {}...", CF.Filename);
-
-    std::vector<server::BlockResolutionResult> ResolvedBlocks;
-    for (ConflictBlock &CB : CF.ConflictBlocks) {
-      std::string_view OurCode, TheirCode;
-      if (WithBase) {
-        OurCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
-            magic_enum::enum_name(ConflictMark::BASE));
-        TheirCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
-            magic_enum::enum_name(ConflictMark::END));
-      } else {
-        OurCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
-            magic_enum::enum_name(ConflictMark::THEIRS));
-        TheirCode = extractCodeFromConflictRange(
-            CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
-            magic_enum::enum_name(ConflictMark::END));
-      }
-      assert((!OurCode.empty() || !TheirCode.empty()) &&
-             "at least one side of code should not be empty");
-      server::BlockResolutionResult BRR;
-      BRR.index = CB.Index;
-
-      if (checkDeletion(OurCode, TheirCode, CF, BRR)) {
-        ResolvedBlocks.push_back(std::move(BRR));
-        CB.Resolved = true;
-        continue;
-      }
-
-      if (checkOneSideDelta(OurCode, TheirCode, CF, BRR)) {
-        ResolvedBlocks.push_back(std::move(BRR));
-        CB.Resolved = true;
-        continue;
-      }
-
-      if (checkInclusion(OurCode, TheirCode, CF, BRR)) {
-        ResolvedBlocks.push_back(std::move(BRR));
-        CB.Resolved = true;
-        continue;
-      }
-
-      if (doListMerge(OurCode, TheirCode, CF, BRR)) {
-        ResolvedBlocks.push_back(std::move(BRR));
-        CB.Resolved = true;
-        continue;
-      }
-    }
-
-    std::for_each(CF.ConflictBlocks.begin(), CF.ConflictBlocks.end(),
-                  [&](ConflictBlock const &CB) {
-                    if (CB.Resolved) {
-                      EverResolved = true;
-                    } else {
-                      AllResolved = false;
-                    }
-                  });
-    // update resolved flag of ConflictFile
-    CF.Resolved = AllResolved;
-    // check any of blocks is resolved, if true, marshal resolution results to
-    // MSCache dir; if false, do nothing
-    if (EverResolved) {
-      const std::string RelativePath =
-          fs::relative(CF.Filename, Meta.ProjectPath).string();
-      fs::path ResolutionDest =
-          fs::path(Meta.MSCacheDir) / "resolutions" / pathToName(RelativePath);
-      marshalResolutionResult(ResolutionDest.string(), RelativePath,
-                              ResolvedBlocks);
-    }
-
-    // tidy up conflict files and their conflict blocks
-    if (EverResolved) {
-      NeedShrink = true;
-    }
-  }
+  // the heuristics of a block only read its own code and the merged file
+  // written above, which no one writes from now on. Files and their blocks
+  // are therefore checked in parallel, each block reporting to its own slot
+  tbb::parallel_for(size_t(0), ConflictFiles.size(), [&](size_t I) {
+    resolveConflictFile(ConflictFiles[I], WithBase);
+  });
+
+  // tidy up conflict files and their conflict blocks
+  bool NeedShrink = std::any_of(
+      ConflictFiles.begin(), ConflictFiles.end(), [](ConflictFile const &CF) {
+        return std::any_of(CF.ConflictBlocks.begin(), CF.ConflictBlocks.end(),
+                           [](ConflictBlock const &CB) { return CB.Resolved; });
+      });
   if (NeedShrink) {
     tidyUpConflictFiles(ConflictFiles);
   }
 }
 
+void TextBasedHandler::resolveConflictFile(ConflictFile &CF, bool WithBase) {
+  spdlog::debug("resolving {}...", CF.Filename);
+
+  std::vector<std::optional<server::BlockResolutionResult>> Results(
+      CF.ConflictBlocks.size());
+  tbb::parallel_for(size_t(0), CF.ConflictBlocks.size(), [&](size_t J) {
+    ConflictBlock &CB = CF.ConflictBlocks[J];
+    std::string_view OurCode, TheirCode;
+    if (WithBase) {
+      OurCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
+          magic_enum::enum_name(ConflictMark::BASE));
+      TheirCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
+          magic_enum::enum_name(ConflictMark::END));
+    } else {
+      OurCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::OURS),
+          magic_enum::enum_name(ConflictMark::THEIRS));
+      TheirCode = extractCodeFromConflictRange(
+          CB.ConflictRange, magic_enum::enum_name(ConflictMark::THEIRS),
+          magic_enum::enum_name(ConflictMark::END));
+    }
+    assert((!OurCode.empty() || !TheirCode.empty()) &&
+           "at least one side of code should not be empty");
+    server::BlockResolutionResult BRR;
+    BRR.index = CB.Index;
+
+    if (checkDeletion(OurCode, TheirCode, CF, BRR) ||
+        checkOneSideDelta(OurCode, TheirCode, CF, BRR) ||
+        checkInclusion(OurCode, TheirCode, CF, BRR) ||
+        doListMerge(OurCode, TheirCode, CF, BRR)) {
+      CB.Resolved = true;
+      Results[J] = std::move(BRR);
+    }
+  });
+
+  std::vector<server::BlockResolutionResult> ResolvedBlocks;
+  for (std::optional<server::BlockResolutionResult> &Result : Results) {
+    if (Result.has_value()) {
+      ResolvedBlocks.push_back(std::move(Result.value()));
+    }
+  }
+  // update resolved flag of ConflictFile
+  CF.Resolved = std::all_of(CF.ConflictBlocks.begin(), CF.ConflictBlocks.end(),
+                            [](ConflictBlock const &CB) { return CB.Resolved; });
+  // check any of blocks is resolved, if true, marshal resolution results to
+  // MSCache dir; if false, do nothing
+  if (ResolvedBlocks.size()) {
+    const std::string RelativePath =
+        fs::relative(CF.Filename, Meta.ProjectPath).string();
+    fs::path ResolutionDest =
+        fs::path(Meta.MSCacheDir) / "resolutions" / pathToName(RelativePath);
+    marshalResolutionResult(ResolutionDest.string(), RelativePath,
+                            ResolvedBlocks);
+  }
+}
+
 bool TextBasedHandler::checkDeletion(std::string_view Our,
                                      std::string_view Their,
                                      const ConflictFile &CF,
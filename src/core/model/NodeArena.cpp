@@ -0,0 +1,37 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/model/NodeArena.h"
+
+namespace mergebot {
+namespace sa {
+NodeArena::~NodeArena() {
+  // nodes own strings and child lists on the heap, the slabs are freed by the
+  // allocator afterwards
+  for (SemanticNode *Node : Nodes_) {
+    Node->~SemanticNode();
+  }
+}
+
+void *NodeArena::allocate(size_t Size, size_t Alignment) {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Allocator_.Allocate(Size, llvm::Align(Alignment));
+}
+
+void NodeArena::adopt(SemanticNode *Node) {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  Nodes_.push_back(Node);
+}
+
+size_t NodeArena::size() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Nodes_.size();
+}
+
+size_t NodeArena::bytesAllocated() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Allocator_.getBytesAllocated();
+}
+} // namespace sa
+} // namespace mergebot
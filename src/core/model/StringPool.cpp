@@ -0,0 +1,40 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/model/StringPool.h"
+
+#include <cassert>
+
+namespace mergebot {
+namespace sa {
+StringPool::Symbol StringPool::intern(llvm::StringRef Str) {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  auto [It, Inserted] =
+      Symbols_.try_emplace(Str, static_cast<Symbol>(Strings_.size()));
+  if (Inserted) {
+    assert(Strings_.size() < None && "too many strings for 32-bit symbols");
+    // keys of a StringMap don't move on rehash
+    Strings_.push_back(It->getKey());
+  }
+  return It->getValue();
+}
+
+StringPool::Symbol StringPool::lookup(llvm::StringRef Str) const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  auto It = Symbols_.find(Str);
+  return It == Symbols_.end() ? None : It->getValue();
+}
+
+llvm::StringRef StringPool::str(Symbol Sym) const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  assert(Sym < Strings_.size() && "unknown symbol");
+  return Strings_[Sym];
+}
+
+size_t StringPool::size() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Strings_.size();
+}
+} // namespace sa
+} // namespace mergebot
@@ -0,0 +1,297 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
+
+#include <limits>
+#include <numeric>
+
+namespace mergebot::sa {
+namespace detail {
+/// components with more steps than this are matched greedily
+constexpr size_t HungarianBudget = size_t(1) << 26;
+/// rounds of local exchanges after the greedy matching
+constexpr int ExchangeRounds = 8;
+constexpr uint32_t Unmatched = std::numeric_limits<uint32_t>::max();
+
+class DisjointSets {
+public:
+  explicit DisjointSets(size_t Size) : Parents(Size) {
+    std::iota(Parents.begin(), Parents.end(), 0);
+  }
+
+  size_t find(size_t X) {
+    while (Parents[X] != X) {
+      Parents[X] = Parents[Parents[X]];
+      X = Parents[X];
+    }
+    return X;
+  }
+
+  void unite(size_t X, size_t Y) { Parents[find(X)] = find(Y); }
+
+private:
+  std::vector<size_t> Parents;
+};
+
+/// Kuhn-Munkres with potentials, O(Rows^2 * Cols), on a dense matrix of the
+/// component. Pairs without an edge weigh 0, assigning a row to one of them
+/// leaves it unmatched.
+std::vector<ScoredPair> hungarian(const std::vector<ScoredPair> &Edges) {
+  std::vector<uint32_t> Bases, Revisions;
+  for (const ScoredPair &Edge : Edges) {
+    Bases.push_back(Edge.Base);
+    Revisions.push_back(Edge.Revision);
+  }
+  for (std::vector<uint32_t> *Side : {&Bases, &Revisions}) {
+    std::sort(Side->begin(), Side->end());
+    Side->erase(std::unique(Side->begin(), Side->end()), Side->end());
+  }
+  auto indexOf = [](const std::vector<uint32_t> &Side, uint32_t Idx) {
+    return std::lower_bound(Side.begin(), Side.end(), Idx) - Side.begin();
+  };
+
+  // rows are the smaller side
+  const bool Transposed = Bases.size() > Revisions.size();
+  const std::vector<uint32_t> &RowIds = Transposed ? Revisions : Bases;
+  const std::vector<uint32_t> &ColIds = Transposed ? Bases : Revisions;
+  const size_t N = RowIds.size();
+  const size_t M = ColIds.size();
+  std::vector<double> Cost(N * M, 0.0);
+  for (const ScoredPair &Edge : Edges) {
+    size_t Row = indexOf(Transposed ? Revisions : Bases,
+                         Transposed ? Edge.Revision : Edge.Base);
+    size_t Col = indexOf(Transposed ? Bases : Revisions,
+                         Transposed ? Edge.Base : Edge.Revision);
+    Cost[Row * M + Col] = -Edge.Score;
+  }
+
+  // 1-based, as column 0 stands for the row being inserted
+  const double Inf = std::numeric_limits<double>::infinity();
+  std::vector<double> U(N + 1, 0.0), V(M + 1, 0.0);
+  std::vector<size_t> RowOf(M + 1, 0), Way(M + 1, 0);
+  for (size_t Row = 1; Row <= N; ++Row) {
+    RowOf[0] = Row;
+    size_t Col0 = 0;
+    std::vector<double> MinV(M + 1, Inf);
+    std::vector<bool> Used(M + 1, false);
+    do {
+      Used[Col0] = true;
+      const size_t Row0 = RowOf[Col0];
+      double Delta = Inf;
+      size_t Col1 = 0;
+      for (size_t Col = 1; Col <= M; ++Col) {
+        if (Used[Col]) {
+          continue;
+        }
+        const double Cur = Cost[(Row0 - 1) * M + (Col - 1)] - U[Row0] - V[Col];
+        if (Cur < MinV[Col]) {
+          MinV[Col] = Cur;
+          Way[Col] = Col0;
+        }
+        if (MinV[Col] < Delta) {
+          Delta = MinV[Col];
+          Col1 = Col;
+        }
+      }
+      for (size_t Col = 0; Col <= M; ++Col) {
+        if (Used[Col]) {
+          U[RowOf[Col]] += Delta;
+          V[Col] -= Delta;
+        } else {
+          MinV[Col] -= Delta;
+        }
+      }
+      Col0 = Col1;
+    } while (RowOf[Col0] != 0);
+    do {
+      const size_t Col1 = Way[Col0];
+      RowOf[Col0] = RowOf[Col1];
+      Col0 = Col1;
+    } while (Col0);
+  }
+
+  std::vector<ScoredPair> Assigned;
+  for (size_t Col = 1; Col <= M; ++Col) {
+    if (RowOf[Col] == 0) {
+      continue;
+    }
+    const double Weight = -Cost[(RowOf[Col] - 1) * M + (Col - 1)];
+    if (Weight <= 0) {
+      continue;
+    }
+    const uint32_t Row = RowIds[RowOf[Col] - 1];
+    const uint32_t Other = ColIds[Col - 1];
+    Assigned.push_back(Transposed ? ScoredPair{Other, Row, Weight}
+                                  : ScoredPair{Row, Other, Weight});
+  }
+  return Assigned;
+}
+
+/// Greedy by descending score, then improved by local exchanges whenever they
+/// gain: an edge replaces the (at most two) matched edges it conflicts with,
+/// re-pairing their loose ends if they share an edge, and a free base takes
+/// the revision of a matched base which moves on to a free revision.
+std::vector<ScoredPair> greedy(const std::vector<ScoredPair> &Edges) {
+  std::vector<ScoredPair> Sorted(Edges);
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const ScoredPair &L, const ScoredPair &R) {
+              if (L.Score != R.Score) {
+                return L.Score > R.Score;
+              }
+              return std::make_pair(L.Base, L.Revision) <
+                     std::make_pair(R.Base, R.Revision);
+            });
+
+  auto key = [](uint32_t Base, uint32_t Revision) {
+    return (uint64_t(Base) << 32) | Revision;
+  };
+  std::unordered_map<uint64_t, double> Weights;
+  Weights.reserve(Sorted.size());
+  std::unordered_map<uint32_t, std::vector<ScoredPair>> EdgesOfBase;
+  for (const ScoredPair &Edge : Sorted) {
+    Weights.emplace(key(Edge.Base, Edge.Revision), Edge.Score);
+    EdgesOfBase[Edge.Base].push_back(Edge);
+  }
+  auto weight = [&](uint32_t Base, uint32_t Revision) {
+    auto It = Weights.find(key(Base, Revision));
+    return It == Weights.end() ? 0.0 : It->second;
+  };
+
+  std::unordered_map<uint32_t, uint32_t> MateOfBase, MateOfRevision;
+  auto mate = [](const std::unordered_map<uint32_t, uint32_t> &Mates,
+                 uint32_t Idx) {
+    auto It = Mates.find(Idx);
+    return It == Mates.end() ? Unmatched : It->second;
+  };
+  auto unpair = [&](uint32_t Base) {
+    MateOfRevision.erase(MateOfBase[Base]);
+    MateOfBase.erase(Base);
+  };
+  auto pair = [&](uint32_t Base, uint32_t Revision) {
+    MateOfBase[Base] = Revision;
+    MateOfRevision[Revision] = Base;
+  };
+
+  for (const ScoredPair &Edge : Sorted) {
+    if (mate(MateOfBase, Edge.Base) == Unmatched &&
+        mate(MateOfRevision, Edge.Revision) == Unmatched) {
+      pair(Edge.Base, Edge.Revision);
+    }
+  }
+
+  constexpr double Epsilon = 1e-12;
+  for (int Round = 0; Round < ExchangeRounds; ++Round) {
+    bool Improved = false;
+    for (const ScoredPair &Edge : Sorted) {
+      const uint32_t A = Edge.Base, D = Edge.Revision;
+      const uint32_t B = mate(MateOfBase, A);
+      const uint32_t C = mate(MateOfRevision, D);
+      if (B == D) {
+        continue;
+      }
+      const double Lost = (B == Unmatched ? 0.0 : weight(A, B)) +
+                          (C == Unmatched ? 0.0 : weight(C, D));
+      const double Repaired =
+          B != Unmatched && C != Unmatched ? weight(C, B) : 0.0;
+      if (Edge.Score + Repaired <= Lost + Epsilon) {
+        continue;
+      }
+      if (B != Unmatched) {
+        unpair(A);
+      }
+      if (C != Unmatched) {
+        unpair(C);
+      }
+      pair(A, D);
+      if (Repaired > 0) {
+        pair(C, B);
+      }
+      Improved = true;
+    }
+
+    for (const auto &[A, Candidates] : EdgesOfBase) {
+      if (mate(MateOfBase, A) != Unmatched) {
+        continue;
+      }
+      bool Augmented = false;
+      for (const ScoredPair &AB : Candidates) {
+        const uint32_t C = mate(MateOfRevision, AB.Revision);
+        if (C == Unmatched) {
+          continue;
+        }
+        const double Lost = weight(C, AB.Revision);
+        for (const ScoredPair &CD : EdgesOfBase.at(C)) {
+          if (mate(MateOfRevision, CD.Revision) != Unmatched ||
+              AB.Score + CD.Score <= Lost + Epsilon) {
+            continue;
+          }
+          unpair(C);
+          pair(A, AB.Revision);
+          pair(C, CD.Revision);
+          Augmented = Improved = true;
+          break;
+        }
+        if (Augmented) {
+          break;
+        }
+      }
+    }
+    if (!Improved) {
+      break;
+    }
+  }
+
+  std::vector<ScoredPair> Assigned;
+  Assigned.reserve(MateOfBase.size());
+  for (const auto &[Base, Revision] : MateOfBase) {
+    Assigned.push_back({Base, Revision, weight(Base, Revision)});
+  }
+  return Assigned;
+}
+} // namespace detail
+
+std::vector<ScoredPair> maxWeightAssignment(size_t NumBase, size_t NumRevision,
+                                            std::vector<ScoredPair> Edges) {
+  detail::DisjointSets Components(NumBase + NumRevision);
+  for (const ScoredPair &Edge : Edges) {
+    assert(Edge.Base < NumBase && Edge.Revision < NumRevision &&
+           "edge out of range");
+    assert(Edge.Score >= 0 && "negative scores are never matched");
+    Components.unite(Edge.Base, NumBase + Edge.Revision);
+  }
+
+  std::unordered_map<size_t, std::vector<ScoredPair>> EdgesOf;
+  for (const ScoredPair &Edge : Edges) {
+    EdgesOf[Components.find(Edge.Base)].push_back(Edge);
+  }
+
+  std::vector<ScoredPair> Assigned;
+  for (auto &[Root, Component] : EdgesOf) {
+    if (Component.size() == 1) {
+      if (Component.front().Score > 0) {
+        Assigned.push_back(Component.front());
+      }
+      continue;
+    }
+    std::unordered_set<uint32_t> Bases, Revisions;
+    for (const ScoredPair &Edge : Component) {
+      Bases.insert(Edge.Base);
+      Revisions.insert(Edge.Revision);
+    }
+    const size_t Rows = std::min(Bases.size(), Revisions.size());
+    const size_t Cols = std::max(Bases.size(), Revisions.size());
+    std::vector<ScoredPair> Solved = Rows * Rows * Cols <= detail::HungarianBudget
+                                         ? detail::hungarian(Component)
+                                         : detail::greedy(Component);
+    Assigned.insert(Assigned.end(), Solved.begin(), Solved.end());
+  }
+
+  std::sort(Assigned.begin(), Assigned.end(),
+            [](const ScoredPair &L, const ScoredPair &R) {
+              return L.Base < R.Base;
+            });
+  return Assigned;
+}
+} // namespace mergebot::sa
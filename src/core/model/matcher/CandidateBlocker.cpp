@@ -0,0 +1,116 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/model/matcher/CandidateBlocker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace mergebot::sa {
+namespace detail {
+constexpr double DefaultRecall = 0.95;
+/// distinguishes keys of empty sketches from keys of bands
+constexpr uint64_t EmptySketchTag = 0x656d707479ULL;
+
+/// splitmix64 finalizer, the k-gram hashes of std::hash may be weak in their
+/// low bits
+uint64_t mix(uint64_t X) {
+  X += 0x9e3779b97f4a7c15ULL;
+  X = (X ^ (X >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  X = (X ^ (X >> 27)) * 0x94d049bb133111ebULL;
+  return X ^ (X >> 31);
+}
+
+uint64_t combine(uint64_t Seed, uint64_t Value) {
+  return mix(Seed ^ (Value + 0x9e3779b97f4a7c15ULL + (Seed << 6) +
+                     (Seed >> 2)));
+}
+} // namespace detail
+
+size_t CandidateBlocker::bandsForRecall(double Recall) {
+  if (Recall >= 1.0) {
+    return 0;
+  }
+  const double PerBand = std::pow(TargetJaccard, static_cast<double>(Rows));
+  const double Bands = std::log(1.0 - Recall) / std::log(1.0 - PerBand);
+  return std::max<size_t>(static_cast<size_t>(std::ceil(Bands)), 1);
+}
+
+double CandidateBlocker::recall() {
+  const char *Env = std::getenv("MERGEBOT_MATCH_RECALL");
+  if (Env && *Env) {
+    char *End = nullptr;
+    const double Value = std::strtod(Env, &End);
+    if (!*End && Value > 0) {
+      return std::min(Value, 1.0);
+    }
+  }
+  return detail::DefaultRecall;
+}
+
+std::vector<uint64_t>
+CandidateBlocker::sketchKeys(const util::KGramSketch &Sketch, size_t Bands,
+                             unsigned Slot) {
+  if (Sketch.hashes.empty()) {
+    return {detail::combine(detail::EmptySketchTag, Slot)};
+  }
+
+  std::vector<uint64_t> MinHashes(Bands * Rows,
+                                  std::numeric_limits<uint64_t>::max());
+  for (uint64_t Gram : Sketch.hashes) {
+    for (size_t H = 0; H < MinHashes.size(); ++H) {
+      MinHashes[H] = std::min(MinHashes[H], detail::mix(Gram ^ detail::mix(H)));
+    }
+  }
+
+  std::vector<uint64_t> Keys(Bands);
+  for (size_t Band = 0; Band < Bands; ++Band) {
+    uint64_t Key = detail::combine(Slot + 1, Band);
+    for (size_t Row = 0; Row < Rows; ++Row) {
+      Key = detail::combine(Key, MinHashes[Band * Rows + Row]);
+    }
+    Keys[Band] = Key;
+  }
+  return Keys;
+}
+
+void CandidateBlocker::add(bool IsBase, uint32_t Idx,
+                           const std::vector<uint64_t> &Keys,
+                           std::optional<size_t> Affinity) {
+  assert(Idx < (IsBase ? NumBase : NumRevision) && "node out of range");
+  for (uint64_t Key : Keys) {
+    Bucket &B = Buckets[Key];
+    Group &G = Affinity ? B.ByAffinity[*Affinity] : B.Neutral;
+    (IsBase ? G.Bases : G.Revisions).push_back(Idx);
+  }
+}
+
+std::vector<std::vector<uint32_t>> CandidateBlocker::candidates() const {
+  std::vector<std::vector<uint32_t>> Candidates(NumBase);
+  auto Pair = [&](const std::vector<uint32_t> &Bases,
+                  const std::vector<uint32_t> &Revisions) {
+    for (uint32_t Base : Bases) {
+      Candidates[Base].insert(Candidates[Base].end(), Revisions.begin(),
+                              Revisions.end());
+    }
+  };
+  for (const auto &[Key, B] : Buckets) {
+    for (const auto &[Affinity, G] : B.ByAffinity) {
+      Pair(G.Bases, G.Revisions);
+      Pair(G.Bases, B.Neutral.Revisions);
+      Pair(B.Neutral.Bases, G.Revisions);
+    }
+    Pair(B.Neutral.Bases, B.Neutral.Revisions);
+  }
+  for (std::vector<uint32_t> &Revisions : Candidates) {
+    std::sort(Revisions.begin(), Revisions.end());
+    Revisions.erase(std::unique(Revisions.begin(), Revisions.end()),
+                    Revisions.end());
+  }
+  return Candidates;
+}
+} // namespace mergebot::sa
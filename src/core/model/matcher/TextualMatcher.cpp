@@ -0,0 +1,421 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/model/matcher/TextualMatcher.h"
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
+#include "mergebot/globals.h"
+#include "mergebot/utils/similarity.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <map>
+#include <oneapi/tbb/parallel_for.h>
+#include <spdlog/spdlog.h>
+#include <string_view>
+#include <unordered_set>
+
+namespace mergebot::sa {
+namespace detail {
+/// gaps without anchors of more cells than this are left unaligned
+constexpr size_t DenseAlignBudget = size_t(1) << 20;
+/// leading tokens of the text an alignment key is made of, only the
+/// directive and the name for preprocessor lines
+constexpr size_t AlignTokens = 3;
+constexpr size_t DirectiveAlignTokens = 2;
+
+/// text with runs of whitespace collapsed into a single space, trimmed, and
+/// without the trailing comma of an enumerator
+std::string normalize(std::string_view Text) {
+  std::string Normalized;
+  Normalized.reserve(Text.size());
+  bool Space = false;
+  for (char C : Text) {
+    if (std::isspace(static_cast<unsigned char>(C))) {
+      Space = true;
+      continue;
+    }
+    if (Space && !Normalized.empty()) {
+      Normalized.push_back(' ');
+    }
+    Space = false;
+    Normalized.push_back(C);
+  }
+  if (!Normalized.empty() && Normalized.back() == ',') {
+    Normalized.pop_back();
+    if (!Normalized.empty() && Normalized.back() == ' ') {
+      Normalized.pop_back();
+    }
+  }
+  return Normalized;
+}
+
+/// the first tokens before any initializer, parameter list or body, e.g.
+/// "#define FOO", "using Foo", "typedef unsigned int" or an enumerator name
+std::string_view leadingTokens(std::string_view Normalized) {
+  const size_t Stop = Normalized.find_first_of("=({;,");
+  std::string_view Head = Normalized.substr(0, Stop);
+  const size_t Tokens =
+      !Head.empty() && Head.front() == '#' ? DirectiveAlignTokens : AlignTokens;
+  size_t End = 0;
+  for (size_t Token = 0; Token < Tokens && End != std::string_view::npos;
+       ++Token) {
+    End = Head.find(' ', End ? End + 1 : 0);
+  }
+  Head = Head.substr(0, End);
+  while (!Head.empty() && Head.back() == ' ') {
+    Head.remove_suffix(1);
+  }
+  return Head.empty() ? Normalized : Head;
+}
+
+using AlignedPairs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+/// indices into \p Pairs of a longest subsequence increasing on the second
+/// member, by patience sorting
+std::vector<size_t> longestIncreasing(const AlignedPairs &Pairs) {
+  std::vector<size_t> Tails;
+  std::vector<size_t> Prev(Pairs.size(), SIZE_MAX);
+  for (size_t i = 0; i < Pairs.size(); ++i) {
+    auto It = std::lower_bound(Tails.begin(), Tails.end(), Pairs[i].second,
+                               [&](size_t Tail, uint32_t Value) {
+                                 return Pairs[Tail].second < Value;
+                               });
+    if (It != Tails.begin()) {
+      Prev[i] = *std::prev(It);
+    }
+    if (It == Tails.end()) {
+      Tails.push_back(i);
+    } else {
+      *It = i;
+    }
+  }
+  std::vector<size_t> Sequence;
+  for (size_t i = Tails.empty() ? SIZE_MAX : Tails.back(); i != SIZE_MAX;
+       i = Prev[i]) {
+    Sequence.push_back(i);
+  }
+  std::reverse(Sequence.begin(), Sequence.end());
+  return Sequence;
+}
+
+void alignDense(const std::vector<uint64_t> &A, const std::vector<uint64_t> &B,
+                uint32_t A0, uint32_t A1, uint32_t B0, uint32_t B1,
+                AlignedPairs &Out) {
+  const size_t N = A1 - A0;
+  const size_t M = B1 - B0;
+  std::vector<uint32_t> Lcs((N + 1) * (M + 1), 0);
+  auto at = [&](size_t i, size_t j) -> uint32_t & {
+    return Lcs[i * (M + 1) + j];
+  };
+  for (size_t i = N; i-- > 0;) {
+    for (size_t j = M; j-- > 0;) {
+      at(i, j) = A[A0 + i] == B[B0 + j]
+                     ? at(i + 1, j + 1) + 1
+                     : std::max(at(i + 1, j), at(i, j + 1));
+    }
+  }
+  for (size_t i = 0, j = 0; i < N && j < M;) {
+    if (A[A0 + i] == B[B0 + j]) {
+      Out.emplace_back(A0 + i++, B0 + j++);
+    } else if (at(i + 1, j) >= at(i, j + 1)) {
+      ++i;
+    } else {
+      ++j;
+    }
+  }
+}
+
+void alignRange(const std::vector<uint64_t> &A, const std::vector<uint64_t> &B,
+                uint32_t A0, uint32_t A1, uint32_t B0, uint32_t B1,
+                AlignedPairs &Out) {
+  while (A0 < A1 && B0 < B1 && A[A0] == B[B0]) {
+    Out.emplace_back(A0++, B0++);
+  }
+  AlignedPairs Suffix;
+  while (A0 < A1 && B0 < B1 && A[A1 - 1] == B[B1 - 1]) {
+    Suffix.emplace_back(--A1, --B1);
+  }
+
+  if (A0 < A1 && B0 < B1) {
+    struct Occurrence {
+      uint32_t InBase = 0;
+      uint32_t InRevision = 0;
+      uint32_t RevisionPos = 0;
+    };
+    std::unordered_map<uint64_t, Occurrence> Occurrences;
+    for (uint32_t i = A0; i < A1; ++i) {
+      ++Occurrences[A[i]].InBase;
+    }
+    for (uint32_t j = B0; j < B1; ++j) {
+      auto It = Occurrences.find(B[j]);
+      if (It != Occurrences.end()) {
+        ++It->second.InRevision;
+        It->second.RevisionPos = j;
+      }
+    }
+    AlignedPairs Unique;
+    for (uint32_t i = A0; i < A1; ++i) {
+      const Occurrence &Occ = Occurrences[A[i]];
+      if (Occ.InBase == 1 && Occ.InRevision == 1) {
+        Unique.emplace_back(i, Occ.RevisionPos);
+      }
+    }
+
+    if (!Unique.empty()) {
+      uint32_t PrevA = A0, PrevB = B0;
+      for (size_t Anchor : longestIncreasing(Unique)) {
+        const auto [i, j] = Unique[Anchor];
+        alignRange(A, B, PrevA, i, PrevB, j, Out);
+        Out.emplace_back(i, j);
+        PrevA = i + 1;
+        PrevB = j + 1;
+      }
+      alignRange(A, B, PrevA, A1, PrevB, B1, Out);
+    } else if (size_t(A1 - A0) * (B1 - B0) <= DenseAlignBudget) {
+      alignDense(A, B, A0, A1, B0, B1, Out);
+    }
+  }
+
+  Out.insert(Out.end(), Suffix.rbegin(), Suffix.rend());
+}
+
+void eraseMatched(std::vector<SemanticNode *> &Nodes,
+                  const std::unordered_set<size_t> &Matched) {
+  Nodes.erase(std::remove_if(Nodes.begin(), Nodes.end(),
+                             [&](SemanticNode *Node) {
+                               return Matched.count(Node->hashSignature());
+                             }),
+              Nodes.end());
+}
+} // namespace detail
+
+std::vector<std::pair<uint32_t, uint32_t>>
+alignSequences(const std::vector<uint64_t> &Base,
+               const std::vector<uint64_t> &Revision) {
+  detail::AlignedPairs Aligned;
+  detail::alignRange(Base, Revision, 0, static_cast<uint32_t>(Base.size()), 0,
+                     static_cast<uint32_t>(Revision.size()), Aligned);
+  return Aligned;
+}
+
+void TextualMatcher::match(
+    TwoWayMatching &Matching,
+    std::vector<SemanticNode *> &BaseNodes,
+    std::vector<SemanticNode *> &RevisionNodes) {
+  const size_t NumBase = BaseNodes.size();
+  const size_t NumRevision = RevisionNodes.size();
+  const std::vector<Entry> BaseEntries = entriesOf(BaseNodes);
+  const std::vector<Entry> RevisionEntries = entriesOf(RevisionNodes);
+
+  // nodes of each TU, in source order
+  std::map<std::string_view,
+           std::pair<std::vector<uint32_t>, std::vector<uint32_t>>>
+      Units;
+  for (uint32_t i = 0; i < BaseEntries.size(); ++i) {
+    Units[BaseEntries[i].Textual->TUPath].first.push_back(i);
+  }
+  for (uint32_t j = 0; j < RevisionEntries.size(); ++j) {
+    auto It = Units.find(RevisionEntries[j].Textual->TUPath);
+    if (It != Units.end()) {
+      It->second.second.push_back(j);
+    }
+  }
+  std::vector<const std::pair<std::vector<uint32_t>, std::vector<uint32_t>> *>
+      Paired;
+  for (const auto &[TUPath, Indices] : Units) {
+    if (!Indices.second.empty()) {
+      Paired.push_back(&Indices);
+    }
+  }
+
+  std::vector<detail::AlignedPairs> Exact(Paired.size());
+  std::vector<detail::AlignedPairs> Aligned(Paired.size());
+  tbb::parallel_for(size_t(0), Paired.size(), [&](size_t Unit) {
+    matchInUnit(BaseEntries, RevisionEntries, Paired[Unit]->first,
+                Paired[Unit]->second, Exact[Unit], Aligned[Unit]);
+  });
+
+  size_t NumExact = 0;
+  size_t NumAligned = 0;
+  std::unordered_set<size_t> BaseMatched;
+  std::unordered_set<size_t> RevisionMatched;
+  for (size_t Unit = 0; Unit < Paired.size(); ++Unit) {
+    NumExact += Exact[Unit].size();
+    NumAligned += Aligned[Unit].size();
+    for (const detail::AlignedPairs *Pairs : {&Exact[Unit], &Aligned[Unit]}) {
+      for (const auto &[i, j] : *Pairs) {
+        Matching.OneOneMatching.insert(
+            {BaseEntries[i].Node, RevisionEntries[j].Node});
+        BaseMatched.insert(BaseEntries[i].Node->hashSignature());
+        RevisionMatched.insert(RevisionEntries[j].Node->hashSignature());
+      }
+    }
+  }
+  detail::eraseMatched(BaseNodes, BaseMatched);
+  detail::eraseMatched(RevisionNodes, RevisionMatched);
+  spdlog::info("{} base and {} revision textual nodes: {} matched exactly, {} "
+               "aligned, {} and {} left for similarity",
+               NumBase, NumRevision, NumExact, NumAligned, BaseNodes.size(),
+               RevisionNodes.size());
+
+  if (!BaseNodes.empty() && !RevisionNodes.empty()) {
+    matchSimilar(Matching, BaseNodes, RevisionNodes);
+  }
+}
+
+std::vector<TextualMatcher::Entry> TextualMatcher::entriesOf(
+    const std::vector<SemanticNode *> &Nodes) {
+  std::vector<Entry> Entries(Nodes.size());
+  tbb::parallel_for(size_t(0), Nodes.size(), [&](size_t i) {
+    assert(llvm::isa<TextualNode>(Nodes[i]));
+    const auto *Textual = llvm::cast<TextualNode>(Nodes[i]);
+    const std::string Normalized = detail::normalize(Textual->Body);
+    Entries[i] = {Nodes[i], Textual, std::hash<std::string>()(Normalized),
+                  std::hash<std::string_view>()(
+                      detail::leadingTokens(Normalized))};
+  });
+  return Entries;
+}
+
+void TextualMatcher::matchInUnit(
+    const std::vector<Entry> &BaseEntries,
+    const std::vector<Entry> &RevisionEntries, std::vector<uint32_t> BaseIdx,
+    std::vector<uint32_t> RevisionIdx,
+    std::vector<std::pair<uint32_t, uint32_t>> &Exact,
+    std::vector<std::pair<uint32_t, uint32_t>> &Aligned) {
+  auto inSourceOrder = [](const std::vector<Entry> &Entries) {
+    return [&Entries](uint32_t L, uint32_t R) {
+      const SemanticNode &LNode = *Entries[L].Node;
+      const SemanticNode &RNode = *Entries[R].Node;
+      if (LNode.StartPoint && RNode.StartPoint) {
+        if (LNode.StartPoint->row != RNode.StartPoint->row) {
+          return LNode.StartPoint->row < RNode.StartPoint->row;
+        }
+        if (LNode.StartPoint->column != RNode.StartPoint->column) {
+          return LNode.StartPoint->column < RNode.StartPoint->column;
+        }
+      }
+      return LNode.ID < RNode.ID;
+    };
+  };
+  std::sort(BaseIdx.begin(), BaseIdx.end(), inSourceOrder(BaseEntries));
+  std::sort(RevisionIdx.begin(), RevisionIdx.end(),
+            inSourceOrder(RevisionEntries));
+
+  // equal normalized text, the n-th occurrence in base to the n-th one in
+  // revision
+  std::unordered_map<uint64_t, std::vector<uint32_t>> ByText;
+  for (auto It = RevisionIdx.rbegin(); It != RevisionIdx.rend(); ++It) {
+    ByText[RevisionEntries[*It].ExactKey].push_back(*It);
+  }
+  std::vector<uint32_t> BaseLeft;
+  std::unordered_set<uint32_t> RevisionTaken;
+  for (uint32_t i : BaseIdx) {
+    auto It = ByText.find(BaseEntries[i].ExactKey);
+    if (It == ByText.end() || It->second.empty()) {
+      BaseLeft.push_back(i);
+      continue;
+    }
+    Exact.emplace_back(i, It->second.back());
+    RevisionTaken.insert(It->second.back());
+    It->second.pop_back();
+  }
+  std::vector<uint32_t> RevisionLeft;
+  for (uint32_t j : RevisionIdx) {
+    if (!RevisionTaken.count(j)) {
+      RevisionLeft.push_back(j);
+    }
+  }
+  if (BaseLeft.empty() || RevisionLeft.empty()) {
+    return;
+  }
+
+  // the rest, aligned by leading tokens in source order
+  std::vector<uint64_t> BaseKeys, RevisionKeys;
+  BaseKeys.reserve(BaseLeft.size());
+  RevisionKeys.reserve(RevisionLeft.size());
+  for (uint32_t i : BaseLeft) {
+    BaseKeys.push_back(BaseEntries[i].AlignKey);
+  }
+  for (uint32_t j : RevisionLeft) {
+    RevisionKeys.push_back(RevisionEntries[j].AlignKey);
+  }
+  for (const auto &[Bi, Rj] : alignSequences(BaseKeys, RevisionKeys)) {
+    const TextualNode *Base = BaseEntries[BaseLeft[Bi]].Textual;
+    const TextualNode *Revision = RevisionEntries[RevisionLeft[Rj]].Textual;
+    if (util::sketch_cosine(Base->bodySketch(), Revision->bodySketch()) >=
+        MIN_SIMI) {
+      Aligned.emplace_back(BaseLeft[Bi], RevisionLeft[Rj]);
+    }
+  }
+}
+
+void TextualMatcher::matchSimilar(
+    TwoWayMatching &Matching,
+    std::vector<SemanticNode *> &BaseNodes,
+    std::vector<SemanticNode *> &RevisionNodes) {
+  std::vector<const SemanticNode *> Left;
+  Left.reserve(BaseNodes.size() + RevisionNodes.size());
+  for (const auto *Nodes : {&BaseNodes, &RevisionNodes}) {
+    for (SemanticNode *Node : *Nodes) {
+      Left.push_back(Node);
+    }
+  }
+  std::vector<std::vector<std::string>> Names(Left.size());
+  tbb::parallel_for(size_t(0), Left.size(), [&](size_t i) {
+    Names[i] = Left[i]->getNearestNeighborNames();
+  });
+  for (size_t i = 0; i < Left.size(); ++i) {
+    Neighbors[Left[i]] = std::move(Names[i]);
+  }
+
+  auto Matcher = makeBipartiteMatcher<TextualNode>(
+      [this](const TextualNode *Base, const TextualNode *Revision) {
+        return calcSimilarity(Base, Revision);
+      },
+      HIGH_SIMI);
+  Matcher.block({{[](const TextualNode &Node) -> const util::KGramSketch & {
+                   return Node.bodySketch();
+                 }},
+                 [](const TextualNode &Node, bool) {
+                   return std::hash<std::string>()(Node.TUPath);
+                 }});
+  Matcher.match(Matching, BaseNodes, RevisionNodes,
+                [](const TextualNode *Base, const TextualNode *Revision) {
+                  return Base->TUPath == Revision->TUPath;
+                });
+}
+
+bool TextualMatcher::available(
+    const std::vector<std::string> &BaseRefs,
+    const std::vector<std::string> &RevisionRefs) const {
+  if (BaseRefs.empty() || RevisionRefs.empty()) {
+    return false;
+  }
+  bool BaseAllEmpty =
+      std::all_of(BaseRefs.begin(), BaseRefs.end(),
+                  [&](const auto &item) { return item.empty(); });
+  bool RevisionAllEmpty =
+      std::all_of(RevisionRefs.begin(), RevisionRefs.end(),
+                  [&](const auto &item) { return item.empty(); });
+  return !(BaseAllEmpty || RevisionAllEmpty);
+}
+
+double TextualMatcher::calcSimilarity(const TextualNode *BaseNode,
+                                      const TextualNode *RevisionNode) const {
+  double BodySim =
+      util::sketch_cosine(BaseNode->bodySketch(), RevisionNode->bodySketch());
+
+  // copies, as dice sorts them and pairs are scored concurrently
+  std::vector<std::string> BaseNeighbors = Neighbors.at(BaseNode);
+  std::vector<std::string> RevisionNeighbors = Neighbors.at(RevisionNode);
+  if (available(BaseNeighbors, RevisionNeighbors)) {
+    double NeighborSim = util::dice(BaseNeighbors, RevisionNeighbors);
+    return (BodySim + NeighborSim) / 2;
+  }
+
+  return BodySim;
+}
+} // namespace mergebot::sa
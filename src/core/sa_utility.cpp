@@ -264,6 +264,16 @@ std::string removeComment(const std::string &line) {
   }
   return result;
 }
+
+/// resolutions of a file in block order, whichever handlers published them
+/// first, so that the file doesn't depend on the order handlers run in
+void sortResolutions(std::vector<server::BlockResolutionResult> &Resolutions) {
+  std::stable_sort(Resolutions.begin(), Resolutions.end(),
+                   [](server::BlockResolutionResult const &BR1,
+                      server::BlockResolutionResult const &BR2) {
+                     return BR1.index < BR2.index;
+                   });
+}
 } // namespace _details
 
 void handleSAExecError(std::error_code err, std::string_view cmd) {
@@ -343,6 +353,7 @@ void marshalResolutionResult(
        !nlohmann::json::accept(ResolutionFS))) {
     server::FileResolutionResult FR{.filepath = std::string(FileName),
                                     .resolutions = Results};
+    _details::sortResolutions(FR.resolutions);
     nlohmann::json JsonToDump = FR;
     bool Success = util::file_overwrite_content_sync(ResolutionFilePath,
                                                      JsonToDump.dump(2));
@@ -372,6 +383,7 @@ void marshalResolutionResult(
 #endif
     Resolutions.reserve(Resolutions.size() + Results.size());
     std::copy(Results.begin(), Results.end(), std::back_inserter(Resolutions));
+    _details::sortResolutions(Resolutions);
     nlohmann::json JsonToDump = FileResolved;
     bool Success = util::file_overwrite_content_sync(ResolutionFilePath,
                                                      JsonToDump.dump(2));
@@ -3,6 +3,7 @@
 //
 
 #include "mergebot/core/semantic/GraphBuilder.h"
+#include "mergebot/core/SparseCheckout.h"
 
 #include "mergebot/core/model/enum/Side.h" // for enum_name instantiation
 #include "mergebot/core/model/node/AccessSpecifierNode.h"
@@ -17,16 +18,24 @@
 #include "mergebot/core/model/node/TextualNode.h"
 #include "mergebot/core/model/node/TranslationUnitNode.h"
 #include "mergebot/core/model/node/TypeDeclNode.h"
+#include "mergebot/core/semantic/RemappedCompDB.h"
 #include "mergebot/filesystem.h"
 #include "mergebot/lsp/client.h"
+#include "mergebot/parser/parse_cache.h"
 #include "mergebot/parser/parser.h"
 #include "mergebot/parser/point.h" // for template instantiation for ts::Point
 #include "mergebot/parser/utils.h"
 #include "mergebot/utils/fileio.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <llvm/Support/xxhash.h>
 #include <magic_enum.hpp>
 #include <nlohmann/json.hpp> // for std::vector deserialization
+#include <oneapi/tbb/parallel_for.h>
 #include <spdlog/spdlog.h>
 #include <string_view>
+#include <thread>
 
 namespace mergebot {
 namespace details {
@@ -97,6 +106,51 @@ bool IsCSource(std::string_view Path) {
   std::string_view ext = Path.substr(pos);
   return c_exts.count(ext);
 }
+
+/// symbol queries kept in flight to clangd, 0 to query one at a time
+size_t lspInFlightWindow() {
+  const char *Env = std::getenv("MERGEBOT_LSP_INFLIGHT");
+  if (!Env || !*Env) {
+    return 64;
+  }
+  return std::strtoull(Env, nullptr, 10);
+}
+
+/// builders, each with its own clangd, processing translation units of a
+/// side in parallel
+size_t graphWorkers() {
+  const char *Env = std::getenv("MERGEBOT_GRAPH_WORKERS");
+  if (Env && *Env) {
+    return std::max<size_t>(std::strtoull(Env, nullptr, 10), 1);
+  }
+  // the sides are built in parallel, and each clangd takes its own share of
+  // memory
+  return std::clamp<size_t>(std::thread::hardware_concurrency() / 3, 1, 4);
+}
+
+std::optional<lsp::SymbolDetails>
+toSymbolDetails(const std::optional<nlohmann::json> &Returned) {
+  if (!Returned.has_value() || !Returned->is_array() || Returned->empty()) {
+    return std::nullopt;
+  }
+  std::vector<lsp::SymbolDetails> Details = Returned.value();
+  return Details[0];
+}
+
+std::vector<std::string>
+toReferences(const std::optional<nlohmann::json> &Returned) {
+  if (!Returned.has_value() || !Returned->is_array()) {
+    return {};
+  }
+  std::vector<lsp::ReferenceLocation> Locations = Returned.value();
+  std::vector<std::string> References;
+  for (auto &Location : Locations) {
+    if (Location.containerName.has_value()) {
+      References.push_back(std::move(Location.containerName.value()));
+    }
+  }
+  return References;
+}
 } // namespace details
 namespace sa {
 std::unordered_set<std::string> GraphBuilder::CompositeTypes = {
@@ -151,8 +205,8 @@ bool GraphBuilder::build() {
   //    std::for_each(
   //        this->SourceList.begin(), this->SourceList.end(), [&](auto &P) {
   //          std::string MainFile = (fs::path(SourceDir) / P).string();
-  //          Client.DidOpen(MainFile, util::file_get_content(MainFile));
-  //          auto URIOpt = Client.SwitchSourceHeader(MainFile);
+  //          Client->DidOpen(MainFile, util::file_get_content(MainFile));
+  //          auto URIOpt = Client->SwitchSourceHeader(MainFile);
   //          if (URIOpt.has_value() && URIOpt.value() != nullptr) {
   //            std::string AltFileScheme = URIOpt.value();
   //            lsp::URIForFile AltUri = lsp::URIForFile(AltFileScheme);
@@ -160,7 +214,7 @@ bool GraphBuilder::build() {
   //            HeaderSourceMapping.push_back(fs::relative(AltFilePath,
   //            SourceDir));
   //          }
-  //          Client.DidClose(MainFile);
+  //          Client->DidClose(MainFile);
   //        });
   //    SourceList.insert(SourceList.end(), HeaderSourceMapping.begin(),
   //                      HeaderSourceMapping.end());
@@ -168,8 +222,24 @@ bool GraphBuilder::build() {
   //                     SourceList.end());
   //  }
 
-  for (std::string const &Path : SourceList) {
-    processTranslationUnit(Path);
+  if (SymbolIndex::enabled()) {
+    buildSymbolIndex();
+  }
+
+  const size_t Workers = std::min(details::graphWorkers(), SourceList.size());
+  if (Workers > 1) {
+    processTranslationUnits(Workers);
+  } else {
+    for (std::string const &Path : SourceList) {
+      processTranslationUnit(Path);
+    }
+  }
+
+  // nodes are final, so are their signatures, which are looked up all along
+  // matching and merging, and the sketches the matchers compare
+  StringPool *Pool = Arena ? &Arena->strings() : nullptr;
+  for (auto VDesc : boost::make_iterator_range(boost::vertices(G))) {
+    G[VDesc]->seal(Pool);
   }
 
   // lazy generation
@@ -188,6 +258,9 @@ void GraphBuilder::processTranslationUnit(const std::string &Path) {
 
   bool IsConflicting = isConflicting(Path);
   std::string FilePath = (fs::path(SourceDir) / Path).string();
+  // side trees may be sparse, bring the TU and its counterpart to disk
+  Meta.materialize(S, {Path});
+  syncWorkspace();
   if (!fs::exists(FilePath)) {
     spdlog::warn("Side: [{}], translation unit {} doesn't exist",
                  magic_enum::enum_name(S), FilePath);
@@ -203,6 +276,101 @@ void GraphBuilder::processTranslationUnit(const std::string &Path) {
   }
 }
 
+void GraphBuilder::processTranslationUnits(size_t Workers) {
+  // no more builders than translation units, each of them leases a clangd
+  Workers = std::max<size_t>(std::min(Workers, SourceList.size()), 1);
+  std::vector<TranslationUnitGraph> Units(SourceList.size());
+  std::atomic<size_t> Next{0};
+  auto Drain = [&](GraphBuilder &Builder) {
+    for (size_t I = Next++; I < SourceList.size(); I = Next++) {
+      Builder.processTranslationUnit(SourceList[I]);
+      Units[I].G = std::move(Builder.G);
+      Units[I].NodeCount = Builder.NodeCount;
+      Units[I].EdgeCount = Builder.EdgeCount;
+      Builder.G = SemanticGraph();
+      Builder.NodeCount = 0;
+      Builder.EdgeCount = 0;
+    }
+  };
+
+  // this builder drains into a fresh graph like the others, what it has
+  // built so far keeps its ids
+  SemanticGraph Base = std::move(G);
+  G = SemanticGraph();
+  const int BaseNodeCount = NodeCount;
+  const int BaseEdgeCount = EdgeCount;
+  NodeCount = 0;
+  EdgeCount = 0;
+  // this builder starts at once, the others join as soon as their clangd is
+  // up, and are dropped if it cannot be started. Starting clangd costs more
+  // than most translation units, so none is started once the queue is empty
+  std::atomic<size_t> Spawned{0};
+  tbb::parallel_for(size_t(0), Workers, [&](size_t W) {
+    if (W == 0) {
+      Drain(*this);
+      return;
+    }
+    if (Next.load() >= SourceList.size()) {
+      return;
+    }
+    if (std::unique_ptr<GraphBuilder> Worker = spawnWorker()) {
+      ++Spawned;
+      Drain(*Worker);
+    }
+  });
+
+  G = std::move(Base);
+  NodeCount = BaseNodeCount;
+  EdgeCount = BaseEdgeCount;
+  for (TranslationUnitGraph &Unit : Units) {
+    mergeTranslationUnit(G, NodeCount, EdgeCount, Unit);
+  }
+  spdlog::debug("Side: [{}], {} translation units processed by {} workers",
+                magic_enum::enum_name(S), Units.size(), Spawned + 1);
+}
+
+std::unique_ptr<GraphBuilder> GraphBuilder::spawnWorker() const {
+  auto Worker = std::make_unique<GraphBuilder>(
+      S, Meta,
+      std::vector<std::string>(ConflictPaths.begin(), ConflictPaths.end()),
+      SourceList, DirectIncluded, Compilations, Symbols, Arena);
+  Worker->IsWorker = true;
+  Worker->Index = Index;
+  Worker->Workspace = Workspace;
+  if (!Worker->initLanguageServer()) {
+    spdlog::warn("Side: [{}], cannot start clangd for a worker",
+                 magic_enum::enum_name(S));
+    return nullptr;
+  }
+  return Worker;
+}
+
+void GraphBuilder::mergeTranslationUnit(SemanticGraph &Into, int &NodeCount,
+                                        int &EdgeCount,
+                                        TranslationUnitGraph &Unit) {
+  std::vector<vertex_descriptor> Merged(boost::num_vertices(Unit.G));
+  vertex_iterator VBegin, VEnd;
+  std::tie(VBegin, VEnd) = boost::vertices(Unit.G);
+  for (vertex_iterator It = VBegin; It != VEnd; ++It) {
+    SemanticNode *Node = Unit.G[*It];
+    Node->ID += NodeCount;
+    Merged[*It] = boost::add_vertex(Node, Into);
+  }
+  // out edges in the order they were added to each vertex, as if they were
+  // added to the graph directly
+  for (vertex_iterator It = VBegin; It != VEnd; ++It) {
+    auto [EBegin, EEnd] = boost::out_edges(*It, Unit.G);
+    for (auto E = EBegin; E != EEnd; ++E) {
+      SemanticEdge Edge = Unit.G[*E];
+      Edge.ID += EdgeCount;
+      boost::add_edge(Merged[*It], Merged[boost::target(*E, Unit.G)], Edge,
+                      Into);
+    }
+  }
+  NodeCount += Unit.NodeCount;
+  EdgeCount += Unit.EdgeCount;
+}
+
 void GraphBuilder::processCppTranslationUnit(const std::string &Path,
                                              const std::string &FilePath,
                                              bool IsConflicting) {
@@ -211,20 +379,33 @@ void GraphBuilder::processCppTranslationUnit(const std::string &Path,
   /// TODO(hwa): add macro replace here
   /// replace macro to magic string /*MB_MR_BG*/ MACRO /*MB_MR_ED*/
 
-  Client.DidOpen(FilePath, FileSource);
-  auto URIOpt = Client.SwitchSourceHeader(FilePath);
+  const std::string WorkspacePath = toWorkspace(FilePath);
+  Client->DidOpen(WorkspacePath, FileSource);
+  auto URIOpt = Client->SwitchSourceHeader(WorkspacePath);
   lsp::URIForFile AltUri;
+  std::string AltFileContent;
   bool HasAltFile = URIOpt.has_value() && URIOpt.value() != nullptr;
   if (HasAltFile) {
     std::string AltFileScheme = URIOpt.value();
     AltUri = lsp::URIForFile(AltFileScheme);
     std::string AltFilePath = AltUri.path();
-    std::string AltFileContent = util::file_get_content(AltFilePath);
-    Client.DidOpen(AltUri, AltFileContent);
+    AltFileContent = util::file_get_content(AltFilePath);
+    Client->DidOpen(AltUri, AltFileContent);
   }
 
-  ts::Parser PS(ts::cpp::language());
-  std::shared_ptr<ts::Tree> Tree = PS.parse(FileSource);
+  CacheScope = SymbolCacheScope();
+  if (Symbols) {
+    CacheScope.FilePath = FilePath;
+    CacheScope.ContentHash = llvm::xxHash64(FileSource);
+    CacheScope.ContextHash =
+        includeContextHash(Path, FilePath, AltFileContent);
+  }
+
+  // files unchanged across sides are parsed once per scenario
+  std::shared_ptr<ts::Tree> Tree =
+      Meta.Parses
+          ? Meta.Parses->parse(FileSource)
+          : ts::Parser::forThread(ts::cpp::language()).parse(FileSource);
   if (!Tree) {
     spdlog::error("Side: [{}], translation unit {} cannot be parsed",
                   magic_enum::enum_name(S), FilePath);
@@ -234,41 +415,233 @@ void GraphBuilder::processCppTranslationUnit(const std::string &Path,
   assert(TSRoot.type() ==
          mergebot::ts::cpp::symbols::sym_translation_unit.name);
 
+  if (details::lspInFlightWindow()) {
+    prefetchSymbols(Path, FilePath, IsConflicting, TSRoot);
+  }
+
   size_t FrontDeclCnt = 0;
   ts::Node TURoot = TSRoot;
   // 如果是头文件，并且使用的是传统的header
   // guard，那么TSRoot是一个preproc_ifdef，
   // 并且FrontDeclCnt同时也要进行更新；如果是头文件或实现文件，有#pragma header
   // guard 或无header guard，那么TSRoot是translation_unit; FrontDeclCnt不用更新
-  std::shared_ptr<SemanticNode> TUPtr = parseTranslationUnit(
+  SemanticNode *TUPtr = parseTranslationUnit(
       TSRoot, IsConflicting, Path, FilePath, FrontDeclCnt, TURoot);
   vertex_descriptor TUVertex = addVertex(TUPtr);
   parseCompositeNode(TUPtr, TUVertex, IsConflicting, TURoot, FilePath,
                      FrontDeclCnt);
 
-  Client.DidClose(FilePath);
+  Prefetch = SymbolPrefetch();
+  CacheScope = SymbolCacheScope();
+  Client->DidClose(WorkspacePath);
   if (HasAltFile) {
-    Client.DidClose(AltUri);
+    Client->DidClose(AltUri);
   }
 }
 
-void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
+void GraphBuilder::prefetchSymbols(const std::string &Path,
+                                   const std::string &FilePath,
+                                   bool IsConflicting, const ts::Node &TSRoot) {
+  const int SavedNodeCount = NodeCount;
+  const int SavedEdgeCount = EdgeCount;
+  Prefetch = SymbolPrefetch();
+  Prefetch.Recording = true;
+  Prefetch.Scratch = std::make_unique<NodeArena>();
+  size_t FrontDeclCnt = 0;
+  ts::Node TURoot = TSRoot;
+  SemanticNode *TUPtr = parseTranslationUnit(
+      TSRoot, IsConflicting, Path, FilePath, FrontDeclCnt, TURoot);
+  parseCompositeNode(TUPtr, vertex_descriptor(), IsConflicting, TURoot,
+                     FilePath, FrontDeclCnt);
+  Prefetch.Recording = false;
+  Prefetch.Scratch.reset();
+  NodeCount = SavedNodeCount;
+  EdgeCount = SavedEdgeCount;
+
+  const size_t Window = details::lspInFlightWindow();
+  auto KeyOf = [](const SymbolPrefetch::Query &Q) {
+    return SymbolPrefetch::QueryKey(Q.first, Q.second.line,
+                                    Q.second.character);
+  };
+
+  // symbol queries answered, or being answered, by the other sides are not
+  // sent, references are always asked to our clangd. Claimed ones are
+  // fulfilled before waiting for the others, so that sides waiting for each
+  // other never deadlock. Claims are held until then, if a batch throws they
+  // fulfill as failures on unwinding
+  struct Shared {
+    SymbolPrefetch::Query Q;
+    std::shared_future<SymbolCache::Result> Future;
+  };
+  auto Partition = [&](std::vector<SymbolPrefetch::Query> &Queries,
+                       SymbolCache::Method M, std::vector<Shared> &Waiting,
+                       std::vector<SymbolCache::Claim> &Claims) {
+    if (!Symbols) {
+      return;
+    }
+    std::vector<SymbolPrefetch::Query> Claimed;
+    for (SymbolPrefetch::Query &Q : Queries) {
+      std::optional<SymbolCache::Key> Key = cacheKeyOf(Q.first, Q.second, M);
+      if (!Key) {
+        Claimed.push_back(std::move(Q));
+        Claims.emplace_back();
+        continue;
+      }
+      bool IsClaimed = false;
+      std::shared_future<SymbolCache::Result> Future =
+          Symbols->acquire(*Key, IsClaimed);
+      if (IsClaimed) {
+        Claimed.push_back(std::move(Q));
+        Claims.emplace_back(*Symbols, *Key);
+      } else {
+        Waiting.push_back({std::move(Q), std::move(Future)});
+      }
+    }
+    Queries = std::move(Claimed);
+  };
+  auto Fulfill = [&](std::vector<SymbolCache::Claim> &Claims,
+                     std::vector<std::optional<nlohmann::json>> &Results) {
+    for (size_t I = 0; I < Claims.size(); ++I) {
+      Claims[I].fulfill(I < Results.size() ? Results[I] : std::nullopt);
+    }
+  };
+  std::vector<Shared> SharedInfos;
+  std::vector<SymbolCache::Claim> InfoClaims;
+  Partition(Prefetch.InfoQueries, SymbolCache::Method::SymbolInfo, SharedInfos,
+            InfoClaims);
+
+  auto InWorkspace = [&](const std::vector<SymbolPrefetch::Query> &Queries) {
+    std::vector<SymbolPrefetch::Query> Mapped;
+    Mapped.reserve(Queries.size());
+    for (const SymbolPrefetch::Query &Q : Queries) {
+      Mapped.emplace_back(lsp::URIForFile(toWorkspace(Q.first.file)),
+                          Q.second);
+    }
+    return Mapped;
+  };
+  std::vector<std::optional<nlohmann::json>> Infos =
+      Client->SymbolInfoBatch(InWorkspace(Prefetch.InfoQueries), Window);
+  Fulfill(InfoClaims, Infos);
+  std::vector<std::optional<nlohmann::json>> Refs =
+      Client->ReferencesBatch(InWorkspace(Prefetch.RefQueries), Window);
+  for (size_t I = 0; I < Infos.size(); ++I) {
+    Prefetch.Infos[KeyOf(Prefetch.InfoQueries[I])] =
+        details::toSymbolDetails(Infos[I]);
+  }
+  for (size_t I = 0; I < Refs.size(); ++I) {
+    Prefetch.Refs[KeyOf(Prefetch.RefQueries[I])] =
+        details::toReferences(Refs[I]);
+  }
+
+  // shared queries failed on the other side are left to the real parse
+  for (const Shared &Info : SharedInfos) {
+    if (const SymbolCache::Result &Returned = Info.Future.get()) {
+      Prefetch.Infos[KeyOf(Info.Q)] = details::toSymbolDetails(Returned);
+    }
+  }
+  spdlog::debug("Side: [{}], {} symbol and {} reference queries prefetched "
+                "for {}, {} symbol queries shared with other sides",
+                magic_enum::enum_name(S), Infos.size(), Refs.size(), FilePath,
+                SharedInfos.size());
+}
+
+uint64_t GraphBuilder::includeContextHash(
+    const std::string &Path, const std::string &FilePath,
+    const std::string &AltFileContent) const {
+  // side dirs differ in paths only, hash commands as if they were the same
+  const char *const SidePlaceholder = "${MB_SIDE_DIR}";
+  std::string Context;
+  if (Compilations) {
+    for (const clang::tooling::CompileCommand &Command :
+         Compilations->getCompileCommands(FilePath)) {
+      for (const std::string &Arg : Command.CommandLine) {
+        Context += RemappedCompDB::remap(Arg, SourceDir, SidePlaceholder);
+        Context.push_back('\0');
+      }
+    }
+  }
+  if (auto It = DirectIncluded.find(Path); It != DirectIncluded.end()) {
+    for (const std::string &Included : It->second) {
+      const std::string IncludedPath =
+          (fs::path(SourceDir) / Included).string();
+      Context += Included;
+      Context.push_back('\0');
+      if (fs::exists(IncludedPath)) {
+        Context += std::to_string(
+            llvm::xxHash64(util::file_get_content(IncludedPath)));
+      }
+      Context.push_back('\0');
+    }
+  }
+  // symbols are resolved from the open files, the counterpart included
+  Context += std::to_string(llvm::xxHash64(AltFileContent));
+  return llvm::xxHash64(Context);
+}
+
+std::optional<SymbolCache::Key>
+GraphBuilder::cacheKeyOf(const lsp::URIForFile &URI, const lsp::Position Pos,
+                         SymbolCache::Method M) const {
+  if (!Symbols || !SymbolCache::shareable(M) || CacheScope.FilePath.empty() ||
+      URI.file != CacheScope.FilePath) {
+    return std::nullopt;
+  }
+  return SymbolCache::Key{CacheScope.ContentHash, CacheScope.ContextHash,
+                          static_cast<uint32_t>(Pos.line),
+                          static_cast<uint32_t>(Pos.character), M};
+}
+
+template <typename AskFn>
+std::optional<nlohmann::json>
+GraphBuilder::querySymbolCache(const lsp::URIForFile &URI,
+                               const lsp::Position Pos, SymbolCache::Method M,
+                               AskFn &&Ask) {
+  std::optional<SymbolCache::Key> Key = cacheKeyOf(URI, Pos, M);
+  if (!Key) {
+    return Ask();
+  }
+  bool Claimed = false;
+  std::shared_future<SymbolCache::Result> Future =
+      Symbols->acquire(*Key, Claimed);
+  if (!Claimed) {
+    if (SymbolCache::Result Returned = Future.get()) {
+      return Returned;
+    }
+    // failed on the other side, try our own clangd
+    return Ask();
+  }
+  // fulfilled as a failure if Ask throws
+  SymbolCache::Claim Claim(*Symbols, *Key);
+  std::optional<nlohmann::json> Returned = Ask();
+  Claim.fulfill(Returned);
+  return Returned;
+}
+
+void GraphBuilder::parseCompositeNode(SemanticNode *SRoot,
                                       const vertex_descriptor &SRootVDesc,
                                       bool IsConflicting, const ts::Node &Root,
                                       const std::string &FilePath,
                                       const int FirstChildIdx /* = 0 */) {
   namespace symbols = ts::cpp::symbols;
   namespace fields = ts::cpp::fields;
-  for (size_t Idx = FirstChildIdx; Idx < Root.childrenCount();) {
-    const ts::Node &Child = Root.children[Idx];
+  // children are parsed before SRoot is sealed, hash it once
+  const size_t SRootHash = SRoot->hashSignature();
+  const size_t ChildrenCount = Root.childrenCount();
+  // children are visited in order with some skipped, step a cursor forward
+  // instead of indexing each, which walks the siblings before it
+  ts::ChildIterator Cursor = Root.ref().children().begin();
+  for (size_t Idx = FirstChildIdx; Idx < ChildrenCount;) {
+    if (!Cursor.advanceTo(Idx)) {
+      break;
+    }
+    const ts::Node Child = (*Cursor).node();
     const std::string ChildType = Child.type();
     if (CompositeTypes.count(ChildType)) { // plain Composite
-      std::shared_ptr<NamespaceNode> NamespacePtr =
+      NamespaceNode *NamespacePtr =
           parseNamespaceNode(Child, IsConflicting, FilePath);
       if (NamespacePtr->NSComment.size()) {
         Idx++; // skip the following namespace comment
       }
-      std::shared_ptr<SemanticNode> SemanticPtr = NamespacePtr;
+      SemanticNode *SemanticPtr = NamespacePtr;
       auto [CurDesc, _] =
           insertToGraphAndParent(SRoot, SRootVDesc, NamespacePtr);
       assert(Child.getChildByFieldName(fields::field_body.name).has_value() &&
@@ -278,8 +651,8 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
           Child.getChildByFieldName(fields::field_body.name).value(), FilePath);
     } else if (TerminalTypes.count(ChildType)) { // plain terminal
       if (details::IsTextualNode(ChildType)) {
-        std::shared_ptr<SemanticNode> TextualPtr = parseTextualNode(
-            Child, IsConflicting, SRoot->hashSignature(), FilePath);
+        SemanticNode *TextualPtr = parseTextualNode(
+            Child, IsConflicting, SRootHash, FilePath);
         insertToGraphAndParent(SRoot, SRootVDesc, TextualPtr);
       } else if (ChildType == symbols::sym_comment.name) {
         size_t CommentCnt = 0;
@@ -289,33 +662,32 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
         if (Orphan) {
           int FollowingEOLs = !RealOrphan ? 0 : 1;
           // FollowingEOL to 1: fix for inline comment
-          std::shared_ptr<SemanticNode> OrphanCommentPtr =
-              std::make_shared<OrphanCommentNode>(
-                  NodeCount++, IsConflicting, NodeKind::ORPHAN_COMMENT, Comment,
-                  Comment, Comment, "", Child.startPoint(), "",
-                  std::string(Comment), SRoot->hashSignature(), FollowingEOLs);
+          SemanticNode *OrphanCommentPtr = makeNode<OrphanCommentNode>(
+              NodeCount++, IsConflicting, NodeKind::ORPHAN_COMMENT, Comment,
+              Comment, Comment, "", Child.startPoint(), "",
+              std::string(Comment), SRootHash, FollowingEOLs);
           insertToGraphAndParent(SRoot, SRootVDesc, OrphanCommentPtr);
           Idx +=
               CommentCnt - 1; // -1 as the loop end will auto increment Idx by 1
         }
       } else if (ChildType == symbols::sym_field_declaration.name ||
                  ChildType == symbols::sym_declaration.name) {
-        std::shared_ptr<SemanticNode> FieldDeclPtr = parseFieldDeclarationNode(
-            Child, IsConflicting, SRoot->hashSignature(), FilePath,
+        SemanticNode *FieldDeclPtr = parseFieldDeclarationNode(
+            Child, IsConflicting, SRootHash, FilePath,
             ChildType == symbols::sym_field_declaration.name);
         insertToGraphAndParent(SRoot, SRootVDesc, FieldDeclPtr);
       } else if (ChildType == symbols::sym_function_definition.name) {
         const std::optional<ts::Node> TypeOpt =
             Child.getChildByFieldName(fields::field_type.name);
         if (TypeOpt.has_value()) { // with return value
-          if (TypeOpt.value().text() == "namespace") {
+          if (TypeOpt.value().textView() == "namespace") {
             // tree-sitter will parse inline namespace as function definition
-            std::shared_ptr<NamespaceNode> NamespacePtr =
+            NamespaceNode *NamespacePtr =
                 parseNamespaceNode(Child, IsConflicting, FilePath);
             if (NamespacePtr->NSComment.size()) {
               Idx++; // skip the following namespace comment
             }
-            std::shared_ptr<SemanticNode> SemanticPtr = NamespacePtr;
+            SemanticNode *SemanticPtr = NamespacePtr;
             auto [NSDesc, _] =
                 insertToGraphAndParent(SRoot, SRootVDesc, NamespacePtr);
             assert(Child.getChildByFieldName(fields::field_body.name)
@@ -327,8 +699,8 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
                 FilePath);
           } else {
             // plain function definition
-            std::shared_ptr<SemanticNode> FncDefNodePtr = parseFuncDefNode(
-                Child, Child, IsConflicting, SRoot->hashSignature(), FilePath);
+            SemanticNode *FncDefNodePtr = parseFuncDefNode(
+                Child, Child, IsConflicting, SRootHash, FilePath);
             insertToGraphAndParent(SRoot, SRootVDesc, FncDefNodePtr);
           }
         } else { // without return value
@@ -337,14 +709,12 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
           if (declaratorOpt.has_value() &&
               declaratorOpt.value().type() ==
                   symbols::sym_operator_cast.name) { // operator cast function
-            std::shared_ptr<SemanticNode> FuncOperatorCastNodePtr =
-                parseFuncOperatorCastNode(Child, IsConflicting,
-                                          SRoot->hashSignature(), FilePath);
+            SemanticNode *FuncOperatorCastNodePtr = parseFuncOperatorCastNode(
+                Child, IsConflicting, SRootHash, FilePath);
             insertToGraphAndParent(SRoot, SRootVDesc, FuncOperatorCastNodePtr);
           } else { // special function member
-            std::shared_ptr<SemanticNode> FuncSpecialMemberNodePtr =
-                parseFuncSpecialMemberNode(Child, IsConflicting,
-                                           SRoot->hashSignature(), FilePath);
+            SemanticNode *FuncSpecialMemberNodePtr = parseFuncSpecialMemberNode(
+                Child, IsConflicting, SRootHash, FilePath);
             insertToGraphAndParent(SRoot, SRootVDesc, FuncSpecialMemberNodePtr);
           }
         }
@@ -380,20 +750,19 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
         }
         if (Kind == FUNCTION_TEMPLATE) {
           if (HasBody) {
-            std::shared_ptr<SemanticNode> FuncDefNodePtr =
-                parseFuncDefNode(Child, RealNode, IsConflicting,
-                                 SRoot->hashSignature(), FilePath);
+            SemanticNode *FuncDefNodePtr = parseFuncDefNode(
+                Child, RealNode, IsConflicting, SRootHash, FilePath);
             insertToGraphAndParent(SRoot, SRootVDesc, FuncDefNodePtr);
           } else {
-            std::shared_ptr<TextualNode> TextualPtr = parseTextualNode(
-                Child, IsConflicting, SRoot->hashSignature(), FilePath);
+            TextualNode *TextualPtr = parseTextualNode(
+                Child, IsConflicting, SRootHash, FilePath);
             insertToGraphAndParent(SRoot, SRootVDesc, TextualPtr);
           }
         } else if (Kind == CLASS_TEMPLATE) {
           if (HasBody) {
             auto [TypeDeclNodePtr, TypeKind] =
                 parseTypeDeclNode(Child, RealNode, IsConflicting, FilePath);
-            std::shared_ptr<SemanticNode> SemanticPtr = TypeDeclNodePtr;
+            SemanticNode *SemanticPtr = TypeDeclNodePtr;
             auto [TypeDeclDesc, _] =
                 insertToGraphAndParent(SRoot, SRootVDesc, SemanticPtr);
             assert(RealNode.getChildByFieldName(fields::field_body.name)
@@ -405,8 +774,8 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
                 FilePath);
             TypeDeclNodePtr->setMemberAccessSpecifier();
           } else {
-            std::shared_ptr<TextualNode> TextualPtr = parseTextualNode(
-                Child, IsConflicting, SRoot->hashSignature(), FilePath);
+            TextualNode *TextualPtr = parseTextualNode(
+                Child, IsConflicting, SRootHash, FilePath);
             insertToGraphAndParent(SRoot, SRootVDesc, TextualPtr);
           }
         } else {
@@ -417,13 +786,13 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
           assert(false);
         }
       } else if (ChildType == symbols::sym_access_specifier.name) {
-        SemanticNode *ParentRawPtr = SRoot.get();
+        SemanticNode *ParentRawPtr = SRoot;
         AccessSpecifierKind AccessKind =
-            details::getAccessSpecifierKind(Child.text());
+            details::getAccessSpecifierKind(Child.textView());
         // SRoot must be a class specifier type
         if (llvm::isa<TypeDeclNode>(ParentRawPtr)) {
           SRoot->Children.push_back(
-              std::make_shared<AccessSpecifierNode>(AccessKind));
+              makeNode<AccessSpecifierNode>(AccessKind));
         } else {
           spdlog::error("access specifier should only appear in type decl "
                         "node: file path is {}, location "
@@ -439,13 +808,13 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
         const std::optional<ts::Node> TypeBodyOpt = Child.getChildByFieldName(
             fields::field_body.name); // class, struct, union body
         if (!TypeBodyOpt.has_value()) {
-          std::shared_ptr<TextualNode> TextualPtr = parseTextualNode(
-              Child, IsConflicting, SRoot->hashSignature(), FilePath);
+          TextualNode *TextualPtr = parseTextualNode(
+              Child, IsConflicting, SRootHash, FilePath);
           insertToGraphAndParent(SRoot, SRootVDesc, TextualPtr);
         } else {
           auto [TypeDeclNodePtr, Kind] =
               parseTypeDeclNode(Child, Child, IsConflicting, FilePath);
-          std::shared_ptr<SemanticNode> SemanticPtr = TypeDeclNodePtr;
+          SemanticNode *SemanticPtr = TypeDeclNodePtr;
           auto [TypeDeclDesc, _] =
               insertToGraphAndParent(SRoot, SRootVDesc, SemanticPtr);
           assert(
@@ -465,12 +834,12 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
         const ts::Node &LinkageBody = LinkageBodyOpt.value();
         if (LinkageBody.type() == symbols::sym_declaration.name ||
             LinkageBody.type() == symbols::sym_function_definition.name) {
-          std::shared_ptr<SemanticNode> TextualPtr = parseTextualNode(
-              Child, IsConflicting, SRoot->hashSignature(), FilePath);
+          SemanticNode *TextualPtr = parseTextualNode(
+              Child, IsConflicting, SRootHash, FilePath);
           insertToGraphAndParent(SRoot, SRootVDesc, TextualPtr);
         } else {
-          std::shared_ptr<SemanticNode> LinkagePtr = parseLinkageSpecNode(
-              Child, IsConflicting, SRoot->hashSignature());
+          SemanticNode *LinkagePtr = parseLinkageSpecNode(
+              Child, IsConflicting, SRootHash);
           auto [LinkageDesc, _] =
               insertToGraphAndParent(SRoot, SRootVDesc, LinkagePtr);
           assert(
@@ -485,11 +854,11 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
         const std::optional<ts::Node> EnumBodyOpt =
             Child.getChildByFieldName(fields::field_body.name);
         if (!EnumBodyOpt.has_value()) { // empty enum specifier
-          std::shared_ptr<TextualNode> TextualPtr = parseTextualNode(
-              Child, IsConflicting, SRoot->hashSignature(), FilePath);
+          TextualNode *TextualPtr = parseTextualNode(
+              Child, IsConflicting, SRootHash, FilePath);
           insertToGraphAndParent(SRoot, SRootVDesc, TextualPtr);
         } else {
-          std::shared_ptr<SemanticNode> EnumNodePtr =
+          SemanticNode *EnumNodePtr =
               parseEnumNode(Child, IsConflicting, FilePath);
           auto [EnumDesc, _] =
               insertToGraphAndParent(SRoot, SRootVDesc, EnumNodePtr);
@@ -503,8 +872,8 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
         }
       }
     } else {
-      if (Child.type() != "{" && Child.type() != "}" && Child.type() != ";" &&
-          Child.type() != "#endif" && Child.type() != ",") {
+      if (ChildType != "{" && ChildType != "}" && ChildType != ";" &&
+          ChildType != "#endif" && ChildType != ",") {
         spdlog::error("unexpected node: file path is {}, location is: {}, node "
                       "type is {}, "
                       "isNamed is {}, text is {}",
@@ -516,7 +885,7 @@ void GraphBuilder::parseCompositeNode(std::shared_ptr<SemanticNode> &SRoot,
   }
 }
 
-std::shared_ptr<TranslationUnitNode> GraphBuilder::parseTranslationUnit(
+TranslationUnitNode *GraphBuilder::parseTranslationUnit(
     const ts::Node &Node, bool IsConflicting, const std::string &Path,
     const std::string &FilePath, size_t &FrontDeclCnt, ts::Node &TURoot) {
   auto CommentPair = ts::getTranslationUnitComment(Node);
@@ -547,16 +916,15 @@ std::shared_ptr<TranslationUnitNode> GraphBuilder::parseTranslationUnit(
   //    }
   //  }
 
-  return std::make_shared<TranslationUnitNode>(
+  return makeNode<TranslationUnitNode>(
       NodeCount++, IsConflicting, NodeKind::TRANSLATION_UNIT, Path,
       Meta.ProjectPath, FilePath, std::move(Comment), std::nullopt,
       std::string(Path), IsHeader, TraditionGuard, std::move(HeaderGuard),
       std::move(FrontDecls), BeforeFirstChildEOL);
 }
 
-std::shared_ptr<NamespaceNode>
-GraphBuilder::parseNamespaceNode(const ts::Node &Node, bool IsConflicting,
-                                 const std::string &Path) {
+NamespaceNode *GraphBuilder::parseNamespaceNode(
+    const ts::Node &Node, bool IsConflicting, const std::string &Path) {
   // cascade, normal, anonymous, inline
   std::string DisplayName;
   std::string OriginalSignature;
@@ -610,22 +978,21 @@ GraphBuilder::parseNamespaceNode(const ts::Node &Node, bool IsConflicting,
   }
 
   const std::string TUPath = fs::relative(Path, SourceDir).string();
-  return std::make_shared<NamespaceNode>(
+  return makeNode<NamespaceNode>(
       NodeCount++, IsConflicting, NodeKind::NAMESPACE, DisplayName,
       QualifiedName, OriginalSignature, std::move(Comment), Node.startPoint(),
       std::move(USR), BeforeFirstChildEOL, TUPath, Inline.size() != 0,
       std::move(NSComment), Anonymous);
 }
 
-std::shared_ptr<TextualNode>
-GraphBuilder::parseTextualNode(const ts::Node &Node, bool IsConflicting,
-                               size_t ParentSignatureHash,
-                               const std::string &Path) {
+TextualNode *GraphBuilder::parseTextualNode(
+    const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash,
+    const std::string &Path) {
   std::string TextContent = Node.text();
   if (Node.type() == ts::cpp::symbols::sym_enumerator.name) {
     if (Node.nextSibling().has_value()) {
       ts::Node nextSibling = Node.nextSibling().value();
-      if (nextSibling.text().find(',') != std::string::npos) {
+      if (nextSibling.textView().find(',') != std::string_view::npos) {
         TextContent += ",";
       }
     }
@@ -636,14 +1003,14 @@ GraphBuilder::parseTextualNode(const ts::Node &Node, bool IsConflicting,
   }
 
   const std::string TUPath = fs::relative(Path, SourceDir).string();
-  return std::make_shared<TextualNode>(
+  return makeNode<TextualNode>(
       NodeCount++, IsConflicting, NodeKind::TEXTUAL, TextContent, TextContent,
       TextContent, ts::getNodeComment(Node), Node.startPoint(), "",
       std::move(TextContent), ParentSignatureHash, ts::getFollowingEOLs(Node),
       TUPath);
 }
 
-std::shared_ptr<FieldDeclarationNode> GraphBuilder::parseFieldDeclarationNode(
+FieldDeclarationNode *GraphBuilder::parseFieldDeclarationNode(
     const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash,
     const std::string &FilePath, bool IsFieldDecl) {
   const std::optional<ts::Node> DeclaratorNodeOpt =
@@ -705,30 +1072,26 @@ std::shared_ptr<FieldDeclarationNode> GraphBuilder::parseFieldDeclarationNode(
     QualifiedName = details.containerName.value_or("");
     DisplayName = details.name;
   }
-  std::shared_ptr<FieldDeclarationNode> FDNodePtr =
-      std::make_shared<FieldDeclarationNode>(
-          NodeCount++, IsConflicting, NodeKind::FIELD_DECLARATION, DisplayName,
-          QualifiedName, Node.text(), ts::getNodeComment(Node),
-          Node.startPoint(), std::move(USR), Node.text(),
-          ts::getFollowingEOLs(Node), std::move(Declarator),
-          ParentSignatureHash);
+  FieldDeclarationNode *FDNodePtr = makeNode<FieldDeclarationNode>(
+      NodeCount++, IsConflicting, NodeKind::FIELD_DECLARATION, DisplayName,
+      QualifiedName, Node.text(), ts::getNodeComment(Node), Node.startPoint(),
+      std::move(USR), Node.text(), ts::getFollowingEOLs(Node),
+      std::move(Declarator), ParentSignatureHash);
   FDNodePtr->References = References;
   return FDNodePtr;
 }
 
-std::shared_ptr<LinkageSpecNode>
-GraphBuilder::parseLinkageSpecNode(const ts::Node &Node, bool IsConflicting,
-                                   size_t ParentSignatureHash) {
-  return std::make_shared<LinkageSpecNode>(
+LinkageSpecNode *GraphBuilder::parseLinkageSpecNode(
+    const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash) {
+  return makeNode<LinkageSpecNode>(
       NodeCount++, IsConflicting, NodeKind::LINKAGE_SPEC_LIST,
       "extern \"C\" {}", "", "extern \"C\" ", ts::getNodeComment(Node),
       Node.startPoint(), "", ts::beforeFirstChildEOLs(Node),
       ParentSignatureHash);
 }
 
-std::shared_ptr<EnumNode>
-GraphBuilder::parseEnumNode(const ts::Node &Node, bool IsConflicting,
-                            const std::string &FilePath) {
+EnumNode *GraphBuilder::parseEnumNode(const ts::Node &Node, bool IsConflicting,
+                                      const std::string &FilePath) {
   auto [row, col] = Node.startPoint();
 
   const std::string pattern =
@@ -765,14 +1128,14 @@ GraphBuilder::parseEnumNode(const ts::Node &Node, bool IsConflicting,
     USR = details.usr;
     QualifiedName = details.containerName.value_or("");
   }
-  return std::make_shared<EnumNode>(
+  return makeNode<EnumNode>(
       NodeCount++, IsConflicting, NodeKind::ENUM, EnumName, QualifiedName,
       OriginalSignature, ts::getNodeComment(Node), Node.startPoint(),
       std::move(USR), Node.text(), ts::beforeFirstChildEOLs(Node), EnumKey,
       Attrs, EnumBase);
 }
 
-std::pair<std::shared_ptr<TypeDeclNode>, TypeDeclNode::TypeDeclKind>
+std::pair<TypeDeclNode *, TypeDeclNode::TypeDeclKind>
 GraphBuilder::parseTypeDeclNode(const ts::Node &Node, const ts::Node &RealNode,
                                 bool IsConflicting,
                                 const std::string &FilePath) {
@@ -806,7 +1169,7 @@ GraphBuilder::parseTypeDeclNode(const ts::Node &Node, const ts::Node &RealNode,
                                  static_cast<int>(col + Info.ColOffset)});
   }
 
-  std::shared_ptr<TypeDeclNode> TypeDeclPtr = std::make_shared<TypeDeclNode>(
+  TypeDeclNode *TypeDeclPtr = makeNode<TypeDeclNode>(
       NodeCount++, IsConflicting, NodeKind::TYPE, Info.ClassName, QualifiedName,
       Info.OriginalSignature, ts::getNodeComment(Node), Node.startPoint(),
       std::move(USR), ts::beforeFirstChildEOLs(RealNode), Kind,
@@ -814,16 +1177,15 @@ GraphBuilder::parseTypeDeclNode(const ts::Node &Node, const ts::Node &RealNode,
       std::move(Info.TemplateParameterList));
   TypeDeclPtr->References = std::move(References);
 
-  return std::pair<std::shared_ptr<TypeDeclNode>, TypeDeclNode::TypeDeclKind>({
+  return std::pair<TypeDeclNode *, TypeDeclNode::TypeDeclKind>({
       TypeDeclPtr,
       Kind,
   });
 }
 
-std::shared_ptr<FuncDefNode>
-GraphBuilder::parseFuncDefNode(const ts::Node &Node, const ts::Node &RealNode,
-                               bool IsConflicting, size_t ParentSignatureHash,
-                               const std::string &FilePath) {
+FuncDefNode *GraphBuilder::parseFuncDefNode(
+    const ts::Node &Node, const ts::Node &RealNode, bool IsConflicting,
+    size_t ParentSignatureHash, const std::string &FilePath) {
   //  ts::Node FDefNode = Node;
   //  if (Node.type() == ts::cpp::symbols::sym_template_declaration.name) {
   //    for (size_t i = 0; i < Node.childrenCount(); ++i) {
@@ -841,8 +1203,9 @@ GraphBuilder::parseFuncDefNode(const ts::Node &Node, const ts::Node &RealNode,
   const ts::Node DeclaratorNode =
       RealNode.getChildByFieldName(ts::cpp::fields::field_declarator.name)
           .value();
-  std::string QualifiedFuncName =
-      DeclaratorNode.text().substr(0, DeclaratorNode.text().find('('));
+  const std::string_view DeclaratorText = DeclaratorNode.textView();
+  std::string QualifiedFuncName(
+      DeclaratorText.substr(0, DeclaratorText.find('(')));
   int Offset = 0;
   for (auto c : QualifiedFuncName) {
     if (c == '&' || c == '*' || isspace(c)) {
@@ -909,7 +1272,7 @@ GraphBuilder::parseFuncDefNode(const ts::Node &Node, const ts::Node &RealNode,
       ts::cpp::fields::field_body.name); // function body
   std::string BodyText = BodyOpt.has_value() ? BodyOpt.value().text() : "";
 
-  std::shared_ptr<FuncDefNode> FuncDefNodePtr = std::make_shared<FuncDefNode>(
+  FuncDefNode *FuncDefNodePtr = makeNode<FuncDefNode>(
       NodeCount++, IsConflicting, NodeKind::FUNC_DEF, DefInfo.FuncName,
       QualifiedName, DefInfo.OriginalSignature, ts::getNodeComment(Node),
       Node.startPoint(), std::move(USR), std::move(BodyText),
@@ -924,7 +1287,7 @@ GraphBuilder::parseFuncDefNode(const ts::Node &Node, const ts::Node &RealNode,
   return FuncDefNodePtr;
 }
 
-std::shared_ptr<FuncOperatorCastNode> GraphBuilder::parseFuncOperatorCastNode(
+FuncOperatorCastNode *GraphBuilder::parseFuncOperatorCastNode(
     const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash,
     const std::string &FilePath) {
   ts::FuncOperatorCastInfo Info = ts::extractFuncOperatorCastInfo(Node.text());
@@ -952,19 +1315,18 @@ std::shared_ptr<FuncOperatorCastNode> GraphBuilder::parseFuncOperatorCastNode(
       ts::cpp::fields::field_body.name); // function body
   std::string BodyText = BodyOpt.has_value() ? BodyOpt.value().text() : "";
 
-  std::shared_ptr<FuncOperatorCastNode> FOpCastPtr =
-      std::make_shared<FuncOperatorCastNode>(
-          NodeCount++, IsConflicting, NodeKind::FUNC_OPERATOR_CAST,
-          Info.FuncName, QualifiedName, Info.OriginalSignature,
-          ts::getNodeComment(Node), Node.startPoint(), std::move(USR),
-          std::move(BodyText), ParentSignatureHash, ts::getFollowingEOLs(Node),
-          std::move(Info.TemplateParameterList), std::move(Info.Attrs),
-          std::move(Info.ParameterList), std::move(Info.AfterParameterList));
+  FuncOperatorCastNode *FOpCastPtr = makeNode<FuncOperatorCastNode>(
+      NodeCount++, IsConflicting, NodeKind::FUNC_OPERATOR_CAST, Info.FuncName,
+      QualifiedName, Info.OriginalSignature, ts::getNodeComment(Node),
+      Node.startPoint(), std::move(USR), std::move(BodyText),
+      ParentSignatureHash, ts::getFollowingEOLs(Node),
+      std::move(Info.TemplateParameterList), std::move(Info.Attrs),
+      std::move(Info.ParameterList), std::move(Info.AfterParameterList));
   FOpCastPtr->References = std::move(References);
   return FOpCastPtr;
 }
 
-std::shared_ptr<FuncSpecialMemberNode> GraphBuilder::parseFuncSpecialMemberNode(
+FuncSpecialMemberNode *GraphBuilder::parseFuncSpecialMemberNode(
     const ts::Node &Node, bool IsConflicting, size_t ParentSignatureHash,
     const std::string &FilePath) {
   ts::FuncSpecialMemberInfo Info =
@@ -1024,15 +1386,14 @@ std::shared_ptr<FuncSpecialMemberNode> GraphBuilder::parseFuncSpecialMemberNode(
       ts::cpp::fields::field_body.name); // function body
   std::string BodyText = BodyOpt.has_value() ? BodyOpt.value().text() : "";
 
-  std::shared_ptr<FuncSpecialMemberNode> FSMPtr =
-      std::make_shared<FuncSpecialMemberNode>(
-          NodeCount++, IsConflicting, NodeKind::FUNC_SPECIAL_MEMBER,
-          Info.FuncName, QualifiedName, Info.OriginalSignature,
-          ts::getNodeComment(Node), Node.startPoint(), std::move(USR),
-          std::move(BodyText), ParentSignatureHash, ts::getFollowingEOLs(Node),
-          Info.DefType, std::move(Info.TemplateParameterList),
-          std::move(Info.Attrs), std::move(Info.BeforeFuncName),
-          std::move(Info.ParameterList), std::move(Info.InitList));
+  FuncSpecialMemberNode *FSMPtr = makeNode<FuncSpecialMemberNode>(
+      NodeCount++, IsConflicting, NodeKind::FUNC_SPECIAL_MEMBER, Info.FuncName,
+      QualifiedName, Info.OriginalSignature, ts::getNodeComment(Node),
+      Node.startPoint(), std::move(USR), std::move(BodyText),
+      ParentSignatureHash, ts::getFollowingEOLs(Node), Info.DefType,
+      std::move(Info.TemplateParameterList), std::move(Info.Attrs),
+      std::move(Info.BeforeFuncName), std::move(Info.ParameterList),
+      std::move(Info.InitList));
   FSMPtr->ParameterTypes = std::move(ParameterTypeList);
   FSMPtr->References = std::move(References);
 
@@ -1042,10 +1403,10 @@ std::shared_ptr<FuncSpecialMemberNode> GraphBuilder::parseFuncSpecialMemberNode(
 void GraphBuilder::addIncludeEdges() {
   auto rangePair = boost::vertices(G);
   std::vector<
-      std::pair<std::shared_ptr<SemanticNode>, decltype(rangePair.first)>>
+      std::pair<SemanticNode *, decltype(rangePair.first)>>
       TUPtrs;
   for (auto It = rangePair.first; It != rangePair.second; ++It) {
-    if (llvm::isa<TranslationUnitNode>(G[*It].get())) {
+    if (llvm::isa<TranslationUnitNode>(G[*It])) {
       TUPtrs.push_back({G[*It], It});
     }
   }
@@ -1065,13 +1426,11 @@ void GraphBuilder::addIncludeEdges() {
                     SemanticEdge(EdgeCount++, EdgeKind::INCLUDE));
           } else {
             // insert synthetic node and edge
-            std::shared_ptr<SemanticNode> SyntheticPtr =
-                std::make_shared<TranslationUnitNode>(
-                    NodeCount++, false, NodeKind::TRANSLATION_UNIT,
-                    IncludedFile, "", "", "", std::nullopt,
-                    std::string(IncludedFile), false, false,
-                    std::vector<std::string>(), std::vector<std::string>(), 0,
-                    true);
+            SemanticNode *SyntheticPtr = makeNode<TranslationUnitNode>(
+                NodeCount++, false, NodeKind::TRANSLATION_UNIT, IncludedFile,
+                "", "", "", std::nullopt, std::string(IncludedFile), false,
+                false, std::vector<std::string>(), std::vector<std::string>(),
+                0, true);
             auto SyntheticVertex = addVertex(SyntheticPtr);
             addEdge(*TUPair.second, SyntheticVertex,
                     SemanticEdge(EdgeCount++, EdgeKind::INCLUDE, 1, true));
@@ -1083,17 +1442,17 @@ void GraphBuilder::addIncludeEdges() {
 void GraphBuilder::addReferenceEdges() {
   auto rangePair = boost::vertices(G);
   std::vector<
-      std::pair<std::shared_ptr<SemanticNode>, decltype(rangePair.first)>>
+      std::pair<SemanticNode *, decltype(rangePair.first)>>
       FieldDecls;
   for (auto It = rangePair.first; It != rangePair.second; ++It) {
-    if (llvm::isa<FieldDeclarationNode>(G[*It].get())) {
+    if (llvm::isa<FieldDeclarationNode>(G[*It])) {
       FieldDecls.push_back({G[*It], It});
     }
   }
 
   std::for_each(FieldDecls.begin(), FieldDecls.end(), [&](auto &FieldDeclPair) {
     if (auto FieldDeclRawPtr =
-            llvm::dyn_cast<FieldDeclarationNode>(FieldDeclPair.first.get())) {
+            llvm::dyn_cast<FieldDeclarationNode>(FieldDeclPair.first)) {
       std::for_each(
           FieldDeclRawPtr->References.begin(),
           FieldDeclRawPtr->References.end(), [&](const auto &Reference) {
@@ -1106,11 +1465,10 @@ void GraphBuilder::addReferenceEdges() {
               addEdge(*FieldDeclPair.second, *It,
                       SemanticEdge(EdgeCount++, EdgeKind::REFERENCE));
             } else {
-              std::shared_ptr<SemanticNode> SyntheticPtr =
-                  std::make_shared<FuncDefNode>(
-                      NodeCount++, false, NodeKind::FUNC_DEF, Reference, "", "",
-                      "", std::nullopt, "", "", -1, 0, "", "", "",
-                      std::vector<std::string>(), "", true);
+              SemanticNode *SyntheticPtr = makeNode<FuncDefNode>(
+                  NodeCount++, false, NodeKind::FUNC_DEF, Reference, "", "", "",
+                  std::nullopt, "", "", -1, 0, "", "", "",
+                  std::vector<std::string>(), "", true);
               auto SyntheticVertex = addVertex(SyntheticPtr);
               addEdge(*FieldDeclPair.second, SyntheticVertex,
                       SemanticEdge(EdgeCount++, EdgeKind::REFERENCE, 1, true));
@@ -1123,17 +1481,17 @@ void GraphBuilder::addReferenceEdges() {
 void GraphBuilder::addUseEdges() {
   auto rangePair = boost::vertices(G);
   std::vector<
-      std::pair<std::shared_ptr<SemanticNode>, decltype(rangePair.first)>>
+      std::pair<SemanticNode *, decltype(rangePair.first)>>
       PlainFuncs;
   std::vector<
-      std::pair<std::shared_ptr<SemanticNode>, decltype(rangePair.first)>>
+      std::pair<SemanticNode *, decltype(rangePair.first)>>
       TypeDecls;
   for (auto It = rangePair.first; It != rangePair.second; ++It) {
-    if (llvm::isa<FuncDefNode>(G[*It].get()) ||
-        llvm::isa<FuncSpecialMemberNode>(G[*It].get())) {
+    if (llvm::isa<FuncDefNode>(G[*It]) ||
+        llvm::isa<FuncSpecialMemberNode>(G[*It])) {
       PlainFuncs.push_back({G[*It], It});
     }
-    if (llvm::isa<TypeDeclNode>(G[*It].get())) {
+    if (llvm::isa<TypeDeclNode>(G[*It])) {
       TypeDecls.push_back({G[*It], It});
     }
   }
@@ -1141,11 +1499,11 @@ void GraphBuilder::addUseEdges() {
   std::for_each(PlainFuncs.begin(), PlainFuncs.end(), [&](auto &FuncPair) {
     std::vector<std::string> FuncUses;
     if (auto FuncDefRawPtr =
-            llvm::dyn_cast<FuncDefNode>(FuncPair.first.get())) {
+            llvm::dyn_cast<FuncDefNode>(FuncPair.first)) {
       FuncUses = FuncDefRawPtr->ParameterTypes;
     }
     if (auto FuncSpecialRawPtr =
-            llvm::dyn_cast<FuncSpecialMemberNode>(FuncPair.first.get())) {
+            llvm::dyn_cast<FuncSpecialMemberNode>(FuncPair.first)) {
       FuncUses = FuncSpecialRawPtr->ParameterTypes;
     }
     std::for_each(FuncUses.begin(), FuncUses.end(), [&](const auto &UseType) {
@@ -1157,11 +1515,10 @@ void GraphBuilder::addUseEdges() {
         addEdge(*FuncPair.second, *(It->second),
                 SemanticEdge(EdgeCount++, EdgeKind::USE));
       } else {
-        std::shared_ptr<SemanticNode> SyntheticPtr =
-            std::make_shared<TypeDeclNode>(
-                NodeCount++, false, NodeKind::TYPE, UseType, "", "", "",
-                std::nullopt, "", 0, TypeDeclNode::TypeDeclKind::Class, "",
-                false, "", "", true);
+        SemanticNode *SyntheticPtr = makeNode<TypeDeclNode>(
+            NodeCount++, false, NodeKind::TYPE, UseType, "", "", "",
+            std::nullopt, "", 0, TypeDeclNode::TypeDeclKind::Class, "", false,
+            "", "", true);
         auto SyntheticVertex = addVertex(SyntheticPtr);
         addEdge(*FuncPair.second, SyntheticVertex,
                 SemanticEdge(EdgeCount++, EdgeKind::USE, 1, true));
@@ -1178,71 +1535,149 @@ bool GraphBuilder::isConflicting(std::string_view Path) const {
 std::optional<lsp::SymbolDetails>
 GraphBuilder::getSymbolDetails(const lsp::URIForFile &URI,
                                const lsp::Position Pos) {
-  auto returned = Client.SymbolInfo(URI, Pos);
-  if (!returned.has_value()) {
-    return std::nullopt;
+  if (Index) {
+    if (const SymbolIndex::Symbol *Sym =
+            Index->lookup(URI.file, Pos.line, Pos.character)) {
+      lsp::SymbolDetails Details;
+      Details.name = Sym->Name;
+      Details.containerName = Sym->ContainerName;
+      Details.usr = Sym->USR;
+      return Details;
+    }
   }
-  std::vector<lsp::SymbolDetails> details = returned.value();
-  if (!details.size()) {
+  if (Prefetch.Recording) {
+    Prefetch.InfoQueries.emplace_back(URI, Pos);
     return std::nullopt;
   }
-  return details[0];
+  if (auto It = Prefetch.Infos.find({URI, Pos.line, Pos.character});
+      It != Prefetch.Infos.end()) {
+    return It->second;
+  }
+  return details::toSymbolDetails(
+      querySymbolCache(URI, Pos, SymbolCache::Method::SymbolInfo,
+                       [&]() {
+                         return Client->SymbolInfo(toWorkspace(URI.file), Pos);
+                       }));
 }
 
 std::vector<std::string> GraphBuilder::getReferences(const lsp::URIForFile &URI,
                                                      const lsp::Position Pos) {
-  auto returned = Client.References(URI, Pos);
-  if (!returned.has_value()) {
-    return {};
+  if (Index) {
+    if (const SymbolIndex::Symbol *Sym =
+            Index->lookup(URI.file, Pos.line, Pos.character)) {
+      return Index->references(Sym->USR);
+    }
   }
-
-  std::vector<lsp::ReferenceLocation> locations = returned.value();
-  if (!locations.size()) {
+  if (Prefetch.Recording) {
+    Prefetch.RefQueries.emplace_back(URI, Pos);
     return {};
   }
-
-  std::vector<std::string> References;
-  for (auto &location : locations) {
-    if (location.containerName.has_value()) {
-      References.push_back(std::move(location.containerName.value()));
-    }
+  if (auto It = Prefetch.Refs.find({URI, Pos.line, Pos.character});
+      It != Prefetch.Refs.end()) {
+    return It->second;
   }
-  return References;
+  // callers differ across sides, never shared, see SymbolCache::shareable
+  return details::toReferences(
+      Client->References(toWorkspace(URI.file), Pos));
 }
 
 bool GraphBuilder::initLanguageServer() {
-  fs::path current_exec_path = std::filesystem::read_symlink("/proc/self/exe");
-  fs::path dir = current_exec_path.parent_path();
-  fs::path clangd_path = dir / "clangd";
-  if (!fs::exists(clangd_path)) {
-    spdlog::error("clangd not found");
-    return false;
+  // a root stable across scenarios lets clangd reuse its index and preambles,
+  // workers share the one of the builder spawning them
+  if (StableWorkspace::enabled() && !IsWorker) {
+    Workspace = StableWorkspace::lease(Meta.ProjectCacheDir,
+                                       magic_enum::enum_name(S), SourceDir);
+    syncWorkspace();
   }
-  auto Communicator =
-      lsp::PipeCommunicator::create(clangd_path.string().c_str(), "clangd");
-  if (!Communicator) {
-    spdlog::error("cannot create pipe to communicate with child process");
+  const std::string WorkspaceRoot = Workspace ? Workspace->root() : SourceDir;
+  Client = lsp::ClientPool::Instance().Acquire(
+      {Meta.ProjectPath, WorkspaceRoot, Meta.CDBPath,
+       StableWorkspace::indexDir(Meta.ProjectCacheDir)});
+  if (!Client) {
     return false;
   }
-  std::unique_ptr<lsp::JSONRpcEndpoint> RpcEndpoint =
-      std::make_unique<lsp::JSONRpcEndpoint>(std::move(Communicator));
-  std::unique_ptr<lsp::LspEndpoint> LspEndpoint =
-      std::make_unique<lsp::LspEndpoint>(std::move(RpcEndpoint), 5);
+  spdlog::debug("Side: [{}], {} clangd leased in {}", magic_enum::enum_name(S),
+                Client.Reused() ? "warm" : "cold", WorkspaceRoot);
+  pushCompileCommands();
+  return true;
+}
 
-  Client = lsp::LspClient(std::move(LspEndpoint));
+void GraphBuilder::syncWorkspace() {
+  if (!Workspace) {
+    return;
+  }
+  const size_t Idx = static_cast<size_t>(S);
+  // sparse side dirs grow as files are materialized
+  Workspace->sync(Idx < Meta.Checkouts.size() && Meta.Checkouts[Idx]
+                      ? Meta.Checkouts[Idx]->size()
+                      : 0);
+}
 
-  std::string WorkspaceRoot =
-      (fs::path(Meta.MSCacheDir) / magic_enum::enum_name(S)).string();
-  auto InitializedResult = Client.Initialize(WorkspaceRoot);
-  if (InitializedResult.has_value()) {
-    spdlog::debug("server info: {}",
-                  InitializedResult.value()["serverInfo"]["version"]);
+std::string GraphBuilder::toWorkspace(const std::string &Path) const {
+  if (!Workspace) {
+    return Path;
   }
-  return true;
+  return RemappedCompDB::remap(Path, SourceDir, Workspace->root());
+}
+
+void GraphBuilder::buildSymbolIndex() {
+  if (!Compilations) {
+    return;
+  }
+  // the sources are on disk now, materialized for clangd
+  std::vector<std::string> Files;
+  Files.reserve(SourceList.size());
+  for (const std::string &Path : SourceList) {
+    if (details::IsCppSource(Path) || details::IsCSource(Path)) {
+      Files.push_back((fs::path(SourceDir) / Path).string());
+    }
+  }
+  Index = SymbolIndex::build(*Compilations, Files, SourceDir);
+  spdlog::info("Side: [{}], {} symbols of {} sources indexed in process",
+               magic_enum::enum_name(S), Index->numSymbols(), Files.size());
+}
+
+void GraphBuilder::pushCompileCommands() {
+  if (!Compilations) {
+    return;
+  }
+  Meta.materialize(S, SourceList);
+  syncWorkspace();
+  lsp::ConfigurationSettings Settings;
+  auto Push = [&](const std::string &FilePath) {
+    std::vector<clang::tooling::CompileCommand> Commands =
+        Compilations->getCompileCommands(FilePath);
+    if (!Commands.empty()) {
+      std::vector<std::string> CommandLine;
+      CommandLine.reserve(Commands.front().CommandLine.size());
+      for (const std::string &Arg : Commands.front().CommandLine) {
+        CommandLine.push_back(toWorkspace(Arg));
+      }
+      Settings.compilationDatabaseChanges[toWorkspace(FilePath)] = {
+          toWorkspace(Commands.front().Directory), std::move(CommandLine)};
+    }
+  };
+  for (const std::string &Path : SourceList) {
+    Push((fs::path(SourceDir) / Path).string());
+    // clangd switches to the counterpart of each source, cover it too
+    for (const std::string &Counterpart : SparseCheckout::counterpartsOf(Path)) {
+      const std::string FilePath = (fs::path(SourceDir) / Counterpart).string();
+      if (fs::exists(FilePath)) {
+        Push(FilePath);
+      }
+    }
+  }
+  spdlog::debug("Side: [{}], {} compile commands pushed to clangd",
+                magic_enum::enum_name(S),
+                Settings.compilationDatabaseChanges.size());
+  Client->DidChangeConfiguration(Settings);
 }
 
 GraphBuilder::vertex_descriptor
-GraphBuilder::addVertex(std::shared_ptr<SemanticNode> Node) {
+GraphBuilder::addVertex(SemanticNode *Node) {
+  if (Prefetch.Recording) {
+    return vertex_descriptor();
+  }
   // Note(hwa): will there be a memory leak?
   return boost::add_vertex(Node, G);
 }
@@ -1251,25 +1686,31 @@ std::pair<GraphBuilder::edge_descriptor, bool>
 GraphBuilder::addEdge(GraphBuilder::vertex_descriptor Source,
                       GraphBuilder::vertex_descriptor Target,
                       SemanticEdge Edge) {
+  if (Prefetch.Recording) {
+    return {edge_descriptor(), false};
+  }
   return boost::add_edge(Source, Target, Edge, G);
 }
 
 std::pair<GraphBuilder::vertex_descriptor, bool>
 GraphBuilder::insertToGraphAndParent(
-    std::shared_ptr<SemanticNode> &ParentPtr,
+    SemanticNode *ParentPtr,
     const vertex_descriptor &ParentDesc,
-    const std::shared_ptr<SemanticNode> &CurPtr) {
+    SemanticNode *CurPtr) {
   vertex_descriptor CurDesc = addVertex(CurPtr);
   auto [_, Success] = addEdge(ParentDesc, CurDesc,
                               SemanticEdge(EdgeCount++, EdgeKind::CONTAIN));
+  if (Prefetch.Recording) {
+    return {CurDesc, Success};
+  }
   CurPtr->Parent = ParentPtr;
   ParentPtr->Children.push_back(CurPtr);
   return {CurDesc, Success};
 }
 
 GraphBuilder::~GraphBuilder() {
-  Client.Shutdown();
-  Client.Exit();
+  // clangd is not shut down, the lease gives it back to the pool
+  Client.Reset();
 }
 
 // std::shared_ptr<IfDefBlockNode>
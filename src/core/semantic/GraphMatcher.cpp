@@ -18,8 +18,8 @@
 
 namespace mergebot::sa {
 void GraphMatcher::topDownMatch() {
-  std::unordered_map<size_t, std::shared_ptr<SemanticNode>> BaseNodes;
-  std::unordered_map<size_t, std::shared_ptr<SemanticNode>> RevisionNodes;
+  std::unordered_map<size_t, SemanticNode *> BaseNodes;
+  std::unordered_map<size_t, SemanticNode *> RevisionNodes;
   for (auto VDesc : boost::make_iterator_range(boost::vertices(BaseGraph))) {
     auto Node = BaseGraph[VDesc];
     // we only care about nodes that need to be merged,
@@ -52,9 +52,9 @@ void GraphMatcher::topDownMatch() {
 void GraphMatcher::bottomUpMatch() {
   /// Assume that only nodes of the same type are allowed to match.
   // translation unit
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedTUs =
+  std::vector<SemanticNode *> &BaseUnmatchedTUs =
       Matching.PossiblyDeleted[NodeKind::TRANSLATION_UNIT];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedTUs =
+  std::vector<SemanticNode *> &RevisionUnmatchedTUs =
       Matching.PossiblyAdded[NodeKind::TRANSLATION_UNIT];
   if (BaseUnmatchedTUs.size() && RevisionUnmatchedTUs.size()) {
     spdlog::info("bottom-up match Translation Unit for Side {}",
@@ -64,9 +64,9 @@ void GraphMatcher::bottomUpMatch() {
   }
 
   /// TODO(hwa): add body similarity calc, linkage spec list
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedLinkageSpecs =
+  std::vector<SemanticNode *> &BaseUnmatchedLinkageSpecs =
       Matching.PossiblyDeleted[NodeKind::LINKAGE_SPEC_LIST];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedLinkageSpecs =
+  std::vector<SemanticNode *> &RevisionUnmatchedLinkageSpecs =
       Matching.PossiblyAdded[NodeKind::LINKAGE_SPEC_LIST];
   if (BaseUnmatchedLinkageSpecs.size() &&
       RevisionUnmatchedLinkageSpecs.size()) {
@@ -77,9 +77,9 @@ void GraphMatcher::bottomUpMatch() {
                      RevisionUnmatchedLinkageSpecs);
   }
 
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedNamespaces =
+  std::vector<SemanticNode *> &BaseUnmatchedNamespaces =
       Matching.PossiblyDeleted[NodeKind::NAMESPACE];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedNamespaces =
+  std::vector<SemanticNode *> &RevisionUnmatchedNamespaces =
       Matching.PossiblyAdded[NodeKind::NAMESPACE];
   if (!BaseUnmatchedNamespaces.empty() &&
       !RevisionUnmatchedNamespaces.empty()) {
@@ -91,9 +91,9 @@ void GraphMatcher::bottomUpMatch() {
   }
 
   /// type class, struct, union
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedTypes =
+  std::vector<SemanticNode *> &BaseUnmatchedTypes =
       Matching.PossiblyDeleted[NodeKind::TYPE];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedTypes =
+  std::vector<SemanticNode *> &RevisionUnmatchedTypes =
       Matching.PossiblyAdded[NodeKind::TYPE];
   std::unordered_map<size_t, size_t> RefactoredTypes;
   if (BaseUnmatchedTypes.size() && RevisionUnmatchedTypes.size()) {
@@ -104,9 +104,9 @@ void GraphMatcher::bottomUpMatch() {
   }
 
   /// enum
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedEnums =
+  std::vector<SemanticNode *> &BaseUnmatchedEnums =
       Matching.PossiblyDeleted[NodeKind::ENUM];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedEnums =
+  std::vector<SemanticNode *> &RevisionUnmatchedEnums =
       Matching.PossiblyAdded[NodeKind::ENUM];
   if (BaseUnmatchedEnums.size() && RevisionUnmatchedEnums.size()) {
     spdlog::info("bottom-up match Enum for Side {}", magic_enum::enum_name(S));
@@ -115,9 +115,9 @@ void GraphMatcher::bottomUpMatch() {
   }
 
   // field declaration
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedFields =
+  std::vector<SemanticNode *> &BaseUnmatchedFields =
       Matching.PossiblyDeleted[NodeKind::FIELD_DECLARATION];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedFields =
+  std::vector<SemanticNode *> &RevisionUnmatchedFields =
       Matching.PossiblyAdded[NodeKind::FIELD_DECLARATION];
   if (BaseUnmatchedFields.size() && RevisionUnmatchedFields.size()) {
     spdlog::info("bottom-up match Field Declaration for Side {}",
@@ -128,9 +128,9 @@ void GraphMatcher::bottomUpMatch() {
   }
 
   // function definition
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedFuncDefs =
+  std::vector<SemanticNode *> &BaseUnmatchedFuncDefs =
       Matching.PossiblyDeleted[NodeKind::FUNC_DEF];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedFuncDefs =
+  std::vector<SemanticNode *> &RevisionUnmatchedFuncDefs =
       Matching.PossiblyAdded[NodeKind::FUNC_DEF];
   if (BaseUnmatchedFuncDefs.size() && RevisionUnmatchedFuncDefs.size()) {
     spdlog::info("bottom-up match Function Definition for Side {}",
@@ -143,9 +143,9 @@ void GraphMatcher::bottomUpMatch() {
   // no need to do this for operator cast
 
   // func special member
-  std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedFSMembers =
+  std::vector<SemanticNode *> &BaseUnmatchedFSMembers =
       Matching.PossiblyDeleted[NodeKind::FUNC_SPECIAL_MEMBER];
-  std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedFSMembers =
+  std::vector<SemanticNode *> &RevisionUnmatchedFSMembers =
       Matching.PossiblyAdded[NodeKind::FUNC_SPECIAL_MEMBER];
   if (BaseUnmatchedFSMembers.size() && RevisionUnmatchedFSMembers.size()) {
     spdlog::info("bottom-up match Function Special Member for Side {}",
@@ -156,17 +156,17 @@ void GraphMatcher::bottomUpMatch() {
   }
 
   // textual node
-//   std::vector<std::shared_ptr<SemanticNode>> &BaseUnmatchedTextualNode =
-//       Matching.PossiblyDeleted[NodeKind::TEXTUAL];
-//   std::vector<std::shared_ptr<SemanticNode>> &RevisionUnmatchedTextualNode =
-//       Matching.PossiblyAdded[NodeKind::TEXTUAL];
-//   if (BaseUnmatchedTextualNode.size() && RevisionUnmatchedTextualNode.size()) {
-//     spdlog::info("bottom-up match Textual Node for Side {}",
-//                  magic_enum::enum_name(S));
-//     TextualMatcher TTMatcher;
-//     TTMatcher.match(Matching, BaseUnmatchedTextualNode,
-//                     RevisionUnmatchedTextualNode);
-//   }
+  std::vector<SemanticNode *> &BaseUnmatchedTextualNode =
+      Matching.PossiblyDeleted[NodeKind::TEXTUAL];
+  std::vector<SemanticNode *> &RevisionUnmatchedTextualNode =
+      Matching.PossiblyAdded[NodeKind::TEXTUAL];
+  if (BaseUnmatchedTextualNode.size() && RevisionUnmatchedTextualNode.size()) {
+    spdlog::info("bottom-up match Textual Node for Side {}",
+                 magic_enum::enum_name(S));
+    TextualMatcher TTMatcher;
+    TTMatcher.match(Matching, BaseUnmatchedTextualNode,
+                    RevisionUnmatchedTextualNode);
+  }
 
   // no need to do this for access specifier, orphan comment
 }
@@ -191,7 +191,7 @@ TwoWayMatching GraphMatcher::match() {
 #ifdef MB_DEBUG
   auto format_unmatched_map =
       [](const std::unordered_map<
-          NodeKind, std::vector<std::shared_ptr<SemanticNode>>> &map)
+          NodeKind, std::vector<SemanticNode *>> &map)
       -> std::string {
     std::ostringstream oss;
     oss << "{\n";
@@ -29,7 +29,7 @@ void GraphMerger::threeWayMatch() {
   tbb::parallel_invoke([&]() { OurMatching = OurMatcher.match(); },
                        [&]() { TheirMatching = TheirMatcher.match(); });
 
-  std::unordered_set<std::shared_ptr<SemanticNode>> NeedToMergeNodes;
+  std::unordered_set<SemanticNode *> NeedToMergeNodes;
   for (auto VD : boost::make_iterator_range(boost::vertices(BaseGraph))) {
     auto &Node = BaseGraph[VD];
     if (Node->NeedToMerge || !Node->IsSynthetic) {
@@ -39,14 +39,14 @@ void GraphMerger::threeWayMatch() {
 
   for (auto &NodePtr : NeedToMergeNodes) {
 #ifndef MB_MERGER_DEBUG
-    if (llvm::isa<TranslationUnitNode>(NodePtr.get()) && NodePtr->NeedToMerge) {
+    if (llvm::isa<TranslationUnitNode>(NodePtr) && NodePtr->NeedToMerge) {
 #endif
-      std::optional<std::shared_ptr<SemanticNode>> OurOpt = std::nullopt;
+      std::optional<SemanticNode *> OurOpt = std::nullopt;
       if (OurMatching.OneOneMatching.left.find(NodePtr) !=
           OurMatching.OneOneMatching.left.end()) {
         OurOpt = OurMatching.OneOneMatching.left.at(NodePtr);
       }
-      std::optional<std::shared_ptr<SemanticNode>> TheirOpt = std::nullopt;
+      std::optional<SemanticNode *> TheirOpt = std::nullopt;
       if (TheirMatching.OneOneMatching.left.find(NodePtr) !=
           TheirMatching.OneOneMatching.left.end()) {
         TheirOpt = TheirMatching.OneOneMatching.left.at(NodePtr);
@@ -75,9 +75,9 @@ std::vector<std::string> GraphMerger::threeWayMerge() {
   for (const auto &Mapping : Mappings) {
     assert(Mapping.BaseNode.has_value());
 #ifdef MB_MERGER_DEBUG
-    if (llvm::isa<TranslationUnitNode>(Mapping.BaseNode.value().get())) {
+    if (llvm::isa<TranslationUnitNode>(Mapping.BaseNode.value())) {
 #endif
-      std::shared_ptr<SemanticNode> BaseNodePtr = Mapping.BaseNode.value();
+      SemanticNode *BaseNodePtr = Mapping.BaseNode.value();
       mergeSemanticNode(BaseNodePtr);
       if (BaseNodePtr) {
         MergedFiles.emplace_back(PrettyPrintTU(
@@ -91,22 +91,22 @@ std::vector<std::string> GraphMerger::threeWayMerge() {
   return MergedFiles;
 }
 
-void GraphMerger::mergeSemanticNode(std::shared_ptr<SemanticNode> &BaseNode) {
-  std::shared_ptr<SemanticNode> OurNode = nullptr;
+void GraphMerger::mergeSemanticNode(SemanticNode *BaseNode) {
+  SemanticNode *OurNode = nullptr;
   if (OurMatching.OneOneMatching.left.find(BaseNode) !=
       OurMatching.OneOneMatching.left.end()) {
     OurNode = OurMatching.OneOneMatching.left.at(BaseNode);
   }
-  std::shared_ptr<SemanticNode> TheirNode = nullptr;
+  SemanticNode *TheirNode = nullptr;
   if (TheirMatching.OneOneMatching.left.find(BaseNode) !=
       TheirMatching.OneOneMatching.left.end()) {
     TheirNode = TheirMatching.OneOneMatching.left.at(BaseNode);
   }
   if (OurNode && TheirNode) {
-    if (llvm::isa<TerminalNode>(BaseNode.get())) {
-      auto BasePtr = llvm::cast<TerminalNode>(BaseNode.get());
-      auto OurPtr = llvm::cast<TerminalNode>(OurNode.get());
-      auto TheirPtr = llvm::cast<TerminalNode>(TheirNode.get());
+    if (llvm::isa<TerminalNode>(BaseNode)) {
+      auto BasePtr = llvm::cast<TerminalNode>(BaseNode);
+      auto OurPtr = llvm::cast<TerminalNode>(OurNode);
+      auto TheirPtr = llvm::cast<TerminalNode>(TheirNode);
 
       if (BasePtr && OurPtr && TheirPtr) {
         BasePtr->Body = mergeText(OurPtr->Body, BasePtr->Body, TheirPtr->Body);
@@ -121,22 +121,22 @@ void GraphMerger::mergeSemanticNode(std::shared_ptr<SemanticNode> &BaseNode) {
                     TheirNode->QualifiedName);
       // in favor of theirs
       BaseNode->AccessSpecifier = OurNode->AccessSpecifier;
-      if (llvm::isa<FuncDefNode>(BaseNode.get()) ||
-          llvm::isa<FuncSpecialMemberNode>(BaseNode.get()) ||
-          llvm::isa<FuncOperatorCastNode>(BaseNode.get())) {
+      if (llvm::isa<FuncDefNode>(BaseNode) ||
+          llvm::isa<FuncSpecialMemberNode>(BaseNode) ||
+          llvm::isa<FuncOperatorCastNode>(BaseNode)) {
         bool SkipSigMerge = false;
         if (BaseNode->OriginalSignature == OurNode->OriginalSignature ||
             BaseNode->OriginalSignature == TheirNode->OriginalSignature) {
           SkipSigMerge = true;
-          llvm::cast<TerminalNode>(BaseNode.get())->SigUnchanged = true;
+          llvm::cast<TerminalNode>(BaseNode)->SigUnchanged = true;
         }
         if (!SkipSigMerge) {
-          if (llvm::isa<FuncDefNode>(BaseNode.get())) {
+          if (llvm::isa<FuncDefNode>(BaseNode)) {
             // 2. func def node, template parameter list, attrs, before func
             // name, displayName, ParameterList, AfterParameterList, body
-            auto BaseFuncPtr = llvm::cast<FuncDefNode>(BaseNode.get());
-            auto OurFuncPtr = llvm::cast<FuncDefNode>(OurNode.get());
-            auto TheirFuncPtr = llvm::cast<FuncDefNode>(TheirNode.get());
+            auto BaseFuncPtr = llvm::cast<FuncDefNode>(BaseNode);
+            auto OurFuncPtr = llvm::cast<FuncDefNode>(OurNode);
+            auto TheirFuncPtr = llvm::cast<FuncDefNode>(TheirNode);
             BaseFuncPtr->TemplateParameterList =
                 mergeText(OurFuncPtr->TemplateParameterList,
                           BaseFuncPtr->TemplateParameterList,
@@ -152,13 +152,11 @@ void GraphMerger::mergeSemanticNode(std::shared_ptr<SemanticNode> &BaseNode) {
             BaseFuncPtr->AfterParameterList = mergeText(
                 OurFuncPtr->AfterParameterList, BaseFuncPtr->AfterParameterList,
                 TheirFuncPtr->AfterParameterList);
-          } else if (llvm::isa<FuncSpecialMemberNode>(BaseNode.get())) {
+          } else if (llvm::isa<FuncSpecialMemberNode>(BaseNode)) {
             // 4. func special members,
-            auto BaseFuncPtr =
-                llvm::cast<FuncSpecialMemberNode>(BaseNode.get());
-            auto OurFuncPtr = llvm::cast<FuncSpecialMemberNode>(OurNode.get());
-            auto TheirFuncPtr =
-                llvm::cast<FuncSpecialMemberNode>(TheirNode.get());
+            auto BaseFuncPtr = llvm::cast<FuncSpecialMemberNode>(BaseNode);
+            auto OurFuncPtr = llvm::cast<FuncSpecialMemberNode>(OurNode);
+            auto TheirFuncPtr = llvm::cast<FuncSpecialMemberNode>(TheirNode);
             BaseFuncPtr->TemplateParameterList =
                 mergeText(OurFuncPtr->TemplateParameterList,
                           BaseFuncPtr->TemplateParameterList,
@@ -184,12 +182,11 @@ void GraphMerger::mergeSemanticNode(std::shared_ptr<SemanticNode> &BaseNode) {
             BaseFuncPtr->InitList =
                 mergeStrVecByUnion(OurFuncPtr->InitList, BaseFuncPtr->InitList,
                                    TheirFuncPtr->InitList);
-          } else if (llvm::isa<FuncOperatorCastNode>(BaseNode.get())) {
+          } else if (llvm::isa<FuncOperatorCastNode>(BaseNode)) {
             // 3. func operator cast, the same as func def node
-            auto BaseFuncPtr = llvm::cast<FuncOperatorCastNode>(BaseNode.get());
-            auto OurFuncPtr = llvm::cast<FuncOperatorCastNode>(OurNode.get());
-            auto TheirFuncPtr =
-                llvm::cast<FuncOperatorCastNode>(TheirNode.get());
+            auto BaseFuncPtr = llvm::cast<FuncOperatorCastNode>(BaseNode);
+            auto OurFuncPtr = llvm::cast<FuncOperatorCastNode>(OurNode);
+            auto TheirFuncPtr = llvm::cast<FuncOperatorCastNode>(TheirNode);
             BaseFuncPtr->TemplateParameterList =
                 mergeText(OurFuncPtr->TemplateParameterList,
                           BaseFuncPtr->TemplateParameterList,
@@ -212,16 +209,18 @@ void GraphMerger::mergeSemanticNode(std::shared_ptr<SemanticNode> &BaseNode) {
       BaseNode->OriginalSignature =
           mergeText(OurNode->OriginalSignature, BaseNode->OriginalSignature,
                     TheirNode->OriginalSignature);
+      // merged fields may be part of the signature
+      BaseNode->seal();
     } else { // composite node
-      assert(llvm::isa<CompositeNode>(BaseNode.get()));
+      assert(llvm::isa<CompositeNode>(BaseNode));
       BaseNode->FollowingEOL = OurNode->FollowingEOL;
       BaseNode->AccessSpecifier = OurNode->AccessSpecifier;
 
       // translation unit
-      if (llvm::isa<TranslationUnitNode>(BaseNode.get())) [[unlikely]] {
-        auto BaseTU = llvm::dyn_cast<TranslationUnitNode>(BaseNode.get());
-        auto OurTU = llvm::dyn_cast<TranslationUnitNode>(OurNode.get());
-        auto TheirTU = llvm::dyn_cast<TranslationUnitNode>(TheirNode.get());
+      if (llvm::isa<TranslationUnitNode>(BaseNode)) [[unlikely]] {
+        auto BaseTU = llvm::dyn_cast<TranslationUnitNode>(BaseNode);
+        auto OurTU = llvm::dyn_cast<TranslationUnitNode>(OurNode);
+        auto TheirTU = llvm::dyn_cast<TranslationUnitNode>(TheirNode);
         if (BaseTU && OurTU && TheirTU) {
           assert(BaseTU->IsHeader == OurTU->IsHeader &&
                  BaseTU->IsHeader == TheirTU->IsHeader &&
@@ -245,10 +244,11 @@ void GraphMerger::mergeSemanticNode(std::shared_ptr<SemanticNode> &BaseNode) {
           mergeText(OurNode->QualifiedName, BaseNode->QualifiedName,
                     TheirNode->QualifiedName);
 
-      assert(llvm::isa<CompositeNode>(TheirNode.get()));
-      auto BaseComposite = llvm::cast<CompositeNode>(BaseNode.get());
-      auto TheirComposite = llvm::cast<CompositeNode>(TheirNode.get());
+      assert(llvm::isa<CompositeNode>(TheirNode));
+      auto BaseComposite = llvm::cast<CompositeNode>(BaseNode);
+      auto TheirComposite = llvm::cast<CompositeNode>(TheirNode);
       BaseComposite->BeforeFirstChildEOL = TheirComposite->BeforeFirstChildEOL;
+      BaseNode->seal();
 
       /// merge children
       // conservative approach
@@ -280,9 +280,9 @@ std::string GraphMerger::mergeText(const std::string &OurText,
 }
 
 void GraphMerger::threeWayMergeChildren(
-    const std::vector<std::shared_ptr<SemanticNode>> &OurChildren,
-    std::vector<std::shared_ptr<SemanticNode>> &BaseChildren,
-    const std::vector<std::shared_ptr<SemanticNode>> &TheirChildren) {
+    const std::vector<SemanticNode *> &OurChildren,
+    std::vector<SemanticNode *> &BaseChildren,
+    const std::vector<SemanticNode *> &TheirChildren) {
 
   std::vector<size_t> Fences;
   int FenceIdx = -1;
@@ -388,10 +388,8 @@ void GraphMerger::threeWayMergeChildren(
 }
 
 /// not used, may introduce larger diffs
-std::vector<std::shared_ptr<SemanticNode>> GraphMerger::directMergeChildren(
-    const std::shared_ptr<SemanticNode> &OurNode,
-    const std::shared_ptr<SemanticNode> &BaseNode,
-    const std::shared_ptr<SemanticNode> &TheirNode) {
+std::vector<SemanticNode *> GraphMerger::directMergeChildren(
+    SemanticNode *OurNode, SemanticNode *BaseNode, SemanticNode *TheirNode) {
   switch (OrderInFavour) {
   case OrderInfavour::Ours:
     return directMergeChildrenInOurOrder(OurNode, BaseNode, TheirNode);
@@ -402,24 +400,21 @@ std::vector<std::shared_ptr<SemanticNode>> GraphMerger::directMergeChildren(
   }
 }
 
-std::vector<std::shared_ptr<SemanticNode>>
-GraphMerger::directMergeChildrenInTheirOrder(
-    const std::shared_ptr<SemanticNode> &OurNode,
-    const std::shared_ptr<SemanticNode> &BaseNode,
-    const std::shared_ptr<SemanticNode> &TheirNode) {
+std::vector<SemanticNode *>
+GraphMerger::directMergeChildrenInTheirOrder(SemanticNode *OurNode,
+                                             SemanticNode *BaseNode,
+                                             SemanticNode *TheirNode) {
   assert(OurNode && BaseNode && TheirNode);
-  std::vector<std::shared_ptr<SemanticNode>> MergedChildren;
+  std::vector<SemanticNode *> MergedChildren;
   MergedChildren.reserve(OurNode->Children.size() + BaseNode->Children.size());
 
-  std::vector<std::shared_ptr<SemanticNode>> &TheirChildren =
-      TheirNode->Children;
+  std::vector<SemanticNode *> &TheirChildren = TheirNode->Children;
 
   // merge base and their side, in their order
   for (auto &Child : TheirChildren) {
     if (TheirMatching.OneOneMatching.right.find(Child) !=
         TheirMatching.OneOneMatching.right.end()) {
-      std::shared_ptr<SemanticNode> BaseChild =
-          TheirMatching.OneOneMatching.right.at(Child);
+      SemanticNode *BaseChild = TheirMatching.OneOneMatching.right.at(Child);
       mergeSemanticNode(BaseChild);
       if (BaseChild) {
         BaseChild->FollowingEOL = Child->FollowingEOL;
@@ -437,7 +432,7 @@ GraphMerger::directMergeChildrenInTheirOrder(
                        MergedChildren.end());
 
   // the focus is on remove duplicates, as their side added have been merged
-  std::vector<std::shared_ptr<SemanticNode>> OursAdded =
+  std::vector<SemanticNode *> OursAdded =
       removeDuplicates(filterAddedNodes(BaseNode, OurMatching),
                        filterAddedNodes(BaseNode, TheirMatching));
 
@@ -485,24 +480,22 @@ GraphMerger::directMergeChildrenInTheirOrder(
 /// @param BaseNode The node from base version
 /// @param TheirNode The node from their version
 /// @return A vector of merged children nodes
-std::vector<std::shared_ptr<SemanticNode>>
-GraphMerger::directMergeChildrenInOurOrder(
-    const std::shared_ptr<SemanticNode> &OurNode,
-    const std::shared_ptr<SemanticNode> &BaseNode,
-    const std::shared_ptr<SemanticNode> &TheirNode) {
+std::vector<SemanticNode *>
+GraphMerger::directMergeChildrenInOurOrder(SemanticNode *OurNode,
+                                           SemanticNode *BaseNode,
+                                           SemanticNode *TheirNode) {
   assert(OurNode && BaseNode && TheirNode);
-  std::vector<std::shared_ptr<SemanticNode>> MergedChildren;
+  std::vector<SemanticNode *> MergedChildren;
   MergedChildren.reserve(OurNode->Children.size() + BaseNode->Children.size());
 
-  std::vector<std::shared_ptr<SemanticNode>> &OurChildren = OurNode->Children;
+  std::vector<SemanticNode *> &OurChildren = OurNode->Children;
 
   // First phase: merge base and our side, following our order
   for (auto &Child : OurChildren) {
     if (OurMatching.OneOneMatching.right.find(Child) !=
         OurMatching.OneOneMatching.right.end()) {
       // Child exists in base version
-      std::shared_ptr<SemanticNode> BaseChild =
-          OurMatching.OneOneMatching.right.at(Child);
+      SemanticNode *BaseChild = OurMatching.OneOneMatching.right.at(Child);
       mergeSemanticNode(BaseChild);
       if (BaseChild) {
         BaseChild->FollowingEOL = Child->FollowingEOL;
@@ -521,7 +514,7 @@ GraphMerger::directMergeChildrenInOurOrder(
                        MergedChildren.end());
 
   // Get nodes added in their version but not in our version
-  std::vector<std::shared_ptr<SemanticNode>> TheirsAdded =
+  std::vector<SemanticNode *> TheirsAdded =
       removeDuplicates(filterAddedNodes(BaseNode, TheirMatching),
                        filterAddedNodes(BaseNode, OurMatching));
 
@@ -569,11 +562,11 @@ GraphMerger::directMergeChildrenInOurOrder(
   return MergedChildren;
 }
 
-std::vector<std::shared_ptr<SemanticNode>>
-GraphMerger::filterAddedNodes(const std::shared_ptr<SemanticNode> &BaseNode,
+std::vector<SemanticNode *>
+GraphMerger::filterAddedNodes(SemanticNode *BaseNode,
                               const TwoWayMatching &Matching) const {
-  std::vector<std::shared_ptr<SemanticNode>> AddedNodes;
-  std::vector<std::shared_ptr<SemanticNode>> FilteredAdded;
+  std::vector<SemanticNode *> AddedNodes;
+  std::vector<SemanticNode *> FilteredAdded;
 
   for (const auto &Entry : Matching.PossiblyAdded) {
     AddedNodes.insert(AddedNodes.end(), Entry.second.begin(),
@@ -584,7 +577,7 @@ GraphMerger::filterAddedNodes(const std::shared_ptr<SemanticNode> &BaseNode,
   if (MatchedParentNodeIter != Matching.OneOneMatching.left.end()) {
     auto MatchedParentNode = MatchedParentNodeIter->second;
     for (const auto &NewlyAdded : AddedNodes) {
-      if (auto NodeParent = NewlyAdded->Parent.lock()) {
+      if (SemanticNode *NodeParent = NewlyAdded->Parent) {
         if (*NodeParent == *MatchedParentNode) {
           FilteredAdded.push_back(NewlyAdded);
         }
@@ -598,14 +591,14 @@ GraphMerger::filterAddedNodes(const std::shared_ptr<SemanticNode> &BaseNode,
   return FilteredAdded;
 }
 
-std::vector<std::shared_ptr<SemanticNode>> GraphMerger::removeDuplicates(
-    std::vector<std::shared_ptr<SemanticNode>> &&OurAdded,
-    std::vector<std::shared_ptr<SemanticNode>> &&TheirAdded) const {
+std::vector<SemanticNode *>
+GraphMerger::removeDuplicates(std::vector<SemanticNode *> &&OurAdded,
+                              std::vector<SemanticNode *> &&TheirAdded) const {
   for (const auto &TheirAdd : TheirAdded) {
     OurAdded.erase(
         std::remove_if(
             OurAdded.begin(), OurAdded.end(),
-            [&TheirAdd](const std::shared_ptr<SemanticNode> &OurAdd) {
+            [&TheirAdd](SemanticNode *OurAdd) {
               return TheirAdd->hashSignature() == OurAdd->hashSignature();
             }),
         OurAdded.end());
@@ -615,7 +608,7 @@ std::vector<std::shared_ptr<SemanticNode>> GraphMerger::removeDuplicates(
 
 std::optional<GraphMerger::NeighborTuple>
 GraphMerger::getNeighbors(const RCSemanticNode &Node) const {
-  if (auto NodeParent = Node->Parent.lock()) {
+  if (SemanticNode *NodeParent = Node->Parent) {
     RCSemanticNode PrevSibling = nullptr, NextSibling = nullptr;
 
     auto Pos =
@@ -628,7 +621,7 @@ GraphMerger::getNeighbors(const RCSemanticNode &Node) const {
     auto ItBefore = Pos;
     while (ItBefore != NodeParent->Children.begin()) {
       --ItBefore;
-      if (!llvm::isa<OrphanCommentNode>(ItBefore->get())) {
+      if (!llvm::isa<OrphanCommentNode>(*ItBefore)) {
         PrevSibling = *ItBefore;
         break;
       }
@@ -637,7 +630,7 @@ GraphMerger::getNeighbors(const RCSemanticNode &Node) const {
     auto ItAfter = Pos;
     while (ItAfter != NodeParent->Children.end() - 1) {
       ++ItAfter;
-      if (!llvm::isa<OrphanCommentNode>(ItAfter->get())) {
+      if (!llvm::isa<OrphanCommentNode>(*ItAfter)) {
         NextSibling = *ItAfter;
         break;
       }
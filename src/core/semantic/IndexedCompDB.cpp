@@ -0,0 +1,413 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/semantic/IndexedCompDB.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/StringSaver.h>
+#include <spdlog/spdlog.h>
+#include <type_traits>
+#include <unistd.h>
+
+#include "mergebot/filesystem.h"
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+constexpr char IndexMagic[8] = {'M', 'B', 'C', 'D', 'B', 'I', '0', '1'};
+
+/// characters that change the state of the scanner, everything else is
+/// skipped without branching on its value
+constexpr std::array<bool, 256> makeStructuralTable() {
+  std::array<bool, 256> Table{};
+  for (unsigned char C : {'"', '[', ']', '{', '}', ',', ':'}) {
+    Table[C] = true;
+  }
+  return Table;
+}
+constexpr std::array<bool, 256> IsStructural = makeStructuralTable();
+
+/// \return the unescaped closing quote of a JSON string starting at P, or
+/// nullptr if the string is not terminated
+const char *findClosingQuote(const char *P, const char *End) {
+  while (P < End) {
+    // strings make up most of a CompDB, memchr skips them vectorized
+    const char *Quote =
+        static_cast<const char *>(std::memchr(P, '"', End - P));
+    if (!Quote) {
+      return nullptr;
+    }
+    size_t Backslashes = 0;
+    for (const char *Q = Quote; Q > P && *(Q - 1) == '\\'; --Q) {
+      ++Backslashes;
+    }
+    if (Backslashes % 2 == 0) {
+      return Quote;
+    }
+    P = Quote + 1;
+  }
+  return nullptr;
+}
+
+template <typename T> void writePOD(std::ofstream &Out, const T &Value) {
+  Out.write(reinterpret_cast<const char *>(&Value), sizeof(T));
+}
+
+template <typename T> bool readPOD(std::ifstream &In, T &Value) {
+  return static_cast<bool>(
+      In.read(reinterpret_cast<char *>(&Value), sizeof(T)));
+}
+} // namespace detail
+
+std::unique_ptr<IndexedCompDB>
+IndexedCompDB::load(const std::string &CompDBPath, const std::string &IndexPath,
+                    std::string &ErrMsg) {
+  std::error_code EC;
+  const uint64_t Size = fs::file_size(CompDBPath, EC);
+  const int64_t MTime =
+      EC ? 0
+         : fs::last_write_time(CompDBPath, EC).time_since_epoch().count();
+  if (EC) {
+    ErrMsg = "cannot stat " + CompDBPath + ": " + EC.message();
+    return nullptr;
+  }
+
+  // mmap-ed for any CompDB worth indexing
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+      llvm::MemoryBuffer::getFile(CompDBPath, /*IsText=*/false,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr) {
+    ErrMsg = "cannot open " + CompDBPath + ": " +
+             BufferOrErr.getError().message();
+    return nullptr;
+  }
+  std::unique_ptr<IndexedCompDB> CompDB(
+      new IndexedCompDB(CompDBPath, std::move(BufferOrErr.get())));
+
+  if (!IndexPath.empty() && CompDB->readIndex(IndexPath, Size, MTime)) {
+    spdlog::debug("reuse index {} of CompDB {}", IndexPath, CompDBPath);
+    return CompDB;
+  }
+
+  if (!CompDB->scan(ErrMsg)) {
+    ErrMsg = "malformed CompDB " + CompDBPath + ": " + ErrMsg;
+    return nullptr;
+  }
+  if (!IndexPath.empty() && !CompDB->writeIndex(IndexPath, Size, MTime)) {
+    spdlog::warn("fail to persist index of CompDB {} to {}", CompDBPath,
+                 IndexPath);
+  }
+  spdlog::info("CompDB {} indexed, {} entries", CompDBPath, CompDB->size());
+  return CompDB;
+}
+
+std::string IndexedCompDB::normalize(llvm::StringRef Directory,
+                                     llvm::StringRef File) {
+  llvm::SmallString<256> Path;
+  if (llvm::sys::path::is_absolute(File)) {
+    Path = File;
+  } else {
+    Path = Directory;
+    llvm::sys::path::append(Path, File);
+  }
+  llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  llvm::sys::path::native(Path);
+  return std::string(Path.str());
+}
+
+bool IndexedCompDB::scan(std::string &ErrMsg) {
+  const char *const Begin = Buffer_->getBufferStart();
+  const char *const End = Buffer_->getBufferEnd();
+  const char *P = Begin;
+
+  // the CompDB is an array (depth 1) of entries (depth 2), only keys and
+  // values of "file" and "directory" at depth 2 are of interest
+  int Depth = 0;
+  bool ExpectKey = false;
+  std::string_view Key;
+  std::string_view Directory;
+  std::string_view File;
+  bool Escaped = false;
+  const char *EntryBegin = nullptr;
+
+  while (P < End) {
+    while (P < End && !detail::IsStructural[static_cast<unsigned char>(*P)]) {
+      ++P;
+    }
+    if (P == End) {
+      break;
+    }
+
+    if (*P == '"') {
+      const char *Close = detail::findClosingQuote(P + 1, End);
+      if (!Close) {
+        ErrMsg = "unterminated string at offset " + std::to_string(P - Begin);
+        return false;
+      }
+      if (Depth == 2) {
+        std::string_view Str(P + 1, Close - P - 1);
+        if (ExpectKey) {
+          Key = Str;
+        } else if (Key == "file" || Key == "directory") {
+          (Key == "file" ? File : Directory) = Str;
+          Escaped |= Str.find('\\') != std::string_view::npos;
+        }
+      }
+      P = Close + 1;
+      continue;
+    }
+
+    switch (*P) {
+    case '[':
+    case '{':
+      ++Depth;
+      if (*P == '{' && Depth == 2) {
+        EntryBegin = P;
+        ExpectKey = true;
+        Directory = File = std::string_view();
+        Escaped = false;
+      }
+      break;
+    case ']':
+    case '}':
+      if (Depth == 0) {
+        ErrMsg = "unbalanced brackets at offset " + std::to_string(P - Begin);
+        return false;
+      }
+      if (*P == '}' && Depth == 2) {
+        const uint64_t Offset = EntryBegin - Begin;
+        const uint64_t Length = P + 1 - EntryBegin;
+        if (Escaped) {
+          // rare, leave unescaping to the real parser
+          clang::tooling::CompileCommand Cmd;
+          Record R{0, 0, Offset, Length};
+          if (!parseEntry(R, Cmd)) {
+            ErrMsg = "bad entry at offset " + std::to_string(Offset);
+            return false;
+          }
+          addRecord(Cmd.Filename, Offset, Length);
+        } else {
+          if (File.empty()) {
+            ErrMsg = "no file in entry at offset " + std::to_string(Offset);
+            return false;
+          }
+          addRecord(
+              normalize(llvm::StringRef(Directory.data(), Directory.size()),
+                        llvm::StringRef(File.data(), File.size())),
+              Offset, Length);
+        }
+      }
+      --Depth;
+      break;
+    case ',':
+      if (Depth == 2) {
+        ExpectKey = true;
+      }
+      break;
+    case ':':
+      if (Depth == 2) {
+        ExpectKey = false;
+      }
+      break;
+    default:
+      break;
+    }
+    ++P;
+  }
+
+  if (Depth != 0) {
+    ErrMsg = "unexpected end of file";
+    return false;
+  }
+  sortRecords();
+  return true;
+}
+
+void IndexedCompDB::addRecord(std::string_view Path, uint64_t Offset,
+                              uint64_t Length) {
+  Records_.push_back({static_cast<uint32_t>(PathPool_.size()),
+                      static_cast<uint32_t>(Path.size()), Offset, Length});
+  PathPool_.append(Path);
+}
+
+void IndexedCompDB::sortRecords() {
+  std::stable_sort(Records_.begin(), Records_.end(),
+                   [this](const Record &Lhs, const Record &Rhs) {
+                     return pathOf(Lhs) < pathOf(Rhs);
+                   });
+}
+
+bool IndexedCompDB::writeIndex(const std::string &IndexPath, uint64_t Size,
+                               int64_t MTime) const {
+  std::error_code EC;
+  fs::create_directories(fs::path(IndexPath).parent_path(), EC);
+  // write aside and rename, so that concurrent loaders never see a partial
+  // index
+  const std::string TmpPath =
+      IndexPath + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream Out(TmpPath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+      return false;
+    }
+    Out.write(detail::IndexMagic, sizeof(detail::IndexMagic));
+    detail::writePOD(Out, Size);
+    detail::writePOD(Out, MTime);
+    detail::writePOD(Out, static_cast<uint64_t>(CompDBPath_.size()));
+    Out.write(CompDBPath_.data(), CompDBPath_.size());
+    detail::writePOD(Out, static_cast<uint64_t>(PathPool_.size()));
+    Out.write(PathPool_.data(), PathPool_.size());
+    detail::writePOD(Out, static_cast<uint64_t>(Records_.size()));
+    Out.write(reinterpret_cast<const char *>(Records_.data()),
+              Records_.size() * sizeof(Record));
+    if (!Out) {
+      fs::remove(TmpPath, EC);
+      return false;
+    }
+  }
+  fs::rename(TmpPath, IndexPath, EC);
+  if (EC) {
+    fs::remove(TmpPath, EC);
+    return false;
+  }
+  return true;
+}
+
+bool IndexedCompDB::readIndex(const std::string &IndexPath, uint64_t Size,
+                              int64_t MTime) {
+  std::ifstream In(IndexPath, std::ios::binary);
+  if (!In) {
+    return false;
+  }
+  char Magic[sizeof(detail::IndexMagic)];
+  uint64_t IndexedSize = 0;
+  int64_t IndexedMTime = 0;
+  uint64_t SourceLength = 0;
+  if (!In.read(Magic, sizeof(Magic)) ||
+      std::memcmp(Magic, detail::IndexMagic, sizeof(Magic)) != 0 ||
+      !detail::readPOD(In, IndexedSize) || !detail::readPOD(In, IndexedMTime) ||
+      IndexedSize != Size || IndexedMTime != MTime ||
+      !detail::readPOD(In, SourceLength) ||
+      SourceLength != CompDBPath_.size()) {
+    return false;
+  }
+  std::string Source(SourceLength, '\0');
+  if (!In.read(Source.data(), SourceLength) || Source != CompDBPath_) {
+    return false;
+  }
+
+  uint64_t PoolSize = 0;
+  uint64_t Count = 0;
+  std::string PathPool;
+  std::vector<Record> Records;
+  if (!detail::readPOD(In, PoolSize)) {
+    return false;
+  }
+  PathPool.resize(PoolSize);
+  if (!In.read(PathPool.data(), PoolSize) || !detail::readPOD(In, Count)) {
+    return false;
+  }
+  Records.resize(Count);
+  if (!In.read(reinterpret_cast<char *>(Records.data()),
+               Count * sizeof(Record))) {
+    return false;
+  }
+  const uint64_t BufferSize = Buffer_->getBufferSize();
+  for (const Record &R : Records) {
+    if (uint64_t(R.PathOffset) + R.PathLength > PoolSize ||
+        R.Offset + R.Length > BufferSize) {
+      return false;
+    }
+  }
+  PathPool_ = std::move(PathPool);
+  Records_ = std::move(Records);
+  return true;
+}
+
+bool IndexedCompDB::parseEntry(const Record &R,
+                               clang::tooling::CompileCommand &Cmd) const {
+  llvm::Expected<llvm::json::Value> Entry = llvm::json::parse(
+      llvm::StringRef(Buffer_->getBufferStart() + R.Offset, R.Length));
+  if (!Entry) {
+    spdlog::warn("fail to parse entry at offset {} of CompDB {}: {}", R.Offset,
+                 CompDBPath_, llvm::toString(Entry.takeError()));
+    return false;
+  }
+  const llvm::json::Object *Obj = Entry->getAsObject();
+  if (!Obj) {
+    return false;
+  }
+  const llvm::Optional<llvm::StringRef> Directory =
+      Obj->getString("directory");
+  const llvm::Optional<llvm::StringRef> File = Obj->getString("file");
+  if (!Directory || !File) {
+    return false;
+  }
+  Cmd.Directory = Directory->str();
+  Cmd.Filename = normalize(*Directory, *File);
+  if (llvm::Optional<llvm::StringRef> Output = Obj->getString("output")) {
+    Cmd.Output = Output->str();
+  }
+
+  if (const llvm::json::Array *Arguments = Obj->getArray("arguments")) {
+    for (const llvm::json::Value &Argument : *Arguments) {
+      if (llvm::Optional<llvm::StringRef> Arg = Argument.getAsString()) {
+        Cmd.CommandLine.push_back(Arg->str());
+      }
+    }
+  } else if (llvm::Optional<llvm::StringRef> Command =
+                 Obj->getString("command")) {
+    llvm::BumpPtrAllocator Alloc;
+    llvm::StringSaver Saver(Alloc);
+    llvm::SmallVector<const char *, 64> Argv;
+    llvm::cl::TokenizeGNUCommandLine(*Command, Saver, Argv);
+    Cmd.CommandLine.assign(Argv.begin(), Argv.end());
+  }
+  return !Cmd.CommandLine.empty();
+}
+
+std::vector<clang::tooling::CompileCommand>
+IndexedCompDB::getCompileCommands(llvm::StringRef FilePath) const {
+  const std::string Key = normalize("", FilePath);
+  auto [First, Last] = std::equal_range(
+      Records_.begin(), Records_.end(), std::string_view(Key),
+      [this](const auto &Lhs, const auto &Rhs) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(Lhs)>, Record>) {
+          return pathOf(Lhs) < Rhs;
+        } else {
+          return Lhs < pathOf(Rhs);
+        }
+      });
+
+  std::vector<clang::tooling::CompileCommand> Commands;
+  for (auto It = First; It != Last; ++It) {
+    clang::tooling::CompileCommand Cmd;
+    if (parseEntry(*It, Cmd)) {
+      Commands.push_back(std::move(Cmd));
+    }
+  }
+  return Commands;
+}
+
+std::vector<std::string> IndexedCompDB::getAllFiles() const {
+  std::vector<std::string> Files;
+  Files.reserve(Records_.size());
+  for (const Record &R : Records_) {
+    std::string_view Path = pathOf(R);
+    if (Files.empty() || Files.back() != Path) {
+      Files.emplace_back(Path);
+    }
+  }
+  return Files;
+}
+} // namespace sa
+} // namespace mergebot
@@ -0,0 +1,189 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/semantic/RemappedCompDB.h"
+
+#include <algorithm>
+#include <cctype>
+#include <clang/Tooling/JSONCompilationDatabase.h>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+
+#include "mergebot/core/semantic/IndexedCompDB.h"
+#include "mergebot/filesystem.h"
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+/// CompDBs of different projects kept in memory at the same time
+constexpr size_t CompDBCacheCapacity = 4;
+
+struct CachedCompDB {
+  fs::file_time_type MTime;
+  uint64_t LastAccess = 0;
+  std::shared_ptr<clang::tooling::CompilationDatabase> CompDB;
+};
+
+bool isPathChar(char C) {
+  return std::isalnum(static_cast<unsigned char>(C)) || C == '_' || C == '-' ||
+         C == '.' || C == '+' || C == '@' || C == '~';
+}
+} // namespace detail
+
+RemappedCompDB::RemappedCompDB(
+    std::shared_ptr<clang::tooling::CompilationDatabase> Base, std::string From,
+    std::string To)
+    : Base_(std::move(Base)), From_(std::move(From)), To_(std::move(To)) {
+  // remove trailing separator if it has
+  for (std::string *Path : {&From_, &To_}) {
+    while (Path->size() > 1 && Path->back() == fs::path::preferred_separator) {
+      Path->pop_back();
+    }
+  }
+}
+
+std::shared_ptr<clang::tooling::CompilationDatabase>
+RemappedCompDB::loadShared(const std::string &CompDBPath,
+                           const std::string &IndexDir, std::string &ErrMsg) {
+  static std::mutex Mutex;
+  static std::unordered_map<std::string, detail::CachedCompDB> Cache;
+  static uint64_t Clock = 0;
+
+  std::error_code EC;
+  const fs::file_time_type MTime = fs::last_write_time(CompDBPath, EC);
+  if (EC) {
+    ErrMsg = "cannot stat CompDB " + CompDBPath + ": " + EC.message();
+    return nullptr;
+  }
+
+  // load under the lock, so that concurrent scenarios of a project parse a
+  // huge CompDB only once
+  std::lock_guard<std::mutex> Lock(Mutex);
+  if (auto It = Cache.find(CompDBPath);
+      It != Cache.end() && It->second.MTime == MTime) {
+    It->second.LastAccess = ++Clock;
+    return It->second.CompDB;
+  }
+
+  // only commands of a few dozen files are ever asked for, so entries are
+  // parsed lazily through a persisted index. Fall back to the eager loader
+  // if the CompDB is something the index scanner doesn't understand
+  std::unique_ptr<clang::tooling::CompilationDatabase> Loaded =
+      IndexedCompDB::load(
+          CompDBPath,
+          IndexDir.empty()
+              ? ""
+              : (fs::path(IndexDir) / "compile_commands.idx").string(),
+          ErrMsg);
+  if (!Loaded) {
+    spdlog::warn("fail to index CompDB: {}, load it eagerly", ErrMsg);
+    ErrMsg.clear();
+    Loaded = clang::tooling::JSONCompilationDatabase::loadFromFile(
+        CompDBPath, ErrMsg, clang::tooling::JSONCommandLineSyntax::AutoDetect);
+  }
+  if (!Loaded || !ErrMsg.empty()) {
+    return nullptr;
+  }
+  std::shared_ptr<clang::tooling::CompilationDatabase> CompDB =
+      clang::tooling::inferMissingCompileCommands(std::move(Loaded));
+
+  if (Cache.size() >= detail::CompDBCacheCapacity && !Cache.count(CompDBPath)) {
+    auto Victim = std::min_element(Cache.begin(), Cache.end(),
+                                   [](const auto &Lhs, const auto &Rhs) {
+                                     return Lhs.second.LastAccess <
+                                            Rhs.second.LastAccess;
+                                   });
+    spdlog::debug("evict CompDB {} from memory", Victim->first);
+    Cache.erase(Victim);
+  }
+  Cache[CompDBPath] = detail::CachedCompDB{MTime, ++Clock, CompDB};
+  spdlog::info("CompDB {} loaded and cached", CompDBPath);
+  return CompDB;
+}
+
+std::string RemappedCompDB::locate(const std::string &ProjectPath,
+                                   const std::string &CDBPath) {
+  if (fs::exists(fs::path(ProjectPath) / "compile_commands.json")) {
+    // project-root
+    return (fs::path(ProjectPath) / "compile_commands.json").string();
+  } else if (fs::exists(fs::path(ProjectPath) / "build" /
+                        "compile_commands.json")) {
+    // project-root/build
+    return (fs::path(ProjectPath) / "build" / "compile_commands.json")
+        .string();
+  } else if (!CDBPath.empty() && fs::exists(CDBPath)) {
+    // specific location
+    return CDBPath;
+  }
+  return "";
+}
+
+std::string RemappedCompDB::remap(llvm::StringRef S, llvm::StringRef From,
+                                  llvm::StringRef To) {
+  if (From.empty()) {
+    return S.str();
+  }
+  std::string Result;
+  Result.reserve(S.size());
+  size_t Pos = 0;
+  while (true) {
+    size_t Found = S.find(From, Pos);
+    if (Found == llvm::StringRef::npos) {
+      break;
+    }
+    const size_t End = Found + From.size();
+    // /path/to/proj shouldn't hit /path/to/project
+    if (End < S.size() && detail::isPathChar(S[End])) {
+      Result.append(S.begin() + Pos, S.begin() + End);
+    } else {
+      Result.append(S.begin() + Pos, S.begin() + Found);
+      Result.append(To.begin(), To.end());
+    }
+    Pos = End;
+  }
+  Result.append(S.begin() + Pos, S.end());
+  return Result;
+}
+
+clang::tooling::CompileCommand
+RemappedCompDB::remapCommand(clang::tooling::CompileCommand Cmd) const {
+  Cmd.Directory = remap(Cmd.Directory, From_, To_);
+  Cmd.Filename = remap(Cmd.Filename, From_, To_);
+  Cmd.Output = remap(Cmd.Output, From_, To_);
+  for (std::string &Arg : Cmd.CommandLine) {
+    Arg = remap(Arg, From_, To_);
+  }
+  return Cmd;
+}
+
+std::vector<clang::tooling::CompileCommand>
+RemappedCompDB::getCompileCommands(llvm::StringRef FilePath) const {
+  std::vector<clang::tooling::CompileCommand> Commands =
+      Base_->getCompileCommands(remap(FilePath, To_, From_));
+  for (clang::tooling::CompileCommand &Cmd : Commands) {
+    Cmd = remapCommand(std::move(Cmd));
+  }
+  return Commands;
+}
+
+std::vector<std::string> RemappedCompDB::getAllFiles() const {
+  std::vector<std::string> Files = Base_->getAllFiles();
+  for (std::string &File : Files) {
+    File = remap(File, From_, To_);
+  }
+  return Files;
+}
+
+std::vector<clang::tooling::CompileCommand>
+RemappedCompDB::getAllCompileCommands() const {
+  std::vector<clang::tooling::CompileCommand> Commands =
+      Base_->getAllCompileCommands();
+  for (clang::tooling::CompileCommand &Cmd : Commands) {
+    Cmd = remapCommand(std::move(Cmd));
+  }
+  return Commands;
+}
+} // namespace sa
+} // namespace mergebot
@@ -205,6 +205,9 @@ void SourceCollectorV2::extendIncludedSources(Side S) {
   fs::path SourceDir =
       fs::path(Meta.ProjectCacheDir) / Meta.MS.name / magic_enum::enum_name(S);
 
+  // the header search of clang needs sources and their includes on disk
+  Meta.materialize(S, SourceList);
+
   std::vector<std::string> SourcePaths;
   SourcePaths.reserve(SourceList.size());
 
@@ -0,0 +1,211 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/semantic/SymbolCache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <utility>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/core/sa_utility.h"
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+constexpr char SymbolCacheMagic[8] = {'M', 'B', 'S', 'Y', 'M', 'C', '0', '1'};
+
+template <typename T> void writeField(std::ostream &Out, const T &Value) {
+  Out.write(reinterpret_cast<const char *>(&Value), sizeof(T));
+}
+
+template <typename T> bool readField(std::istream &In, T &Value) {
+  return static_cast<bool>(
+      In.read(reinterpret_cast<char *>(&Value), sizeof(T)));
+}
+} // namespace detail
+
+size_t SymbolCache::KeyHash::operator()(const Key &K) const noexcept {
+  size_t H = 0;
+  mergebot::hash_combine(H, K.ContentHash);
+  mergebot::hash_combine(H, K.ContextHash);
+  mergebot::hash_combine(H, K.Line);
+  mergebot::hash_combine(H, K.Column);
+  mergebot::hash_combine(H, static_cast<uint8_t>(K.M));
+  return H;
+}
+
+bool SymbolCache::persistent() {
+  const char *Env = std::getenv("MERGEBOT_SYMBOL_CACHE_PERSIST");
+  return Env && *Env && strcmp(Env, "0") != 0;
+}
+
+std::shared_ptr<SymbolCache> SymbolCache::open(std::string Path) {
+  std::shared_ptr<SymbolCache> Cache(new SymbolCache(std::move(Path)));
+  if (!Cache->Path_.empty()) {
+    Cache->load();
+  }
+  return Cache;
+}
+
+void SymbolCache::load() {
+  std::ifstream In(Path_, std::ios::binary);
+  if (!In) {
+    return;
+  }
+  char Magic[sizeof(detail::SymbolCacheMagic)];
+  uint64_t Count = 0;
+  if (!In.read(Magic, sizeof(Magic)) ||
+      memcmp(Magic, detail::SymbolCacheMagic, sizeof(Magic)) != 0 ||
+      !detail::readField(In, Count)) {
+    spdlog::warn("symbol cache {} is malformed, ignore it", Path_);
+    return;
+  }
+
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  for (uint64_t I = 0; I < Count; ++I) {
+    Key K;
+    uint8_t M = 0;
+    uint32_t Length = 0;
+    if (!detail::readField(In, K.ContentHash) ||
+        !detail::readField(In, K.ContextHash) ||
+        !detail::readField(In, K.Line) || !detail::readField(In, K.Column) ||
+        !detail::readField(In, M) || !detail::readField(In, Length)) {
+      break;
+    }
+    std::string Dumped(Length, '\0');
+    if (!In.read(Dumped.data(), Length)) {
+      break;
+    }
+    nlohmann::json Value = nlohmann::json::parse(Dumped, nullptr, false);
+    if (Value.is_discarded()) {
+      continue;
+    }
+    K.M = static_cast<Method>(M);
+    // saved by versions sharing references
+    if (!shareable(K.M)) {
+      continue;
+    }
+    std::promise<Result> Promise;
+    Promise.set_value(std::move(Value));
+    Entries_[K] = Entry{Promise.get_future().share(), nullptr};
+  }
+  spdlog::debug("{} symbol results loaded from {}", Entries_.size(), Path_);
+}
+
+bool SymbolCache::save() const {
+  if (Path_.empty()) {
+    return true;
+  }
+  std::error_code EC;
+  fs::create_directories(fs::path(Path_).parent_path(), EC);
+  // write aside and rename, so that concurrent scenarios of the project never
+  // see a partial cache
+  const std::string TmpPath = Path_ + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream Out(TmpPath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+      return false;
+    }
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    Out.write(detail::SymbolCacheMagic, sizeof(detail::SymbolCacheMagic));
+    const std::streampos CountPos = Out.tellp();
+    uint64_t Count = 0;
+    detail::writeField(Out, Count);
+    for (const auto &[K, E] : Entries_) {
+      // failures are not worth remembering across runs
+      if (E.Promise || !E.Future.get().has_value()) {
+        continue;
+      }
+      const std::string Dumped = E.Future.get()->dump();
+      detail::writeField(Out, K.ContentHash);
+      detail::writeField(Out, K.ContextHash);
+      detail::writeField(Out, K.Line);
+      detail::writeField(Out, K.Column);
+      detail::writeField(Out, static_cast<uint8_t>(K.M));
+      detail::writeField(Out, static_cast<uint32_t>(Dumped.size()));
+      Out.write(Dumped.data(), Dumped.size());
+      ++Count;
+    }
+    Out.seekp(CountPos);
+    detail::writeField(Out, Count);
+    if (!Out) {
+      fs::remove(TmpPath, EC);
+      return false;
+    }
+  }
+  fs::rename(TmpPath, Path_, EC);
+  if (EC) {
+    fs::remove(TmpPath, EC);
+    return false;
+  }
+  return true;
+}
+
+std::shared_future<SymbolCache::Result>
+SymbolCache::acquire(const Key &K, bool &Claimed) {
+  if (!shareable(K.M)) {
+    Claimed = true;
+    ++Misses_;
+    return {};
+  }
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  auto [It, Inserted] = Entries_.try_emplace(K);
+  Claimed = Inserted;
+  if (Inserted) {
+    ++Misses_;
+    It->second.Promise = std::make_shared<std::promise<Result>>();
+    It->second.Future = It->second.Promise->get_future().share();
+  } else {
+    ++Hits_;
+  }
+  return It->second.Future;
+}
+
+void SymbolCache::fulfill(const Key &K, Result R) {
+  std::shared_ptr<std::promise<Result>> Promise;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex_);
+    auto It = Entries_.find(K);
+    if (It == Entries_.end() || !It->second.Promise) {
+      return;
+    }
+    Promise = std::move(It->second.Promise);
+  }
+  Promise->set_value(std::move(R));
+}
+
+SymbolCache::Claim &SymbolCache::Claim::operator=(Claim &&Other) noexcept {
+  if (this != &Other) {
+    release();
+    Cache_ = Other.Cache_;
+    K_ = Other.K_;
+    Other.Cache_ = nullptr;
+  }
+  return *this;
+}
+
+void SymbolCache::Claim::fulfill(Result R) {
+  if (SymbolCache *Cache = std::exchange(Cache_, nullptr)) {
+    Cache->fulfill(K_, std::move(R));
+  }
+}
+
+void SymbolCache::Claim::release() noexcept {
+  try {
+    fulfill(std::nullopt);
+  } catch (...) {
+    // never throw out of a destructor
+  }
+}
+
+size_t SymbolCache::size() const {
+  std::lock_guard<std::mutex> Lock(Mutex_);
+  return Entries_.size();
+}
+} // namespace sa
+} // namespace mergebot
@@ -0,0 +1,270 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/core/semantic/SymbolIndex.h"
+
+#include <algorithm>
+#include <clang/AST/Decl.h>
+#include <clang/AST/DeclBase.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Index/IndexDataConsumer.h>
+#include <clang/Index/IndexSymbol.h>
+#include <clang/Index/IndexingAction.h>
+#include <clang/Index/USRGeneration.h>
+#include <clang/Lex/Lexer.h>
+#include <clang/Tooling/Tooling.h>
+#include <cstdlib>
+#include <cstring>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Path.h>
+#include <mutex>
+#include <oneapi/tbb/parallel_for.h>
+#include <spdlog/spdlog.h>
+#include <tuple>
+
+namespace mergebot {
+namespace sa {
+namespace detail {
+/// what the indexer sees in one translation unit
+struct IndexShard {
+  struct Occurrence {
+    std::string File;
+    unsigned Line;
+    unsigned Column;
+    unsigned Length;
+    bool IsDecl;
+    SymbolIndex::Symbol Sym;
+  };
+  struct Reference {
+    std::string USR;
+    std::string Container;
+  };
+
+  std::vector<Occurrence> Occurrences;
+  std::vector<Reference> References;
+};
+
+/// qualified name of the closest named declaration containing an occurrence
+std::string containerOf(const clang::index::IndexDataConsumer::ASTNodeInfo
+                            &ASTNode) {
+  if (const auto *ND =
+          llvm::dyn_cast_or_null<clang::NamedDecl>(ASTNode.Parent)) {
+    return ND->getQualifiedNameAsString();
+  }
+  for (const clang::DeclContext *DC = ASTNode.ContainerDC; DC;
+       DC = DC->getParent()) {
+    if (const auto *ND = llvm::dyn_cast<clang::NamedDecl>(DC)) {
+      return ND->getQualifiedNameAsString();
+    }
+  }
+  return "";
+}
+
+class ShardConsumer : public clang::index::IndexDataConsumer {
+public:
+  ShardConsumer(IndexShard &Shard, std::string Root)
+      : Shard(Shard), Root(std::move(Root)) {}
+
+  void initialize(clang::ASTContext &Ctx) override { this->Ctx = &Ctx; }
+
+  bool handleDeclOccurrence(const clang::Decl *D,
+                            clang::index::SymbolRoleSet Roles,
+                            llvm::ArrayRef<clang::index::SymbolRelation>,
+                            clang::SourceLocation Loc,
+                            ASTNodeInfo ASTNode) override {
+    const auto *ND = llvm::dyn_cast_or_null<clang::NamedDecl>(D);
+    // occurrences spelled in macros are left to clangd
+    if (!ND || !Ctx || Loc.isInvalid() || Loc.isMacroID()) {
+      return true;
+    }
+    const clang::SourceManager &SM = Ctx->getSourceManager();
+    std::string File = SymbolIndex::normalize(SM.getFilename(Loc));
+    if (!llvm::StringRef(File).startswith(Root)) {
+      return true;
+    }
+
+    llvm::SmallString<128> USR;
+    if (clang::index::generateUSRForDecl(ND, USR)) {
+      return true;
+    }
+
+    using clang::index::SymbolRole;
+    const bool IsDecl =
+        Roles & (static_cast<clang::index::SymbolRoleSet>(
+                     SymbolRole::Declaration) |
+                 static_cast<clang::index::SymbolRoleSet>(
+                     SymbolRole::Definition));
+    if (!IsDecl &&
+        (Roles & static_cast<clang::index::SymbolRoleSet>(
+                     SymbolRole::Reference))) {
+      std::string Container = containerOf(ASTNode);
+      if (!Container.empty()) {
+        Shard.References.push_back({std::string(USR), std::move(Container)});
+      }
+    }
+
+    SymbolIndex::Symbol Sym;
+    Sym.USR = std::string(USR);
+    Sym.Name = ND->getNameAsString();
+    std::string QualifiedName = ND->getQualifiedNameAsString();
+    if (QualifiedName.size() > Sym.Name.size() &&
+        llvm::StringRef(QualifiedName).endswith(Sym.Name)) {
+      Sym.ContainerName =
+          QualifiedName.substr(0, QualifiedName.size() - Sym.Name.size());
+    }
+    Shard.Occurrences.push_back(
+        {std::move(File), SM.getSpellingLineNumber(Loc) - 1,
+         SM.getSpellingColumnNumber(Loc) - 1,
+         clang::Lexer::MeasureTokenLength(Loc, SM, Ctx->getLangOpts()), IsDecl,
+         std::move(Sym)});
+    return true;
+  }
+
+private:
+  IndexShard &Shard;
+  std::string Root;
+  clang::ASTContext *Ctx = nullptr;
+};
+
+class IndexActionFactory : public clang::tooling::FrontendActionFactory {
+public:
+  IndexActionFactory(IndexShard &Shard, std::string Root)
+      : Shard(Shard), Root(std::move(Root)) {}
+
+  std::unique_ptr<clang::FrontendAction> create() override {
+    clang::index::IndexingOptions Opts;
+    Opts.SystemSymbolFilter =
+        clang::index::IndexingOptions::SystemSymbolFilterKind::None;
+    Opts.IndexFunctionLocals = false;
+    Opts.IndexImplicitInstantiation = false;
+    return clang::index::createIndexingAction(
+        std::make_shared<ShardConsumer>(Shard, Root), Opts);
+  }
+
+private:
+  IndexShard &Shard;
+  std::string Root;
+};
+} // namespace detail
+
+bool SymbolIndex::enabled() {
+  const char *Env = std::getenv("MERGEBOT_INPROCESS_INDEX");
+  return Env && *Env && strcmp(Env, "0") != 0;
+}
+
+std::string SymbolIndex::normalize(llvm::StringRef File) {
+  llvm::SmallString<256> Path(File);
+  llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  return std::string(Path);
+}
+
+std::unique_ptr<SymbolIndex>
+SymbolIndex::build(const clang::tooling::CompilationDatabase &CompDB,
+                   const std::vector<std::string> &Files,
+                   llvm::StringRef Root) {
+  std::unique_ptr<SymbolIndex> Index(new SymbolIndex());
+  std::string RootPrefix = normalize(Root);
+  if (!llvm::StringRef(RootPrefix).endswith("/")) {
+    RootPrefix.push_back('/');
+  }
+  std::mutex IndexMutex;
+
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, Files.size(), 1),
+      [&](const tbb::blocked_range<size_t> &R) {
+        for (size_t I = R.begin(); I != R.end(); ++I) {
+          detail::IndexShard Shard;
+          clang::tooling::ClangTool Tool(CompDB, Files[I]);
+          Tool.setPrintErrorMessage(false);
+          std::unique_ptr<clang::IgnoringDiagConsumer> DiagConsumer =
+              std::make_unique<clang::IgnoringDiagConsumer>();
+          Tool.setDiagnosticConsumer(DiagConsumer.get());
+          detail::IndexActionFactory Factory(Shard, RootPrefix);
+          if (Tool.run(&Factory) != 0) {
+            spdlog::debug("{} is not indexed completely", Files[I]);
+          }
+
+          std::lock_guard<std::mutex> Lock(IndexMutex);
+          Index->merge(Shard);
+        }
+      });
+
+  Index->finalize();
+  return Index;
+}
+
+void SymbolIndex::merge(detail::IndexShard &Shard) {
+  for (detail::IndexShard::Occurrence &Occ : Shard.Occurrences) {
+    auto [It, Inserted] = SymbolByUSR_.try_emplace(
+        Occ.Sym.USR, static_cast<uint32_t>(Symbols_.size()));
+    if (Inserted) {
+      Symbols_.push_back(std::move(Occ.Sym));
+    }
+    Occurrences_[Occ.File].push_back(
+        {Occ.Line, Occ.Column, Occ.Length, Occ.IsDecl, It->second});
+  }
+  for (detail::IndexShard::Reference &Ref : Shard.References) {
+    References_[Ref.USR].push_back(std::move(Ref.Container));
+  }
+}
+
+void SymbolIndex::finalize() {
+  // headers are seen by every translation unit including them
+  for (auto &Entry : Occurrences_) {
+    std::vector<Occurrence> &Occs = Entry.second;
+    std::sort(Occs.begin(), Occs.end(),
+              [](const Occurrence &Lhs, const Occurrence &Rhs) {
+                return std::tie(Lhs.Line, Lhs.Column, Rhs.IsDecl) <
+                       std::tie(Rhs.Line, Rhs.Column, Lhs.IsDecl);
+              });
+    Occs.erase(std::unique(Occs.begin(), Occs.end(),
+                           [](const Occurrence &Lhs, const Occurrence &Rhs) {
+                             return Lhs.Line == Rhs.Line &&
+                                    Lhs.Column == Rhs.Column;
+                           }),
+               Occs.end());
+  }
+  for (auto &Entry : References_) {
+    std::vector<std::string> &Containers = Entry.second;
+    std::sort(Containers.begin(), Containers.end());
+    Containers.erase(std::unique(Containers.begin(), Containers.end()),
+                     Containers.end());
+  }
+}
+
+const SymbolIndex::Symbol *SymbolIndex::lookup(llvm::StringRef File,
+                                               unsigned Line,
+                                               unsigned Column) const {
+  auto It = Occurrences_.find(normalize(File));
+  if (It == Occurrences_.end()) {
+    return nullptr;
+  }
+  const std::vector<Occurrence> &Occs = It->second;
+  // the last occurrence starting at or before the position
+  auto Next = std::upper_bound(
+      Occs.begin(), Occs.end(), std::make_pair(Line, Column),
+      [](const std::pair<unsigned, unsigned> &Pos, const Occurrence &Occ) {
+        return Pos < std::make_pair(Occ.Line, Occ.Column);
+      });
+  if (Next == Occs.begin()) {
+    return nullptr;
+  }
+  const Occurrence &Occ = *std::prev(Next);
+  if (Occ.Line != Line || Column >= Occ.Column + std::max(Occ.Length, 1u)) {
+    return nullptr;
+  }
+  return &Symbols_[Occ.SymbolIdx];
+}
+
+std::vector<std::string> SymbolIndex::references(llvm::StringRef USR) const {
+  auto It = References_.find(USR);
+  if (It == References_.end()) {
+    return {};
+  }
+  return It->second;
+}
+} // namespace sa
+} // namespace mergebot
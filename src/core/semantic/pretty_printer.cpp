@@ -120,28 +120,27 @@ std::string indentCodeLines(const std::string &str, int indent,
   return indentedStr;
 }
 
-std::string prettyPrintNode(const std::shared_ptr<SemanticNode> &Node) {
+std::string prettyPrintNode(SemanticNode *Node) {
   std::stringstream ss;
   int indent = Node->StartPoint.value_or(ts::Point{0, 0}).column;
   int collapseSpaceCnt = 0;
   std::string nodeStr;
 
-  if (llvm::isa<TerminalNode>(Node.get())) {
-    auto TerminalNodePtr = llvm::cast<TerminalNode>(Node.get());
+  if (llvm::isa<TerminalNode>(Node)) {
+    auto TerminalNodePtr = llvm::cast<TerminalNode>(Node);
     ss << Node->Comment;
-    if (llvm::isa<FuncDefNode>(Node.get()) ||
-        llvm::isa<FuncOperatorCastNode>(Node.get()) ||
-        llvm::isa<FuncSpecialMemberNode>(Node.get())) {
+    if (llvm::isa<FuncDefNode>(Node) || llvm::isa<FuncOperatorCastNode>(Node) ||
+        llvm::isa<FuncSpecialMemberNode>(Node)) {
       if (TerminalNodePtr->SigUnchanged) {
         ss << Node->OriginalSignature;
       } else {
-        if (auto FuncDef = llvm::dyn_cast<FuncDefNode>(Node.get())) {
+        if (auto FuncDef = llvm::dyn_cast<FuncDefNode>(Node)) {
           ss << printFuncDefNodeSignature(FuncDef);
         } else if (auto FuncCast =
-                       llvm::dyn_cast<FuncOperatorCastNode>(Node.get())) {
+                       llvm::dyn_cast<FuncOperatorCastNode>(Node)) {
           ss << printFuncOperatorCastSignature(FuncCast);
         } else if (auto FuncSpecial =
-                       llvm::dyn_cast<FuncSpecialMemberNode>(Node.get())) {
+                       llvm::dyn_cast<FuncSpecialMemberNode>(Node)) {
           ss << printFuncSpecialMemberSignature(FuncSpecial);
         }
       }
@@ -156,9 +155,9 @@ std::string prettyPrintNode(const std::shared_ptr<SemanticNode> &Node) {
     }
   } else {
     // composite node
-    assert(llvm::isa<CompositeNode>(Node.get()));
-    auto CompositePtr = llvm::cast<CompositeNode>(Node.get());
-    if (!llvm::isa<TranslationUnitNode>(Node.get())) {
+    assert(llvm::isa<CompositeNode>(Node));
+    auto CompositePtr = llvm::cast<CompositeNode>(Node);
+    if (!llvm::isa<TranslationUnitNode>(Node)) {
       ss << Node->Comment;
       ss << Node->OriginalSignature << "{";
       for (int i = 0; i < CompositePtr->BeforeFirstChildEOL; ++i) {
@@ -177,10 +176,9 @@ std::string prettyPrintNode(const std::shared_ptr<SemanticNode> &Node) {
       }
       ss << "}";
 
-      if (auto NamespacePtr = llvm::dyn_cast<NamespaceNode>(Node.get())) {
+      if (auto NamespacePtr = llvm::dyn_cast<NamespaceNode>(Node)) {
         ss << " " + NamespacePtr->NSComment;
-      } else if (llvm::isa<TypeDeclNode>(Node.get()) ||
-                 llvm::isa<EnumNode>(Node.get())) {
+      } else if (llvm::isa<TypeDeclNode>(Node) || llvm::isa<EnumNode>(Node)) {
         ss << ";";
       }
 
@@ -203,10 +201,9 @@ std::string prettyPrintNode(const std::shared_ptr<SemanticNode> &Node) {
 }
 } // namespace details
 
-std::string PrettyPrintTU(const std::shared_ptr<SemanticNode> &TUNode,
-                          const std::string &DestDir) {
-  assert(llvm::isa<TranslationUnitNode>(TUNode.get()));
-  TranslationUnitNode *TURawPtr = llvm::cast<TranslationUnitNode>(TUNode.get());
+std::string PrettyPrintTU(SemanticNode *TUNode, const std::string &DestDir) {
+  assert(llvm::isa<TranslationUnitNode>(TUNode));
+  TranslationUnitNode *TURawPtr = llvm::cast<TranslationUnitNode>(TUNode);
   std::string DestFile = (fs::path(DestDir) / TURawPtr->DisplayName).string();
   fs::create_directories(fs::path(DestFile).parent_path());
 
@@ -240,11 +237,10 @@ std::string PrettyPrintTU(const std::shared_ptr<SemanticNode> &TUNode,
   return DestFile;
 }
 
-std::string PrettyPrintTU(const std::shared_ptr<SemanticNode> &TUNode,
-                          const std::string &DestDir,
+std::string PrettyPrintTU(SemanticNode *TUNode, const std::string &DestDir,
                           const std::string &ClangFormatPath) {
-  assert(llvm::isa<TranslationUnitNode>(TUNode.get()));
-  TranslationUnitNode *TURawPtr = llvm::cast<TranslationUnitNode>(TUNode.get());
+  assert(llvm::isa<TranslationUnitNode>(TUNode));
+  TranslationUnitNode *TURawPtr = llvm::cast<TranslationUnitNode>(TUNode);
   std::string DestFile = (fs::path(DestDir) / TURawPtr->DisplayName).string();
   fs::create_directories(fs::path(DestFile).parent_path());
 
@@ -4,7 +4,9 @@
 
 #include "mergebot/lsp/client.h"
 
-#include <shared_mutex>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
 
 #include "mergebot/lsp/protocol.h"
 
@@ -13,8 +15,7 @@ namespace lsp {
 ssize_t JSONRpcEndpoint::SendRequest(const RpcRequestBody& json) {
   std::string jsonStr = json.dump();
   std::string message = fillMessageHeader(jsonStr);
-  // obtain a unique_lock for writing
-  std::unique_lock<std::shared_mutex> lock(rwMutex);
+  std::lock_guard<std::mutex> lock(writeMutex);
 
   spdlog::debug("--> send request to server, message: {}", jsonStr);
   ssize_t bytesWritten = communicator->write(message);
@@ -29,26 +30,70 @@ ssize_t JSONRpcEndpoint::SendRequest(const RpcRequestBody& json) {
 
 std::optional<JSONRpcEndpoint::RpcResponseBody>
 JSONRpcEndpoint::RecvResponse() {
-  ssize_t bodySize = -1;
+  constexpr size_t ChunkSize = 1 << 16;
+  std::lock_guard<std::mutex> lock(readMutex);
   while (true) {
-    std::string line = readLine();
-    if (line.empty()) {
-      // empty pipe
-      return "";
+    bool malformed = false;
+    std::optional<std::string> msgContent = takeFrame(malformed);
+    if (malformed) {
+      return std::nullopt;
+    }
+    if (msgContent) {
+      spdlog::debug("<-- response received, content part is {}", *msgContent);
+      json msgBodyJSON = json::parse(*msgContent, nullptr, false);
+      if (msgBodyJSON.is_discarded()) {
+        spdlog::error(
+            "content part of response message is illegal: content is {}",
+            *msgContent);
+        return std::nullopt;
+      }
+      return msgBodyJSON;
+    }
+
+    // read everything available in one go, instead of a byte per syscall
+    const size_t oldSize = inbox.size();
+    inbox.resize(oldSize + ChunkSize);
+    errno = 0;
+    ssize_t bytesRead = communicator->read(&inbox[oldSize], ChunkSize);
+    inbox.resize(oldSize + std::max<ssize_t>(bytesRead, 0));
+    if (bytesRead > 0) {
+      continue;
     }
-    if (!util::ends_with(line, "\r\n")) {
-      // illegal message format
+    if (bytesRead == 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // empty pipe of a non-blocking Communicator
+        return RpcResponseBody();
+      }
+      spdlog::error("unexpected pipe closed, {} bytes left unframed",
+                    inbox.size() - inboxPos);
       return std::nullopt;
     }
+    if (errno == EINTR) {
+      return RpcResponseBody();
+    }
+    spdlog::error("unexpected error occurred: error message: {}",
+                  strerror(errno));
+    return std::nullopt;
+  }
+}
 
-    line = line.substr(0, line.size() - 2);
-    if (line.empty()) {
-      break;
-    } else if (util::starts_with(line, LEN_HEADER)) {
-      //      spdlog::debug("content-length line: {}", line);
-      line = line.substr(strlen(LEN_HEADER));
+std::optional<std::string> JSONRpcEndpoint::takeFrame(bool& malformed) {
+  std::string_view pending = std::string_view(inbox).substr(inboxPos);
+  const size_t headerEnd = pending.find("\r\n\r\n");
+  if (headerEnd == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  ssize_t bodySize = -1;
+  std::string_view headers = pending.substr(0, headerEnd + 2);
+  while (!headers.empty()) {
+    const size_t lineEnd = headers.find("\r\n");
+    std::string_view line = headers.substr(0, lineEnd);
+    headers.remove_prefix(lineEnd + 2);
+    if (util::starts_with(line, LEN_HEADER)) {
+      std::string len(line.substr(strlen(LEN_HEADER)));
       char* end;
-      bodySize = static_cast<ssize_t>(strtoll(line.c_str(), &end, 10));
+      bodySize = static_cast<ssize_t>(strtoll(len.c_str(), &end, 10));
     } else if (util::starts_with(line, TYPE_HEADER)) {
       spdlog::debug("content type line found: {}", line);
     } else {
@@ -57,19 +102,27 @@ JSONRpcEndpoint::RecvResponse() {
   }
 
   // illegal json message
-  if (bodySize == -1) {
+  if (bodySize < 0) {
+    malformed = true;
     return std::nullopt;
   }
 
-  std::string msgContent = readMessageContent(bodySize);
-  spdlog::debug("<-- response received, content part is {}", msgContent);
-  json msgBodyJSON = json::parse(msgContent, nullptr, false);
-  if (msgBodyJSON.is_discarded()) {
-    spdlog::error("content part of response message is illegal: content is {}",
-                  msgContent);
+  const size_t bodyStart = headerEnd + 4;
+  if (pending.size() - bodyStart < static_cast<size_t>(bodySize)) {
+    // wait for the rest of the content
     return std::nullopt;
   }
-  return msgBodyJSON;
+  std::string content(pending.substr(bodyStart, bodySize));
+  inboxPos += bodyStart + bodySize;
+  // compact once the consumed prefix dominates
+  if (inboxPos == inbox.size()) {
+    inbox.clear();
+    inboxPos = 0;
+  } else if (inboxPos > inbox.size() / 2) {
+    inbox.erase(0, inboxPos);
+    inboxPos = 0;
+  }
+  return content;
 }
 
 std::string JSONRpcEndpoint::fillMessageHeader(const std::string& body) {
@@ -78,106 +131,7 @@ std::string JSONRpcEndpoint::fillMessageHeader(const std::string& body) {
   return oss.str();
 }
 
-std::string JSONRpcEndpoint::readLine() {
-  char buf[256];
-  memset(buf, 0, sizeof(buf));
-  size_t len = 0;
-  ssize_t bytesRead = 0;
-  {
-    std::unique_lock<std::shared_mutex> lock(rwMutex);
-    do {
-      bytesRead = communicator->read(buf + len, 1);
-      if (bytesRead == 0) {                             // pipe close or EAGAIN
-        if (errno != EWOULDBLOCK && errno != EAGAIN) {  // pipe close
-          spdlog::error("unexpected pipe closed, simply drop message header");
-        }
-        return "";
-      }
-
-      if (bytesRead == -1) {  // error or max retry reached
-        if (errno == EWOULDBLOCK || errno == EAGAIN) {
-          spdlog::warn(
-              "reached max retries, failed to read from pipe, simply drop "
-              "message header");
-          return "";
-        }
-
-        spdlog::error(
-            "unexpected error occurred: error message: {}, simply drop message "
-            "header",
-            strerror(errno));
-        return "";
-      }
-
-      if (buf[len] == '\n') {
-        return std::string(buf);
-      }
-
-      len++;
-    } while (true);
-  }
-  //  spdlog::warn("empty pipe: language server may fail to start");
-  //  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  //  return std::string(buf);
-}
-
-std::string JSONRpcEndpoint::readMessageContent(ssize_t len) {
-  std::unique_lock<std::shared_mutex> lock(rwMutex);
-  std::string content;
-  content.resize(len);
-
-  ssize_t bytesRead = -1;
-  ssize_t totalBytesRead = 0;
-  int retryCnt = 0, maxRetryCnt = 6;
-  while (totalBytesRead < static_cast<ssize_t>(len)) {
-    bytesRead =
-        communicator->read(&content[0 + totalBytesRead], len - totalBytesRead);
-
-    if (bytesRead == -1) {  // error or max retry reached
-      if (errno == EWOULDBLOCK || errno == EAGAIN) {
-        spdlog::warn(
-            "reached max retries, failed to read from pipe, simply drop "
-            "message content");
-        return "";
-      }
-
-      return "";  // data read in is dirty, drop it
-    }
-
-    if (bytesRead == 0 &&
-        (errno == EAGAIN || errno == EWOULDBLOCK)) {  // pipe close or EAGAIN
-      if (retryCnt < maxRetryCnt) {
-        retryCnt++;
-        spdlog::debug("non-blocking read returns 0, wait for a while");
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-        continue;
-      }
-      spdlog::warn(
-          "readMessageContent reached max retries, failed to read "
-          "from pipe, simply drop message content");
-      return "";
-    }
-
-    if (bytesRead == 0) {
-      spdlog::error("unexpected pipe close, simply drop message content");
-      return "";
-    }
-
-    totalBytesRead += bytesRead;
-  }
-
-  if (totalBytesRead < len) {
-    spdlog::error(
-        "failed to read the required number of bytes. bytesRead={}, "
-        "expected={}",
-        bytesRead, len);
-    return "";
-  }
-
-  return content;
-}
-
-int LspEndpoint::ID = 0;
+std::atomic<int> LspEndpoint::ID{0};
 
 void LspEndpoint::SendNotification(std::string_view method,
                                    const JSONRpcParams& params) {
@@ -188,6 +142,7 @@ std::optional<LspEndpoint::JSONRpcResult> LspEndpoint::CallMethod(
     std::string_view method, const json& params) {
   int currentId = ID++;
 
+  std::pair<JSONRpcResult, JSONRpcError> response;
   {
     std::unique_lock<std::mutex> lock(cvMutex);
     std::shared_ptr<std::condition_variable> cond =
@@ -196,37 +151,157 @@ std::optional<LspEndpoint::JSONRpcResult> LspEndpoint::CallMethod(
 
     sendMessage(method, params, currentId);
     if (shutdownFlag) {
+      eventDict.erase(currentId);
       return std::nullopt;
     }
 
-    if (cond->wait_for(lock, std::chrono::seconds(timeout)) ==
-        std::cv_status::timeout) {
+    // woken up by the reader thread as soon as the response is framed
+    bool responded =
+        cond->wait_for(lock, std::chrono::seconds(timeout), [&]() {
+          return responseDict.count(currentId) || shutdownFlag;
+        });
+    eventDict.erase(currentId);
+    auto it = responseDict.find(currentId);
+    if (!responded || it == responseDict.end()) {
       spdlog::debug("timeout waiting for response, timeout is {}s", timeout);
       return std::nullopt;
     }
+    response = std::move(it->second);
+    responseDict.erase(it);
+  }
 
-    // timeout or response received
-    eventDict.erase(currentId);
+  return unwrapResponse(response.first, response.second);
+}
+
+int LspEndpoint::CallMethodAsync(std::string_view method, const json& params,
+                                 Callback callback) {
+  if (shutdownFlag) {
+    callback(std::nullopt);
+    return -1;
   }
+  int currentId = ID++;
 
-  auto it = responseDict.find(currentId);
-  if (it != responseDict.end()) {
-    auto& response = it->second;
-    if (response.second.contains("code") &&
-        response.second.contains("message")) {
-      LSPError error(
-          response.second["message"].get<std::string>(),
-          static_cast<ErrorCode>(response.second["code"].get<int>()));
-      spdlog::error("error occurs, response error: {}", error.toString());
-      return std::nullopt;
+  std::vector<Callback> expired;
+  {
+    std::lock_guard<std::mutex> lock(cvMutex);
+    const auto now = std::chrono::steady_clock::now();
+    pendingCalls[currentId] = {std::move(callback),
+                               now + std::chrono::seconds(timeout)};
+    // servers may never answer, sweep the expired calls once in a while
+    if (now >= nextSweep) {
+      takeExpiredCalls(expired);
+      nextSweep = now + std::chrono::seconds(1);
+    }
+  }
+  for (Callback& cb : expired) {
+    cb(std::nullopt);
+  }
+
+  // registered before sending, the response may come back at once
+  sendMessage(method, params, currentId);
+  return currentId;
+}
+
+std::future<std::optional<LspEndpoint::JSONRpcResult>>
+LspEndpoint::CallMethodAsync(std::string_view method, const json& params) {
+  auto promise = std::make_shared<std::promise<std::optional<JSONRpcResult>>>();
+  std::future<std::optional<JSONRpcResult>> future = promise->get_future();
+  CallMethodAsync(method, params,
+                  [promise](std::optional<JSONRpcResult> result) {
+                    promise->set_value(std::move(result));
+                  });
+  return future;
+}
+
+std::vector<std::optional<LspEndpoint::JSONRpcResult>>
+LspEndpoint::CallMethodBatch(std::string_view method,
+                             const std::vector<json>& paramsList,
+                             size_t window) {
+  // outlives this call if we give up waiting on a silent server
+  struct BatchState {
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t inFlight = 0;
+    std::vector<std::optional<JSONRpcResult>> results;
+  };
+  auto state = std::make_shared<BatchState>();
+  state->results.resize(paramsList.size());
+  window = std::max<size_t>(window, 1);
+
+  const auto stalled = std::chrono::seconds(timeout);
+  for (size_t i = 0; i < paramsList.size(); ++i) {
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      if (!state->cond.wait_for(lock, stalled, [&]() {
+            return state->inFlight < window || shutdownFlag;
+          })) {
+        spdlog::warn("{} requests of {} stalled, give up the rest",
+                     state->inFlight, method);
+        return state->results;
+      }
+      if (shutdownFlag) {
+        break;
+      }
+      ++state->inFlight;
+    }
+    CallMethodAsync(method, paramsList[i],
+                    [state, i](std::optional<JSONRpcResult> result) {
+                      std::lock_guard<std::mutex> lock(state->mutex);
+                      state->results[i] = std::move(result);
+                      --state->inFlight;
+                      state->cond.notify_one();
+                    });
+  }
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  // every call is answered or expired within the timeout
+  if (!state->cond.wait_for(lock, stalled, [&]() {
+        return state->inFlight == 0 || shutdownFlag;
+      })) {
+    spdlog::warn("{} requests of {} timed out", state->inFlight, method);
+  }
+  return state->results;
+}
+
+void LspEndpoint::takeExpiredCalls(std::vector<Callback>& expired) {
+  const auto now = std::chrono::steady_clock::now();
+  for (auto it = pendingCalls.begin(); it != pendingCalls.end();) {
+    if (it->second.deadline <= now) {
+      spdlog::debug("timeout waiting for response of rpcId {}", it->first);
+      expired.push_back(std::move(it->second.callback));
+      it = pendingCalls.erase(it);
+    } else {
+      ++it;
     }
-    return response.first;
   }
-  spdlog::warn("cannot find rpcId in response dict, which is weird");
-  return std::nullopt;
 }
 
-void LspEndpoint::Stop() { shutdownFlag = true; }
+std::optional<LspEndpoint::JSONRpcResult> LspEndpoint::unwrapResponse(
+    const JSONRpcResult& result, const JSONRpcError& error) {
+  if (error.contains("code") && error.contains("message")) {
+    LSPError lspError(error["message"].get<std::string>(),
+                      static_cast<ErrorCode>(error["code"].get<int>()));
+    spdlog::error("error occurs, response error: {}", lspError.toString());
+    return std::nullopt;
+  }
+  return std::make_optional<JSONRpcResult>(result);
+}
+
+void LspEndpoint::Stop() {
+  shutdownFlag = true;
+  rpcEndpoint->Interrupt();
+  std::unordered_map<int, PendingCall> abandoned;
+  {
+    std::lock_guard<std::mutex> lock(cvMutex);
+    for (auto& [rpcId, cond] : eventDict) {
+      cond->notify_one();
+    }
+    abandoned.swap(pendingCalls);
+  }
+  for (auto& [rpcId, call] : abandoned) {
+    call.callback(std::nullopt);
+  }
+}
 
 void LspEndpoint::operator()() {
   while (!shutdownFlag) {
@@ -240,7 +315,11 @@ void LspEndpoint::operator()() {
     JSONRpcEndpoint::RpcResponseBody body = bodyOpt.value();
 
     if (body.empty()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      // only polling Communicators come back empty-handed, blocking ones
+      // return as soon as a message is framed or when interrupted
+      if (!shutdownFlag) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
       continue;
     }
 
@@ -279,6 +358,7 @@ void LspEndpoint::sendMessage(std::string_view method, const json& params,
   if (id != -1) {
     value["id"] = id;
   }
+  ++requestCount;
   rpcEndpoint->SendRequest(value);
 }
 
@@ -286,13 +366,27 @@ void LspEndpoint::handleResult(int rpcId,
                                const LspEndpoint::JSONRpcResult& result,
                                const LspEndpoint::JSONRpcError& error) {
   if (rpcId == -1) return;
-  std::unique_lock<std::mutex> lock(cvMutex);
-  responseDict[rpcId] = std::make_pair(result, error);
-  auto it = eventDict.find(rpcId);
-  lock.unlock();
-  if (it != eventDict.end()) {
-    it->second->notify_one();
+  std::shared_ptr<std::condition_variable> cond;
+  {
+    std::unique_lock<std::mutex> lock(cvMutex);
+    if (auto pending = pendingCalls.find(rpcId);
+        pending != pendingCalls.end()) {
+      Callback callback = std::move(pending->second.callback);
+      pendingCalls.erase(pending);
+      lock.unlock();
+      callback(unwrapResponse(result, error));
+      return;
+    }
+    auto it = eventDict.find(rpcId);
+    if (it == eventDict.end()) {
+      // the caller has given up waiting
+      spdlog::debug("drop response of rpcId {}, no one is waiting", rpcId);
+      return;
+    }
+    cond = it->second;
+    responseDict[rpcId] = std::make_pair(result, error);
   }
+  cond->notify_one();
 }
 
 void LspEndpoint::SendResponse(int id, const JSONRpcResult& result,
@@ -0,0 +1,196 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/lsp/client_pool.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstdlib>
+#include <fstream>
+
+#include "mergebot/filesystem.h"
+
+namespace mergebot {
+namespace lsp {
+namespace _details {
+size_t envOr(const char *name, size_t fallback) {
+  const char *env = std::getenv(name);
+  if (!env || !*env) {
+    return fallback;
+  }
+  char *end = nullptr;
+  unsigned long long value = std::strtoull(env, &end, 10);
+  return *end ? fallback : static_cast<size_t>(value);
+}
+
+/// resident memory in KB and whether the process is gone, read from
+/// /proc/<pid>/status
+std::pair<size_t, bool> processStatus(pid_t pid) {
+  std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+  if (!status) {
+    return {0, true};
+  }
+  size_t rssKB = 0;
+  bool gone = false;
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("State:", 0) == 0) {
+      // zombie or dead
+      size_t pos = line.find_first_not_of(" \t", 6);
+      gone = pos != std::string::npos &&
+             (line[pos] == 'Z' || line[pos] == 'X');
+    } else if (line.rfind("VmRSS:", 0) == 0) {
+      rssKB = std::strtoull(line.c_str() + 6, nullptr, 10);
+    }
+  }
+  return {rssKB, gone};
+}
+}  // namespace _details
+
+ClientPool::Options ClientPool::Options::FromEnv() {
+  Options options;
+  options.maxIdle =
+      _details::envOr("MERGEBOT_CLANGD_POOL_SIZE", options.maxIdle);
+  options.maxRequests =
+      _details::envOr("MERGEBOT_CLANGD_MAX_REQUESTS", options.maxRequests);
+  options.maxRssMB =
+      _details::envOr("MERGEBOT_CLANGD_MAX_RSS_MB", options.maxRssMB);
+  return options;
+}
+
+ClientPool &ClientPool::Instance() {
+  static ClientPool pool(Options::FromEnv(), []() {
+    fs::path exePath = fs::read_symlink("/proc/self/exe");
+    return (exePath.parent_path() / "clangd").string();
+  }());
+  return pool;
+}
+
+ClientPool::Lease ClientPool::Acquire(const Key &key) {
+  const std::string keyStr = key.str();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = idle.begin(); it != idle.end(); ++it) {
+      if ((*it)->key == keyStr) {
+        std::unique_ptr<Entry> entry = std::move(*it);
+        idle.erase(it);
+        spdlog::debug("reuse warm clangd[{}] for workspace {}", entry->pid,
+                      key.workspaceRoot);
+        return Lease(this, std::move(entry), true);
+      }
+    }
+  }
+
+  std::unique_ptr<Entry> entry = spawn(key);
+  if (!entry) {
+    return Lease();
+  }
+  return Lease(this, std::move(entry), false);
+}
+
+std::unique_ptr<ClientPool::Entry> ClientPool::spawn(const Key &key) const {
+  if (!fs::exists(clangdPath)) {
+    spdlog::error("clangd not found");
+    return nullptr;
+  }
+  std::vector<std::string> env;
+  if (!key.indexDir.empty()) {
+    env.push_back("XDG_CACHE_HOME=" + key.indexDir);
+  }
+  auto pipe = PipeCommunicator::create(clangdPath.c_str(), "clangd", env);
+  if (!pipe) {
+    spdlog::error("cannot create pipe to communicate with child process");
+    return nullptr;
+  }
+  const pid_t pid = pipe->pid();
+  // block in epoll instead of polling the pipe
+  auto communicator = EpollCommunicator::create(std::move(pipe));
+  if (!communicator) {
+    return nullptr;
+  }
+  auto entry = std::make_unique<Entry>();
+  entry->key = key.str();
+  entry->pid = pid;
+  std::unique_ptr<JSONRpcEndpoint> rpcEndpoint =
+      std::make_unique<JSONRpcEndpoint>(std::move(communicator));
+  std::unique_ptr<LspEndpoint> lspEndpoint =
+      std::make_unique<LspEndpoint>(std::move(rpcEndpoint), 5);
+  entry->client = std::make_unique<LspClient>(std::move(lspEndpoint));
+
+  auto initializedResult = entry->client->Initialize(key.workspaceRoot);
+  if (initializedResult.has_value()) {
+    spdlog::debug("server info: {}",
+                  initializedResult.value()["serverInfo"]["version"]);
+  }
+  return entry;
+}
+
+void ClientPool::release(std::unique_ptr<Entry> entry) {
+  if (!healthy(*entry)) {
+    retire(std::move(entry));
+    return;
+  }
+
+  std::unique_ptr<Entry> evicted;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (options.maxIdle == 0) {
+      evicted = std::move(entry);
+    } else {
+      idle.push_front(std::move(entry));
+      if (idle.size() > options.maxIdle) {
+        evicted = std::move(idle.back());
+        idle.pop_back();
+      }
+    }
+  }
+  // shutting down may take a while, do it out of the lock
+  if (evicted) {
+    retire(std::move(evicted));
+  }
+}
+
+bool ClientPool::healthy(const Entry &entry) const {
+  if (entry.client->RequestCount() >= options.maxRequests) {
+    spdlog::info("clangd[{}] served {} requests, recycle it", entry.pid,
+                 entry.client->RequestCount());
+    return false;
+  }
+  auto [rssKB, gone] = _details::processStatus(entry.pid);
+  if (gone) {
+    spdlog::warn("clangd[{}] is gone, drop it", entry.pid);
+    return false;
+  }
+  if (rssKB > options.maxRssMB * 1024) {
+    spdlog::info("clangd[{}] takes {}MB memory, recycle it", entry.pid,
+                 rssKB / 1024);
+    return false;
+  }
+  return true;
+}
+
+void ClientPool::retire(std::unique_ptr<Entry> entry) {
+  entry->client->Shutdown();
+  entry->client->Exit();
+  // joins the endpoint thread and waits for clangd to exit
+  entry->client.reset();
+}
+
+void ClientPool::Clear() {
+  std::list<std::unique_ptr<Entry>> retired;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    retired.swap(idle);
+  }
+  for (std::unique_ptr<Entry> &entry : retired) {
+    retire(std::move(entry));
+  }
+}
+
+size_t ClientPool::IdleCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return idle.size();
+}
+}  // namespace lsp
+}  // namespace mergebot
@@ -5,16 +5,43 @@
 
 #include <fcntl.h>
 #include <spdlog/spdlog.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
+#include <algorithm>
+#include <cstring>
 #include <random>
+#include <string_view>
 
 #include "mergebot/filesystem.h"
 #include "mergebot/globals.h"
 
 namespace mergebot {
 namespace lsp {
+namespace _details {
+/// environment of the current process with `overrides` applied
+std::vector<std::string> mergeEnvironment(
+    const std::vector<std::string>& overrides) {
+  std::vector<std::string> merged(overrides);
+  for (char** var = environ; var && *var; ++var) {
+    std::string_view entry(*var);
+    std::string_view name = entry.substr(0, entry.find('='));
+    bool overridden = std::any_of(
+        overrides.begin(), overrides.end(), [&](const std::string& o) {
+          return o.size() > name.size() && o[name.size()] == '=' &&
+                 o.compare(0, name.size(), name) == 0;
+        });
+    if (!overridden) {
+      merged.emplace_back(entry);
+    }
+  }
+  return merged;
+}
+}  // namespace _details
+
 std::unique_ptr<PipeCommunicator> PipeCommunicator::create(
-    const char* executable, const char* args) {
+    const char* executable, const char* args,
+    const std::vector<std::string>& env) {
   int pipeIn[2];
   int pipeOut[2];
   pid_t processId;
@@ -50,6 +77,17 @@ std::unique_ptr<PipeCommunicator> PipeCommunicator::create(
     return nullptr;
   }
 
+  // prepared before fork, the child only execs
+  std::vector<std::string> envStrings;
+  std::vector<char*> envp;
+  if (!env.empty()) {
+    envStrings = _details::mergeEnvironment(env);
+    for (std::string& var : envStrings) {
+      envp.push_back(var.data());
+    }
+    envp.push_back(nullptr);
+  }
+
   processId = fork();
   if (processId == -1) {
     spdlog::error("fail to fork: {}", strerror(errno));
@@ -71,7 +109,11 @@ std::unique_ptr<PipeCommunicator> PipeCommunicator::create(
       assert("failed to dup2" && false);
     }
 
-    execl(executable, args, NULL);
+    if (envp.empty()) {
+      execl(executable, args, NULL);
+    } else {
+      execle(executable, args, NULL, envp.data());
+    }
     const std::string err_msg =
         fmt::format("failed to exec: {}", strerror(errno));
     ::write(STDERR_FILENO, err_msg.c_str(), err_msg.size());
@@ -201,33 +243,178 @@ ssize_t PipeCommunicator::write(const std::string& message) {
 ssize_t PipeCommunicator::read(void* buf, size_t len) {
   ssize_t bytesRead = 0;
   ssize_t totalBytesRead = 0;
-  int retryCnt = 0;
-  constexpr int MaxRetryCnt = 3;
   while (totalBytesRead < static_cast<ssize_t>(len)) {
     bytesRead = ::read(pipeOut[0], static_cast<char*>(buf) + totalBytesRead,
                        len - totalBytesRead);
     if (bytesRead == -1) {
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        if (totalBytesRead == 0) {
-          // No data available for non-blocking read, break the loop, wait
-          // high-level retry
-          return 0;
-        } else if (retryCnt < MaxRetryCnt) {
-          retryCnt++;
-          std::this_thread::sleep_for(std::chrono::milliseconds(300));
-          continue;
-        }
-        return -1;  // indicate error
+        // No data available for non-blocking read, return what we have got,
+        // the caller frames messages itself
+        return totalBytesRead;
       } else {
         return -1;
       }
     } else if (bytesRead == 0) {
-      return 0;
+      // pipe closed, errno is cleared to tell it from an empty pipe
+      errno = 0;
+      return totalBytesRead;
     }
     totalBytesRead += bytesRead;
   }
 
   return totalBytesRead;
 }
+
+int RingBuffer::writableSegments(struct iovec* iov) {
+  const size_t cap = capacity();
+  const size_t free = cap - size();
+  if (free == 0) {
+    return 0;
+  }
+  const size_t start = tail % cap;
+  const size_t first = std::min(free, cap - start);
+  iov[0].iov_base = buffer.data() + start;
+  iov[0].iov_len = first;
+  if (first == free) {
+    return 1;
+  }
+  iov[1].iov_base = buffer.data();
+  iov[1].iov_len = free - first;
+  return 2;
+}
+
+size_t RingBuffer::pop(void* out, size_t len) {
+  const size_t cap = capacity();
+  len = std::min(len, size());
+  const size_t start = head % cap;
+  const size_t first = std::min(len, cap - start);
+  memcpy(out, buffer.data() + start, first);
+  memcpy(static_cast<char*>(out) + first, buffer.data(), len - first);
+  head += len;
+  return len;
+}
+
+std::unique_ptr<EpollCommunicator> EpollCommunicator::create(
+    std::unique_ptr<PipeCommunicator> pipe, size_t ringCapacity) {
+  if (!pipe) {
+    return nullptr;
+  }
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd == -1) {
+    spdlog::error("fail to create epoll instance: {}", strerror(errno));
+    return nullptr;
+  }
+  int wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd == -1) {
+    spdlog::error("fail to create eventfd: {}", strerror(errno));
+    close(epollFd);
+    return nullptr;
+  }
+
+  struct epoll_event readEvent {};
+  readEvent.events = EPOLLIN;
+  readEvent.data.fd = pipe->readFd();
+  struct epoll_event wakeEvent {};
+  wakeEvent.events = EPOLLIN;
+  wakeEvent.data.fd = wakeFd;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pipe->readFd(), &readEvent) == -1 ||
+      epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &wakeEvent) == -1) {
+    spdlog::error("fail to register fds to epoll: {}", strerror(errno));
+    close(wakeFd);
+    close(epollFd);
+    return nullptr;
+  }
+  return std::unique_ptr<EpollCommunicator>(
+      new EpollCommunicator(std::move(pipe), epollFd, wakeFd, ringCapacity));
+}
+
+EpollCommunicator::~EpollCommunicator() {
+  close(wakeFd);
+  close(epollFd);
+  // the pipe closes its fds and reaps the child process
+}
+
+ssize_t EpollCommunicator::write(const std::string& message) {
+  size_t totalBytesWritten = 0;
+  while (totalBytesWritten < message.size()) {
+    ssize_t bytesWritten =
+        ::write(pipe->writeFd(), message.data() + totalBytesWritten,
+                message.size() - totalBytesWritten);
+    if (bytesWritten == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      spdlog::error("failed to write to pipe: {}", strerror(errno));
+      return totalBytesWritten == 0 ? -1 : totalBytesWritten;
+    }
+    totalBytesWritten += bytesWritten;
+  }
+  return totalBytesWritten;
+}
+
+ssize_t EpollCommunicator::fill() {
+  while (true) {
+    // drain whatever is already there before going to sleep
+    struct iovec iov[2];
+    int segments = ring.writableSegments(iov);
+    if (segments == 0) {
+      return ring.size();
+    }
+    ssize_t bytesRead = ::readv(pipe->readFd(), iov, segments);
+    if (bytesRead > 0) {
+      ring.commit(bytesRead);
+      return bytesRead;
+    }
+    if (bytesRead == 0) {
+      closed = true;
+      return 0;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      return -1;
+    }
+
+    struct epoll_event events[2];
+    int ready = epoll_wait(epollFd, events, 2, -1);
+    if (ready == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    for (int i = 0; i < ready; ++i) {
+      if (events[i].data.fd == wakeFd) {
+        // keep the eventfd readable, so that all the later reads return
+        errno = EINTR;
+        return -1;
+      }
+    }
+  }
+}
+
+ssize_t EpollCommunicator::read(void* buf, size_t len) {
+  if (len == 0) {
+    return 0;
+  }
+  if (ring.empty()) {
+    if (closed) {
+      return 0;
+    }
+    ssize_t filled = fill();
+    if (filled <= 0) {
+      return filled;
+    }
+  }
+  return ring.pop(buf, len);
+}
+
+void EpollCommunicator::interrupt() {
+  uint64_t one = 1;
+  if (::write(wakeFd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+    spdlog::warn("fail to interrupt reader: {}", strerror(errno));
+  }
+}
 }  // namespace lsp
 }  // namespace mergebot
\ No newline at end of file
@@ -11,7 +11,7 @@
 namespace mergebot {
 namespace ts {
 Node Children::operator[](uint32_t index) const {
-  return Node(ts_node_child(parent, index), tree);
+  return NodeRef(ts_node_child(parent, index), tree).node();
 }
 
 uint32_t Children::size() const { return ts_node_child_count(parent); }
@@ -22,11 +22,10 @@ Children::iterator Children::end() const {
   return iterator(parent, tree, size());
 }
 
-Children::Children(TSNode parent, std::shared_ptr<Tree> tree)
+Children::Children(TSNode parent, const Tree* tree)
     : parent(parent), tree(tree) {}
 
-Children::iterator::iterator(TSNode parent, std::shared_ptr<Tree> tree,
-                             uint32_t index)
+Children::iterator::iterator(TSNode parent, const Tree* tree, uint32_t index)
     : index(index), parent(parent), tree(tree) {}
 
 Children::iterator& Children::iterator::findSymbol(TSSymbol symbol) {
@@ -38,11 +37,11 @@ Children::iterator& Children::iterator::findSymbol(TSSymbol symbol) {
 }
 
 Node Children::iterator::operator*() const {
-  return Node(ts_node_child(parent, index), tree);
+  return NodeRef(ts_node_child(parent, index), tree).node();
 }
 
 std::unique_ptr<Node> Children::iterator::operator->() const {
-  return std::make_unique<Node>(ts_node_child(parent, index), tree);
+  return std::make_unique<Node>(**this);
 }
 
 Children::iterator& Children::iterator::operator++() {
@@ -10,15 +10,15 @@
 #include <cstddef>
 #include <memory>
 #include <optional>
+#include <string_view>
 
 #include "mergebot/parser/tree.h"
 #include "mergebot/parser/tree_cursor.h"
 
 namespace mergebot {
 namespace ts {
-static TSTreeCursor cursor;
 Node::Node(TSNode node, std::shared_ptr<Tree> tree)
-    : children(node, tree), node(node), tree(tree) {
+    : children(node, tree.get()), node(node), tree(std::move(tree)) {
   assert(!ts_node_is_null(node) && "node should not be null");
 }
 
@@ -76,15 +76,12 @@ std::vector<Node> Node::namedChildren() const {
 
 std::vector<Node> Node::childrenByFieldID(TSFieldId id) {
   std::vector<Node> result;
-  ts_tree_cursor_reset(&cursor, node);
-  int ok = ts_tree_cursor_goto_first_child(&cursor);
-  while (ok) {
-    if (ts_tree_cursor_current_field_id(&cursor) == id) {
-      result.emplace_back(Node(ts_tree_cursor_current_node(&cursor), tree));
+  // a cursor per call, trees are traversed in parallel
+  for (ChildIterator it(node, tree.get(), false); it != nullptr; ++it) {
+    if (it.fieldID() == id) {
+      result.emplace_back(Node((*it).node_, tree));
     }
-    ok = ts_tree_cursor_goto_next_sibling(&cursor);
   }
-
   return result;
 }
 
@@ -174,9 +171,131 @@ std::string Node::text() const {
   return tree->source().substr(startByte(), endByte() - startByte());
 }
 
+std::string_view Node::textView() const {
+  return std::string_view(tree->source())
+      .substr(startByte(), endByte() - startByte());
+}
+
+NodeRef Node::ref() const { return NodeRef(node, tree.get()); }
+
 long Node::id() const { return *static_cast<const long *>(node.id); }
 
 TreeCursor Node::walk() const { return TreeCursor(*this, tree); }
+
+NodeRef::NodeRef(TSNode node, const Tree *tree) : node_(node), tree_(tree) {
+  assert(!ts_node_is_null(node) && "node should not be null");
+}
+
+TSSymbol NodeRef::symbol() const { return ts_node_symbol(node_); }
+std::string_view NodeRef::type() const { return ts_node_type(node_); }
+std::string_view NodeRef::textView() const {
+  return std::string_view(tree_->source())
+      .substr(startByte(), endByte() - startByte());
+}
+bool NodeRef::isNamed() const { return ts_node_is_named(node_); }
+size_t NodeRef::startByte() const { return ts_node_start_byte(node_); }
+size_t NodeRef::endByte() const { return ts_node_end_byte(node_); }
+Point NodeRef::startPoint() const { return ts_node_start_point(node_); }
+Point NodeRef::endPoint() const { return ts_node_end_point(node_); }
+size_t NodeRef::childrenCount() const { return ts_node_child_count(node_); }
+
+ChildRange NodeRef::children() const { return ChildRange(node_, tree_, false); }
+ChildRange NodeRef::namedChildren() const {
+  return ChildRange(node_, tree_, true);
+}
+
+std::optional<NodeRef> NodeRef::getChildByFieldID(TSFieldId field_id) const {
+  return wrap(ts_node_child_by_field_id(node_, field_id));
+}
+std::optional<NodeRef> NodeRef::getChildByFieldName(
+    std::string_view name) const {
+  return wrap(ts_node_child_by_field_name(node_, name.data(), name.length()));
+}
+std::optional<NodeRef> NodeRef::nextSibling() const {
+  return wrap(ts_node_next_sibling(node_));
+}
+std::optional<NodeRef> NodeRef::prevSibling() const {
+  return wrap(ts_node_prev_sibling(node_));
+}
+std::optional<NodeRef> NodeRef::parent() const {
+  return wrap(ts_node_parent(node_));
+}
+
+Node NodeRef::node() const {
+  // trees are always created shared, see Tree::create
+  return Node(node_, std::const_pointer_cast<Tree>(tree_->shared_from_this()));
+}
+
+bool NodeRef::operator==(const NodeRef &rhs) const {
+  return node_.id == rhs.node_.id && tree_ == rhs.tree_;
+}
+
+std::optional<NodeRef> NodeRef::wrap(TSNode nodeOrNull) const {
+  if (ts_node_is_null(nodeOrNull)) {
+    return std::nullopt;
+  }
+  return NodeRef(nodeOrNull, tree_);
+}
+
+ChildIterator ChildRange::begin() const {
+  return ChildIterator(parent, tree, named);
+}
+
+ChildIterator::ChildIterator(TSNode parent, const Tree *tree, bool named)
+    : cursor(ts_tree_cursor_new(parent)),
+      tree(tree),
+      named(named),
+      valid(ts_tree_cursor_goto_first_child(&cursor)),
+      owns(true) {
+  skipUnnamed();
+}
+
+ChildIterator::ChildIterator(ChildIterator &&other) noexcept
+    : cursor(other.cursor),
+      tree(other.tree),
+      named(other.named),
+      valid(other.valid),
+      owns(other.owns),
+      index_(other.index_) {
+  other.owns = false;
+  other.valid = false;
+}
+
+ChildIterator::~ChildIterator() {
+  if (owns) {
+    ts_tree_cursor_delete(&cursor);
+  }
+}
+
+NodeRef ChildIterator::operator*() const {
+  assert(valid && "no more children");
+  return NodeRef(ts_tree_cursor_current_node(&cursor), tree);
+}
+
+ChildIterator &ChildIterator::operator++() {
+  valid = ts_tree_cursor_goto_next_sibling(&cursor);
+  skipUnnamed();
+  ++index_;
+  return *this;
+}
+
+bool ChildIterator::advanceTo(size_t target) {
+  while (valid && index_ < target) {
+    ++*this;
+  }
+  return valid && index_ == target;
+}
+
+TSFieldId ChildIterator::fieldID() const {
+  return ts_tree_cursor_current_field_id(&cursor);
+}
+
+void ChildIterator::skipUnnamed() {
+  while (named && valid &&
+         !ts_node_is_named(ts_tree_cursor_current_node(&cursor))) {
+    valid = ts_tree_cursor_goto_next_sibling(&cursor);
+  }
+}
 }  // namespace ts
 }  // namespace mergebot
 
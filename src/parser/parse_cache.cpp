@@ -0,0 +1,70 @@
+//
+// Created by whalien on 18/10/26.
+//
+
+#include "mergebot/parser/parse_cache.h"
+
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+#include "mergebot/parser/parser.h"
+
+namespace mergebot {
+namespace ts {
+namespace {
+size_t capacityFromEnv() {
+  size_t capacity_mb = 16;
+  if (const char *env = std::getenv("MERGEBOT_PARSE_CACHE_MB")) {
+    char *end = nullptr;
+    unsigned long long value = std::strtoull(env, &end, 10);
+    if (*env && !*end) {
+      capacity_mb = value;
+    }
+  }
+  return capacity_mb << 20;
+}
+}  // namespace
+
+ParseCache::ParseCache(const TSLanguage *language)
+    : ParseCache(language, capacityFromEnv()) {}
+
+ParseCache::ParseCache(const TSLanguage *language, size_t capacity_bytes)
+    : language(language), capacity(capacity_bytes) {}
+
+std::shared_ptr<Tree> ParseCache::parse(std::string_view source) {
+  const size_t hash = std::hash<std::string_view>{}(source);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = trees.find(hash);
+    if (it != trees.end() && it->second->source() == source) {
+      ++hits_;
+      return it->second->copy();
+    }
+  }
+
+  ++misses_;
+  std::shared_ptr<Tree> tree =
+      Parser::forThread(language).parse(std::string(source));
+  if (!tree || source.size() > capacity) {
+    return tree;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto [it, inserted] = trees.try_emplace(hash, tree);
+  if (!inserted) {
+    // parsed by another thread meanwhile, or a collision, keep the first
+    return tree;
+  }
+  order.push_back(hash);
+  bytes += source.size();
+  while (bytes > capacity && !order.empty()) {
+    auto evicted = trees.find(order.front());
+    bytes -= evicted->second->source().size();
+    trees.erase(evicted);
+    order.pop_front();
+  }
+  return tree->copy();
+}
+}  // namespace ts
+}  // namespace mergebot
@@ -6,6 +6,8 @@
 #include <tree_sitter/api.h>
 
 #include <cassert>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "mergebot/parser/range.h"
@@ -20,6 +22,16 @@ Parser::Parser(const TSLanguage *language)
 }
 Parser::~Parser() { ts_parser_delete(parser); }
 
+Parser &Parser::forThread(const TSLanguage *language) {
+  thread_local std::unordered_map<const TSLanguage *, std::unique_ptr<Parser>>
+      parsers;
+  std::unique_ptr<Parser> &parser = parsers[language];
+  if (!parser) {
+    parser = std::make_unique<Parser>(language);
+  }
+  return *parser;
+}
+
 std::shared_ptr<Tree> Parser::parse(const std::string &source, Tree *old_tree,
                                     bool keep_text) const {
   ts_parser_set_cancellation_flag(parser, cancel_flag);
@@ -13,13 +13,12 @@
 namespace mergebot {
 namespace ts {
 Tree::Tree(TSTree *tree, const std::string &source, bool keep_text)
-    : source_(""),
+    : source_(std::make_shared<const std::string>(keep_text ? source : "")),
       // the corresponding parser's lifetime is almost always longer than tree
-      tree(tree) {
-  if (keep_text) {
-    this->source_ = source;
-  }
-}
+      tree(tree) {}
+
+Tree::Tree(TSTree *tree, std::shared_ptr<const std::string> source)
+    : source_(std::move(source)), tree(tree) {}
 
 Tree::~Tree() { ts_tree_delete(tree); }
 
@@ -27,7 +26,11 @@ Node Tree::rootNode() {
   return Node(ts_tree_root_node(tree), shared_from_this());
 }
 
-const std::string &Tree::source() const { return source_; }
+std::shared_ptr<Tree> Tree::copy() const {
+  return std::make_shared<Tree>(ts_tree_copy(tree), source_);
+}
+
+const std::string &Tree::source() const { return *source_; }
 TreeCursor Tree::walk() {
   return TreeCursor(Node(ts_tree_root_node(tree), shared_from_this()),
                     shared_from_this());
@@ -40,7 +43,7 @@ void Tree::edit(TSInputEdit edit) {
   // After editing, the original source has lost its meaning, we here
   // temporarily clear it.
   // TODO(hwa): can we sync source_?
-  source_.clear();
+  source_ = std::make_shared<const std::string>();
 }
 
 std::vector<Range> Tree::getChangedRanges(const Tree &new_tree) const {
@@ -19,9 +19,9 @@ namespace ts {
 std::pair<size_t, std::string> getTranslationUnitComment(const ts::Node &root) {
   std::stringstream comment;
   size_t commentCnt = 0;
-  for (ts::Node const &child : root.children) {
+  for (ts::NodeRef child : root.ref().children()) {
     if (child.isNamed() && child.type() == ts::cpp::symbols::sym_comment.name) {
-      comment << child.text() << "\n";
+      comment << child.textView() << "\n";
       commentCnt++;
     } else {
       break;
@@ -105,21 +105,25 @@ std::pair<bool, std::vector<std::string>> getHeaderGuard(
     if (ChildrenCnt < 2) {
       return {false, {}};
     }
-    const ts::Node defineNode = HeaderGuardNode.namedChildren()[1];
+    ts::ChildIterator defineIt = HeaderGuardNode.ref().namedChildren().begin();
+    defineIt.advanceTo(1);
+    const ts::NodeRef defineNode = *defineIt;
     if (defineNode.type() == ts::cpp::symbols::sym_preproc_def.name) {
       TURoot = HeaderGuardNode;    // 更改TURoot为ifdef block
       BeforeBodyChildCnt = 2 + 1;  // first two is identifier and define
-      size_t first_newline = HeaderGuardNode.text().find('\n');
-      std::string ifndefText = HeaderGuardNode.text().substr(0, first_newline);
-      std::string endifText = HeaderGuardNode.text().substr(
-          HeaderGuardNode.text().rfind('\n') + 1, std::string::npos);
+      // the guard spans the whole header, don't copy it
+      const std::string_view guardText = HeaderGuardNode.textView();
+      size_t first_newline = guardText.find('\n');
+      std::string ifndefText(guardText.substr(0, first_newline));
+      std::string endifText(guardText.substr(guardText.rfind('\n') + 1));
       if (HeaderGuardNode.nextSibling()) {
         const ts::Node nextSibling = HeaderGuardNode.nextSibling().value();
         if (nextSibling.type() == ts::cpp::symbols::sym_comment.name) {
           endifText += nextSibling.text();
         }
       }
-      return {true, {ifndefText, defineNode.text(), endifText}};
+      return {true, {ifndefText, std::string(defineNode.textView()),
+                     endifText}};
     }
   }
   return {false, {}};
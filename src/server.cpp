@@ -21,12 +21,14 @@
 
 #include "mergebot/controller/project_controller.h"
 #include "mergebot/controller/resolve_controller.h"
+#include "mergebot/core/ScenarioCache.h"
 #include "mergebot/core/sa_utility.h"
 #include "mergebot/filesystem.h"
 #include "mergebot/globals.h"
 #include "mergebot/server/CrowSubLogger.h"
 #include "mergebot/server/server_utility.h"
 #include "mergebot/utils/ThreadPool.h"
+#include "mergebot/utils/gitservice.h"
 #include "mergebot/utils/pathop.h"
 
 namespace server = mergebot::server;
@@ -130,17 +132,32 @@ void InitMergebot() {
   fs::path mergebotDirPath = mergebot::util::toabs(mergebot::MBDIR);
 
   try {
-    // If directory exists, remove it recursively
-    if (fs::exists(mergebotDirPath)) {
-      spdlog::warn("Directory {} exists, removing it...",
+    // Cached sources and resolution results are kept across restarts, so we
+    // validate what's left instead of wiping the directory.
+    if (!fs::exists(mergebotDirPath)) {
+      fs::create_directory(mergebotDirPath);
+      spdlog::info("Directory {} created successfully",
                    mergebotDirPath.string());
-      fs::remove_all(mergebotDirPath);
     }
 
-    // Create the new directory
-    fs::create_directory(mergebotDirPath);
-    spdlog::info("Directory {} created successfully", mergebotDirPath.string());
+    // No resolution survives a restart, running signs left by the previous
+    // process would lock their merge scenarios forever:
+    // MBDIR/<project checksum>/<merge scenario>/running
+    for (const auto& projDir : fs::directory_iterator(mergebotDirPath)) {
+      if (!projDir.is_directory()) continue;
+      for (const auto& msDir : fs::directory_iterator(projDir.path())) {
+        const fs::path runningSign = msDir.path() / "running";
+        if (msDir.is_directory() && fs::exists(runningSign)) {
+          spdlog::warn("remove stale running sign {}", runningSign.string());
+          fs::remove(runningSign);
+        }
+      }
+      // blobs whose side trees were evicted, or removed by hand, while no
+      // scenario of the project was retired to prune them
+      mergebot::util::prune_blob_store((projDir.path() / "blobs").string());
+    }
 
+    mergebot::sa::ScenarioCache::instance().load();
   } catch (const std::exception& ex) {
     spdlog::error("Failed to init mergebot, reason: {}", ex.what());
     exit(1);
@@ -218,7 +218,8 @@ void checkFilesField(crow::json::rvalue const& body,
 
 void checkGitRepo(std::string const& path) {
   const fs::path gitDirPath = fs::path(path) / ".git";
-  const auto repoPtr = util::GitRepository::create(gitDirPath.c_str());
+  // opened once, later git queries of the project reuse the handle
+  const auto repoPtr = util::GitRepository::shared(gitDirPath);
   if (!repoPtr) {
     spdlog::warn("project path[{}] is not a valid git repo", path);
     throw AppBaseException(
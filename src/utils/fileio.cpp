@@ -4,7 +4,9 @@
 #include "mergebot/utils/fileio.h"
 
 #include <fcntl.h>
+#include <linux/fs.h>
 #include <spdlog/spdlog.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -103,6 +105,36 @@ bool copy_file(const std::string &source, const std::string &destination) {
   return true;
 }
 
+bool clone_or_link_file(const std::string &source,
+                        const std::string &destination) {
+#ifdef FICLONE
+  int srcFd = open(source.c_str(), O_RDONLY);
+  if (srcFd != -1) {
+    int destFd = open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL,
+                      S_IRUSR | S_IWUSR);
+    if (destFd == -1) {
+      close(srcFd);
+      return false;
+    }
+    bool cloned = ioctl(destFd, FICLONE, srcFd) == 0;
+    close(srcFd);
+    close(destFd);
+    if (cloned) {
+      return true;
+    }
+    // reflinks are not supported here, fall back to a hardlink
+    unlink(destination.c_str());
+  }
+#endif
+  if (link(source.c_str(), destination.c_str()) == 0) {
+    return true;
+  }
+  if (errno == EEXIST) {
+    return false;
+  }
+  return copy_file(source, destination);
+}
+
 bool file_overwrite_content_sync(const std::string &path,
                                  const std::string &content) {
   auto [fd, lck] = mergebot::utils::lockWRFD(path);
@@ -5,6 +5,7 @@
 #include "mergebot/utils/gitservice.h"
 
 #include <fcntl.h>
+#include <fmt/format.h>
 #include <git2.h>
 #include <oneapi/tbb/blocked_range.h>
 #include <oneapi/tbb/parallel_for.h>
@@ -12,7 +13,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cctype>
 #include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "mergebot/core/model/SimplifiedDiffDelta.h"
@@ -33,8 +39,8 @@ bool is_cpp_file(std::string_view path) {
 }
 
 namespace detail {
-std::string corresponding_commit_hash(
-    std::string_view hash, const std::unique_ptr<GitRepository> &repo_ptr) {
+std::string corresponding_commit_hash(std::string_view hash,
+                                      GitRepository &repo) {
   git_object *obj = nullptr;
   git_oid oid;
   int error = git_oid_fromstr(&oid, hash.data());
@@ -45,7 +51,7 @@ std::string corresponding_commit_hash(
     return "";
   }
 
-  error = git_object_lookup(&obj, repo_ptr->unwrap(), &oid, GIT_OBJECT_ANY);
+  error = git_object_lookup(&obj, repo.unwrap(), &oid, GIT_OBJECT_ANY);
   if (error != 0) {
     const git_error *e = git_error_last();
     spdlog::debug("error to parse hash [{}] into git object, error {}/{}: {}",
@@ -56,7 +62,7 @@ std::string corresponding_commit_hash(
   git_otype obj_type = git_object_type(obj);
   if (obj_type == GIT_OBJECT_TAG) {
     git_tag *tag = nullptr;
-    error = git_tag_lookup(&tag, repo_ptr->unwrap(), &oid);
+    error = git_tag_lookup(&tag, repo.unwrap(), &oid);
     if (error != 0) {
       const git_error *e = git_error_last();
       spdlog::debug("error to parse hash [{}] into git object, error {}/{}: {}",
@@ -84,6 +90,7 @@ std::string corresponding_commit_hash(
 typedef struct {
   std::string_view dest;
   git_repository *repo;
+  std::string_view blob_store;
 } DumpTreePayload;
 
 int fill_diff_map(const git_diff_delta *delta, float progress, void *payload) {
@@ -108,6 +115,104 @@ int fill_diff_set(const git_diff_delta *delta, float progress, void *payload) {
   return 0;
 }
 
+int write_blob_to(const git_blob *blob, const std::string &dest_path,
+                  mode_t mode) {
+  const void *data = git_blob_rawcontent(blob);
+  size_t size = git_blob_rawsize(blob);
+
+  int output_fd = open(dest_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+  if (output_fd == -1) {
+    spdlog::error("failed to open output file: {}", dest_path);
+    return -1;
+  }
+
+  ssize_t bytes_written = write(output_fd, data, size);
+  if (bytes_written != static_cast<ssize_t>(size)) {
+    spdlog::error("failed to write data to output file: {}", dest_path);
+    close(output_fd);
+    return -1;
+  }
+
+  close(output_fd);
+  return 0;
+}
+
+/// make sure the blob is in the store, the store is shared by all the sides
+/// and merge scenarios of a project, thus concurrently written
+/// \return path of the blob in the store, empty if it cannot be written
+std::string store_blob(const git_blob *blob, const git_oid *oid,
+                       std::string_view blob_store) {
+  char hex[GIT_OID_MAX_HEXSIZE + 1];
+  git_oid_tostr(hex, sizeof(hex), oid);
+  const fs::path store_dir = fs::path(blob_store) / std::string_view(hex, 2);
+  const fs::path store_path = store_dir / (hex + 2);
+  if (fs::exists(store_path)) {
+    return store_path.string();
+  }
+
+  std::error_code ec;
+  fs::create_directories(store_dir, ec);
+  // write aside and rename, so that readers never see a partial blob
+  const std::string tmp_path = fmt::format(
+      "{}.{}.{}", store_path.string(), getpid(),
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  // read-only, as every side tree links to it
+  if (write_blob_to(blob, tmp_path, S_IRUSR | S_IRGRP | S_IROTH) != 0) {
+    unlink(tmp_path.c_str());
+    return "";
+  }
+  if (rename(tmp_path.c_str(), store_path.c_str()) != 0) {
+    spdlog::error("failed to move blob {} into store {}, reason: {}", hex,
+                  blob_store, strerror(errno));
+    unlink(tmp_path.c_str());
+    return "";
+  }
+  return store_path.string();
+}
+
+int dump_blob_entry(git_repository *repo, const git_tree_entry *entry,
+                    const std::string &dest_path,
+                    std::string_view blob_store) {
+  if (fs::exists(dest_path)) {
+    return 1;
+  }
+
+  git_blob *blob = nullptr;
+  int error = git_blob_lookup(&blob, repo, git_tree_entry_id(entry));
+  if (error < 0) {
+    const git_error *e = git_error_last();
+    spdlog::error("error to lookup blob {}/{}: {}", error, e->klass,
+                  e->message);
+    return error;
+  }
+
+  if (git_tree_entry_filemode(entry) == GIT_FILEMODE_LINK) {
+    const char *target = static_cast<const char *>(git_blob_rawcontent(blob));
+    int res = symlink(target, dest_path.c_str());
+    if (res != 0) {
+      git_blob_free(blob);
+      spdlog::error("symlink {} to {} failed", dest_path, target);
+      return 1;
+    }
+    git_blob_free(blob);
+    return 0;
+  }
+
+  if (!blob_store.empty()) {
+    std::string store_path =
+        store_blob(blob, git_tree_entry_id(entry), blob_store);
+    if (!store_path.empty() && clone_or_link_file(store_path, dest_path)) {
+      git_blob_free(blob);
+      return 0;
+    }
+    // fall through, write a private copy
+  }
+
+  error = write_blob_to(blob, dest_path, S_IRUSR | S_IWUSR);
+  git_blob_free(blob);
+  return error;
+}
+
 int dump_tree_entry(const char *root, const git_tree_entry *entry,
                     void *payload) {
   DumpTreePayload dump_payload = *static_cast<DumpTreePayload *>(payload);
@@ -156,51 +261,7 @@ int dump_tree_entry(const char *root, const git_tree_entry *entry,
       return error;
     }
   } else if (object_type == GIT_OBJECT_BLOB) {
-    if (fs::exists(dest_path)) {
-      return 1;
-    }
-
-    git_blob *blob = nullptr;
-    int error = git_blob_lookup(&blob, repo, git_tree_entry_id(entry));
-    if (error < 0) {
-      const git_error *e = git_error_last();
-      spdlog::error("error to lookup blob {}/{}: {}", error, e->klass,
-                    e->message);
-      return error;
-    }
-
-    const void *data = git_blob_rawcontent(blob);
-    size_t size = git_blob_rawsize(blob);
-
-    if (git_tree_entry_filemode(entry) == GIT_FILEMODE_LINK) {
-      int res = symlink(static_cast<const char *>(data), dest_path.c_str());
-      if (res != 0) {
-        git_blob_free(blob);
-        spdlog::error("symlink {} to {} failed", dest_path,
-                      static_cast<const char *>(data));
-        return 1;
-      }
-      git_blob_free(blob);
-    } else {
-      int output_fd = open(dest_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
-                           S_IRUSR | S_IWUSR);
-      if (output_fd == -1) {
-        spdlog::error("failed to open output file: {}", dest_path);
-        git_blob_free(blob);
-        return -1;
-      }
-
-      ssize_t bytes_written = write(output_fd, data, size);
-      if (bytes_written != static_cast<ssize_t>(size)) {
-        spdlog::error("failed to write data to output file: {}", dest_path);
-        close(output_fd);
-        git_blob_free(blob);
-        return -1;
-      }
-
-      close(output_fd);
-      git_blob_free(blob);
-    }
+    return dump_blob_entry(repo, entry, dest_path, dump_payload.blob_store);
   } else {
     spdlog::warn("unexpected git object type found: {}",
                  static_cast<int>(object_type));
@@ -263,8 +324,68 @@ int get_diff_hunk_cb(const git_diff_delta *delta, const git_diff_hunk *hunk,
   return 0;
 }
 
+bool is_full_hash(std::string_view revision) {
+  return revision.size() == GIT_OID_MAX_HEXSIZE &&
+         std::all_of(revision.begin(), revision.end(),
+                     [](unsigned char c) { return std::isxdigit(c); });
+}
+
+/// memo of revision queries which are immutable once answered
+class RevisionCache {
+ public:
+  std::optional<std::string> get(const std::string &key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(key);
+    if (it == cache_.end()) return std::nullopt;
+    return it->second;
+  }
+
+  void put(const std::string &key, const std::string &value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // entries are tiny, but a long-running server shouldn't grow unbounded
+    if (cache_.size() >= kCapacity) cache_.clear();
+    cache_.insert_or_assign(key, value);
+  }
+
+ private:
+  static constexpr size_t kCapacity = 1 << 16;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::string> cache_;
+};
+
+RevisionCache &revision_cache() {
+  static RevisionCache cache;
+  return cache;
+}
+
 }  // namespace detail
 
+std::shared_ptr<GitRepository> GitRepository::shared(
+    const std::string &project_path) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<GitRepository>>
+      repos;
+
+  // key by the git dir, so that a project and its .git share one handle
+  std::string key = fs::path(project_path).lexically_normal();
+  while (key.size() > 1 && key.back() == fs::path::preferred_separator) {
+    key.pop_back();
+  }
+  if (!util::ends_with(key, ".git")) {
+    key = fs::path(key) / ".git";
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (auto it = repos.find(key); it != repos.end()) {
+    return it->second;
+  }
+  std::shared_ptr<GitRepository> repo = GitRepository::create(key);
+  if (repo) {
+    repos.emplace(std::move(key), repo);
+  }
+  return repo;
+}
+
 std::unique_ptr<GitCommit> GitRepository::lookupCommit(
     std::string_view commit_hash) const {
   int err = -1;
@@ -319,8 +440,10 @@ std::unordered_set<sa::SimplifiedDiffDelta> list_cpp_diff_files(
   options.flags = GIT_DIFF_FIND_RENAMES | GIT_DIFF_FIND_COPIES;
   git_libgit2_init();
 
-  git_repository *repo = nullptr;
-  int err = git_repository_open(&repo, repo_path.data());
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(std::string(repo_path));
+  git_repository *repo = repo_ptr ? repo_ptr->unwrap() : nullptr;
+  int err = repo ? 0 : GIT_ENOTFOUND;
   if (err < 0) goto handle;
 
   err = git_oid_fromstr(&old_oid, old_commit_str.data());
@@ -352,7 +475,6 @@ handle:
   git_tree_free(new_tree);
   git_commit_free(old_commit);
   git_commit_free(new_commit);
-  git_repository_free(repo);
 
   git_libgit2_shutdown();
   return diff_set;
@@ -372,8 +494,10 @@ std::unordered_map<std::string, std::string> get_cpp_diff_mapping(
   //  options.flags = GIT_DIFF_FIND_RENAMES | GIT_DIFF_FIND_COPIES;
   git_libgit2_init();
 
-  git_repository *repo = nullptr;
-  int err = git_repository_open(&repo, repo_path.data());
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(std::string(repo_path));
+  git_repository *repo = repo_ptr ? repo_ptr->unwrap() : nullptr;
+  int err = repo ? 0 : GIT_ENOTFOUND;
   if (err < 0) goto handle;
 
   err = git_oid_fromstr(&old_oid, old_commit_str.data());
@@ -405,14 +529,14 @@ handle:
   git_tree_free(new_tree);
   git_commit_free(old_commit);
   git_commit_free(new_commit);
-  git_repository_free(repo);
 
   git_libgit2_shutdown();
   return diff_map;
 }
 
 bool dump_tree_object_to(std::string_view dest, std::string_view hash,
-                         std::string_view repo_path) {
+                         std::string_view repo_path,
+                         std::string_view blob_store) {
   fs::path dest_path = fs::path(dest);
   if (fs::exists(dest) && !fs::is_directory(dest)) {
     spdlog::error("dest {} is not a directory", dest);
@@ -423,15 +547,15 @@ bool dump_tree_object_to(std::string_view dest, std::string_view hash,
   //    fs::create_directories(dest_path);
   //  }
 
-  std::unique_ptr<GitRepository> repo_ptr =
-      GitRepository::create(repo_path.data());
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(std::string(repo_path));
   if (!repo_ptr) {
     const git_error *e = git_error_last();
     spdlog::error("error {}: {}", e->klass, e->message);
     return false;
   }
 
-  std::string commit_hash = detail::corresponding_commit_hash(hash, repo_ptr);
+  std::string commit_hash = detail::corresponding_commit_hash(hash, *repo_ptr);
 
   std::unique_ptr<GitCommit> commit_ptr = repo_ptr->lookupCommit(commit_hash);
   if (!commit_ptr) {
@@ -454,7 +578,8 @@ bool dump_tree_object_to(std::string_view dest, std::string_view hash,
   tbb::parallel_for(
       tbb::blocked_range<size_t>(0, num_entries),
       [&](const tbb::blocked_range<size_t> &range) {
-        detail::DumpTreePayload payload = {dest, repo_ptr->unwrap()};
+        detail::DumpTreePayload payload = {dest, repo_ptr->unwrap(),
+                                           blob_store};
         for (auto i = range.begin(); i != range.end(); ++i) {
           const git_tree_entry *entry =
               git_tree_entry_byindex(tree_ptr->unwrap(), i);
@@ -470,18 +595,147 @@ bool dump_tree_object_to(std::string_view dest, std::string_view hash,
   return true;
 }
 
-std::optional<std::string> full_commit_hash(const std::string &hash,
-                                            const std::string &project_path) {
-  std::optional<std::string> result = std::nullopt;
+std::optional<std::vector<std::string>> dump_tree_paths_to(
+    std::string_view dest, std::string_view hash, std::string_view repo_path,
+    const std::vector<std::string> &paths, std::string_view blob_store) {
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(std::string(repo_path));
+  if (!repo_ptr) {
+    const git_error *e = git_error_last();
+    spdlog::error("error {}: {}", e->klass, e->message);
+    return std::nullopt;
+  }
 
-  std::unique_ptr<GitRepository> repo_ptr = nullptr;
-  std::unique_ptr<GitCommit> commit_ptr = nullptr;
-  git_oid full_oid;
+  std::string commit_hash = detail::corresponding_commit_hash(hash, *repo_ptr);
+  std::unique_ptr<GitCommit> commit_ptr = repo_ptr->lookupCommit(commit_hash);
+  if (!commit_ptr) {
+    const git_error *e = git_error_last();
+    spdlog::error("error {}: {}", e->klass, e->message);
+    return std::nullopt;
+  }
+  std::unique_ptr<GitTree> tree_ptr = commit_ptr->tree();
+  if (!tree_ptr) {
+    const git_error *e = git_error_last();
+    spdlog::error("error {}: {}", e->klass, e->message);
+    return std::nullopt;
+  }
+
+  std::vector<std::string> dumped;
+  dumped.reserve(paths.size());
+  for (const std::string &path : paths) {
+    git_tree_entry *entry = nullptr;
+    if (git_tree_entry_bypath(&entry, tree_ptr->unwrap(), path.c_str()) != 0) {
+      // not every candidate exists in this revision
+      continue;
+    }
+    if (git_tree_entry_type(entry) != GIT_OBJECT_BLOB) {
+      git_tree_entry_free(entry);
+      continue;
+    }
+
+    const fs::path dest_path = fs::path(dest) / path;
+    std::error_code ec;
+    fs::create_directories(dest_path.parent_path(), ec);
+    int error = detail::dump_blob_entry(repo_ptr->unwrap(), entry,
+                                        dest_path.string(), blob_store);
+    git_tree_entry_free(entry);
+    if (error >= 0) {
+      dumped.push_back(path);
+    }
+  }
+  spdlog::debug("{} of {} paths of commit {} dumped to {}", dumped.size(),
+                paths.size(), commit_hash, dest);
+  return dumped;
+}
+
+uint64_t prune_blob_store(std::string_view blob_store) {
+  std::error_code ec;
+  if (blob_store.empty() || !fs::is_directory(blob_store, ec)) {
+    return 0;
+  }
 
-  repo_ptr = GitRepository::create(project_path);
+  uint64_t freed = 0;
+  size_t pruned = 0;
+  // blob_store/<2 hex>/<38 hex>, see detail::store_blob
+  for (const auto &fan_out : fs::directory_iterator(blob_store, ec)) {
+    if (!fan_out.is_directory(ec)) continue;
+    for (const auto &blob : fs::directory_iterator(fan_out.path(), ec)) {
+      // blobs being written are named <oid>.<pid>.<tid>, leave them alone
+      const std::string name = blob.path().filename().string();
+      if (name.find('.') != std::string::npos) continue;
+      struct stat st;
+      if (lstat(blob.path().c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+          st.st_nlink != 1) {
+        continue;
+      }
+      if (unlink(blob.path().c_str()) == 0) {
+        freed += static_cast<uint64_t>(st.st_size);
+        ++pruned;
+      }
+    }
+    // the fan-out dir is recreated by store_blob if needed
+    fs::remove(fan_out.path(), ec);
+  }
+  spdlog::debug("{} unreferenced blobs ({} bytes) pruned from {}", pruned,
+                freed, blob_store);
+  return freed;
+}
+
+std::optional<std::vector<std::string>> list_conflict_paths(
+    const std::string &project_path) {
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(project_path);
+  if (!repo_ptr) return std::nullopt;
+
+  // open the index afresh instead of the cached one of the shared handle, as
+  // the working tree changes between requests
+  const std::string index_path =
+      fs::path(git_repository_path(repo_ptr->unwrap())) / "index";
+  git_index *index = nullptr;
+  int error = git_index_open(&index, index_path.c_str());
+  if (error < 0) {
+    const git_error *e = git_error_last();
+    spdlog::error("error to open index {}, {}/{}: {}", index_path, error,
+                  e->klass, e->message);
+    return std::nullopt;
+  }
+
+  git_index_conflict_iterator *iter = nullptr;
+  error = git_index_conflict_iterator_new(&iter, index);
+  if (error < 0) {
+    const git_error *e = git_error_last();
+    spdlog::error("error to iterate conflicts of {}, {}/{}: {}", index_path,
+                  error, e->klass, e->message);
+    git_index_free(index);
+    return std::nullopt;
+  }
+
+  // entries are sorted by path, and all stages of a path come in one go
+  std::vector<std::string> paths;
+  const git_index_entry *ancestor = nullptr, *ours = nullptr, *theirs = nullptr;
+  while ((error = git_index_conflict_next(&ancestor, &ours, &theirs, iter)) ==
+         0) {
+    const git_index_entry *entry = ours ? ours : theirs ? theirs : ancestor;
+    paths.emplace_back(entry->path);
+  }
+  git_index_conflict_iterator_free(iter);
+  git_index_free(index);
+  if (error != GIT_ITEROVER) {
+    const git_error *e = git_error_last();
+    spdlog::error("error to read conflicts of {}, {}/{}: {}", index_path,
+                  error, e->klass, e->message);
+    return std::nullopt;
+  }
+  return paths;
+}
+
+std::optional<std::string> full_commit_hash(const std::string &hash,
+                                            const std::string &project_path) {
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(project_path);
   if (!repo_ptr) return std::nullopt;
 
-  commit_ptr = repo_ptr->lookupCommitByPrefix(hash);
+  std::unique_ptr<GitCommit> commit_ptr = repo_ptr->lookupCommitByPrefix(hash);
   if (!commit_ptr) return std::nullopt;
 
   char full_hash[GIT_OID_MAX_HEXSIZE + 1];
@@ -492,11 +746,11 @@ std::optional<std::string> full_commit_hash(const std::string &hash,
 
 std::optional<std::string> commit_hash_of_branch(
     const std::string &branch_name, const std::string &project_path) {
-  std::unique_ptr<GitRepository> repo_ptr = nullptr;
   git_reference *ref;
   git_oid full_oid;
 
-  repo_ptr = GitRepository::create(project_path);
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(project_path);
   if (!repo_ptr) return std::nullopt;
 
   int res = git_branch_lookup(&ref, repo_ptr->unwrap(), branch_name.c_str(),
@@ -521,25 +775,63 @@ std::optional<std::string> commit_hash_of_branch(
 std::optional<std::string> git_merge_base(const std::string &our,
                                           const std::string &their,
                                           const std::string &project_path) {
-  std::string cmd =
-      fmt::format("(cd {} && git merge-base {} {})", project_path, our, their);
-  llvm::ErrorOr<std::string> resultOrErr = utils::ExecCommand(cmd);
-  if (!resultOrErr) return std::nullopt;
-  std::string base = resultOrErr.get();
-  if (base.length() != 40) {
+  // branch names move, so the cache is keyed by the commits they resolve to
+  std::optional<std::string> our_commit = commit_hash_of_rev(our, project_path);
+  std::optional<std::string> their_commit =
+      commit_hash_of_rev(their, project_path);
+  if (!our_commit.has_value() || !their_commit.has_value()) {
+    return std::nullopt;
+  }
+
+  const std::string key = fmt::format("merge-base:{}:{}:{}", project_path,
+                                      *our_commit, *their_commit);
+  if (auto cached = detail::revision_cache().get(key)) {
+    return cached;
+  }
+
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(project_path);
+  if (!repo_ptr) return std::nullopt;
+
+  git_oid our_oid, their_oid, base_oid;
+  git_oid_fromstr(&our_oid, our_commit->c_str());
+  git_oid_fromstr(&their_oid, their_commit->c_str());
+  int error =
+      ::git_merge_base(&base_oid, repo_ptr->unwrap(), &our_oid, &their_oid);
+  if (error < 0) {
     spdlog::warn(
         "base commit of our [{}] and their [{}] branches doesn't exist", our,
         their);
     return std::nullopt;
   }
-  return base;
+
+  char base[GIT_OID_MAX_HEXSIZE + 1];
+  base[GIT_OID_MAX_HEXSIZE] = '\0';
+  git_oid_fmt(base, &base_oid);
+  detail::revision_cache().put(key, base);
+  return std::string(base);
 }
 
 std::optional<std::string> commit_hash_of_rev(const std::string &revision,
                                               const std::string &project_path) {
-  git_object *obj;
+  // a full hash names an immutable object, what it resolves to never changes
+  const bool cacheable = detail::is_full_hash(revision);
+  const std::string key = fmt::format("rev:{}:{}", project_path, revision);
+  if (cacheable) {
+    if (auto cached = detail::revision_cache().get(key)) {
+      return cached;
+    }
+  }
+
+  std::shared_ptr<GitRepository> repo_ptr =
+      GitRepository::shared(project_path);
+  if (!repo_ptr) {
+    spdlog::error("fail to parse revision {}, {} is not a git repo", revision,
+                  project_path);
+    return std::nullopt;
+  }
 
-  std::unique_ptr<GitRepository> repo_ptr = GitRepository::create(project_path);
+  git_object *obj;
   int res = git_revparse_single(&obj, repo_ptr->unwrap(), revision.c_str());
   if (res != 0) {
     const git_error *err = git_error_last();
@@ -559,10 +851,60 @@ std::optional<std::string> commit_hash_of_rev(const std::string &revision,
   git_object_free(obj);
 
   std::string commit_hash =
-      detail::corresponding_commit_hash(full_hash, repo_ptr);
+      detail::corresponding_commit_hash(full_hash, *repo_ptr);
+  if (cacheable && !commit_hash.empty()) {
+    detail::revision_cache().put(key, commit_hash);
+  }
   return commit_hash;
 }
 
+std::optional<std::string> merge_file_diff3(const std::string &ours_path,
+                                            const std::string &base_path,
+                                            const std::string &theirs_path) {
+  std::optional<std::string> ours = file_get_content_sync(ours_path);
+  std::optional<std::string> base = file_get_content_sync(base_path);
+  std::optional<std::string> theirs = file_get_content_sync(theirs_path);
+  if (!ours || !base || !theirs) return std::nullopt;
+
+  git_merge_file_input our_input = GIT_MERGE_FILE_INPUT_INIT;
+  our_input.ptr = ours->c_str();
+  our_input.size = ours->size();
+  our_input.path = ours_path.c_str();
+
+  git_merge_file_input base_input = GIT_MERGE_FILE_INPUT_INIT;
+  base_input.ptr = base->c_str();
+  base_input.size = base->size();
+  base_input.path = base_path.c_str();
+
+  git_merge_file_input their_input = GIT_MERGE_FILE_INPUT_INIT;
+  their_input.ptr = theirs->c_str();
+  their_input.size = theirs->size();
+  their_input.path = theirs_path.c_str();
+
+  git_merge_file_options opts = GIT_MERGE_FILE_OPTIONS_INIT;
+  opts.ancestor_label = base_path.c_str();
+  opts.our_label = ours_path.c_str();
+  opts.their_label = theirs_path.c_str();
+  opts.flags = GIT_MERGE_FILE_STYLE_DIFF3;
+
+  git_libgit2_init();
+  git_merge_file_result result;
+  int error =
+      git_merge_file(&result, &base_input, &our_input, &their_input, &opts);
+  if (error < 0) {
+    const git_error *e = git_error_last();
+    spdlog::error("error to merge {}, {} and {}, {}/{}: {}", ours_path,
+                  base_path, theirs_path, error, e->klass, e->message);
+    git_libgit2_shutdown();
+    return std::nullopt;
+  }
+
+  std::string merged_text(result.ptr, result.ptr + result.len);
+  git_merge_file_result_free(&result);
+  git_libgit2_shutdown();
+  return merged_text;
+}
+
 std::string git_merge_textual(const std::string &ours, const std::string &base,
                               const std::string &theirs,
                               const std::string &base_label,
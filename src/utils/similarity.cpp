@@ -3,57 +3,141 @@
 //
 #include "mergebot/utils/similarity.h"
 
-#include <re2/re2.h>
-
 #include <cmath>
-#include <unordered_map>
+#include <cassert>
+#include <cstdint>
+#include <functional>
 
 namespace mergebot {
 namespace util {
 namespace details {
-int levenshtein_distance(const std::string& s1, const std::string& s2) {
-  std::vector<std::vector<int>> dp(s1.size() + 1,
-                                   std::vector<int>(s2.size() + 1));
-
-  for (size_t i = 0; i <= s1.size(); ++i) {
-    for (size_t j = 0; j <= s2.size(); ++j) {
-      if (i == 0) {
-        dp[i][j] = j;
-      } else if (j == 0) {
-        dp[i][j] = i;
-      } else {
-        dp[i][j] = std::min({dp[i - 1][j - 1] + (s1[i - 1] != s2[j - 1]),
-                             dp[i - 1][j] + 1, dp[i][j - 1] + 1});
+/// Hyyrö's block formulation of Myers' bit-vector algorithm, \p a is the
+/// shorter string, packed in ceil(|a| / 64) words. Only the last row of the
+/// current column is tracked, as the distance of \p a and the prefix of \p b.
+size_t myers_distance(std::string_view a, std::string_view b,
+                      size_t max_distance) {
+  constexpr size_t word_bits = 64;
+  const size_t words = (a.size() + word_bits - 1) / word_bits;
+  // match masks, per word and character
+  std::vector<uint64_t> peq(words * 256, 0);
+  for (size_t i = 0; i < a.size(); ++i) {
+    const auto c = static_cast<unsigned char>(a[i]);
+    peq[(i / word_bits) * 256 + c] |= uint64_t{1} << (i % word_bits);
+  }
+
+  struct Vertical {
+    uint64_t pos = ~uint64_t{0};
+    uint64_t neg = 0;
+  };
+  std::vector<Vertical> vecs(words);
+  const uint64_t last = uint64_t{1} << ((a.size() - 1) % word_bits);
+  size_t distance = a.size();
+
+  for (size_t j = 0; j < b.size(); ++j) {
+    const auto c = static_cast<unsigned char>(b[j]);
+    // the first row of the table grows by 1 per column
+    uint64_t hp_carry = 1;
+    uint64_t hn_carry = 0;
+    for (size_t w = 0; w < words; ++w) {
+      const uint64_t vp = vecs[w].pos;
+      const uint64_t vn = vecs[w].neg;
+      const uint64_t x = peq[w * 256 + c] | hn_carry;
+      const uint64_t d0 = (((x & vp) + vp) ^ vp) | x | vn;
+      uint64_t hp = vn | ~(d0 | vp);
+      uint64_t hn = d0 & vp;
+      if (w == words - 1) {
+        distance += (hp & last) != 0;
+        distance -= (hn & last) != 0;
       }
+      const uint64_t hp_in = hp_carry;
+      const uint64_t hn_in = hn_carry;
+      hp_carry = hp >> (word_bits - 1);
+      hn_carry = hn >> (word_bits - 1);
+      hp = (hp << 1) | hp_in;
+      hn = (hn << 1) | hn_in;
+      vecs[w].pos = hn | ~(d0 | hp);
+      vecs[w].neg = hp & d0;
+    }
+    // each remaining column lowers the distance by 1 at most
+    const size_t remaining = b.size() - j - 1;
+    if (distance > remaining && distance - remaining > max_distance) {
+      return max_distance + 1;
     }
   }
-
-  return dp[s1.size()][s2.size()];
+  return distance;
 }
 
-std::unordered_map<std::string, int> get_profile(const std::string& str,
-                                                 int k) {
-  std::unordered_map<std::string, int> profile;
-  std::string cleaned_str = str;
-  RE2::GlobalReplace(&cleaned_str, "\\s+", " ");
-
-  for (int i = 0; i <= static_cast<int>(cleaned_str.length()) - k; ++i) {
-    std::string kgram = cleaned_str.substr(i, k);
-    ++profile[kgram];
+/// Ukkonen's cutoff: only cells within \p max_distance of the diagonal can
+/// lead to a distance no more than \p max_distance. \p a is the shorter one.
+size_t banded_distance(std::string_view a, std::string_view b,
+                       size_t max_distance) {
+  const size_t k = max_distance;
+  const size_t unreachable = k + 1;
+  std::vector<size_t> prev(b.size() + 1), curr(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); ++j) {
+    prev[j] = std::min(j, unreachable);
   }
-  return profile;
-}
 
-double norm(const std::unordered_map<std::string, int>& profile) {
-  double sum = 0.0;
-  for (const auto& [kgram, count] : profile) {
-    sum += count * count;
+  for (size_t i = 1; i <= a.size(); ++i) {
+    const size_t lo = i > k ? i - k : 1;
+    const size_t hi = std::min(b.size(), i + k);
+    curr[lo - 1] = lo == 1 ? std::min(i, unreachable) : unreachable;
+    size_t row_min = curr[lo - 1];
+    for (size_t j = lo; j <= hi; ++j) {
+      const size_t cell =
+          std::min({prev[j - 1] + (a[i - 1] != b[j - 1]), prev[j] + 1,
+                    curr[j - 1] + 1, unreachable});
+      curr[j] = cell;
+      row_min = std::min(row_min, cell);
+    }
+    // read by the next row as the cell above the band
+    if (hi < b.size()) {
+      curr[hi + 1] = unreachable;
+    }
+    if (row_min > k) {
+      return unreachable;
+    }
+    std::swap(prev, curr);
   }
-  return std::sqrt(sum);
+  return prev[b.size()];
 }
 
+/// the whitespace class of RE2's \s
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
 }  // namespace details
 
+size_t levenshtein_distance(std::string_view s1, std::string_view s2,
+                            size_t max_distance) {
+  // common affixes don't take edits
+  while (!s1.empty() && !s2.empty() && s1.front() == s2.front()) {
+    s1.remove_prefix(1);
+    s2.remove_prefix(1);
+  }
+  while (!s1.empty() && !s2.empty() && s1.back() == s2.back()) {
+    s1.remove_suffix(1);
+    s2.remove_suffix(1);
+  }
+  if (s1.size() > s2.size()) {
+    std::swap(s1, s2);
+  }
+  if (s2.size() - s1.size() > max_distance) {
+    return max_distance + 1;
+  }
+  if (s1.empty()) {
+    return s2.size();
+  }
+
+  // a column of the band costs a few operations per cell, a column of the
+  // bit vectors a dozen per word
+  const size_t words = (s1.size() + 63) / 64;
+  if (words > 1 && max_distance < words) {
+    return details::banded_distance(s1, s2, max_distance);
+  }
+  return details::myers_distance(s1, s2, max_distance);
+}
+
 double cosine(const std::vector<double>& a, const std::vector<double>& b) {
   if (a.size() != b.size()) {
     return SimilarityErrKind::ErrDimensionMismatch;
@@ -74,37 +158,100 @@ double cosine(const std::vector<double>& a, const std::vector<double>& b) {
 }
 
 double string_levenshtein(const std::string& s1, const std::string& s2) {
-  int distance = details::levenshtein_distance(s1, s2);
+  size_t distance = levenshtein_distance(s1, s2);
   return 1.0 - static_cast<double>(distance) / std::max(s1.size(), s2.size());
 }
 
-double string_cosine(const std::string& s1, const std::string& s2, int k) {
-  if (s1.empty() || s2.empty()) {
-    return ErrEmptyVector;
+double string_levenshtein(std::string_view s1, std::string_view s2,
+                          double min_similarity) {
+  const size_t length = std::max(s1.size(), s2.size());
+  if (length == 0) {
+    return 1.0;
+  }
+  // 1 - distance / length >= min_similarity
+  const double slack = (1.0 - min_similarity) * length;
+  if (slack < 0) {
+    return 0;
+  }
+  const auto max_distance =
+      static_cast<size_t>(std::floor(std::min(slack, double(length)) + 1e-9));
+  size_t distance = levenshtein_distance(s1, s2, max_distance);
+  if (distance > max_distance) {
+    return 0;
   }
+  return 1.0 - static_cast<double>(distance) / length;
+}
 
-  auto profile1 = details::get_profile(s1, k);
-  auto profile2 = details::get_profile(s2, k);
+KGramSketch::KGramSketch(std::string_view str, int k)
+    : k(k), source_empty(str.empty()) {
+  assert(k > 0 && "k-gram of no character");
+  std::string cleaned;
+  cleaned.reserve(str.size());
+  for (char c : str) {
+    if (!details::is_space(c)) {
+      cleaned.push_back(c);
+    } else if (cleaned.empty() || cleaned.back() != ' ') {
+      // a space was pushed only for whitespace, so it's the same run
+      cleaned.push_back(' ');
+    }
+  }
+  if (cleaned.size() < static_cast<size_t>(k)) {
+    return;
+  }
 
-  if (profile1.empty() || profile2.empty()) {
-    return ErrZeroVector;
+  std::vector<uint64_t> grams;
+  grams.reserve(cleaned.size() - k + 1);
+  const std::string_view view(cleaned);
+  for (size_t i = 0; i + k <= view.size(); ++i) {
+    grams.push_back(std::hash<std::string_view>()(view.substr(i, k)));
   }
+  std::sort(grams.begin(), grams.end());
 
-  double dot_product = 0.0;
-  for (const auto& [kgram, count] : profile1) {
-    if (profile2.find(kgram) != profile2.end()) {
-      dot_product += count * profile2[kgram];
+  double squares = 0.0;
+  for (size_t i = 0; i < grams.size();) {
+    size_t j = i + 1;
+    while (j < grams.size() && grams[j] == grams[i]) {
+      ++j;
     }
+    hashes.push_back(grams[i]);
+    counts.push_back(static_cast<uint32_t>(j - i));
+    squares += static_cast<double>(j - i) * (j - i);
+    i = j;
   }
+  hashes.shrink_to_fit();
+  counts.shrink_to_fit();
+  norm = std::sqrt(squares);
+}
 
-  double norm1 = details::norm(profile1);
-  double norm2 = details::norm(profile2);
-
-  if (norm1 == 0.0 || norm2 == 0.0) {
+double sketch_cosine(const KGramSketch& a, const KGramSketch& b) {
+  assert((a.source_empty || b.source_empty || a.k == b.k) &&
+         "sketches of different k");
+  if (a.source_empty || b.source_empty) {
+    return ErrEmptyVector;
+  }
+  if (a.hashes.empty() || b.hashes.empty()) {
     return ErrZeroVector;
   }
 
-  return dot_product / (norm1 * norm2);
+  double dot_product = 0.0;
+  size_t i = 0, j = 0;
+  while (i < a.hashes.size() && j < b.hashes.size()) {
+    if (a.hashes[i] < b.hashes[j]) {
+      ++i;
+    } else if (b.hashes[j] < a.hashes[i]) {
+      ++j;
+    } else {
+      dot_product += static_cast<double>(a.counts[i++]) * b.counts[j++];
+    }
+  }
+  return dot_product / (a.norm * b.norm);
+}
+
+double string_cosine(const std::string& s1, const std::string& s2, int k) {
+  if (s1.empty() || s2.empty()) {
+    return ErrEmptyVector;
+  }
+  return sketch_cosine(KGramSketch(s1, k), KGramSketch(s2, k));
 }
 }  // namespace util
 }  // namespace mergebot
\ No newline at end of file
@@ -0,0 +1,247 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/model/matcher/BipartiteMatcher.h"
+#include "mergebot/core/model/NodeArena.h"
+#include "mergebot/utils/similarity.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace {
+using mergebot::sa::maxWeightAssignment;
+using mergebot::sa::NodeArena;
+using mergebot::sa::NodeKind;
+using mergebot::sa::ScoredPair;
+using mergebot::sa::SemanticNode;
+
+class NamedNode : public SemanticNode {
+public:
+  explicit NamedNode(const std::string &Name)
+      : SemanticNode(0, true, NodeKind::TEXTUAL, Name, "", Name, "",
+                     std::nullopt, "") {}
+
+  size_t computeSignature() const override {
+    return std::hash<std::string>()(DisplayName);
+  }
+};
+
+double totalScore(const std::vector<ScoredPair> &Pairs) {
+  return std::accumulate(
+      Pairs.begin(), Pairs.end(), 0.0,
+      [](double Sum, const ScoredPair &Pair) { return Sum + Pair.Score; });
+}
+
+/// best total over all assignments of the bases, by enumeration
+double bruteForce(size_t NumBase, size_t NumRevision,
+                  const std::vector<ScoredPair> &Edges) {
+  std::vector<std::vector<double>> W(NumBase,
+                                     std::vector<double>(NumRevision, 0.0));
+  for (const ScoredPair &Edge : Edges) {
+    W[Edge.Base][Edge.Revision] = Edge.Score;
+  }
+  double Best = 0;
+  std::vector<bool> Taken(NumRevision, false);
+  std::function<void(size_t, double)> Search = [&](size_t Base, double Sum) {
+    if (Base == NumBase) {
+      Best = std::max(Best, Sum);
+      return;
+    }
+    Search(Base + 1, Sum);
+    for (size_t Rev = 0; Rev < NumRevision; ++Rev) {
+      if (!Taken[Rev] && W[Base][Rev] > 0) {
+        Taken[Rev] = true;
+        Search(Base + 1, Sum + W[Base][Rev]);
+        Taken[Rev] = false;
+      }
+    }
+  };
+  Search(0, 0.0);
+  return Best;
+}
+} // namespace
+
+TEST(BipartiteMatcherTest, AssignmentIsOptimal) {
+  std::mt19937 Gen(20261018);
+  std::uniform_real_distribution<double> Score(0.0, 1.0);
+  for (int Round = 0; Round < 200; ++Round) {
+    const size_t NumBase = 1 + Gen() % 6;
+    const size_t NumRevision = 1 + Gen() % 6;
+    std::vector<ScoredPair> Edges;
+    for (uint32_t B = 0; B < NumBase; ++B) {
+      for (uint32_t R = 0; R < NumRevision; ++R) {
+        if (Gen() % 2) {
+          Edges.push_back({B, R, Score(Gen)});
+        }
+      }
+    }
+
+    std::vector<ScoredPair> Assigned =
+        maxWeightAssignment(NumBase, NumRevision, Edges);
+    std::vector<bool> BaseUsed(NumBase), RevisionUsed(NumRevision);
+    for (const ScoredPair &Pair : Assigned) {
+      EXPECT_FALSE(BaseUsed[Pair.Base]);
+      EXPECT_FALSE(RevisionUsed[Pair.Revision]);
+      BaseUsed[Pair.Base] = RevisionUsed[Pair.Revision] = true;
+    }
+    EXPECT_TRUE(std::is_sorted(Assigned.begin(), Assigned.end(),
+                               [](const ScoredPair &L, const ScoredPair &R) {
+                                 return L.Base < R.Base;
+                               }));
+    EXPECT_NEAR(totalScore(Assigned),
+                bruteForce(NumBase, NumRevision, Edges), 1e-9);
+  }
+}
+
+TEST(BipartiteMatcherTest, MatchesAndErasesNodes) {
+  NodeArena Arena;
+  auto node = [&](const std::string &Name) -> SemanticNode * {
+    auto *Node = Arena.create<NamedNode>(Name);
+    Node->seal();
+    return Node;
+  };
+  std::vector<SemanticNode *> BaseNodes = {
+      node("alpha"), node("beta"), node("gamma")};
+  std::vector<SemanticNode *> RevisionNodes = {
+      node("gamma2"), node("alpha2"), node("delta")};
+
+  // the greedy choice of alpha -> alpha2 would leave beta unmatched
+  auto Matcher = mergebot::sa::makeBipartiteMatcher<SemanticNode>(
+      [](const SemanticNode *Base, const SemanticNode *Revision) {
+        if (Revision->DisplayName == Base->DisplayName + "2") {
+          return 0.9;
+        }
+        if (Base->DisplayName == "alpha" && Revision->DisplayName == "delta") {
+          return 0.95;
+        }
+        if (Base->DisplayName == "beta" && Revision->DisplayName == "delta") {
+          return 0.7;
+        }
+        return 0.1;
+      },
+      0.5);
+  mergebot::sa::TwoWayMatching Matching;
+  auto Matched = Matcher.match(
+      Matching, BaseNodes, RevisionNodes,
+      [](const SemanticNode *Base, const SemanticNode *) {
+        return Base->DisplayName != "gamma";
+      });
+
+  ASSERT_EQ(Matched.size(), 2);
+  EXPECT_EQ(Matched[0].first->DisplayName, "alpha");
+  EXPECT_EQ(Matched[0].second->DisplayName, "alpha2");
+  EXPECT_EQ(Matched[1].first->DisplayName, "beta");
+  EXPECT_EQ(Matched[1].second->DisplayName, "delta");
+  EXPECT_EQ(Matching.OneOneMatching.size(), 2);
+  ASSERT_EQ(BaseNodes.size(), 1);
+  EXPECT_EQ(BaseNodes[0]->DisplayName, "gamma");
+  ASSERT_EQ(RevisionNodes.size(), 1);
+  EXPECT_EQ(RevisionNodes[0]->DisplayName, "gamma2");
+}
+
+TEST(BipartiteMatcherTest, BlocksLargeInputs) {
+  NodeArena Arena;
+  auto node = [&](const std::string &Name) -> SemanticNode * {
+    auto *Node = Arena.create<NamedNode>(Name);
+    Node->seal();
+    return Node;
+  };
+  const std::vector<std::string> Verbs = {"open",  "close", "read",  "write",
+                                          "flush", "sync",  "seek",  "stat",
+                                          "lock",  "merge"};
+  const std::vector<std::string> Nouns = {"file",   "table", "block",
+                                          "index",  "log",   "cache",
+                                          "record", "batch"};
+  std::vector<SemanticNode *> BaseNodes, RevisionNodes;
+  for (const std::string &Verb : Verbs) {
+    for (const std::string &Noun : Nouns) {
+      BaseNodes.push_back(node("Status " + Verb + "_" + Noun +
+                               "(const Options& options, Env* env)"));
+      RevisionNodes.push_back(node("Status " + Verb + "_" + Noun +
+                                   "(const Options& opts, Env* env)"));
+    }
+  }
+  using Matcher = mergebot::sa::BipartiteMatcher<
+      SemanticNode, double (*)(const SemanticNode *, const SemanticNode *)>;
+  ASSERT_GE(BaseNodes.size() * RevisionNodes.size(), Matcher::MinBlockedPairs);
+
+  auto Blocked = mergebot::sa::makeBipartiteMatcher<SemanticNode>(
+      [](const SemanticNode *Base, const SemanticNode *Revision) {
+        return mergebot::util::string_levenshtein(Base->DisplayName,
+                                                  Revision->DisplayName);
+      },
+      0.9);
+  Blocked.block(
+      {{[](const SemanticNode &Node) -> const mergebot::util::KGramSketch & {
+        return Node.signatureSketch();
+      }}});
+  mergebot::sa::TwoWayMatching Matching;
+  auto Matched = Blocked.match(Matching, BaseNodes, RevisionNodes);
+
+  EXPECT_EQ(Matched.size(), Verbs.size() * Nouns.size());
+  for (const auto &[Base, Revision] : Matched) {
+    EXPECT_EQ(Base->DisplayName.substr(0, Base->DisplayName.find('(')),
+              Revision->DisplayName.substr(0, Revision->DisplayName.find('(')));
+  }
+  EXPECT_TRUE(BaseNodes.empty());
+  EXPECT_TRUE(RevisionNodes.empty());
+}
+
+TEST(BipartiteMatcherTest, ParentlessNodesBlockWithAny) {
+  NodeArena Arena;
+  auto node = [&](const std::string &Name,
+                  SemanticNode *Parent) -> SemanticNode * {
+    auto *Node = Arena.create<NamedNode>(Name);
+    Node->Parent = Parent;
+    Node->seal();
+    return Node;
+  };
+  const std::unordered_map<size_t, size_t> RefactoredTypes;
+  auto Table = node("class Table", nullptr);
+  auto Index = node("class Index", nullptr);
+
+  // the revision moved the free functions into classes
+  std::vector<SemanticNode *> BaseNodes, RevisionNodes;
+  for (int i = 0; i < 80; ++i) {
+    const std::string Name = "Status op_" + std::to_string(i) +
+                             "(const Options& options, Env* env)";
+    BaseNodes.push_back(node(Name, nullptr));
+    RevisionNodes.push_back(node(Name, i % 2 ? Table : Index));
+  }
+  ASSERT_TRUE(mergebot::sa::compatibleParents(
+      BaseNodes[0], RevisionNodes[0], RefactoredTypes));
+  EXPECT_EQ(mergebot::sa::parentAffinity(*BaseNodes[0], true, RefactoredTypes),
+            std::nullopt);
+  EXPECT_EQ(
+      mergebot::sa::parentAffinity(*RevisionNodes[0], false, RefactoredTypes),
+      Index->hashSignature());
+
+  auto Blocked = mergebot::sa::makeBipartiteMatcher<SemanticNode>(
+      [](const SemanticNode *Base, const SemanticNode *Revision) {
+        return mergebot::util::string_levenshtein(Base->DisplayName,
+                                                  Revision->DisplayName);
+      },
+      0.9);
+  Blocked.block(
+      {{[](const SemanticNode &Node) -> const mergebot::util::KGramSketch & {
+         return Node.signatureSketch();
+       }},
+       [&](const SemanticNode &Node, bool IsBase) {
+         return mergebot::sa::parentAffinity(Node, IsBase, RefactoredTypes);
+       }});
+  mergebot::sa::TwoWayMatching Matching;
+  auto Matched = Blocked.match(
+      Matching, BaseNodes, RevisionNodes,
+      [&](const SemanticNode *Base, const SemanticNode *Revision) {
+        return mergebot::sa::compatibleParents(Base, Revision,
+                                               RefactoredTypes);
+      });
+
+  EXPECT_EQ(Matched.size(), 80);
+  for (const auto &[Base, Revision] : Matched) {
+    EXPECT_EQ(Base->DisplayName, Revision->DisplayName);
+  }
+}
@@ -0,0 +1,63 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/model/matcher/CandidateBlocker.h"
+
+#include <gtest/gtest.h>
+
+using mergebot::sa::CandidateBlocker;
+using mergebot::util::KGramSketch;
+
+TEST(CandidateBlockerTest, BandsForRecall) {
+  EXPECT_EQ(CandidateBlocker::bandsForRecall(1.0), 0);
+  EXPECT_EQ(CandidateBlocker::bandsForRecall(0.95), 32);
+  EXPECT_LT(CandidateBlocker::bandsForRecall(0.5),
+            CandidateBlocker::bandsForRecall(0.95));
+  EXPECT_GE(CandidateBlocker::bandsForRecall(0.01), 1);
+}
+
+TEST(CandidateBlockerTest, PairsOnlyWithinSharedBuckets) {
+  const size_t Bands = CandidateBlocker::bandsForRecall(0.95);
+  const KGramSketch Put("Status DBImpl::Put(const WriteOptions& options)");
+  const KGramSketch PutRenamed("Status DBImpl::Put(const WriteOptions& opts)");
+  const KGramSketch Recover("bool VersionSet::Recover(bool read_only) const");
+  const KGramSketch Short("f()");
+
+  CandidateBlocker Blocker(3, 4);
+  Blocker.add(true, 0, CandidateBlocker::sketchKeys(Put, Bands, 0), 1);
+  Blocker.add(true, 1, CandidateBlocker::sketchKeys(Recover, Bands, 0), 1);
+  Blocker.add(true, 2, CandidateBlocker::sketchKeys(Short, Bands, 0), 1);
+  Blocker.add(false, 0, CandidateBlocker::sketchKeys(PutRenamed, Bands, 0), 1);
+  Blocker.add(false, 1, CandidateBlocker::sketchKeys(Recover, Bands, 0), 1);
+  // same sketch, other affinity
+  Blocker.add(false, 2, CandidateBlocker::sketchKeys(Put, Bands, 0), 2);
+  Blocker.add(false, 3, CandidateBlocker::sketchKeys(Short, Bands, 0), 1);
+
+  std::vector<std::vector<uint32_t>> Candidates = Blocker.candidates();
+  ASSERT_EQ(Candidates.size(), 3);
+  EXPECT_EQ(Candidates[0], std::vector<uint32_t>({0}));
+  EXPECT_EQ(Candidates[1], std::vector<uint32_t>({1}));
+  // sketches of no k-gram share a bucket
+  EXPECT_EQ(Candidates[2], std::vector<uint32_t>({3}));
+}
+
+TEST(CandidateBlockerTest, NoAffinityPairsWithAny) {
+  const size_t Bands = CandidateBlocker::bandsForRecall(0.95);
+  const std::vector<uint64_t> Keys = CandidateBlocker::sketchKeys(
+      KGramSketch("Status DBImpl::Put(const WriteOptions& options)"), Bands,
+      0);
+
+  CandidateBlocker Blocker(3, 3);
+  Blocker.add(true, 0, Keys, 1);
+  Blocker.add(true, 1, Keys, 2);
+  Blocker.add(true, 2, Keys);
+  Blocker.add(false, 0, Keys, 1);
+  Blocker.add(false, 1, Keys, 2);
+  Blocker.add(false, 2, Keys);
+
+  std::vector<std::vector<uint32_t>> Candidates = Blocker.candidates();
+  ASSERT_EQ(Candidates.size(), 3);
+  EXPECT_EQ(Candidates[0], std::vector<uint32_t>({0, 2}));
+  EXPECT_EQ(Candidates[1], std::vector<uint32_t>({1, 2}));
+  EXPECT_EQ(Candidates[2], std::vector<uint32_t>({0, 1, 2}));
+}
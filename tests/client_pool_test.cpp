@@ -0,0 +1,50 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include <gtest/gtest.h>
+
+#include "mergebot/lsp/client_pool.h"
+
+using namespace mergebot::lsp;
+
+namespace {
+// a python script answering every request, copied from tests/mock
+constexpr const char *FakeServer = "./mock/fake_lsp_server";
+}  // namespace
+
+TEST(ClientPoolTest, WarmInstancesAreReusedPerKey) {
+  ClientPool::Options options;
+  options.maxIdle = 1;
+  ClientPool pool(options, FakeServer);
+  {
+    auto lease = pool.Acquire({"proj", "/tmp/ms/ours", "cdb"});
+    ASSERT_TRUE(lease);
+    EXPECT_FALSE(lease.Reused());
+  }
+  EXPECT_EQ(pool.IdleCount(), 1u);
+
+  {
+    auto lease = pool.Acquire({"proj", "/tmp/ms/ours", "cdb"});
+    ASSERT_TRUE(lease);
+    EXPECT_TRUE(lease.Reused());
+    auto other = pool.Acquire({"proj", "/tmp/ms/theirs", "cdb"});
+    ASSERT_TRUE(other);
+    EXPECT_FALSE(other.Reused());
+  }
+  // only one is kept idle, the other one is shut down
+  EXPECT_EQ(pool.IdleCount(), 1u);
+  pool.Clear();
+  EXPECT_EQ(pool.IdleCount(), 0u);
+}
+
+TEST(ClientPoolTest, RecycleAfterRequestBudget) {
+  ClientPool::Options options;
+  options.maxRequests = 1;
+  ClientPool pool(options, FakeServer);
+  {
+    auto lease = pool.Acquire({"proj", "/tmp/ms/ours", "cdb"});
+    ASSERT_TRUE(lease);
+    lease->Sync();
+  }
+  EXPECT_EQ(pool.IdleCount(), 0u);
+}
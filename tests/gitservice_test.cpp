@@ -9,6 +9,7 @@
 
 #include "mergebot/core/model/SimplifiedDiffDelta.h"
 #include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
 
 namespace mergebot {
 namespace sa {
@@ -59,6 +60,40 @@ TEST_F(RepoBasedTest, DumpTreeObjectTest) {
                commit_hash);
 }
 
+TEST_F(RepoBasedTest, DumpTreeObjectWithBlobStoreTest) {
+  std::string commit_hash = "28d1a0c6f59cfdc692a7274f8816b87af7a1d8cc";
+  const std::string blob_store = "/tmp/rocksdb-blobs";
+  ASSERT_TRUE(mergebot::util::dump_tree_object_to("/tmp/rocksdb-ours",
+                                                  commit_hash, rocksdb_path,
+                                                  blob_store));
+  ASSERT_TRUE(mergebot::util::dump_tree_object_to("/tmp/rocksdb-theirs",
+                                                  commit_hash, rocksdb_path,
+                                                  blob_store));
+  const std::string ours = mergebot::util::file_get_content(
+      "/tmp/rocksdb-ours/include/rocksdb/db.h");
+  EXPECT_FALSE(ours.empty());
+  EXPECT_EQ(ours, mergebot::util::file_get_content(
+                      "/tmp/rocksdb-theirs/include/rocksdb/db.h"));
+  fs::remove_all("/tmp/rocksdb-ours");
+  fs::remove_all("/tmp/rocksdb-theirs");
+  fs::remove_all(blob_store);
+}
+
+TEST(FileIOTest, CloneOrLinkFile) {
+  const fs::path dir = fs::temp_directory_path() / "mergebot-clone-test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  const std::string source = dir / "source";
+  const std::string destination = dir / "destination";
+  mergebot::util::file_overwrite_content(source, "blob");
+
+  EXPECT_TRUE(mergebot::util::clone_or_link_file(source, destination));
+  EXPECT_EQ(mergebot::util::file_get_content(destination), "blob");
+  // never overwrite an existing file
+  EXPECT_FALSE(mergebot::util::clone_or_link_file(source, destination));
+  fs::remove_all(dir);
+}
+
 // TEST_F(RepoBasedTest, FullCommitHashTest) {
 //   // test resolve (full hash)
 //   std::string validHash = "8ea21a778bb90d2f8c352b732c13ab64484eb386";
@@ -186,5 +221,55 @@ TEST_F(RepoBasedTest, RevResolution) {
   EXPECT_FALSE(commit_hash.has_value()) << "fake tag should fail to resolve";
 }
 
+TEST_F(RepoBasedTest, SharedRepositoryAndMergeBase) {
+  // a project and its git dir share one handle
+  auto repo = util::GitRepository::shared(rocksdb_path);
+  ASSERT_NE(repo, nullptr);
+  EXPECT_EQ(repo, util::GitRepository::shared(
+                      fs::path(rocksdb_path).parent_path().string() + "/"));
+
+  std::string ours = "8ea21a778bb90d2f8c352b732c13ab64484eb386";
+  std::string theirs = "12966ec1bb22fecf9f43099b13626953d5d3e661";
+  auto base = util::git_merge_base(ours, theirs, rocksdb_path);
+  ASSERT_TRUE(base.has_value());
+  EXPECT_EQ(base.value().size(), GIT_OID_MAX_HEXSIZE);
+  // answered from the cache the second time
+  EXPECT_EQ(util::git_merge_base(ours, theirs, rocksdb_path), base);
+
+  auto conflicts = util::list_conflict_paths(rocksdb_path);
+  EXPECT_TRUE(conflicts.has_value()) << "index should always be readable";
+}
+
+TEST(GitServiceTest, PruneBlobStore) {
+  const fs::path root = fs::temp_directory_path() / "mergebot_blob_store_test";
+  const fs::path store = root / "blobs";
+  fs::remove_all(root);
+  fs::create_directories(store / "ab");
+  fs::create_directories(store / "cd");
+  fs::create_directories(root / "ours");
+  util::file_put_content((store / "ab" / "linked").string(), "linked",
+                         std::ios::out);
+  util::file_put_content((store / "ab" / "orphan").string(), "orphan",
+                         std::ios::out);
+  util::file_put_content((store / "cd" / "orphan").string(), "12345",
+                         std::ios::out);
+  util::file_put_content((store / "cd" / "orphan.42.7").string(), "partial",
+                         std::ios::out);
+  fs::create_hard_link(store / "ab" / "linked", root / "ours" / "a.h");
+
+  EXPECT_EQ(util::prune_blob_store(store.string()), 11);
+  EXPECT_TRUE(fs::exists(store / "ab" / "linked"));
+  EXPECT_FALSE(fs::exists(store / "ab" / "orphan"));
+  EXPECT_FALSE(fs::exists(store / "cd" / "orphan"));
+  EXPECT_TRUE(fs::exists(store / "cd" / "orphan.42.7"));
+
+  // the side tree is gone, so is the last reference
+  fs::remove_all(root / "ours");
+  EXPECT_EQ(util::prune_blob_store(store.string()), 6);
+  EXPECT_FALSE(fs::exists(store / "ab"));
+  EXPECT_EQ(util::prune_blob_store((root / "missing").string()), 0);
+  fs::remove_all(root);
+}
+
 }  // namespace sa
 }  // namespace mergebot
\ No newline at end of file
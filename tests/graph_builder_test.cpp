@@ -0,0 +1,105 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/semantic/GraphBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <boost/range/iterator_range.hpp>
+#include <tuple>
+
+#include "mergebot/core/model/node/TextualNode.h"
+
+namespace {
+using mergebot::sa::EdgeKind;
+using mergebot::sa::GraphBuilder;
+using mergebot::sa::NodeArena;
+using mergebot::sa::NodeKind;
+using mergebot::sa::SemanticEdge;
+using mergebot::sa::SemanticNode;
+using mergebot::sa::TextualNode;
+using Graph = GraphBuilder::SemanticGraph;
+
+/// owns the nodes of the tests
+NodeArena Arena;
+
+SemanticNode *textual(int ID, const std::string &Text,
+                      const std::string &TUPath) {
+  return Arena.create<TextualNode>(
+      ID, false, NodeKind::TEXTUAL, Text, Text, Text, "",
+      mergebot::ts::Point{0, 0}, "", std::string(Text), 0, 1, TUPath);
+}
+
+/// a unit as a worker builds it: ids local to it, a translation unit node
+/// containing a use of the class Widget and the class itself, brought in by
+/// the header both units include
+GraphBuilder::TranslationUnitGraph unitOf(const std::string &TUPath,
+                                          const std::string &Use,
+                                          int NodeCount) {
+  GraphBuilder::TranslationUnitGraph Unit;
+  auto TU = boost::add_vertex(textual(0, TUPath, TUPath), Unit.G);
+  auto Widget = boost::add_vertex(textual(1, "class Widget", TUPath), Unit.G);
+  auto User = boost::add_vertex(textual(2, Use, TUPath), Unit.G);
+  boost::add_edge(TU, Widget, SemanticEdge(0, EdgeKind::CONTAIN), Unit.G);
+  boost::add_edge(TU, User, SemanticEdge(1, EdgeKind::CONTAIN), Unit.G);
+  boost::add_edge(User, Widget, SemanticEdge(2, EdgeKind::REFERENCE), Unit.G);
+  Unit.NodeCount = NodeCount;
+  Unit.EdgeCount = 3;
+  return Unit;
+}
+
+/// (source id, target id, edge id, kind) of the out edges of each vertex, in
+/// vertex order
+std::vector<std::tuple<int, int, int, EdgeKind>> edgesOf(const Graph &G) {
+  std::vector<std::tuple<int, int, int, EdgeKind>> Edges;
+  for (auto V : boost::make_iterator_range(boost::vertices(G))) {
+    for (auto E : boost::make_iterator_range(boost::out_edges(V, G))) {
+      Edges.emplace_back(G[V]->ID, G[boost::target(E, G)]->ID, G[E].ID,
+                         G[E].Kind);
+    }
+  }
+  return Edges;
+}
+} // namespace
+
+TEST(GraphBuilderTest, MergesTranslationUnitsInOrder) {
+  // what the builder had before the translation units
+  Graph G;
+  boost::add_vertex(textual(0, "root", ""), G);
+  int NodeCount = 1;
+  int EdgeCount = 0;
+
+  // the first unit took an id for a node it dropped
+  GraphBuilder::TranslationUnitGraph A =
+      unitOf("a.cpp", "Widget *make();", 4);
+  GraphBuilder::TranslationUnitGraph B =
+      unitOf("b.cpp", "void draw(Widget &);", 3);
+  GraphBuilder::mergeTranslationUnit(G, NodeCount, EdgeCount, A);
+  GraphBuilder::mergeTranslationUnit(G, NodeCount, EdgeCount, B);
+
+  // the ids a serial build would have given
+  EXPECT_EQ(NodeCount, 8);
+  EXPECT_EQ(EdgeCount, 6);
+  ASSERT_EQ(boost::num_vertices(G), 7);
+  std::vector<int> IDs;
+  std::vector<std::string> Names;
+  for (auto V : boost::make_iterator_range(boost::vertices(G))) {
+    IDs.push_back(G[V]->ID);
+    Names.push_back(G[V]->DisplayName);
+  }
+  EXPECT_EQ(IDs, (std::vector<int>{0, 1, 2, 3, 5, 6, 7}));
+  EXPECT_EQ(Names, (std::vector<std::string>{
+                       "root", "a.cpp", "class Widget", "Widget *make();",
+                       "b.cpp", "class Widget", "void draw(Widget &);"}));
+
+  // the Widget of each unit stays its own, referenced from its own unit only
+  using Edge = std::tuple<int, int, int, EdgeKind>;
+  EXPECT_EQ(edgesOf(G), (std::vector<Edge>{
+                            {1, 2, 0, EdgeKind::CONTAIN},
+                            {1, 3, 1, EdgeKind::CONTAIN},
+                            {3, 2, 2, EdgeKind::REFERENCE},
+                            {5, 6, 3, EdgeKind::CONTAIN},
+                            {5, 7, 4, EdgeKind::CONTAIN},
+                            {7, 6, 5, EdgeKind::REFERENCE},
+                        }));
+}
@@ -0,0 +1,238 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/HandlerChain.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+#include "mergebot/core/sa_utility.h"
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace fs = mergebot::fs;
+using mergebot::sa::ConflictBlock;
+using mergebot::sa::ConflictFile;
+using mergebot::sa::HandlerChain;
+using mergebot::sa::ProjectMeta;
+using mergebot::sa::SAHandler;
+
+namespace {
+/// what each handler saw and resolved, keyed by file name
+struct ChainLog {
+  std::mutex Mutex;
+  std::map<std::string, std::vector<std::string>> Visits;
+  std::map<std::string, std::vector<std::string>> ResolvedBy;
+};
+
+/// resolves the files whose name contains Pattern, all of their blocks at
+/// once, and else the blocks containing Pattern, publishing their resolutions
+/// as the real handlers do. An empty Pattern resolves nothing
+class RecordingHandler : public SAHandler {
+public:
+  RecordingHandler(ProjectMeta Meta, std::string Name, std::string Pattern,
+                   bool PerFile, ChainLog &Log)
+      : SAHandler(std::move(Meta), std::move(Name)),
+        Pattern_(std::move(Pattern)), PerFile_(PerFile), Log_(Log) {}
+
+  bool isPerFile() const noexcept override { return PerFile_; }
+
+private:
+  void resolveConflictFiles(std::vector<ConflictFile> &ConflictFiles) override {
+    for (ConflictFile &CF : ConflictFiles) {
+      const std::string File = fs::path(CF.Filename).filename().string();
+      std::lock_guard<std::mutex> Lock(Log_.Mutex);
+      Log_.Visits[File].emplace_back(name());
+      if (Pattern_.empty()) {
+        continue;
+      }
+      if (File.find(Pattern_) != std::string::npos) {
+        CF.Resolved = true;
+        Log_.ResolvedBy[File].emplace_back(name());
+        continue;
+      }
+      std::vector<mergebot::server::BlockResolutionResult> Results;
+      for (ConflictBlock &CB : CF.ConflictBlocks) {
+        if (CB.ConflictRange.find(Pattern_) != std::string::npos) {
+          CB.Resolved = true;
+          Results.push_back({.index = CB.Index, .code = std::string(name())});
+        }
+      }
+      if (Results.empty()) {
+        continue;
+      }
+      mergebot::sa::marshalResolutionResult(
+          (fs::path(Meta.MSCacheDir) / "resolutions" / File).string(), File,
+          Results);
+      CF.Resolved = std::all_of(
+          CF.ConflictBlocks.begin(), CF.ConflictBlocks.end(),
+          [](const ConflictBlock &CB) { return CB.Resolved; });
+      if (CF.Resolved) {
+        Log_.ResolvedBy[File].emplace_back(name());
+      }
+    }
+    mergebot::sa::tidyUpConflictFiles(ConflictFiles);
+  }
+
+  std::string Pattern_;
+  bool PerFile_;
+  ChainLog &Log_;
+};
+
+class HandlerChainTest : public ::testing::Test {
+protected:
+  fs::path Root;
+  std::vector<std::string> Paths;
+
+  void SetUp() override {
+    Root = fs::temp_directory_path() / "mergebot_handler_chain_test";
+    fs::remove_all(Root);
+    fs::create_directories(Root / "conflicts");
+    fs::create_directories(Root / "resolutions");
+    for (const char *Name :
+         {"a_style.cpp", "b_ast.cpp", "c_text.cpp", "d_none.cpp",
+          "e_style_text.cpp", "f_ast.cpp", "g_text.cpp", "h_style_ast.cpp",
+          "i_none.h", "j_text.h"}) {
+      const fs::path Path = Root / "conflicts" / Name;
+      mergebot::util::file_put_content(Path.string(),
+                                       "int a;\n"
+                                       "<<<<<<< ours\n"
+                                       "int b = 1;\n"
+                                       "=======\n"
+                                       "int b = 2;\n"
+                                       ">>>>>>> theirs\n",
+                                       std::ios::out);
+      Paths.push_back(Path.string());
+    }
+    // blocks for each stage, resolved by the AST stage last in pipelined mode
+    // but before the text one in sequential mode, and one for none of them
+    std::string Mixed = "int a;\n";
+    for (const char *Stage : {"style", "ast", "text", "none", "ast", "text"}) {
+      Mixed += std::string("<<<<<<< ours\n"
+                           "int b = 1; // ") +
+               Stage +
+               "\n"
+               "=======\n"
+               "int b = 2;\n"
+               ">>>>>>> theirs\n";
+    }
+    const fs::path MixedPath = Root / "conflicts" / "k_mixed.cpp";
+    mergebot::util::file_put_content(MixedPath.string(), Mixed, std::ios::out);
+    Paths.push_back(MixedPath.string());
+  }
+
+  void TearDown() override {
+    ::unsetenv("MERGEBOT_PIPELINED");
+    fs::remove_all(Root);
+  }
+
+  /// the chain of production in shape: per-file, batched, per-file, and a
+  /// batched sink collecting the leftovers
+  void runChain(ChainLog &Log) {
+    ProjectMeta Meta;
+    Meta.Project = "handler_chain_test";
+    Meta.MSCacheDir = Root.string();
+    std::vector<std::unique_ptr<SAHandler>> Handlers;
+    Handlers.push_back(
+        std::make_unique<RecordingHandler>(Meta, "style", "style", true, Log));
+    Handlers.push_back(
+        std::make_unique<RecordingHandler>(Meta, "ast", "ast", false, Log));
+    Handlers.push_back(
+        std::make_unique<RecordingHandler>(Meta, "text", "text", true, Log));
+    Handlers.push_back(
+        std::make_unique<RecordingHandler>(Meta, "sink", "", false, Log));
+    HandlerChain Chain(std::move(Handlers), Paths);
+    Chain.handle();
+  }
+};
+} // namespace
+
+TEST_F(HandlerChainTest, PipelinedResolvesEachFileOnce) {
+  ::unsetenv("MERGEBOT_PIPELINED");
+  ASSERT_TRUE(HandlerChain::pipelined());
+  ChainLog Log;
+  runChain(Log);
+
+  // every file but the none and mixed ones, by exactly one handler
+  EXPECT_EQ(Log.ResolvedBy.size(), Paths.size() - 3);
+  for (const auto &[File, Handlers] : Log.ResolvedBy) {
+    EXPECT_EQ(Handlers.size(), 1) << File;
+  }
+
+  // resolved by an earlier stage, never seen by a later one
+  for (const char *File : {"a_style.cpp", "e_style_text.cpp",
+                           "h_style_ast.cpp"}) {
+    EXPECT_EQ(Log.Visits[File], std::vector<std::string>{"style"}) << File;
+  }
+  for (const char *File : {"c_text.cpp", "g_text.cpp", "j_text.h"}) {
+    EXPECT_EQ(Log.Visits[File], (std::vector<std::string>{"style", "text"}))
+        << File;
+  }
+  // the batched stages only get what the per-file ones left
+  for (const char *File : {"b_ast.cpp", "f_ast.cpp"}) {
+    EXPECT_EQ(Log.Visits[File],
+              (std::vector<std::string>{"style", "text", "ast"}))
+        << File;
+  }
+  for (const char *File : {"d_none.cpp", "i_none.h"}) {
+    EXPECT_EQ(Log.Visits[File].back(), "sink") << File;
+  }
+  // a file partly resolved per file goes on with the blocks left only
+  EXPECT_EQ(Log.Visits["k_mixed.cpp"],
+            (std::vector<std::string>{"style", "text", "ast", "sink"}));
+}
+
+TEST_F(HandlerChainTest, PipelinedMatchesSequential) {
+  ::setenv("MERGEBOT_PIPELINED", "0", 1);
+  ASSERT_FALSE(HandlerChain::pipelined());
+  ChainLog Sequential;
+  runChain(Sequential);
+  const fs::path MixedResolution = Root / "resolutions" / "k_mixed.cpp";
+  const std::string SequentialResolution =
+      mergebot::util::file_get_content(MixedResolution.string());
+  fs::remove_all(Root / "resolutions");
+  fs::create_directories(Root / "resolutions");
+
+  ::unsetenv("MERGEBOT_PIPELINED");
+  ChainLog Pipelined;
+  runChain(Pipelined);
+  const std::string PipelinedResolution =
+      mergebot::util::file_get_content(MixedResolution.string());
+
+  EXPECT_EQ(Pipelined.ResolvedBy, Sequential.ResolvedBy);
+  // the same leftovers reach the end of the chain
+  auto Leftovers = [](const ChainLog &Log) {
+    std::vector<std::string> Files;
+    for (const auto &[File, Handlers] : Log.Visits) {
+      if (Handlers.back() == "sink") {
+        Files.push_back(File);
+      }
+    }
+    return Files;
+  };
+  EXPECT_EQ(Leftovers(Pipelined), Leftovers(Sequential));
+  EXPECT_EQ(Leftovers(Pipelined),
+            (std::vector<std::string>{"d_none.cpp", "i_none.h",
+                                      "k_mixed.cpp"}));
+
+  // the blocks of the mixed file are resolved in another handler order, to
+  // the same resolution file
+  ASSERT_FALSE(PipelinedResolution.empty());
+  EXPECT_EQ(PipelinedResolution, SequentialResolution);
+  const mergebot::server::FileResolutionResult Resolution =
+      nlohmann::json::parse(PipelinedResolution);
+  std::vector<std::pair<int, std::string>> Blocks;
+  for (const auto &Block : Resolution.resolutions) {
+    Blocks.emplace_back(Block.index, Block.code);
+  }
+  EXPECT_EQ(Blocks, (std::vector<std::pair<int, std::string>>{
+                        {1, "style"},
+                        {2, "ast"},
+                        {3, "text"},
+                        {5, "ast"},
+                        {6, "text"}}));
+}
@@ -0,0 +1,84 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/semantic/IndexedCompDB.h"
+
+#include <gtest/gtest.h>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace {
+namespace fs = mergebot::fs;
+using mergebot::sa::IndexedCompDB;
+
+class IndexedCompDBTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Root = fs::temp_directory_path() / "mb-indexed-compdb";
+    fs::remove_all(Root);
+    fs::create_directories(Root);
+    CompDBPath = (Root / "compile_commands.json").string();
+    IndexPath = (Root / "cache" / "compile_commands.idx").string();
+    mergebot::util::file_overwrite_content(CompDBPath, R"([
+  {"directory": "/p/build", "file": "../src/a.cpp", "output": "a.o",
+   "arguments": ["clang++", "-I/p/include", "-c", "../src/a.cpp"]},
+  {"directory": "/p/build", "file": "/p/src/b.cpp",
+   "command": "clang++ -DMSG=\"a b\" -c /p/src/b.cpp"},
+  {"directory": "/p/build", "file": "/p/src/a.cpp",
+   "command": "clang++ -DALT -c /p/src/a.cpp"}
+])");
+  }
+
+  void TearDown() override { fs::remove_all(Root); }
+
+  fs::path Root;
+  std::string CompDBPath;
+  std::string IndexPath;
+};
+} // namespace
+
+TEST_F(IndexedCompDBTest, LookupParsesEntriesOfTheFile) {
+  std::string ErrMsg;
+  auto CompDB = IndexedCompDB::load(CompDBPath, IndexPath, ErrMsg);
+  ASSERT_TRUE(CompDB) << ErrMsg;
+  EXPECT_EQ(CompDB->size(), 3u);
+  EXPECT_EQ(CompDB->getAllFiles(),
+            (std::vector<std::string>{"/p/src/a.cpp", "/p/src/b.cpp"}));
+
+  auto Commands = CompDB->getCompileCommands("/p/src/a.cpp");
+  ASSERT_EQ(Commands.size(), 2u);
+  EXPECT_EQ(Commands[0].Directory, "/p/build");
+  EXPECT_EQ(Commands[0].Filename, "/p/src/a.cpp");
+  EXPECT_EQ(Commands[0].Output, "a.o");
+  EXPECT_EQ(Commands[0].CommandLine[1], "-I/p/include");
+  EXPECT_EQ(Commands[1].CommandLine[1], "-DALT");
+
+  Commands = CompDB->getCompileCommands("/p/src/b.cpp");
+  ASSERT_EQ(Commands.size(), 1u);
+  EXPECT_EQ(Commands[0].CommandLine[1], "-DMSG=a b");
+  EXPECT_TRUE(CompDB->getCompileCommands("/p/src/c.cpp").empty());
+}
+
+TEST_F(IndexedCompDBTest, PersistedIndexIsReusedUntilModified) {
+  std::string ErrMsg;
+  ASSERT_TRUE(IndexedCompDB::load(CompDBPath, IndexPath, ErrMsg)) << ErrMsg;
+  ASSERT_TRUE(fs::exists(IndexPath));
+
+  auto Reopened = IndexedCompDB::load(CompDBPath, IndexPath, ErrMsg);
+  ASSERT_TRUE(Reopened) << ErrMsg;
+  EXPECT_EQ(Reopened->getCompileCommands("/p/src/a.cpp").size(), 2u);
+
+  // a stale index must not be trusted
+  mergebot::util::file_overwrite_content(
+      CompDBPath, R"([{"directory": "/q", "file": "c.cpp",
+                       "arguments": ["cc", "-c", "c.cpp"]}])");
+  auto Rebuilt = IndexedCompDB::load(CompDBPath, IndexPath, ErrMsg);
+  ASSERT_TRUE(Rebuilt) << ErrMsg;
+  EXPECT_EQ(Rebuilt->size(), 1u);
+  EXPECT_EQ(Rebuilt->getCompileCommands("/q/c.cpp").size(), 1u);
+
+  mergebot::util::file_overwrite_content(CompDBPath, R"([{"file": "x.cpp")");
+  EXPECT_FALSE(IndexedCompDB::load(CompDBPath, IndexPath, ErrMsg));
+  EXPECT_FALSE(ErrMsg.empty());
+}
@@ -0,0 +1,127 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include <gtest/gtest.h>
+
+#include <deque>
+
+#include "mergebot/lsp/client.h"
+
+using namespace mergebot::lsp;
+
+namespace {
+/// hands out pre-recorded chunks, one per read
+class ScriptedCommunicator final : public Communicator {
+ public:
+  explicit ScriptedCommunicator(std::deque<std::string> chunks)
+      : chunks(std::move(chunks)) {}
+
+  ssize_t write(const std::string &message) override {
+    return message.size();
+  }
+
+  ssize_t read(void *buf, size_t len) override {
+    if (chunks.empty()) {
+      errno = 0;  // closed
+      return 0;
+    }
+    std::string &chunk = chunks.front();
+    size_t n = std::min(len, chunk.size());
+    memcpy(buf, chunk.data(), n);
+    chunk.erase(0, n);
+    if (chunk.empty()) {
+      chunks.pop_front();
+    }
+    return n;
+  }
+
+ private:
+  std::deque<std::string> chunks;
+};
+
+std::string frame(const std::string &body) {
+  return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+}  // namespace
+
+TEST(LspTransportTest, RingBufferWrapsAround) {
+  RingBuffer ring(8);
+  struct iovec iov[2];
+  ASSERT_EQ(ring.writableSegments(iov), 1);
+  memcpy(iov[0].iov_base, "abcdef", 6);
+  ring.commit(6);
+
+  char out[8] = {};
+  EXPECT_EQ(ring.pop(out, 4), 4u);
+  EXPECT_EQ(std::string(out, 4), "abcd");
+
+  // free space is [6, 8) and [0, 4)
+  ASSERT_EQ(ring.writableSegments(iov), 2);
+  EXPECT_EQ(iov[0].iov_len, 2u);
+  EXPECT_EQ(iov[1].iov_len, 4u);
+  memcpy(iov[0].iov_base, "gh", 2);
+  memcpy(iov[1].iov_base, "ijkl", 4);
+  ring.commit(6);
+  EXPECT_TRUE(ring.full());
+
+  EXPECT_EQ(ring.pop(out, 8), 8u);
+  EXPECT_EQ(std::string(out, 8), "efghijkl");
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(LspTransportTest, FramesSplitAndCoalescedMessages) {
+  const std::string first = R"({"jsonrpc":"2.0","id":1,"result":null})";
+  const std::string second = R"({"jsonrpc":"2.0","method":"$/progress"})";
+  std::string stream = frame(first) + frame(second);
+  // the header of the first message is split, the body of the first and the
+  // whole second message arrive together
+  std::deque<std::string> chunks{stream.substr(0, 7), stream.substr(7, 12),
+                                 stream.substr(19)};
+  JSONRpcEndpoint endpoint(
+      std::make_unique<ScriptedCommunicator>(std::move(chunks)));
+
+  auto msg = endpoint.RecvResponse();
+  ASSERT_TRUE(msg.has_value());
+  EXPECT_EQ((*msg)["id"], 1);
+  msg = endpoint.RecvResponse();
+  ASSERT_TRUE(msg.has_value());
+  EXPECT_EQ((*msg)["method"], "$/progress");
+  // stream closed
+  EXPECT_FALSE(endpoint.RecvResponse().has_value());
+}
+
+TEST(LspTransportTest, RejectsMessageWithoutLength) {
+  std::deque<std::string> chunks{"Content-Type: utf-8\r\n\r\n{}"};
+  JSONRpcEndpoint endpoint(
+      std::make_unique<ScriptedCommunicator>(std::move(chunks)));
+  EXPECT_FALSE(endpoint.RecvResponse().has_value());
+}
+
+TEST(LspTransportTest, BatchKeepsRequestsInFlight) {
+  auto pipe = PipeCommunicator::create("./mock/fake_lsp_server",
+                                       "fake_lsp_server");
+  ASSERT_NE(pipe, nullptr);
+  auto communicator = EpollCommunicator::create(std::move(pipe));
+  ASSERT_NE(communicator, nullptr);
+  LspClient client(std::make_unique<LspEndpoint>(
+      std::make_unique<JSONRpcEndpoint>(std::move(communicator)), 5));
+
+  std::vector<std::pair<URIForFile, Position>> queries;
+  for (int line = 0; line < 100; ++line) {
+    queries.emplace_back(URIForFile("/tmp/ms/ours/a.cpp"), Position{line, 0});
+  }
+  auto results = client.SymbolInfoBatch(queries, 8);
+  ASSERT_EQ(results.size(), queries.size());
+  for (const auto &result : results) {
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ((*result)["serverInfo"]["version"], "fake");
+  }
+
+  auto future = client.ReferencesAsync(URIForFile("/tmp/ms/ours/a.cpp"),
+                                       Position{1, 2});
+  auto reference = future.get();
+  EXPECT_TRUE(reference.has_value());
+
+  client.Shutdown();
+  client.Exit();
+}
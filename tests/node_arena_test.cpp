@@ -0,0 +1,70 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/model/NodeArena.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+using mergebot::sa::NodeArena;
+using mergebot::sa::NodeKind;
+using mergebot::sa::SemanticNode;
+
+class CountedNode : public SemanticNode {
+public:
+  CountedNode(int ID, const std::string &Name, int &Destroyed)
+      : SemanticNode(ID, false, NodeKind::TEXTUAL, Name, "", Name, "",
+                     std::nullopt, ""),
+        Destroyed(Destroyed) {}
+  ~CountedNode() override { ++Destroyed; }
+
+  size_t computeSignature() const override {
+    return std::hash<std::string>()(DisplayName);
+  }
+
+  int &Destroyed;
+};
+} // namespace
+
+TEST(NodeArenaTest, OwnsNodesUntilDestroyed) {
+  int Destroyed = 0;
+  {
+    NodeArena Arena;
+    CountedNode *Parent = Arena.create<CountedNode>(0, "parent", Destroyed);
+    SemanticNode *Child = Arena.create<CountedNode>(1, "child", Destroyed);
+    Child->Parent = Parent;
+    Parent->Children.push_back(Child);
+
+    EXPECT_EQ(Arena.size(), 2);
+    EXPECT_GE(Arena.bytesAllocated(), 2 * sizeof(CountedNode));
+    EXPECT_EQ(Child->getNearestNeighborNames(),
+              std::vector<std::string>({"", ""}));
+    EXPECT_EQ(Destroyed, 0);
+  }
+  EXPECT_EQ(Destroyed, 2);
+}
+
+TEST(NodeArenaTest, InternsNamesOfSealedNodes) {
+  int Destroyed = 0;
+  NodeArena Arena;
+  mergebot::sa::StringPool &Pool = Arena.strings();
+  CountedNode *Base = Arena.create<CountedNode>(0, "foo", Destroyed);
+  CountedNode *Revision = Arena.create<CountedNode>(1, "foo", Destroyed);
+  Base->seal(&Pool);
+  Revision->seal(&Pool);
+
+  EXPECT_NE(Base->QualifiedNameSym, mergebot::sa::StringPool::None);
+  EXPECT_EQ(Base->QualifiedNameSym, Revision->QualifiedNameSym);
+  EXPECT_EQ(Pool.str(Base->QualifiedNameSym), Base->QualifiedName);
+  EXPECT_EQ(Pool.lookup(Base->QualifiedName), Base->QualifiedNameSym);
+  EXPECT_EQ(Pool.lookup("bar"), mergebot::sa::StringPool::None);
+  EXPECT_TRUE(Base->sameQualifiedName(*Revision));
+
+  // the signature is cached until the node is sealed again
+  const size_t Signature = Base->hashSignature();
+  Base->DisplayName = "bar";
+  EXPECT_EQ(Base->hashSignature(), Signature);
+  Base->seal();
+  EXPECT_NE(Base->hashSignature(), Signature);
+  EXPECT_EQ(Base->QualifiedNameSym, mergebot::sa::StringPool::None);
+}
@@ -0,0 +1,47 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/parser/parse_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "mergebot/parser/languages/cpp.h"
+#include "mergebot/parser/node.h"
+
+namespace mergebot {
+namespace ts {
+TEST(ParseCacheTest, ParsesEachContentOnce) {
+  ParseCache Cache(cpp::language(), 1 << 20);
+  const std::string Source = "int a = 3;\nint b = 4;\n";
+
+  std::shared_ptr<Tree> First = Cache.parse(Source);
+  std::shared_ptr<Tree> Second = Cache.parse(std::string(Source));
+  EXPECT_EQ(Cache.misses(), 1);
+  EXPECT_EQ(Cache.hits(), 1);
+  // every caller gets a tree of its own over the same source
+  EXPECT_NE(First, Second);
+  EXPECT_EQ(First->source(), Second->source());
+  EXPECT_EQ(First->rootNode().sexp(), Second->rootNode().sexp());
+
+  Cache.parse("int c = 5;\n");
+  EXPECT_EQ(Cache.misses(), 2);
+}
+
+TEST(ParseCacheTest, KeepsNothingBeyondCapacity) {
+  ParseCache Cache(cpp::language(), 0);
+  const std::string Source = "int a = 3;\n";
+  std::shared_ptr<Tree> First = Cache.parse(Source);
+  std::shared_ptr<Tree> Second = Cache.parse(Source);
+  EXPECT_EQ(Cache.hits(), 0);
+  EXPECT_EQ(Cache.misses(), 2);
+  EXPECT_EQ(Second->rootNode().type(), "translation_unit");
+}
+
+TEST(ParseCacheTest, ParsersAreKeptPerThread) {
+  Parser &First = Parser::forThread(cpp::language());
+  Parser &Second = Parser::forThread(cpp::language());
+  EXPECT_EQ(&First, &Second);
+  EXPECT_EQ(First.language(), cpp::language());
+}
+}  // namespace ts
+}  // namespace mergebot
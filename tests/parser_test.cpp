@@ -44,6 +44,44 @@ public:
       }));
 }
 
+TEST(ParserTest, NodeRefWalksChildrenInPlace) {
+  // clang-format off
+  std::string source = R"(
+class A{
+public:
+ int a = 3;
+ int b = 4;
+};
+)";
+  // clang-format on
+  ts::Parser parser(ts::cpp::language());
+  std::shared_ptr<ts::Tree> tree = parser.parse(source);
+  ts::Node ClassNode = tree->rootNode().children[0];
+  ts::Node BodyOfClass =
+      ClassNode.getChildByFieldName(ts::cpp::fields::field_body.name).value();
+
+  size_t Idx = 0;
+  for (ts::NodeRef Child : BodyOfClass.ref().children()) {
+    ts::Node Expected = BodyOfClass.children[Idx++];
+    EXPECT_EQ(Child.type(), Expected.type());
+    EXPECT_EQ(Child.textView(), Expected.text());
+    EXPECT_EQ(Child.node(), Expected);
+  }
+  EXPECT_EQ(Idx, BodyOfClass.childrenCount());
+
+  std::vector<std::string_view> Named;
+  for (ts::NodeRef Child : BodyOfClass.ref().namedChildren()) {
+    Named.push_back(Child.textView());
+  }
+  ASSERT_EQ(Named.size(), BodyOfClass.namedChildrenCount());
+  EXPECT_EQ(Named.back(), "int b = 4;");
+
+  ts::ChildIterator Cursor = BodyOfClass.ref().namedChildren().begin();
+  ASSERT_TRUE(Cursor.advanceTo(1));
+  EXPECT_EQ((*Cursor).textView(), "int a = 3;");
+  EXPECT_FALSE(Cursor.advanceTo(Named.size()));
+}
+
 TEST(Parser, GetTranslationUnitComment) {
   // clang-format off
   std::string expected = R"(
@@ -0,0 +1,135 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <oneapi/tbb/global_control.h>
+#include <string>
+#include <vector>
+
+#include "mergebot/core/handler/StyleBasedHandler.h"
+#include "mergebot/core/handler/TextBasedHandler.h"
+#include "mergebot/core/sa_utility.h"
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace fs = mergebot::fs;
+using namespace mergebot::sa;
+
+namespace {
+/// what a handler leaves behind: the blocks still unresolved per file, and
+/// the marshalled resolutions
+struct Outcome {
+  std::map<std::string, std::vector<int>> Unresolved;
+  std::map<std::string, std::string> Resolutions;
+
+  friend bool operator==(const Outcome &Lhs, const Outcome &Rhs) {
+    return Lhs.Unresolved == Rhs.Unresolved &&
+           Lhs.Resolutions == Rhs.Resolutions;
+  }
+};
+
+std::string conflictBlock(const std::string &Ours, const std::string &Theirs) {
+  return "<<<<<<< ours\n" + Ours + "=======\n" + Theirs + ">>>>>>> theirs\n";
+}
+
+class PerFileHandlersTest : public ::testing::Test {
+protected:
+  fs::path Root;
+  fs::path Project;
+  std::vector<std::string> Paths;
+
+  /// files of many blocks, mixing style conflicts, inclusions and real
+  /// conflicts, so that blocks finish out of order when run in parallel
+  void SetUp() override {
+    Root = fs::temp_directory_path() / "mergebot_per_file_handlers_test";
+    Project = Root / "project";
+    fs::remove_all(Root);
+    fs::create_directories(Project / "src");
+    for (int F = 0; F < 6; ++F) {
+      std::string Content = "#include \"common.h\"\n";
+      for (int B = 0; B < 24; ++B) {
+        const std::string Var = "v" + std::to_string(F) + "_" +
+                                std::to_string(B);
+        Content += "int " + Var + "_ctx;\n";
+        switch (B % 3) {
+        case 0: // style only
+          Content += conflictBlock("int " + Var + "=1;\n",
+                                   "int " + Var + " = 1;  // same\n");
+          break;
+        case 1: // their side adds a statement
+          Content += conflictBlock("call(" + Var + ");\n",
+                                   "call(" + Var + ");\ncheck(" + Var +
+                                       ");\n");
+          break;
+        default: // both sides change the value
+          Content += conflictBlock("int " + Var + " = 1;\n",
+                                   "int " + Var + " = 2;\n");
+          break;
+        }
+      }
+      const fs::path Path =
+          Project / "src" / ("file" + std::to_string(F) + ".cpp");
+      mergebot::util::file_put_content(Path.string(), Content, std::ios::out);
+      Paths.push_back(Path.string());
+    }
+  }
+
+  void TearDown() override { fs::remove_all(Root); }
+
+  /// run Handler on all the conflict files, with at most \p Parallelism
+  /// threads, in a fresh merge scenario dir
+  template <typename Handler>
+  Outcome run(size_t Parallelism, int Round) {
+    tbb::global_control Control(
+        tbb::global_control::max_allowed_parallelism, Parallelism);
+    ProjectMeta Meta;
+    Meta.Project = "per_file_handlers_test";
+    Meta.ProjectPath = Project.string();
+    Meta.MSCacheDir =
+        (Root / ("ms-" + std::to_string(Parallelism) + "-" +
+                 std::to_string(Round)))
+            .string();
+    const fs::path ResolutionDir = fs::path(Meta.MSCacheDir) / "resolutions";
+    fs::create_directories(ResolutionDir);
+
+    std::vector<ConflictFile> ConflictFiles = constructConflictFiles(Paths);
+    Handler(Meta).resolve(ConflictFiles);
+
+    Outcome Result;
+    for (const ConflictFile &CF : ConflictFiles) {
+      for (const ConflictBlock &CB : CF.ConflictBlocks) {
+        Result.Unresolved[CF.Filename].push_back(CB.Index);
+      }
+    }
+    for (const auto &Entry : fs::directory_iterator(ResolutionDir)) {
+      Result.Resolutions[Entry.path().filename().string()] =
+          mergebot::util::file_get_content(Entry.path().string());
+    }
+    return Result;
+  }
+};
+} // namespace
+
+TEST_F(PerFileHandlersTest, StyleBasedIsDeterministic) {
+  const Outcome Serial = run<StyleBasedHandler>(1, 0);
+  // every file has style conflicts, and other blocks left
+  EXPECT_EQ(Serial.Resolutions.size(), Paths.size());
+  ASSERT_EQ(Serial.Unresolved.size(), Paths.size());
+  for (const auto &[File, Blocks] : Serial.Unresolved) {
+    EXPECT_EQ(Blocks.size(), 16) << File;
+  }
+  for (int Round = 0; Round < 3; ++Round) {
+    EXPECT_TRUE(run<StyleBasedHandler>(8, Round) == Serial) << Round;
+  }
+}
+
+TEST_F(PerFileHandlersTest, TextBasedIsDeterministic) {
+  const Outcome Serial = run<TextBasedHandler>(1, 0);
+  EXPECT_EQ(Serial.Resolutions.size(), Paths.size());
+  for (int Round = 0; Round < 3; ++Round) {
+    EXPECT_TRUE(run<TextBasedHandler>(8, Round) == Serial) << Round;
+  }
+}
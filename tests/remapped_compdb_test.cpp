@@ -0,0 +1,42 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/semantic/RemappedCompDB.h"
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+
+using mergebot::sa::RemappedCompDB;
+
+TEST(RemappedCompDBTest, RemapOnlyWholePathComponents) {
+  EXPECT_EQ(RemappedCompDB::remap("-I/home/proj/include", "/home/proj",
+                                  "/tmp/ms/ours"),
+            "-I/tmp/ms/ours/include");
+  EXPECT_EQ(RemappedCompDB::remap("/home/proj", "/home/proj", "/tmp/ms/ours"),
+            "/tmp/ms/ours");
+  // a sibling project sharing the prefix stays untouched
+  EXPECT_EQ(RemappedCompDB::remap("-I/home/project/include", "/home/proj",
+                                  "/tmp/ms/ours"),
+            "-I/home/project/include");
+  EXPECT_EQ(RemappedCompDB::remap("-DA=/home/proj:/home/proj/b", "/home/proj",
+                                  "/x"),
+            "-DA=/x:/x/b");
+}
+
+TEST(RemappedCompDBTest, QueriesAreRemappedBothWays) {
+  auto Base = std::make_shared<clang::tooling::FixedCompilationDatabase>(
+      "/home/proj/build",
+      std::vector<std::string>{"-I/home/proj/include", "-std=c++17"});
+  RemappedCompDB CompDB(Base, "/home/proj/", "/tmp/ms/ours");
+
+  auto Commands = CompDB.getCompileCommands("/tmp/ms/ours/src/a.cpp");
+  ASSERT_EQ(Commands.size(), 1u);
+  EXPECT_EQ(Commands[0].Directory, "/tmp/ms/ours/build");
+  EXPECT_EQ(Commands[0].Filename, "/tmp/ms/ours/src/a.cpp");
+  EXPECT_NE(std::find(Commands[0].CommandLine.begin(),
+                      Commands[0].CommandLine.end(), "-I/tmp/ms/ours/include"),
+            Commands[0].CommandLine.end());
+}
@@ -0,0 +1,107 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/ResolutionScheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using mergebot::sa::ResolutionScheduler;
+
+namespace {
+/// a job that blocks the only worker until released
+struct Gate {
+  std::promise<void> Started;
+  std::promise<void> Release;
+  std::shared_future<void> Released = Release.get_future().share();
+
+  ResolutionScheduler::Job job() {
+    return [this]() {
+      Started.set_value();
+      Released.wait();
+    };
+  }
+};
+} // namespace
+
+TEST(ResolutionSchedulerTest, PriorityThenFIFO) {
+  ResolutionScheduler Scheduler({/*Workers=*/1, /*ArenaConcurrency=*/1,
+                                 /*MaxPending=*/8});
+  Gate G;
+  auto Started = G.Started.get_future();
+  ASSERT_TRUE(Scheduler.submit("blocker", G.job()));
+  Started.wait();
+
+  std::mutex OrderMutex;
+  std::vector<std::string> Order;
+  auto Record = [&](std::string Name) {
+    return [&, Name]() {
+      std::lock_guard<std::mutex> Lock(OrderMutex);
+      Order.push_back(Name);
+    };
+  };
+  auto A = Scheduler.submit("a", Record("a"));
+  auto B = Scheduler.submit("b", Record("b"));
+  auto C = Scheduler.submit("c", Record("c"), /*Priority=*/1);
+  ASSERT_TRUE(A && B && C);
+  EXPECT_EQ(A->Position, 1);
+  EXPECT_EQ(B->Position, 2);
+  EXPECT_EQ(C->Position, 1);
+  EXPECT_EQ(Scheduler.query("a")->Position, 2);
+  EXPECT_EQ(Scheduler.query("blocker")->Position, 0);
+
+  G.Release.set_value();
+  while (Scheduler.pending() || Scheduler.running()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(Order, (std::vector<std::string>{"c", "a", "b"}));
+}
+
+TEST(ResolutionSchedulerTest, CoalesceAndAdmissionControl) {
+  ResolutionScheduler Scheduler({1, 1, /*MaxPending=*/1});
+  Gate G;
+  auto Started = G.Started.get_future();
+  ASSERT_TRUE(Scheduler.submit("blocker", G.job()));
+  Started.wait();
+
+  std::atomic<int> Runs = 0;
+  auto Ticket = Scheduler.submit("ms", [&]() { ++Runs; });
+  ASSERT_TRUE(Ticket);
+  EXPECT_FALSE(Ticket->Coalesced);
+
+  // the same scenario joins the queued job instead of being enqueued again
+  auto Dup = Scheduler.submit("ms", [&]() { ++Runs; });
+  ASSERT_TRUE(Dup);
+  EXPECT_TRUE(Dup->Coalesced);
+  EXPECT_EQ(Dup->Position, 1);
+  EXPECT_EQ(Scheduler.pending(), 1);
+
+  // queue is full
+  EXPECT_FALSE(Scheduler.submit("other", []() {}));
+
+  G.Release.set_value();
+  while (Scheduler.pending() || Scheduler.running()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(Runs, 1);
+  EXPECT_FALSE(Scheduler.query("ms"));
+}
+
+TEST(ResolutionSchedulerTest, SurvivesThrowingJobs) {
+  ResolutionScheduler Scheduler({1, 1, /*MaxPending=*/8});
+  std::atomic<int> Runs = 0;
+  ASSERT_TRUE(Scheduler.submit("std", []() { throw std::runtime_error("x"); }));
+  ASSERT_TRUE(Scheduler.submit("non-std", []() { throw 42; }));
+  ASSERT_TRUE(Scheduler.submit("after", [&]() { ++Runs; }));
+
+  while (Scheduler.pending() || Scheduler.running()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(Runs, 1);
+  EXPECT_EQ(Scheduler.failed(), 2);
+}
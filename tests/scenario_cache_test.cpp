@@ -0,0 +1,178 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/ScenarioCache.h"
+
+#include <gtest/gtest.h>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace {
+namespace fs = mergebot::fs;
+using mergebot::sa::MergeScenario;
+using mergebot::sa::ScenarioCache;
+
+class ScenarioCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Root = fs::temp_directory_path() /
+           ("mb-scenario-cache-" +
+            std::string(::testing::UnitTest::GetInstance()
+                            ->current_test_info()
+                            ->name()));
+    fs::remove_all(Root);
+    fs::create_directories(Root);
+  }
+
+  void TearDown() override { fs::remove_all(Root); }
+
+  /// fake a merge scenario dir with one resolution and one merged file
+  fs::path makeScenarioDir(const std::string &Name,
+                           const std::string &Content) {
+    fs::path MSDir = Root / "projects" / Name;
+    fs::create_directories(MSDir / "resolutions");
+    fs::create_directories(MSDir / "merged" / "src");
+    mergebot::util::file_overwrite_content(MSDir / "resolutions" / "src@a.cpp",
+                                           Content);
+    mergebot::util::file_overwrite_content(MSDir / "merged" / "src" / "a.cpp",
+                                           Content);
+    return MSDir;
+  }
+
+  fs::path Root;
+  MergeScenario MS{std::string(40, 'a'), std::string(40, 'b'),
+                   std::string(40, 'c')};
+};
+} // namespace
+
+TEST_F(ScenarioCacheTest, PublishThenRestore) {
+  ScenarioCache Cache(Root / "cache", 0);
+  Cache.load();
+  fs::path MSDir = makeScenarioDir("first", "resolved");
+  ASSERT_TRUE(Cache.publish(MS, "", {"src/a.cpp"}, MSDir));
+  EXPECT_EQ(Cache.entryCount(), 1);
+
+  fs::path Other = Root / "projects" / "second";
+  EXPECT_TRUE(Cache.restore(MS, "", {"src/a.cpp"}, Other));
+  EXPECT_EQ(mergebot::util::file_get_content(Other / "resolutions" /
+                                             "src@a.cpp"),
+            "resolved");
+  EXPECT_TRUE(fs::exists(Other / "merged" / "src" / "a.cpp"));
+
+  // files not covered by the entry, or a different scenario
+  EXPECT_FALSE(Cache.restore(MS, "", {"src/a.cpp", "src/b.cpp"}, Other));
+  MergeScenario Unknown(std::string(40, 'a'), std::string(40, 'd'),
+                        std::string(40, 'c'));
+  EXPECT_FALSE(Cache.restore(Unknown, "", {"src/a.cpp"}, Other));
+}
+
+TEST_F(ScenarioCacheTest, SurvivesReloadAndDropsBrokenEntries) {
+  {
+    ScenarioCache Cache(Root / "cache", 0);
+    Cache.load();
+    ASSERT_TRUE(
+        Cache.publish(MS, "", {"src/a.cpp"}, makeScenarioDir("first", "x")));
+  }
+  // a half-written entry left by a crash
+  fs::create_directories(Root / "cache" / std::string(40, 'f') /
+                         "resolutions");
+
+  ScenarioCache Reloaded(Root / "cache", 0);
+  Reloaded.load();
+  EXPECT_EQ(Reloaded.entryCount(), 1);
+  EXPECT_FALSE(fs::exists(Root / "cache" / std::string(40, 'f')));
+  EXPECT_TRUE(Reloaded.restore(MS, "", {"src/a.cpp"}, Root / "projects" / "b"));
+}
+
+TEST_F(ScenarioCacheTest, EvictsLeastRecentlyUsed) {
+  MergeScenario MS2(std::string(40, 'a'), std::string(40, 'e'),
+                    std::string(40, 'c'));
+  MergeScenario MS3(std::string(40, 'a'), std::string(40, 'f'),
+                    std::string(40, 'c'));
+  const std::string Payload(4096, 'x');
+
+  ScenarioCache Probe(Root / "probe", 0);
+  Probe.load();
+  ASSERT_TRUE(
+      Probe.publish(MS, "", {"src/a.cpp"}, makeScenarioDir("p", Payload)));
+  const uint64_t EntrySize = Probe.size();
+
+  // room for two entries only
+  ScenarioCache Cache(Root / "cache", EntrySize * 2 + EntrySize / 2);
+  Cache.load();
+  ASSERT_TRUE(
+      Cache.publish(MS, "", {"src/a.cpp"}, makeScenarioDir("1", Payload)));
+  ASSERT_TRUE(
+      Cache.publish(MS2, "", {"src/a.cpp"}, makeScenarioDir("2", Payload)));
+  // touch MS so that MS2 becomes the least recently used one
+  ASSERT_TRUE(Cache.restore(MS, "", {"src/a.cpp"}, Root / "projects" / "r"));
+  ASSERT_TRUE(
+      Cache.publish(MS3, "", {"src/a.cpp"}, makeScenarioDir("3", Payload)));
+
+  EXPECT_EQ(Cache.entryCount(), 2);
+  EXPECT_TRUE(Cache.restore(MS, "", {"src/a.cpp"}, Root / "projects" / "r"));
+  EXPECT_FALSE(Cache.restore(MS2, "", {"src/a.cpp"}, Root / "projects" / "r"));
+  EXPECT_TRUE(Cache.restore(MS3, "", {"src/a.cpp"}, Root / "projects" / "r"));
+}
+
+TEST_F(ScenarioCacheTest, KeyedByCompDB) {
+  const fs::path CompDBPath = Root / "compile_commands.json";
+  mergebot::util::file_overwrite_content(CompDBPath, "[]");
+  const std::string Digest = ScenarioCache::compDBDigest(CompDBPath);
+  EXPECT_FALSE(Digest.empty());
+  EXPECT_EQ(ScenarioCache::compDBDigest((Root / "none.json").string()), "");
+
+  ScenarioCache Cache(Root / "cache", 0);
+  Cache.load();
+  ASSERT_TRUE(
+      Cache.publish(MS, Digest, {"src/a.cpp"}, makeScenarioDir("first", "x")));
+  EXPECT_TRUE(
+      Cache.restore(MS, Digest, {"src/a.cpp"}, Root / "projects" / "r"));
+  EXPECT_FALSE(Cache.restore(MS, "", {"src/a.cpp"}, Root / "projects" / "r"));
+
+  // the same path with other compile commands
+  mergebot::util::file_overwrite_content(
+      CompDBPath, R"([{"directory": "/", "file": "a.cpp", "command": "cc"}])");
+  const std::string Changed = ScenarioCache::compDBDigest(CompDBPath);
+  EXPECT_NE(Changed, Digest);
+  EXPECT_FALSE(
+      Cache.restore(MS, Changed, {"src/a.cpp"}, Root / "projects" / "r"));
+
+  ScenarioCache Reloaded(Root / "cache", 0);
+  Reloaded.load();
+  EXPECT_TRUE(
+      Reloaded.restore(MS, Digest, {"src/a.cpp"}, Root / "projects" / "r"));
+}
+
+TEST_F(ScenarioCacheTest, EvictsFinishedScenarioDirs) {
+  const std::string Payload(4096, 'x');
+  ScenarioCache Probe(Root / "probe", 0);
+  Probe.load();
+  ASSERT_TRUE(
+      Probe.publish(MS, "", {"src/a.cpp"}, makeScenarioDir("p", Payload)));
+  const uint64_t EntrySize = Probe.size();
+  fs::remove_all(Root / "probe");
+  fs::remove_all(Root / "projects" / "p");
+
+  ScenarioCache Cache(Root / "cache", EntrySize * 2 + EntrySize / 2, Root);
+  Cache.load();
+  const fs::path Old = makeScenarioDir("old", Payload);
+  const fs::path Running = makeScenarioDir("running", Payload);
+  Cache.track(Old);
+  Cache.track(Running);
+  // being resolved again
+  mergebot::util::file_overwrite_content(Running / "running", "");
+  ASSERT_TRUE(
+      Cache.publish(MS, "", {"src/a.cpp"}, makeScenarioDir("new", Payload)));
+
+  EXPECT_FALSE(fs::exists(Old));
+  EXPECT_TRUE(fs::exists(Running));
+  EXPECT_TRUE(Cache.restore(MS, "", {"src/a.cpp"}, Root / "projects" / "r"));
+
+  // finished scenario dirs are found again on load
+  fs::remove(Running / "running");
+  ScenarioCache Reloaded(Root / "cache", 0, Root);
+  Reloaded.load();
+  EXPECT_GE(Reloaded.size(), Cache.size());
+}
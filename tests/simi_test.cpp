@@ -2,6 +2,10 @@
 // Created by whalien on 17/09/23.
 //
 
+#include <cmath>
+#include <map>
+#include <random>
+
 #include <gtest/gtest.h>
 #include <spdlog/spdlog.h>
 
@@ -1075,4 +1079,140 @@ class InternalKey {
 
   EXPECT_TRUE(similarity > 0);
   spdlog::info("Cosine similarity: {}", similarity);
-}
\ No newline at end of file
+}
+namespace {
+size_t reference_levenshtein(const std::string& s1, const std::string& s2) {
+  std::vector<std::vector<size_t>> dp(s1.size() + 1,
+                                      std::vector<size_t>(s2.size() + 1));
+  for (size_t i = 0; i <= s1.size(); ++i) {
+    for (size_t j = 0; j <= s2.size(); ++j) {
+      if (i == 0) {
+        dp[i][j] = j;
+      } else if (j == 0) {
+        dp[i][j] = i;
+      } else {
+        dp[i][j] = std::min({dp[i - 1][j - 1] + (s1[i - 1] != s2[j - 1]),
+                             dp[i - 1][j] + 1, dp[i][j - 1] + 1});
+      }
+    }
+  }
+  return dp[s1.size()][s2.size()];
+}
+
+double reference_cosine(const std::string& s1, const std::string& s2, int k) {
+  auto profile = [k](const std::string& str) {
+    std::string cleaned;
+    for (char c : str) {
+      bool space =
+          c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+      if (!space) {
+        cleaned.push_back(c);
+      } else if (cleaned.empty() || cleaned.back() != ' ') {
+        cleaned.push_back(' ');
+      }
+    }
+    std::map<std::string, int> grams;
+    for (int i = 0; i <= static_cast<int>(cleaned.size()) - k; ++i) {
+      ++grams[cleaned.substr(i, k)];
+    }
+    return grams;
+  };
+  auto p1 = profile(s1), p2 = profile(s2);
+  double dot = 0, n1 = 0, n2 = 0;
+  for (const auto& [gram, count] : p1) {
+    n1 += count * count;
+    auto it = p2.find(gram);
+    if (it != p2.end()) dot += count * it->second;
+  }
+  for (const auto& [gram, count] : p2) n2 += count * count;
+  return dot / (std::sqrt(n1) * std::sqrt(n2));
+}
+
+std::string mutate(std::string str, std::mt19937& gen, int edits) {
+  std::uniform_int_distribution<int> op(0, 2);
+  std::uniform_int_distribution<int> ch('a', 'd');
+  for (int e = 0; e < edits; ++e) {
+    size_t pos = str.empty() ? 0 : gen() % (str.size() + 1);
+    switch (op(gen)) {
+      case 0:
+        str.insert(str.begin() + pos, static_cast<char>(ch(gen)));
+        break;
+      case 1:
+        if (pos < str.size()) str.erase(pos, 1);
+        break;
+      default:
+        if (pos < str.size()) str[pos] = static_cast<char>(ch(gen));
+    }
+  }
+  return str;
+}
+}  // namespace
+
+TEST(Similarity, LevenshteinDistanceMatchesDP) {
+  using mergebot::util::levenshtein_distance;
+  EXPECT_EQ(levenshtein_distance("", ""), 0);
+  EXPECT_EQ(levenshtein_distance("", "abc"), 3);
+  EXPECT_EQ(levenshtein_distance("kitten", "sitting"), 3);
+  EXPECT_EQ(levenshtein_distance("kitten", "sitting", 2), 3);
+
+  std::mt19937 gen(20261018);
+  std::uniform_int_distribution<int> ch('a', 'd');
+  // across word boundaries of the bit vectors
+  for (size_t len : {1, 7, 63, 64, 65, 127, 128, 129, 300}) {
+    for (int round = 0; round < 20; ++round) {
+      std::string s1;
+      for (size_t i = 0; i < len; ++i) s1.push_back(static_cast<char>(ch(gen)));
+      std::string s2 = round % 4 == 0 ? mutate(s1, gen, static_cast<int>(len))
+                                      : mutate(s1, gen, round);
+      const size_t expected = reference_levenshtein(s1, s2);
+      EXPECT_EQ(levenshtein_distance(s1, s2), expected) << s1 << " " << s2;
+      EXPECT_EQ(levenshtein_distance(s2, s1), expected) << s1 << " " << s2;
+      // cutoffs around the distance, both the bit-parallel and banded kernels
+      for (size_t cutoff : {size_t{0}, expected / 2, expected, expected + 1}) {
+        EXPECT_EQ(levenshtein_distance(s1, s2, cutoff),
+                  expected > cutoff ? cutoff + 1 : expected)
+            << s1 << " " << s2 << " " << cutoff;
+      }
+    }
+  }
+}
+
+TEST(Similarity, BoundedLevenshteinSimilarity) {
+  using mergebot::util::string_levenshtein;
+  const std::string s1 = "void DBImpl::Put(const WriteOptions& options)";
+  const std::string s2 = "void DBImpl::Put(const WriteOptions& opts)";
+  const std::string s3 = "Status VersionSet::Recover(bool read_only)";
+
+  const double similarity = string_levenshtein(s1, s2);
+  EXPECT_DOUBLE_EQ(string_levenshtein(s1, s2, 0.618), similarity);
+  EXPECT_DOUBLE_EQ(string_levenshtein(s1, s2, similarity), similarity);
+  EXPECT_LT(string_levenshtein(s1, s3), 0.618);
+  EXPECT_EQ(string_levenshtein(s1, s3, 0.618), 0);
+  EXPECT_EQ(string_levenshtein("", "", 0.618), 1.0);
+}
+
+TEST(Similarity, SketchCosineMatchesProfiles) {
+  using mergebot::util::KGramSketch;
+  using mergebot::util::sketch_cosine;
+  const std::string s1 =
+      "Status DBImpl::Put(const WriteOptions& o,\n\t  const Slice& key) {\n"
+      "  return DB::Put(o, key);\n}";
+  const std::string s2 =
+      "Status DBImpl::Put(const WriteOptions& opts, const Slice& key) {\n"
+      "  return DB::Put(opts, key, value);\n}";
+  for (int k : {1, 3, 7}) {
+    const double expected = reference_cosine(s1, s2, k);
+    EXPECT_NEAR(sketch_cosine(KGramSketch(s1, k), KGramSketch(s2, k)),
+                expected, 1e-12);
+    EXPECT_NEAR(mergebot::util::string_cosine(s1, s2, k), expected, 1e-12);
+  }
+  // whitespace runs are collapsed
+  EXPECT_NEAR(
+      sketch_cosine(KGramSketch("int  a =\n 1;"), KGramSketch("int a = 1;")),
+      1.0, 1e-12);
+
+  EXPECT_EQ(sketch_cosine(KGramSketch(), KGramSketch(s1)),
+            mergebot::util::ErrEmptyVector);
+  EXPECT_EQ(sketch_cosine(KGramSketch("int"), KGramSketch(s1)),
+            mergebot::util::ErrZeroVector);
+}
@@ -0,0 +1,129 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/SparseCheckout.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace fs = mergebot::fs;
+using mergebot::sa::SparseCheckout;
+
+namespace {
+bool contains(const std::vector<std::string> &Paths, const std::string &P) {
+  return std::find(Paths.begin(), Paths.end(), P) != Paths.end();
+}
+
+void writeFile(const fs::path &Path, const std::string &Content) {
+  fs::create_directories(Path.parent_path());
+  std::ofstream(Path) << Content;
+}
+} // namespace
+
+TEST(SparseCheckoutTest, Counterparts) {
+  auto Counterparts = SparseCheckout::counterpartsOf("src/core/Foo.cpp");
+  EXPECT_TRUE(contains(Counterparts, "src/core/Foo.h"));
+  EXPECT_TRUE(contains(Counterparts, "src/core/Foo.hpp"));
+  EXPECT_FALSE(contains(Counterparts, "src/core/Foo.cpp"));
+
+  EXPECT_TRUE(contains(SparseCheckout::counterpartsOf("a/b.h"), "a/b.cc"));
+  EXPECT_TRUE(SparseCheckout::counterpartsOf("Makefile").empty());
+}
+
+TEST(SparseCheckoutTest, QuotedIncludes) {
+  const std::string Content = R"(#include <vector>
+#include "Foo.h"
+  #  include "mergebot/utils/fileio.h"
+#include "../outside.h"
+// #include "commented.h"
+)";
+  auto Includes = SparseCheckout::includesOf("src/core/Foo.cpp", Content);
+  EXPECT_TRUE(contains(Includes, "src/core/Foo.h"));
+  EXPECT_TRUE(contains(Includes, "Foo.h"));
+  EXPECT_TRUE(contains(Includes, "src/core/mergebot/utils/fileio.h"));
+  EXPECT_TRUE(contains(Includes, "mergebot/utils/fileio.h"));
+  EXPECT_TRUE(contains(Includes, "src/outside.h"));
+  EXPECT_FALSE(contains(Includes, "../outside.h"));
+  // system headers are candidates too, they just don't exist in the commit
+  EXPECT_TRUE(contains(Includes, "vector"));
+  EXPECT_FALSE(contains(Includes, "src/core/vector"));
+  EXPECT_FALSE(contains(Includes, "commented.h"));
+}
+
+TEST(SparseCheckoutTest, AngleIncludesThroughIncludeDirs) {
+  const std::string Content = R"(#include <vector>
+#include <lib/b.h>
+#include "c.h"
+)";
+  auto Includes =
+      SparseCheckout::includesOf("src/a.cpp", Content, {"include", "src"});
+  EXPECT_TRUE(contains(Includes, "include/lib/b.h"));
+  EXPECT_TRUE(contains(Includes, "src/lib/b.h"));
+  EXPECT_TRUE(contains(Includes, "lib/b.h"));
+  EXPECT_FALSE(contains(Includes, "src/a/lib/b.h"));
+  EXPECT_TRUE(contains(Includes, "src/c.h"));
+  EXPECT_TRUE(contains(Includes, "include/c.h"));
+  EXPECT_TRUE(contains(Includes, "include/vector"));
+}
+
+TEST(SparseCheckoutTest, IncludeDirsOfCommand) {
+  auto IncludeDirs = SparseCheckout::includeDirsOf(
+      {"clang++", "-I../include", "-I", "/proj/third_party/x", "-iquote",
+       "gen", "-isystem/usr/include", "-I/proj", "-I/proj/include/", "-c",
+       "../src/a.cpp"},
+      "/proj/build", "/proj/");
+  EXPECT_EQ(IncludeDirs, (std::vector<std::string>{"include",
+                                                   "third_party/x",
+                                                   "build/gen"}));
+}
+
+TEST(SparseCheckoutTest, DisabledByDefault) {
+  ::unsetenv("MERGEBOT_SPARSE_CHECKOUT");
+  EXPECT_FALSE(SparseCheckout::enabled());
+  ::setenv("MERGEBOT_SPARSE_CHECKOUT", "1", 1);
+  EXPECT_TRUE(SparseCheckout::enabled());
+  ::setenv("MERGEBOT_SPARSE_CHECKOUT", "0", 1);
+  EXPECT_FALSE(SparseCheckout::enabled());
+  ::unsetenv("MERGEBOT_SPARSE_CHECKOUT");
+}
+
+TEST(SparseCheckoutTest, MaterializesIncludeClosure) {
+  const fs::path Root = fs::temp_directory_path() / "mergebot_sparse_test";
+  const fs::path Repo = Root / "repo";
+  const fs::path Dest = Root / "dest";
+  fs::remove_all(Root);
+  writeFile(Repo / "src/a.cpp", "#include <lib/b.h>\nint a;\n");
+  writeFile(Repo / "include/lib/b.h", "#include \"c.h\"\n");
+  writeFile(Repo / "include/lib/c.h", "#include \"detail/d.h\"\n");
+  writeFile(Repo / "include/lib/detail/d.h", "#include <string>\n");
+  writeFile(Repo / "include/lib/unused.h", "");
+  const std::string Git = "git -C " + Repo.string() +
+                          " -c user.name=mb -c user.email=mb@localhost ";
+  if (std::system((Git + "init -q && " + Git + "add -A && " + Git +
+                   "commit -qm init && " + Git + "rev-parse HEAD > " +
+                   (Root / "HEAD").string())
+                      .c_str()) != 0) {
+    fs::remove_all(Root);
+    GTEST_SKIP() << "git is not available";
+  }
+  std::string Head =
+      mergebot::util::file_get_content((Root / "HEAD").string());
+  Head.erase(Head.find_last_not_of(" \n") + 1);
+
+  SparseCheckout Checkout(Repo.string(), Head, Dest.string());
+  Checkout.setIncludeDirs({"include"});
+  ASSERT_TRUE(Checkout.materialize("src/a.cpp"));
+  EXPECT_TRUE(fs::exists(Dest / "src/a.cpp"));
+  EXPECT_TRUE(fs::exists(Dest / "include/lib/b.h"));
+  EXPECT_TRUE(fs::exists(Dest / "include/lib/c.h"));
+  EXPECT_TRUE(fs::exists(Dest / "include/lib/detail/d.h"));
+  EXPECT_FALSE(fs::exists(Dest / "include/lib/unused.h"));
+  EXPECT_EQ(Checkout.size(), 4);
+  fs::remove_all(Root);
+}
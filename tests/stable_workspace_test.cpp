@@ -0,0 +1,87 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/StableWorkspace.h"
+
+#include <gtest/gtest.h>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace {
+namespace fs = mergebot::fs;
+using mergebot::sa::StableWorkspace;
+using mergebot::util::file_get_content;
+using mergebot::util::file_overwrite_content;
+
+class StableWorkspaceTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Base = fs::temp_directory_path() / "mb-stable-workspace";
+    fs::remove_all(Base);
+    fs::create_directories(Base / "ms1" / "ours" / "src");
+    fs::create_directories(Base / "ms2" / "ours" / "src");
+  }
+
+  void TearDown() override { fs::remove_all(Base); }
+
+  fs::path Base;
+};
+} // namespace
+
+TEST_F(StableWorkspaceTest, MirrorsScenariosIntoTheSameRoot) {
+  file_overwrite_content((Base / "ms1/ours/src/a.h").string(), "int a;\n");
+  file_overwrite_content((Base / "ms1/ours/src/b.h").string(), "int b;\n");
+  fs::file_time_type AMTime;
+  std::string Root;
+  {
+    auto Workspace = StableWorkspace::lease(Base.string(), "OURS",
+                                            (Base / "ms1/ours").string());
+    ASSERT_NE(Workspace, nullptr);
+    Root = Workspace->root();
+    // leased by one scenario at a time
+    EXPECT_EQ(StableWorkspace::lease(Base.string(), "OURS",
+                                     (Base / "ms2/ours").string()),
+              nullptr);
+    Workspace->sync(0);
+    EXPECT_EQ(file_get_content(Root + "/src/b.h"), "int b;\n");
+    AMTime = fs::last_write_time(Root + "/src/a.h");
+  }
+
+  // a.h is unchanged, b.h is gone and c.h is new in the next scenario
+  file_overwrite_content((Base / "ms2/ours/src/a.h").string(), "int a;\n");
+  file_overwrite_content((Base / "ms2/ours/src/c.h").string(), "int c;\n");
+  auto Workspace = StableWorkspace::lease(Base.string(), "OURS",
+                                          (Base / "ms2/ours").string());
+  ASSERT_NE(Workspace, nullptr);
+  EXPECT_EQ(Workspace->root(), Root);
+  Workspace->sync(1);
+  EXPECT_EQ(fs::last_write_time(Root + "/src/a.h"), AMTime);
+  EXPECT_FALSE(fs::exists(Root + "/src/b.h"));
+  EXPECT_EQ(file_get_content(Root + "/src/c.h"), "int c;\n");
+
+  // materialized later
+  file_overwrite_content((Base / "ms2/ours/src/d.h").string(), "int d;\n");
+  Workspace->sync(1);
+  EXPECT_FALSE(fs::exists(Root + "/src/d.h"));
+  Workspace->sync(2);
+  EXPECT_EQ(file_get_content(Root + "/src/d.h"), "int d;\n");
+}
+
+TEST_F(StableWorkspaceTest, PrunesLeastRecentlyWrittenFirst) {
+  const fs::path Index = Base / "index";
+  fs::create_directories(Index);
+  const auto Now = fs::file_time_type::clock::now();
+  for (int I = 0; I < 4; ++I) {
+    const std::string Shard = (Index / (std::to_string(I) + ".idx")).string();
+    file_overwrite_content(Shard, std::string(100, 'x'));
+    fs::last_write_time(Shard, Now - std::chrono::hours(4 - I));
+  }
+
+  EXPECT_EQ(StableWorkspace::prune(Index.string(), 400), 0);
+  EXPECT_EQ(StableWorkspace::prune(Index.string(), 250), 200);
+  EXPECT_FALSE(fs::exists(Index / "0.idx"));
+  EXPECT_FALSE(fs::exists(Index / "1.idx"));
+  EXPECT_TRUE(fs::exists(Index / "2.idx"));
+  EXPECT_TRUE(fs::exists(Index / "3.idx"));
+}
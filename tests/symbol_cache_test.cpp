@@ -0,0 +1,158 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/semantic/SymbolCache.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "mergebot/filesystem.h"
+
+namespace {
+namespace fs = mergebot::fs;
+using mergebot::sa::SymbolCache;
+
+SymbolCache::Key keyAt(uint32_t Line, SymbolCache::Method M) {
+  return SymbolCache::Key{0x1234, 0x5678, Line, 4, M};
+}
+} // namespace
+
+TEST(SymbolCacheTest, OthersWaitForTheClaimer) {
+  std::shared_ptr<SymbolCache> Cache = SymbolCache::open();
+  const SymbolCache::Key Key = keyAt(1, SymbolCache::Method::SymbolInfo);
+
+  bool Claimed = false;
+  Cache->acquire(Key, Claimed);
+  ASSERT_TRUE(Claimed);
+
+  bool OtherClaimed = true;
+  std::shared_future<SymbolCache::Result> Future =
+      Cache->acquire(Key, OtherClaimed);
+  EXPECT_FALSE(OtherClaimed);
+  EXPECT_EQ(Future.wait_for(std::chrono::milliseconds(0)),
+            std::future_status::timeout);
+
+  std::thread Claimer([&]() {
+    Cache->fulfill(Key, nlohmann::json::array({{{"name", "Widget"}}}));
+  });
+  const SymbolCache::Result &Returned = Future.get();
+  Claimer.join();
+  ASSERT_TRUE(Returned.has_value());
+  EXPECT_EQ((*Returned)[0]["name"], "Widget");
+
+  // the method is part of the key
+  Cache->acquire(keyAt(1, SymbolCache::Method::References), Claimed);
+  EXPECT_TRUE(Claimed);
+  EXPECT_EQ(Cache->hits(), 1);
+  EXPECT_EQ(Cache->misses(), 2);
+}
+
+TEST(SymbolCacheTest, ClaimFailsWaitersOnUnwinding) {
+  std::shared_ptr<SymbolCache> Cache = SymbolCache::open();
+  const SymbolCache::Key Key = keyAt(1, SymbolCache::Method::SymbolInfo);
+  const SymbolCache::Key Other = keyAt(2, SymbolCache::Method::SymbolInfo);
+
+  bool Claimed = false;
+  Cache->acquire(Key, Claimed);
+  ASSERT_TRUE(Claimed);
+  Cache->acquire(Other, Claimed);
+  ASSERT_TRUE(Claimed);
+  std::shared_future<SymbolCache::Result> Future = Cache->acquire(Key, Claimed);
+  std::shared_future<SymbolCache::Result> OtherFuture =
+      Cache->acquire(Other, Claimed);
+  ASSERT_FALSE(Claimed);
+
+  std::thread Claimer([&]() {
+    try {
+      std::vector<SymbolCache::Claim> Claims;
+      Claims.emplace_back(*Cache, Key);
+      Claims.emplace_back();
+      Claims.emplace_back(*Cache, Other);
+      // the first of a batch made it, then the clangd request throws
+      Claims[0].fulfill(nlohmann::json::array({{{"name", "Widget"}}}));
+      throw std::runtime_error("lsp client is gone");
+    } catch (const std::runtime_error &) {
+    }
+  });
+  ASSERT_EQ(Future.wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+  ASSERT_EQ(OtherFuture.wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+  Claimer.join();
+  ASSERT_TRUE(Future.get().has_value());
+  EXPECT_EQ((*Future.get())[0]["name"], "Widget");
+  EXPECT_FALSE(OtherFuture.get().has_value());
+}
+
+TEST(SymbolCacheTest, ReferencesAreNeverShared) {
+  const fs::path CachePath =
+      fs::temp_directory_path() / "mb-symbol-cache-refs" / "lsp_symbols.cache";
+  fs::remove_all(CachePath.parent_path());
+  std::shared_ptr<SymbolCache> Cache = SymbolCache::open(CachePath.string());
+  // a header byte-identical on both sides, called from a changed caller on
+  // ours: the same key, but references of each side's own
+  const SymbolCache::Key Key = keyAt(1, SymbolCache::Method::References);
+  ASSERT_FALSE(SymbolCache::shareable(Key.M));
+
+  bool OursClaimed = false;
+  Cache->acquire(Key, OursClaimed);
+  ASSERT_TRUE(OursClaimed);
+  SymbolCache::Claim Ours(*Cache, Key);
+  Ours.fulfill(nlohmann::json::array({{{"containerName", "Widget::draw"}}}));
+
+  bool BaseClaimed = false;
+  std::shared_future<SymbolCache::Result> Future =
+      Cache->acquire(Key, BaseClaimed);
+  EXPECT_TRUE(BaseClaimed);
+  EXPECT_FALSE(Future.valid());
+  SymbolCache::Claim Base(*Cache, Key);
+  Base.fulfill(nlohmann::json::array({{{"containerName", "Widget::paint"}}}));
+
+  // nor kept for later scenarios
+  EXPECT_EQ(Cache->size(), 0);
+  EXPECT_EQ(Cache->hits(), 0);
+  ASSERT_TRUE(Cache->save());
+  std::shared_ptr<SymbolCache> Reopened = SymbolCache::open(CachePath.string());
+  EXPECT_EQ(Reopened->size(), 0);
+  bool Claimed = false;
+  Reopened->acquire(Key, Claimed);
+  EXPECT_TRUE(Claimed);
+
+  fs::remove_all(CachePath.parent_path());
+}
+
+TEST(SymbolCacheTest, PersistsResolvedResults) {
+  const fs::path CachePath =
+      fs::temp_directory_path() / "mb-symbol-cache" / "lsp_symbols.cache";
+  fs::remove_all(CachePath.parent_path());
+
+  {
+    std::shared_ptr<SymbolCache> Cache =
+        SymbolCache::open(CachePath.string());
+    bool Claimed = false;
+    Cache->acquire(keyAt(1, SymbolCache::Method::SymbolInfo), Claimed);
+    Cache->fulfill(keyAt(1, SymbolCache::Method::SymbolInfo),
+                   nlohmann::json::array({{{"usr", "c:@S@Widget"}}}));
+    // failed and pending results are not persisted
+    Cache->acquire(keyAt(2, SymbolCache::Method::SymbolInfo), Claimed);
+    Cache->fulfill(keyAt(2, SymbolCache::Method::SymbolInfo), std::nullopt);
+    Cache->acquire(keyAt(3, SymbolCache::Method::References), Claimed);
+    ASSERT_TRUE(Cache->save());
+  }
+
+  std::shared_ptr<SymbolCache> Cache = SymbolCache::open(CachePath.string());
+  EXPECT_EQ(Cache->size(), 1);
+  bool Claimed = true;
+  std::shared_future<SymbolCache::Result> Future =
+      Cache->acquire(keyAt(1, SymbolCache::Method::SymbolInfo), Claimed);
+  EXPECT_FALSE(Claimed);
+  ASSERT_TRUE(Future.get().has_value());
+  EXPECT_EQ((*Future.get())[0]["usr"], "c:@S@Widget");
+  Cache->acquire(keyAt(2, SymbolCache::Method::SymbolInfo), Claimed);
+  EXPECT_TRUE(Claimed);
+
+  fs::remove_all(CachePath.parent_path());
+}
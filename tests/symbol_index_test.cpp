@@ -0,0 +1,78 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/semantic/SymbolIndex.h"
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "mergebot/filesystem.h"
+#include "mergebot/utils/fileio.h"
+
+namespace {
+namespace fs = mergebot::fs;
+using mergebot::sa::SymbolIndex;
+
+class SymbolIndexTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Root = fs::temp_directory_path() / "mb-symbol-index";
+    fs::remove_all(Root);
+    fs::create_directories(Root);
+    mergebot::util::file_overwrite_content((Root / "a.h").string(),
+                                           R"(namespace ns {
+struct Widget {
+  int size;
+};
+int area(const Widget &W);
+} // namespace ns
+)");
+    mergebot::util::file_overwrite_content((Root / "a.cpp").string(),
+                                           R"(#include "a.h"
+namespace ns {
+int area(const Widget &W) { return W.size * W.size; }
+} // namespace ns
+)");
+  }
+
+  void TearDown() override { fs::remove_all(Root); }
+
+  fs::path Root;
+};
+} // namespace
+
+TEST_F(SymbolIndexTest, ResolvesDeclarationsAndReferences) {
+  clang::tooling::FixedCompilationDatabase CompDB(
+      Root.string(), std::vector<std::string>{"-std=c++17"});
+  auto Index = SymbolIndex::build(CompDB, {(Root / "a.cpp").string()},
+                                  Root.string());
+  ASSERT_NE(Index, nullptr);
+
+  // `Widget` in a.h, anywhere inside the name
+  const SymbolIndex::Symbol *Widget =
+      Index->lookup((Root / "a.h").string(), 1, 9);
+  ASSERT_NE(Widget, nullptr);
+  EXPECT_EQ(Widget->Name, "Widget");
+  EXPECT_EQ(Widget->ContainerName, "ns::");
+  EXPECT_EQ(Widget->USR, "c:@N@ns@S@Widget");
+  EXPECT_EQ(Index->lookup((Root / "a.h").string(), 1, 0), nullptr);
+
+  // the definition of `area` and the declaration share the USR
+  const SymbolIndex::Symbol *Area =
+      Index->lookup((Root / "a.cpp").string(), 2, 4);
+  ASSERT_NE(Area, nullptr);
+  EXPECT_EQ(Area->Name, "area");
+  const SymbolIndex::Symbol *AreaDecl =
+      Index->lookup((Root / "a.h").string(), 4, 4);
+  ASSERT_NE(AreaDecl, nullptr);
+  EXPECT_EQ(Area->USR, AreaDecl->USR);
+
+  // `size` is read in `ns::area`
+  const SymbolIndex::Symbol *Size =
+      Index->lookup((Root / "a.h").string(), 2, 6);
+  ASSERT_NE(Size, nullptr);
+  std::vector<std::string> Refs = Index->references(Size->USR);
+  EXPECT_NE(std::find(Refs.begin(), Refs.end(), "ns::area"), Refs.end());
+}
@@ -0,0 +1,87 @@
+//
+// Created by whalien on 18/10/26.
+//
+#include "mergebot/core/model/matcher/TextualMatcher.h"
+#include "mergebot/core/model/NodeArena.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace {
+using mergebot::sa::NodeArena;
+using mergebot::sa::NodeKind;
+using mergebot::sa::SemanticNode;
+using mergebot::sa::TextualNode;
+
+/// owns the nodes of the tests
+NodeArena Arena;
+
+SemanticNode *textual(const std::string &Text, uint32_t Row,
+                      const std::string &TUPath = "db.h") {
+  static int NodeId = 0;
+  auto *Node = Arena.create<TextualNode>(
+      NodeId++, true, NodeKind::TEXTUAL, Text, Text, Text, "",
+      mergebot::ts::Point{Row, 0}, "", std::string(Text), 0, 1, TUPath);
+  Node->seal();
+  return Node;
+}
+
+std::string matchedTo(const mergebot::sa::TwoWayMatching &Matching,
+                      const std::string &BaseText) {
+  auto It = std::find_if(
+      Matching.OneOneMatching.left.begin(), Matching.OneOneMatching.left.end(),
+      [&](const auto &Pair) { return Pair.first->DisplayName == BaseText; });
+  return It == Matching.OneOneMatching.left.end() ? ""
+                                                   : It->second->DisplayName;
+}
+} // namespace
+
+TEST(TextualMatcherTest, AlignSequences) {
+  using Aligned = std::vector<std::pair<uint32_t, uint32_t>>;
+  EXPECT_EQ(mergebot::sa::alignSequences({1, 2, 3, 4}, {1, 2, 9, 3, 4}),
+            Aligned({{0, 0}, {1, 1}, {2, 3}, {3, 4}}));
+  // the moved 5 is not an anchor crossing the others
+  EXPECT_EQ(mergebot::sa::alignSequences({5, 1, 2, 3}, {1, 2, 3, 5}),
+            Aligned({{1, 0}, {2, 1}, {3, 2}}));
+  // gaps of repeated keys only are aligned by LCS
+  EXPECT_EQ(mergebot::sa::alignSequences({7, 8, 7, 8}, {8, 7, 8}),
+            Aligned({{1, 0}, {2, 1}, {3, 2}}));
+  EXPECT_TRUE(mergebot::sa::alignSequences({}, {1, 2}).empty());
+}
+
+TEST(TextualMatcherTest, MatchesInStages) {
+  std::vector<SemanticNode *> BaseNodes = {
+      textual("#define kMaxLevels 7", 1),
+      textual("#define kL0_CompactionTrigger 4", 2),
+      textual("using SequenceNumber = uint64_t;", 3),
+      textual("kTypeDeletion = 0x0", 4),
+      textual("friend class VersionSet;", 5),
+      textual("typedef uint64_t SequenceNumber;", 1, "format.h"),
+  };
+  std::vector<SemanticNode *> RevisionNodes = {
+      textual("#define  kMaxLevels   7", 1),
+      textual("#define kL0_CompactionTrigger 8", 2),
+      textual("using SequenceNumber = std::uint64_t;", 3),
+      textual("kTypeDeletion = 0x0,", 4),
+      textual("kTypeValue = 0x1", 5),
+      textual("typedef uint64_t SequenceNumber;", 1, "dbformat.h"),
+  };
+
+  mergebot::sa::TwoWayMatching Matching;
+  mergebot::sa::TextualMatcher Matcher;
+  Matcher.match(Matching, BaseNodes, RevisionNodes);
+
+  EXPECT_EQ(matchedTo(Matching, "#define kMaxLevels 7"),
+            "#define  kMaxLevels   7");
+  EXPECT_EQ(matchedTo(Matching, "kTypeDeletion = 0x0"), "kTypeDeletion = 0x0,");
+  EXPECT_EQ(matchedTo(Matching, "#define kL0_CompactionTrigger 4"),
+            "#define kL0_CompactionTrigger 8");
+  EXPECT_EQ(matchedTo(Matching, "using SequenceNumber = uint64_t;"),
+            "using SequenceNumber = std::uint64_t;");
+  // never across TUs
+  EXPECT_EQ(matchedTo(Matching, "typedef uint64_t SequenceNumber;"), "");
+  EXPECT_EQ(Matching.OneOneMatching.size(), 4);
+  ASSERT_EQ(BaseNodes.size(), 2);
+  ASSERT_EQ(RevisionNodes.size(), 2);
+}